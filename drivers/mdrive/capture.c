@@ -0,0 +1,181 @@
+#include "mdrive.h"
+#include "capture.h"
+
+#include <errno.h>
+#include <fcntl.h>
+#include <sched.h>
+#include <stdio.h>
+#include <sys/mman.h>
+
+struct mdrive_capture {
+    struct mdrive_capture_header * header;
+    struct mdrive_capture_record * records;
+    size_t              size;           // Bytes mapped
+    int                 fd;
+    char                path[256];
+};
+
+/**
+ * mdrive_capture_start
+ *
+ * Starts capturing the traffic of the port into the ring file at [path],
+ * which is created (or truncated). The ring holds [slots] records, or
+ * MDRIVE_CAPTURE_SLOTS if zero. A capture already in progress on the port
+ * is stopped first.
+ *
+ * Returns:
+ * (int) 0 upon success, errno otherwise
+ */
+int
+mdrive_capture_start(mdrive_comm_device_t * comm, const char * path,
+        int slots) {
+    struct mdrive_capture * capture;
+    int status;
+
+    if (slots < 0 || path == NULL || *path == 0)
+        return EINVAL;
+    else if (slots == 0)
+        slots = MDRIVE_CAPTURE_SLOTS;
+
+    mdrive_capture_stop(comm);
+
+    capture = calloc(1, sizeof *capture);
+    if (capture == NULL)
+        return ENOMEM;
+
+    snprintf(capture->path, sizeof capture->path, "%s", path);
+    capture->size = sizeof *capture->header
+        + (size_t) slots * sizeof *capture->records;
+    capture->fd = open(path, O_RDWR | O_CREAT | O_TRUNC, 0644);
+    if (capture->fd < 0)
+        goto error;
+    if (ftruncate(capture->fd, capture->size))
+        goto error_close;
+
+    capture->header = mmap(NULL, capture->size, PROT_READ | PROT_WRITE,
+        MAP_SHARED, capture->fd, 0);
+    if (capture->header == MAP_FAILED)
+        goto error_close;
+    capture->records = (struct mdrive_capture_record *) (capture->header + 1);
+
+    memcpy(capture->header->magic, MDRIVE_CAPTURE_MAGIC,
+        sizeof capture->header->magic);
+    capture->header->slots = slots;
+    capture->header->record_size = sizeof *capture->records;
+    snprintf(capture->header->port, sizeof capture->header->port, "%s",
+        comm->name);
+
+    __atomic_store_n(&comm->capture, capture, __ATOMIC_SEQ_CST);
+    return 0;
+
+error_close:
+    status = errno;
+    close(capture->fd);
+    free(capture);
+    return status;
+
+error:
+    status = errno;
+    free(capture);
+    return status;
+}
+
+/**
+ * mdrive_capture_stop
+ *
+ * Stops the capture of the port, if any. Waits for the threads recording
+ * into the ring to finish, then unmaps and closes the file.
+ */
+void
+mdrive_capture_stop(mdrive_comm_device_t * comm) {
+    struct mdrive_capture * capture;
+
+    capture = __atomic_exchange_n(&comm->capture, NULL, __ATOMIC_SEQ_CST);
+    if (capture == NULL)
+        return;
+
+    while (__atomic_load_n(&comm->capture_users, __ATOMIC_SEQ_CST))
+        sched_yield();
+
+    munmap(capture->header, capture->size);
+    close(capture->fd);
+    free(capture);
+}
+
+/**
+ * mdrive_capture_path
+ *
+ * Retrieves the path of the ring file of the capture in progress on the
+ * port.
+ *
+ * Returns:
+ * (int) length of the path, 0 if the port is not captured
+ */
+int
+mdrive_capture_path(mdrive_comm_device_t * comm, char * path, int size) {
+    struct mdrive_capture * capture;
+    int length = 0;
+
+    __atomic_add_fetch(&comm->capture_users, 1, __ATOMIC_SEQ_CST);
+    capture = __atomic_load_n(&comm->capture, __ATOMIC_SEQ_CST);
+    if (capture)
+        length = snprintf(path, size, "%s", capture->path);
+    else if (size)
+        *path = 0;
+    __atomic_sub_fetch(&comm->capture_users, 1, __ATOMIC_RELEASE);
+
+    return length;
+}
+
+/**
+ * mdrive_capture
+ *
+ * Records a transfer of [length] bytes of [data] on the port, if captured.
+ * Both the sending threads and the receive thread record into the ring;
+ * each record is claimed by number, so the ring is not locked.
+ */
+void
+mdrive_capture(mdrive_comm_device_t * comm, enum mdrive_capture_kind kind,
+        char address, unsigned txid, const char * data, int length) {
+    struct mdrive_capture * capture;
+    struct mdrive_capture_record * record;
+    struct timespec now;
+    uint64_t number;
+    int chunk;
+
+    if (__atomic_load_n(&comm->capture, __ATOMIC_RELAXED) == NULL)
+        return;
+
+    __atomic_add_fetch(&comm->capture_users, 1, __ATOMIC_SEQ_CST);
+    capture = __atomic_load_n(&comm->capture, __ATOMIC_SEQ_CST);
+    if (capture == NULL)
+        goto out;
+
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    do {
+        chunk = (length > MDRIVE_CAPTURE_DATA) ? MDRIVE_CAPTURE_DATA : length;
+        number = __atomic_fetch_add(&capture->header->next, 1,
+            __ATOMIC_RELAXED);
+        record = &capture->records[number % capture->header->slots];
+
+        // Invalidate the slot while it is rewritten
+        __atomic_store_n(&record->number, 0, __ATOMIC_RELAXED);
+        __atomic_thread_fence(__ATOMIC_RELEASE);
+
+        record->time = now.tv_sec * 1000000000ULL + now.tv_nsec;
+        record->txid = txid;
+        record->speed = comm->speed;
+        record->kind = kind;
+        record->flags = (length > chunk) ? MDRIVE_CAPTURE_MORE : 0;
+        record->address = address;
+        record->length = chunk;
+        memcpy(record->data, data, chunk);
+
+        __atomic_store_n(&record->number, number + 1, __ATOMIC_RELEASE);
+        data += chunk;
+        length -= chunk;
+    } while (length > 0);
+
+out:
+    __atomic_sub_fetch(&comm->capture_users, 1, __ATOMIC_RELEASE);
+}
@@ -0,0 +1,78 @@
+#ifndef CAPTURE_H
+#define CAPTURE_H
+
+#include <stdint.h>
+
+/*
+ * The traffic of a port can be captured into a ring file, for replay with
+ * test/mdrive-replay. The file is mapped into memory, so that a capture
+ * costs a copy of the bytes into a slot and no system call. It is a header
+ * followed by fixed-size records. A record holds (part of) the bytes of one
+ * write to the port or one read from it, with the time (CLOCK_MONOTONIC)
+ * of the transfer. A transfer longer than a record continues in the next
+ * record of the same kind.
+ *
+ * Records are numbered from zero and are written to the slot of their
+ * number modulo the slots in the ring, overwriting the oldest. The number
+ * (plus one) is stored last in the record, so a record which is partially
+ * written, or which was overwritten, is told apart by its number.
+ *
+ * Writes record the address of the unit and the id of the transaction
+ * being sent. Reads, which are not yet matched to a transaction, record
+ * the last transaction id sent. A match record is written as each
+ * response is handed to the transaction it belongs to, with the response
+ * as parsed.
+ */
+#define MDRIVE_CAPTURE_MAGIC    "MDCAP01"
+#define MDRIVE_CAPTURE_SLOTS    65536       // Default size of the ring (4MB)
+#define MDRIVE_CAPTURE_DATA     36          // Bytes of data per record
+
+enum mdrive_capture_kind {
+    MDRIVE_CAPTURE_TX = 1,                  // Written to the port
+    MDRIVE_CAPTURE_RX,                      // Read from the port
+    MDRIVE_CAPTURE_MATCH,                   // Response handed to a
+                                            // transaction (0 if dropped)
+};
+
+// Flags of a record
+#define MDRIVE_CAPTURE_MORE     0x01        // Continued in the next record
+
+struct mdrive_capture_header {
+    char                magic[8];
+    uint32_t            slots;              // Records in the ring
+    uint32_t            record_size;
+    uint64_t            next;               // Number of the next record
+    char                port[32];           // Name of the port captured
+    char                reserved[8];
+};
+
+struct mdrive_capture_record {
+    uint64_t            number;             // Record number plus one
+    uint64_t            time;               // Nanoseconds (CLOCK_MONOTONIC)
+    uint32_t            txid;
+    uint32_t            speed;              // Baud rate of the port
+    uint8_t             kind;               // enum mdrive_capture_kind
+    uint8_t             flags;
+    char                address;            // Address of the unit
+    uint8_t             length;             // Bytes of data used
+    char                data[MDRIVE_CAPTURE_DATA];
+};
+
+#ifdef MDRIVE
+
+extern int
+mdrive_capture_start(mdrive_comm_device_t *, const char * path, int slots);
+
+extern void
+mdrive_capture_stop(mdrive_comm_device_t *);
+
+extern int
+mdrive_capture_path(mdrive_comm_device_t *, char * path, int size);
+
+extern void
+mdrive_capture(mdrive_comm_device_t *, enum mdrive_capture_kind, char address,
+    unsigned txid, const char * data, int length);
+
+#endif
+
+#endif
@@ -135,9 +135,324 @@ mdrive_set_echo(mdrive_device_t * device, echo_mode_t mode, bool force) {
     return false;
 }
 
+// Units found on a port, for moving all of them to another baud rate
+struct mdrive_bus_unit {
+    char                address;
+    int                 speed;          // Speed the unit listens at
+    int                 saved;          // BD saved on the unit (0 unknown)
+    int                 original;       // Speed the unit was found at
+    bool                rebooted;
+};
+
+static const char party_addresses[] =
+    "abcdefghijklmnopqrstuvwxyzABCDEFGHIJKLMNOPQRSTUVWXYZ0123456789";
+
+/**
+ * mdrive_config_unit
+ *
+ * Sets up [unit] as a stand-in device to talk to the unit at [address]
+ * listening at [speed] on the port, which need not be connected as an
+ * axis.
+ */
+static void
+mdrive_config_unit(mdrive_device_t * unit, mdrive_comm_device_t * comm,
+        char address, int speed) {
+    memset(unit, 0, sizeof *unit);
+    unit->comm = comm;
+    unit->address = address;
+    unit->party_mode = address != '!';
+    unit->speed = speed;
+}
+
+/**
+ * mdrive_config_probe
+ *
+ * Detects the unit at [address] listening at [speed]. Any reply counts,
+ * even a NACK from a unit expecting a checksum or the garbled reply of one
+ * in an unexpected echo mode.
+ *
+ * Returns:
+ * (bool) TRUE if the unit replied
+ */
+static bool
+mdrive_config_probe(mdrive_comm_device_t * comm, char address, int speed) {
+    mdrive_device_t unit;
+    mdrive_config_unit(&unit, comm, address, speed);
+    unit.ignore_errors = true;
+
+    // Time for the request and the first chars of the reply, and for the
+    // unit to get to it
+    mdrive_set_baudrate(comm, speed);
+    struct timespec timeout = { .tv_nsec = 5e6 + mdrive_xmit_time(comm, 16) };
+    struct mdrive_send_opts options = {
+        .expect_data = false,
+        .waittime = &timeout,
+        .tries = 1
+    };
+    int status = mdrive_communicate(&unit, "PR SN", &options);
+
+    return status != RESPONSE_TIMEOUT && status != RESPONSE_IOERROR;
+}
+
+/**
+ * mdrive_config_find_units
+ *
+ * Probes the party-mode addresses (or the unit not in party mode) not
+ * found yet at [speed].
+ *
+ * Returns:
+ * (int) number of units found so far and placed in [units]
+ */
+static int
+mdrive_config_find_units(mdrive_comm_device_t * comm, bool party_mode,
+        int speed, struct mdrive_bus_unit * units, int count) {
+    const char * address, * addresses = party_mode ? party_addresses : "!";
+    int i;
+
+    mcTraceF(20, MDRIVE_CHANNEL, "Looking for units at %d baud", speed);
+    for (address = addresses; *address; address++) {
+        for (i = 0; i < count; i++)
+            if (units[i].address == *address)
+                break;
+        if (i < count || !mdrive_config_probe(comm, *address, speed))
+            continue;
+
+        mcTraceF(20, MDRIVE_CHANNEL, "Found unit %c at %d baud", *address,
+            speed);
+        units[count++] = (struct mdrive_bus_unit) {
+            .address = *address,
+            .speed = speed,
+            .saved = speed,
+            .original = speed
+        };
+    }
+    return count;
+}
+
+/**
+ * mdrive_config_locate
+ *
+ * Finds where [unit] listens when it did not answer at the expected speed
+ * -- at its original speed, or any other.
+ *
+ * Returns:
+ * (bool) TRUE if found, in which case the BD saved is no longer known
+ */
+static bool
+mdrive_config_locate(mdrive_comm_device_t * comm,
+        struct mdrive_bus_unit * unit) {
+    const struct baud_rate * rate;
+
+    if (mdrive_config_probe(comm, unit->address, unit->original))
+        unit->speed = unit->original;
+    else {
+        for (rate = baud_rates; rate->human; rate++)
+            if (rate->human != unit->original
+                    && mdrive_config_probe(comm, unit->address, rate->human))
+                break;
+        if (!rate->human)
+            return false;
+        unit->speed = rate->human;
+    }
+    unit->saved = 0;
+    return true;
+}
+
+/**
+ * mdrive_config_move_units
+ *
+ * Moves the units to [speed], or back to their original speeds if
+ * [speed] is zero. The new BD is saved on every unit before any of them is
+ * rebooted, so a unit refusing the setting leaves the bus untouched. All
+ * the units listening at a speed are then rebooted together by a global
+ * ^C, and each is verified to answer at its new speed.
+ *
+ * Returns:
+ * (int) 0 upon success, EIO if a unit could not be moved or verified
+ */
+static int
+mdrive_config_move_units(mdrive_comm_device_t * comm,
+        struct mdrive_bus_unit * units, int count, int speed) {
+    const struct baud_rate * rate;
+    struct mdrive_bus_unit * unit;
+    mdrive_device_t device;
+    int want, status = 0;
+
+    for (unit = units; unit < units + count; unit++) {
+        want = speed ? speed : unit->original;
+        if (unit->saved == want || !unit->speed)
+            continue;
+
+        for (rate = baud_rates; rate->human; rate++)
+            if (rate->human == want)
+                break;
+
+        // Settings are left behind by earlier tries. Find them out first
+        mdrive_config_unit(&device, comm, unit->address, unit->speed);
+        if (mdrive_config_inspect(&device, false)
+                || !mdrive_config_rollback(&device)
+                || !mdrive_set_variable(&device, "BD", rate->setting)
+                || !mdrive_config_commit(&device, NULL)) {
+            mcTraceF(10, MDRIVE_CHANNEL, "Unit %c refused %d baud",
+                unit->address, want);
+            return EIO;
+        }
+        unit->saved = want;
+    }
+
+    for (rate = baud_rates; rate->human; rate++) {
+        for (unit = units; unit < units + count; unit++)
+            if (unit->speed == rate->human && unit->saved != unit->speed)
+                break;
+        if (unit == units + count)
+            continue;
+
+        // Reboot every unit listening at this speed at once, so that none
+        // is left behind at the old speed to receive garbage
+        mdrive_config_unit(&device, comm, (units->address == '!') ? '!' : '*',
+            rate->human);
+        mdrive_reboot(&device);
+
+        for (unit = units; unit < units + count; unit++) {
+            if (unit->speed == rate->human) {
+                unit->speed = unit->saved;
+                unit->rebooted = true;
+            }
+        }
+    }
+
+    for (unit = units; unit < units + count; unit++) {
+        if (!unit->speed) {
+            // Lost on the way
+            status = EIO;
+            continue;
+        }
+        mdrive_config_unit(&device, comm, unit->address, unit->speed);
+        if (mdrive_config_inspect(&device, false)) {
+            mcTraceF(10, MDRIVE_CHANNEL, "Unit %c not heard at %d baud",
+                unit->address, unit->speed);
+            unit->speed = 0;
+            status = EIO;
+        }
+    }
+    return status;
+}
+
+/**
+ * mdrive_config_bus_baudrate
+ *
+ * Moves all the units on the port to the highest baud rate from [highest]
+ * down to [lowest] that they all follow to. Zero stands for the fastest
+ * rate, and the slowest speed any unit was found at, respectively. Units cannot tell which rates
+ * they support, so the rates are tried in turn. After a failed try, the
+ * units are moved back to their original speeds before the next one. The
+ * axes connected through the port are updated to talk to their units at
+ * the speeds they end up at.
+ *
+ * Returns:
+ * (int) 0 upon success, ENODEV if no unit was found, EIO otherwise
+ */
+static int
+mdrive_config_bus_baudrate(mdrive_comm_device_t * comm, bool party_mode,
+        int highest, int lowest) {
+    struct mdrive_bus_unit units[sizeof party_addresses], * unit;
+    const struct baud_rate * rate;
+    mdrive_device_t * axis;
+    int count, status = EIO;
+
+    mdrive_port_reserve(comm);
+
+    // Look at the port speed first, where the units are expected
+    int speed = comm->speed;
+    count = mdrive_config_find_units(comm, party_mode, speed, units, 0);
+    for (rate = baud_rates; rate->human; rate++)
+        if (rate->human != speed)
+            count = mdrive_config_find_units(comm, party_mode, rate->human,
+                units, count);
+    if (count == 0) {
+        mcTraceF(10, MDRIVE_CHANNEL, "No units found on %s", comm->name);
+        mdrive_port_release(comm);
+        return ENODEV;
+    }
+
+    // Try from the fastest rate. Every unit is known to work at the
+    // slowest original speed, which has them all on one speed
+    if (lowest == 0)
+        for (unit = units, lowest = units->original; unit < units + count;
+                unit++)
+            if (unit->original < lowest)
+                lowest = unit->original;
+
+    for (rate = baud_rates; rate[1].human; rate++);
+    if (highest == 0)
+        highest = rate->human;
+    for (; rate >= baud_rates && status; rate--) {
+        if (rate->human > highest || rate->human < lowest)
+            continue;
+
+        status = mdrive_config_move_units(comm, units, count, rate->human);
+        if (status == 0) {
+            mcTraceF(10, MDRIVE_CHANNEL, "%d units on %s moved to %d baud",
+                count, comm->name, rate->human);
+            comm->negotiated = rate->human;
+            break;
+        }
+
+        // Back to where they were. Units not heard have to be found first
+        for (unit = units; unit < units + count; unit++) {
+            if (!unit->speed && !mdrive_config_locate(comm, unit))
+                mcTraceF(1, MDRIVE_CHANNEL, "CRITICAL: Unit %c lost",
+                    unit->address);
+        }
+        if (mdrive_config_move_units(comm, units, count, 0)) {
+            mcTraceF(1, MDRIVE_CHANNEL,
+                "CRITICAL: Units on %s could not be moved back", comm->name);
+            break;
+        }
+    }
+
+    for (axis = comm->axes; axis; axis = axis->next_axis) {
+        for (unit = units; unit < units + count; unit++) {
+            if (unit->address != axis->address || !unit->speed)
+                continue;
+            axis->speed = unit->speed;
+            if (unit->rebooted)
+                mdrive_config_after_reboot(axis);
+        }
+    }
+
+    mdrive_port_release(comm);
+    return status;
+}
+
+/**
+ * mdrive_config_negotiate_baudrate
+ *
+ * Moves all the units on the port of [device] to the highest baud rate
+ * they all support (@auto speed in the connection string). This is only
+ * done once for the port. Other axes connecting later with @auto will use
+ * the negotiated speed.
+ *
+ * Returns:
+ * (int) 0 upon success, errno otherwise. Units are left at their original
+ * speeds upon failure
+ */
+int
+mdrive_config_negotiate_baudrate(mdrive_device_t * device) {
+    mdrive_comm_device_t * comm = device->comm;
+
+    if (comm->negotiated) {
+        device->speed = comm->negotiated;
+        return 0;
+    }
+
+    return mdrive_config_bus_baudrate(comm, device->party_mode, 0, 0);
+}
+
 int
 mdrive_config_set_baudrate(mdrive_device_t * device, int speed) {
     const struct baud_rate * selected;
+    int status;
 
     for (selected=baud_rates; selected->setting; selected++)
         if (speed == selected->human)
@@ -146,6 +461,14 @@ mdrive_config_set_baudrate(mdrive_device_t * device, int speed) {
         // Unsupported baud rate setting
         return ENOTSUP;
 
+    if (device->party_mode) {
+        // Other units might share the port. Move all of them together, so
+        // that the bus is not left split across two speeds
+        status = mdrive_config_bus_baudrate(device->comm, true, speed, speed);
+        mcDriverCacheInvalidate(device->driver);
+        return status;
+    }
+
     // Make sure we don't save anything unexpected
     mdrive_config_rollback(device);
 
@@ -192,7 +515,7 @@ mdrive_config_set_address(mdrive_device_t * device, char address) {
     if (!mdrive_set_variable_string(device, "DN", quoted_addr))
         return -EIO;
 
-    device->address = address;
+    mdrive_set_address(device, address);
 
     if (!device->party_mode) {
         if (RESPONSE_OK != mdrive_send(device, "PY=1\n"))
@@ -246,6 +569,41 @@ mdrive_config_inspect_echo(mdrive_device_t * device) {
     return EIO;
 }
 
+/**
+ * mdrive_config_wire
+ *
+ * Configures the echo (EM) and checksum (CK) modes of the unit after the
+ * wire profile of the device:
+ *
+ * FAST (EM=1, CK=1) costs the fewest bytes per request which still have
+ * every request acknowledged (ACK or NACK) and the data returned
+ * checksummed, which mdrive_classify_response relies on. The unit does
+ * not echo the request, and commands are answered with a single ACK.
+ * (Units in quiet mode, EM=2, don't acknowledge commands even in checksum
+ * mode.)
+ *
+ * PLAIN (EM=0, CK=0) has the unit echo the requests and send the prompts,
+ * as for a terminal -- the settings left on the unit when disconnected.
+ *
+ * KEEP leaves the unit as found.
+ *
+ * Returns:
+ * (bool) TRUE upon success, FALSE otherwise
+ */
+bool
+mdrive_config_wire(mdrive_device_t * device) {
+    switch (device->wire_profile) {
+        case MDRIVE_WIRE_FAST:
+            return mdrive_set_echo(device, EM_PROMPT, false)
+                && mdrive_set_checksum(device, CK_ON, false);
+        case MDRIVE_WIRE_PLAIN:
+            return mdrive_set_checksum(device, CK_OFF, false)
+                && mdrive_set_echo(device, EM_ON, false);
+        default:
+            return true;
+    }
+}
+
 int
 mdrive_config_inspect(mdrive_device_t * device, bool set) {
     // The CK and EM settings are sort of interdependent in that until both
@@ -268,11 +626,9 @@ mdrive_config_inspect(mdrive_device_t * device, bool set) {
     if (mdrive_config_inspect_echo(device))
         return EIO;
 
-    // Configure motor in best performance mode for this driver
-    if (set) {
-        mdrive_set_echo(device, EM_PROMPT, false);
-        mdrive_set_checksum(device, CK_ON, false);
-    }
+    // Configure motor after the wire profile of the connection
+    if (set)
+        mdrive_config_wire(device);
 
     // Inspect ES setting (for E-stop)
 
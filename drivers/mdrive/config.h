@@ -35,12 +35,18 @@ mdrive_set_checksum(mdrive_device_t * device, checksum_mode_t mode, bool);
 extern bool
 mdrive_set_echo(mdrive_device_t * device, echo_mode_t mode, bool);
 
+extern bool
+mdrive_config_wire(mdrive_device_t * device);
+
 extern int
 mdrive_config_inspect(mdrive_device_t * device, bool);
 
 extern int
 mdrive_config_set_baudrate(mdrive_device_t * device, int speed);
 
+extern int
+mdrive_config_negotiate_baudrate(mdrive_device_t * device);
+
 extern int
 mdrive_config_set_address(mdrive_device_t * device, char address);
 
@@ -8,6 +8,7 @@
 #include "events.h"
 #include "firmware.h"
 #include "microcode.h"
+#include "search.h"
 
 #include <stdio.h>
 #include <time.h>
@@ -29,13 +30,27 @@ int MDRIVE_CHANNEL, MDRIVE_CHANNEL_TX, MDRIVE_CHANNEL_RX,
  * where the [mdrive://] portion has already been removed by the
  * higher-level driver controller. The speed will default to 9600 if
  * unspecified, and the address [:a] will default to none if unspecified.
+ *
+ * With a speed of @auto, all the units on the port are moved to the
+ * highest baud rate they all support when the port is first opened (see
+ * mdrive_config_negotiate_baudrate).
+ *
+ * The echo and checksum modes the unit is configured with can be selected
+ * with a trailing ?profile=fast (the default), ?profile=plain or
+ * ?profile=keep (see mdrive_config_wire).
  */
 int mdrive_init(Driver * self, const char * cxn) {
     static regex_t re_cxn;
     // XXX: Allow leading / trailing whitespace ?
-    static const char * regex = "^([^@:]+)(@[0-9]+)?(:[*!a-zA-Z0-9^])?$";
+    static const char * regex =
+        "^([^@:?]+)(@[0-9]+|@auto)?(:[*!a-zA-Z0-9^])?(\\?profile=[a-z]+)?$";
+    static const char * profiles[] = {
+        [MDRIVE_WIRE_FAST] = "fast",
+        [MDRIVE_WIRE_PLAIN] = "plain",
+        [MDRIVE_WIRE_KEEP] = "keep",
+    };
 
-    regmatch_t matches[4];
+    regmatch_t matches[5];
     mdrive_address_t address;
     int status;
 
@@ -48,7 +63,7 @@ int mdrive_init(Driver * self, const char * cxn) {
     if (!re_cxn.re_nsub)
         regcomp(&re_cxn, regex, REG_EXTENDED);
 
-    if ((status = regexec(&re_cxn, cxn, 4, matches, 0) != 0)) {
+    if ((status = regexec(&re_cxn, cxn, 5, matches, 0) != 0)) {
         // XXX: Set error condition somewhere
         mcTraceF(10, MDRIVE_CHANNEL, "Bad connection string: %d", status);
         return EINVAL;
@@ -63,12 +78,31 @@ int mdrive_init(Driver * self, const char * cxn) {
     else
         address.address = '!';
 
-    if (matches[2].rm_so > 0)
+    bool negotiate = false;
+    if (matches[2].rm_so > 0 && cxn[matches[2].rm_so + 1] == 'a') {
+        // Units are found at whatever speed they are at
+        negotiate = true;
+        address.speed = DEFAULT_PORT_SPEED;
+    }
+    else if (matches[2].rm_so > 0)
         address.speed = strtol(cxn + matches[2].rm_so + 1, NULL, 10);
     else
         address.speed = DEFAULT_PORT_SPEED;
 
     mdrive_device_t * device = self->internal;
+    if (matches[4].rm_so > 0) {
+        const char * profile = cxn + matches[4].rm_so + strlen("?profile=");
+        int i;
+        for (i = 0; i < MDRIVE_WIRE_PROFILES; i++)
+            if (strcmp(profile, profiles[i]) == 0)
+                break;
+        if (i == MDRIVE_WIRE_PROFILES) {
+            mcTraceF(10, MDRIVE_CHANNEL, "Bad wire profile: %s", profile);
+            return EINVAL;
+        }
+        device->wire_profile = i;
+    }
+
     if (mdrive_connect(&address, device) != 0)
         // XXX: Set some error indication (or set it in mdrive_connect)
         return -1;
@@ -79,6 +113,11 @@ int mdrive_init(Driver * self, const char * cxn) {
     // Link the motor back to the driver (for event callbacks, etc.)
     device->driver = self;
 
+    if (negotiate)
+        // A failure leaves the units at their speeds, which might still
+        // allow talking to this one
+        mdrive_config_negotiate_baudrate(device);
+
     // XXX: Move to mdrive_connect
     if (mdrive_config_inspect(device, true))
         return ER_COMM_FAIL;
@@ -98,6 +137,7 @@ void mdrive_uninit(Driver * self) {
 
     mdrive_disconnect(motor);
 
+    free(motor->microcode.program);
     free(self->internal);
 }
 
@@ -146,30 +186,42 @@ int mdrive_reset(Driver * self) {
     return mdrive_reboot(device);
 }
 
+// Connection strings packed by mdrive_search
+struct mdrive_search_buffer {
+    char *              cxns;
+    int                 size;
+};
+
+static void
+mdrive_search_pack(const mdrive_address_t * address, void * arg) {
+    struct mdrive_search_buffer * buffer = arg;
+    int wr;
+
+    if (buffer->size <= 0)
+        return;
+    else if (address->address)
+        wr = snprintf(buffer->cxns, buffer->size, "%s@%d:%c",
+            address->port, address->speed, address->address);
+    else
+        wr = snprintf(buffer->cxns, buffer->size, "%s@%d",
+            address->port, address->speed);
+    buffer->size -= ++wr;
+    buffer->cxns += wr;
+}
+
 int
 mdrive_search(char * cxns, int size) {
     char ** port = mdrive_enum_serial_ports(), ** port_head=port;
-    mdrive_address_t * results, * head;
-    int count = 0, wr;
-
-    while (*port) {
-        head = results = mdrive_enum_motors_on_port(*port);
-        while (results->speed) {
-            if (results->address)
-                wr = snprintf(cxns, size, "%s@%d:%c",
-                    results->port, results->speed, results->address);
-            else
-                wr = snprintf(cxns, size, "%s@%d",
-                    results->port, results->speed);
-            results++;
-            count++;
-            size -= ++wr;
-            cxns += wr;
-        }
-        free(head);
-        free(*port);
-        port++;
-    }
+    struct mdrive_search_buffer buffer = { .cxns = cxns, .size = size };
+    int count;
+
+    if (port == NULL)
+        return 0;
+
+    count = mdrive_search_ports(port_head, 0, mdrive_search_pack, &buffer);
+
+    while (*port)
+        free(*port++);
     free(port_head);
     return count;
 }
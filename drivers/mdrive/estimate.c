@@ -0,0 +1,181 @@
+#include "mdrive.h"
+#include "estimate.h"
+
+#include "motion.h"
+#include "poller.h"
+#include "serial.h"
+
+#include <errno.h>
+#include <math.h>
+#include <stdlib.h>
+#include <time.h>
+
+// XXX: Use a stinkin' header file include
+extern long long nsecDiff(struct timespec *, struct timespec *);
+
+/*
+ * The position of an axis can be estimated without a round-trip, from the
+ * last position confirmed by the unit and the travel planned for the move
+ * in progress (see kinematics.h). The position is confirmed by reads of
+ * the unit made by the driver anyway -- reads of the position, the rest
+ * position read when a move completes and the samples of the status
+ * poller.
+ *
+ * The estimate comes with a bound on its error: the distance traveled
+ * over the latency of the unit (the start of the move is only known that
+ * well), and, while the plan still has travel left, the error of the plan
+ * at the last confirmed position. If a correction period is set, the unit
+ * is read when the last confirmed position is older than it.
+ */
+
+static double
+seconds(struct timespec * a, struct timespec * b) {
+    return nsecDiff(a, b) / 1e9;
+}
+
+/**
+ * mdrive_estimate_travel
+ *
+ * Travel planned (steps) for the current move of the device [t] seconds
+ * into it, and the velocity (steps per second) then. Slews are planned as
+ * a ramp up to the slew rate, held indefinitely.
+ */
+static double
+mdrive_estimate_travel(mdrive_device_t * device, double t, double * velocity) {
+    struct motion_details * move = &device->movement;
+    kinematics_t slew, * plan = &move->plan;
+    double urevs;
+
+    if (move->type == MCSLEW) {
+        if (kinematics_plan(&slew, HUGE_VAL, device->profile.vstart.value,
+                llabs(move->urevs), device->profile.accel.value,
+                device->profile.decel.value))
+            return *velocity = 0;
+        plan = &slew;
+    }
+
+    urevs = kinematics_position(plan, t);
+    *velocity = kinematics_velocity(plan, t);
+    *velocity = mdrive_microrevs_to_steps(device, llround(*velocity));
+    if (move->urevs < 0)
+        urevs = -urevs;
+
+    return mdrive_microrevs_to_steps(device, llround(urevs));
+}
+
+/**
+ * mdrive_estimate_confirm
+ *
+ * Records [position] (steps) as read from the unit just now, [rested] if
+ * the unit was read at rest too.
+ */
+void
+mdrive_estimate_confirm(mdrive_device_t * device, int position,
+        bool rested) {
+    clock_gettime(CLOCK_REALTIME, &device->estimate.confirmed);
+    device->estimate.position = position;
+    if (rested)
+        device->estimate.rested = device->estimate.confirmed;
+}
+
+/**
+ * mdrive_estimate_lost
+ *
+ * Notes that the position of the unit cannot be told from the confirmed
+ * one, until the unit is read at rest. Called when the unit is stopped or
+ * stalled, or set moving other than by mdrive_move (homing, executing a
+ * label or setting a variable), where no travel is planned.
+ */
+void
+mdrive_estimate_lost(mdrive_device_t * device) {
+    clock_gettime(CLOCK_REALTIME, &device->estimate.lost);
+}
+
+/**
+ * mdrive_estimate_position
+ *
+ * Estimates the current position of the device, and the bound on the
+ * error of the estimate (both in steps). The newer of the position last
+ * confirmed and the last status polled is used as the starting point. The
+ * unit is only read if it is due for correction, or if its position was
+ * lost and the unit not read at rest since. The position and velocity are
+ * read together, so that a unit still moving on its own is read again at
+ * the next estimate.
+ *
+ * Returns:
+ * (int) 0 upon success, EIO if the unit had to be, and could not be, read
+ */
+int
+mdrive_estimate_position(mdrive_device_t * device, int * position,
+        int * error) {
+    struct mdrive_estimate * e = &device->estimate;
+    struct motion_details * move = &device->movement;
+    struct mdrive_status sample;
+    struct timespec now, anchored;
+    double travel, anchor_travel, velocity, unused;
+    int anchor, P, V;
+    const char * variables[] = { "P", "V" };
+    int * values[] = { &P, &V };
+    bool unknown, due;
+
+    clock_gettime(CLOCK_REALTIME, &now);
+
+    // Start from the most recent position read
+    anchored = e->confirmed;
+    anchor = e->position;
+    if (mdrive_poller_sample(device, &sample)
+            && nsecDiff(&sample.taken, &anchored) > 0) {
+        anchored = sample.taken;
+        anchor = sample.position;
+        if (!sample.moving && sample.velocity == 0)
+            e->rested = sample.taken;
+    }
+
+    // Read the unit if due for correction, or if it was set moving
+    // somewhere unknown and not seen at rest since
+    unknown = anchored.tv_sec == 0 || nsecDiff(&e->lost, &e->rested) >= 0;
+    due = e->correction
+        && nsecDiff(&now, &anchored) > e->correction * 1000000LL;
+    if (due || (unknown && !move->moving)) {
+        if (mdrive_get_integers(device, variables, values, 2))
+            return EIO;
+        mdrive_estimate_confirm(device, P, V == 0);
+        anchored = e->confirmed;
+        anchor = P;
+
+        if (V != 0 && !move->moving) {
+            // Moving on its own, with no travel planned. Count the distance
+            // traveled over the latency of the read
+            *position = P;
+            *error = abs(V) * (device->stats.latency / 1e9);
+            return 0;
+        }
+    }
+
+    if (!move->moving) {
+        // At rest, where last read
+        *position = anchor;
+        *error = 0;
+        return 0;
+    }
+
+    travel = mdrive_estimate_travel(device, seconds(&now, &move->start),
+        &velocity);
+    *error = fabs(velocity) * device->stats.latency / 1e9;
+
+    if (nsecDiff(&anchored, &move->start) < 0) {
+        // Not read since the start of the move
+        *position = move->pstart + travel;
+        return 0;
+    }
+
+    // Read during the move. Carry the read position along the plan, and
+    // count the error of the plan then, if the plan has travel left
+    anchor_travel = mdrive_estimate_travel(device,
+        seconds(&anchored, &move->start), &unused);
+    *position = anchor + travel - anchor_travel;
+    if (travel != anchor_travel)
+        *error += abs(anchor - (move->pstart + (int) anchor_travel));
+
+    return 0;
+}
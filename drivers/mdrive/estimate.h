@@ -0,0 +1,8 @@
+extern void
+mdrive_estimate_confirm(mdrive_device_t *, int position, bool rested);
+
+extern void
+mdrive_estimate_lost(mdrive_device_t *);
+
+extern int
+mdrive_estimate_position(mdrive_device_t *, int * position, int * error);
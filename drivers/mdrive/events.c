@@ -3,6 +3,7 @@
 #include "events.h"
 
 #include "config.h"
+#include "estimate.h"
 #include "serial.h"
 
 #include <errno.h>
@@ -123,6 +124,7 @@ mdrive_signal_error_event(mdrive_device_t * device, int error) {
             mdrive_send(device, "ST");
             // Device is no longer moving
             device->movement.moving = false;
+            mdrive_estimate_lost(device);
             break;
         
         case MDRIVE_EDEADBAND:  // 92
@@ -218,11 +220,9 @@ mdrive_signal_event(mdrive_device_t * device, int code, union event_data * data)
  * from the async receive thread that will receive events for multiple
  * devices in party mode.
  *
- * The routine will query mcEnumDrivers from the connected mcontrol library
- * in order to get all active instances of the mdrive device driver. For
- * each, the ->name member will be queried against the address indicated.
- * For the driver that matches, the mdrive_signal_event routine will be
- * called to trigger the event.
+ * The axis is looked up by [address] in the address table of the port
+ * (kept by mdrive_connect, mdrive_disconnect and mdrive_set_address), so
+ * that delivery does not depend on the number of motors in the process.
  *
  * Parameters:
  * event - (int) event code to signal -- use mdrive_error_to_event() to
@@ -235,22 +235,10 @@ mdrive_signal_event(mdrive_device_t * device, int code, union event_data * data)
 int
 mdrive_signal_event_device(mdrive_comm_device_t * comm, char address,
         int event) {
-    Driver * d;
-    mdrive_device_t * device;
-    void * handle;
-    handle = mcEnumDrivers();
+    mdrive_device_t * device = mdrive_axis_at(comm, address);
 
-    while (true) {
-        d = mcEnumDriversNext(&handle);
-        if (!d || !d->class || !d->class->name)
-            break;
-
-        if (strcmp(d->class->name, "mdrive") == 0) {
-            device = d->internal;
-            if (device->address == address)
-                return mdrive_signal_event(device, event, NULL);
-        }
-    }
+    if (device == NULL)
+        return EINVAL;
 
-    return EINVAL;
+    return mdrive_signal_event(device, event, NULL);
 }
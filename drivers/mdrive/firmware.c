@@ -2,32 +2,213 @@
 
 #include "config.h"
 #include "driver.h"
+#include "events.h"
 #include "serial.h"
 
 #include <ctype.h>
 #include <errno.h>
+#include <fcntl.h>
 #include <stdio.h>
+#include <stdlib.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
 #include <time.h>
 
-int
-mdrive_firmware_write(mdrive_device_t * device, const char * filename) {
-    static const struct timespec wait = { .tv_sec = 3 };
+// XXX: Use a stinkin' header file include
+extern long long nsecDiff(struct timespec *, struct timespec *);
 
-    mcTraceF(10, MDRIVE_CHANNEL, "Loading firmware from: %s", filename);
-    
-    // Attempt to open firmware file before switching into upgrade mode
-    FILE * file = fopen(filename, "rt");
-    if (file == NULL) {
-        switch (errno) {
+// Records kept in flight while burning, at most. The bootloader answers
+// each record with an ACK or NACK once it is flashed
+#define MDRIVE_FIRMWARE_WINDOW 4
+
+// Longest record sent (with the CR and null)
+#define MDRIVE_FIRMWARE_RECORD 64
+
+// Records of a firmware file, as sent to the unit
+struct mdrive_firmware {
+    char                (*records)[MDRIVE_FIRMWARE_RECORD];
+    const char **       lines;
+    int                 count;
+    struct timespec     started;        // Start of the burn
+    mdrive_device_t *   device;
+};
+
+/**
+ * mdrive_firmware_hex
+ *
+ * Returns:
+ * (int) value of the hex byte at [text]
+ */
+static int
+mdrive_firmware_hex(const char * text) {
+    int high = isdigit(text[0]) ? text[0] - '0' : toupper(text[0]) - 'A' + 10,
+        low = isdigit(text[1]) ? text[1] - '0' : toupper(text[1]) - 'A' + 10;
+
+    return (high << 4) | low;
+}
+
+/**
+ * mdrive_firmware_parse
+ *
+ * Reads the Intel-HEX records of a firmware file into memory, before the
+ * unit is put into upgrade mode, and checks them: each record must be as
+ * long as its byte count says and its bytes must sum to zero. The file is
+ * mapped rather than read a char at a time. Records of type "03" are not
+ * sent to the unit, and are skipped.
+ *
+ * Data format of a record (without '|' chars):
+ * :|10|1EB8|00|0C94A54642E00C94C1430E9468452801|51
+ * ^ ^^ ^-+^ ^^ ^--------- payload ------------^ ^^
+ * |  |   |  record-type                      checksum
+ * |  |   address
+ * |  byte-count (2-char, hex byte)
+ * address (1-char ':')
+ *
+ * Returns:
+ * (int) 0 upon success, ER_BAD_FILE if the file does not exist or a record
+ * is malformed, errno otherwise
+ */
+static int
+mdrive_firmware_parse(const char * filename, struct mdrive_firmware * image) {
+    struct stat info;
+    const char * text, * end, * eol, * ch;
+    char * record;
+    int fd, length, lines = 1, i;
+    unsigned char sum;
+
+    fd = open(filename, O_RDONLY);
+    if (fd < 0 || fstat(fd, &info)) {
+        int error = errno;
+        if (fd >= 0)
+            close(fd);
+        switch (error) {
             case ENOENT:
             case EISDIR:
             case ENAMETOOLONG:
             case ENOTDIR:
                 return ER_BAD_FILE;
             default:
-                return errno;
+                return error;
+        }
+    }
+    if (!S_ISREG(info.st_mode) || info.st_size == 0) {
+        close(fd);
+        return ER_BAD_FILE;
+    }
+
+    text = mmap(NULL, info.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (text == MAP_FAILED)
+        return errno;
+    end = text + info.st_size;
+
+    for (ch = text; ch < end; ch++)
+        if (*ch == '\n')
+            lines++;
+
+    image->records = malloc(lines * sizeof *image->records);
+    image->lines = malloc(lines * sizeof *image->lines);
+    image->count = 0;
+    if (!image->records || !image->lines) {
+        munmap((void *) text, info.st_size);
+        return ENOMEM;
+    }
+
+    for (lines = 1; text < end; text = eol + 1, lines++) {
+        eol = memchr(text, '\n', end - text);
+        if (eol == NULL)
+            eol = end;
+
+        // Only accept ':' and hex chars
+        record = image->records[image->count];
+        for (length = 0, ch = text; ch < eol; ch++) {
+            if (!(*ch == ':' || isxdigit(*ch)))
+                continue;
+            else if (length == MDRIVE_FIRMWARE_RECORD - 2)
+                goto bad_record;
+            record[length++] = *ch;
+        }
+
+        // Skip blank lines
+        if (length == 0)
+            continue;
+
+        if (length < 11 || record[0] != ':' || length % 2 == 0
+                || length != 11 + 2 * mdrive_firmware_hex(record + 1))
+            goto bad_record;
+        for (sum = 0, i = 1; i < length; i += 2) {
+            if (!isxdigit(record[i]) || !isxdigit(record[i + 1]))
+                goto bad_record;
+            sum += mdrive_firmware_hex(record + i);
         }
+        if (sum)
+            goto bad_record;
+
+        // Skip records of type "03"
+        if (record[7] == '0' && record[8] == '3')
+            continue;
+
+        // Add carriage return and null-terminate
+        record[length++] = '\r';
+        record[length] = 0;
+        image->lines[image->count] = record;
+        image->count++;
     }
+    munmap((void *) (end - info.st_size), info.st_size);
+
+    mcTraceF(20, MDRIVE_CHANNEL_FW, "Read %d records", image->count);
+    return 0;
+
+bad_record:
+    mcTraceF(10, MDRIVE_CHANNEL_FW, "Bad record on line %d", lines);
+    munmap((void *) (end - info.st_size), info.st_size);
+    free(image->records);
+    free(image->lines);
+    return ER_BAD_FILE;
+}
+
+/**
+ * mdrive_firmware_progress
+ *
+ * Called as records are acknowledged by the unit. Traces the progress of
+ * the burn and signals it to the EV_FIRMWARE subscribers of the unit.
+ */
+static void
+mdrive_firmware_progress(struct mdrive_stream * stream, void * arg) {
+    struct mdrive_firmware * image = arg;
+    struct timespec now;
+    long long elapsed;
+
+    if (stream->acked % 25 && stream->acked != stream->count)
+        return;
+
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    elapsed = nsecDiff(&now, &image->started);
+    union event_data data = { .firmware = {
+        .lines = stream->acked,
+        .total = stream->count,
+        .rate = elapsed ? stream->acked * 1000000000LL / elapsed : 0,
+        .resent = stream->resent
+    } };
+
+    mcTraceF(20, MDRIVE_CHANNEL_FW, "Burned %d of %d records, %u lines/s",
+        stream->acked, stream->count, data.firmware.rate);
+    mdrive_signal_event(image->device, EV_FIRMWARE, &data);
+}
+
+int
+mdrive_firmware_write(mdrive_device_t * device, const char * filename) {
+    static const struct timespec wait = { .tv_sec = 3 };
+    struct mdrive_firmware image = { .device = device };
+    int status;
+
+    mcTraceF(10, MDRIVE_CHANNEL, "Loading firmware from: %s", filename);
+    
+    // Read and check the firmware file before switching into upgrade mode
+    status = mdrive_firmware_parse(filename, &image);
+    if (status)
+        return status;
+
     mcTraceF(20, MDRIVE_CHANNEL_FW, "Entering firmware upgrade mode");
 
     // Put device in upgrade mode
@@ -53,10 +234,12 @@ mdrive_firmware_write(mdrive_device_t * device, const char * filename) {
     mdrive_reboot(device);
 
     // Ensure the device is in upgrade mode
-    if (!device->upgrade_mode)
-        return EIO;
+    if (!device->upgrade_mode) {
+        status = EIO;
+        goto finish;
+    }
 
-    // Prepare options for sending firmware lines
+    // Prepare options for sending the magic codes
     mdrive_response_t result;
     struct mdrive_send_opts options = {
         .result = &result,      // Capture the received result
@@ -64,7 +247,8 @@ mdrive_firmware_write(mdrive_device_t * device, const char * filename) {
         .expect_err = true,     // Handle error condition here
         .waittime = &wait,      // For magic wait prescribed time
         .tries = 1,             // Don't retry
-        .raw = true             // Don't add EOL
+        .raw = true,            // Don't add EOL
+        .priority = MDRIVE_PRIORITY_BULK
     };
 
     // TODO: Split firmware load into two parts, the first will read the
@@ -80,82 +264,41 @@ mdrive_firmware_write(mdrive_device_t * device, const char * filename) {
     // :e -- Enter into programming mode
     char * magic_codes[] =
         { ":IMSInc\r", "::v\r", "::c\r", "::p\r", "::s\r", "::e\r", NULL };
-    struct timespec waittime = { .tv_nsec=15e6 },
-        longer = { .tv_nsec=250e6 };
+    struct timespec waittime = { .tv_nsec=15e6 };
     for (char ** magic = magic_codes; *magic; magic++) {
-        do {
+        result.ack = false;
+        mdrive_communicate(device, *magic, &options);
+        // Give the unit a moment before trying again
+        while (!result.ack) {
             nanosleep(&waittime, NULL);
-            result.ack = false;
             mdrive_communicate(device, *magic, &options);
-        } while (!result.ack);
-    }
-
-    // Use default timeout algorithm when sending firmware lines
-    options.waittime = NULL;
-    // Read data from the input file
-    char ch, buffer[64], *pBuffer;
-    int tries, line=0;
-    do {
-        // Reset the buffer position (for file reads)
-        pBuffer = buffer;
-
-        while (true) {
-            ch = getc(file);
-            if (ch == '\n' || ch == EOF)
-                break;
-            // Only accept ':' and hex chars
-            else if (!(ch == ':' || isxdigit(ch)))
-                continue;
-
-            *pBuffer++ = ch;
-        }
-
-        // Skip blank lines
-        if (pBuffer - buffer == 0)
-            continue;
-
-        // Data format of the buffer (without '|' chars):
-        // :|10|1EB8|00|0C94A54642E00C94C1430E9468452801|51
-        // ^ ^^ ^-+^ ^^ ^--------- payload ------------^ ^^
-        // |  |   |  record-type                   checksum (?)
-        // |  |   address
-        // |  byte-count (2-char, hex byte)
-        // address (1-char ':')
-
-        // Skip records of type "03"
-        else if (buffer[7] == '0' && buffer[8] == '3')
-            continue;
-
-        // Add carriage return and null-terminate
-        *pBuffer++ = '\r';
-        *pBuffer = 0;
-
-        // Increment the line counter
-        if (++line % 25 == 0)
-            mcTraceF(20, MDRIVE_CHANNEL_FW, "Burning block %d", line);
-
-        // Retry the send until we get a clear ACK from the unit. Even
-        // though the unit is not in checksum mode, it will respond with an
-        // ACK or NACK char to indicate receipt of the record.
-        tries = 3;    // Three tries max
-        while (true) {
-            nanosleep(&waittime, NULL);
-            result.ack = false;
-            mdrive_communicate(device, buffer, &options);
-            if (result.ack)
-                break;
-            else if (tries-- > 0) {
-                nanosleep(&longer, NULL);
-                waittime.tv_nsec += 1e6;
-            }
-            else
-                return EIO;
         }
+    }
 
-    } while (ch != EOF);
-    fclose(file);
+    // Burn the records, several in flight. Even though the unit is not in
+    // checksum mode, it will respond with an ACK or NACK char to indicate
+    // receipt of each record
+    struct mdrive_stream stream = {
+        .lines = image.lines,
+        .count = image.count,
+        .window = MDRIVE_FIRMWARE_WINDOW,
+        .tries = 4,
+        .progress = mdrive_firmware_progress,
+        .arg = &image
+    };
+    clock_gettime(CLOCK_MONOTONIC, &image.started);
+    status = mdrive_stream(device, &stream);
+    if (status) {
+        mcTraceF(10, MDRIVE_CHANNEL_FW, "Unable to burn record %d",
+            stream.acked);
+        goto finish;
+    }
 
-    mcTraceF(30, MDRIVE_CHANNEL_FW, "Completed. Rebooting");
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    mcTraceF(30, MDRIVE_CHANNEL_FW, "Completed %d records in %lldms "
+        "(%d resent). Rebooting", stream.acked,
+        nsecDiff(&now, &image.started) / 1000000, stream.resent);
 
     // Restore error handling
     device->ignore_errors = false;
@@ -170,8 +313,10 @@ mdrive_firmware_write(mdrive_device_t * device, const char * filename) {
     // Reboot the motor (again)
     mdrive_reboot(device);
 
-    if (device->upgrade_mode)
-        return EIO;
+    if (device->upgrade_mode) {
+        status = EIO;
+        goto finish;
+    }
 
     mcTraceF(30, MDRIVE_CHANNEL_FW, "Firmware upgrade is successful");
 
@@ -184,7 +329,7 @@ mdrive_firmware_write(mdrive_device_t * device, const char * filename) {
         device->speed = DEFAULT_PORT_SPEED;
 
     mdrive_config_inspect(device, true);
-    device->address = '!';
+    mdrive_set_address(device, '!');
 
     // Invalidate driver cache so that a request on the original connection
     // string that hit this motor will not be reused
@@ -192,7 +337,11 @@ mdrive_firmware_write(mdrive_device_t * device, const char * filename) {
 
     // Clear cached firmware version
     bzero(device->firmware_version, sizeof device->firmware_version);
-    return 0;
+
+finish:
+    free(image.records);
+    free(image.lines);
+    return status;
 }
 
 int
@@ -237,7 +386,8 @@ mdrive_check_ug_mode(mdrive_device_t * device, char * serial, int size) {
         .expect_err = true,     // Handle error condition here
         .waittime = &wait,      // For magic wait prescribed time
         .tries = 1,             // Don't retry
-        .raw = true             // Don't add EOL
+        .raw = true,            // Don't add EOL
+        .priority = MDRIVE_PRIORITY_BULK
     };
 
     char * magic_codes[] = { ":IMSInc\r", "::s\r", NULL };
@@ -0,0 +1,111 @@
+#include "histogram.h"
+
+#include <stdbool.h>
+
+/**
+ * histogram_index
+ *
+ * Finds the bucket for a value (us). Values below 2^(SUB_BITS+1) have a
+ * bucket each. Above that, the power of two of the value selects a group of
+ * SUB_COUNT buckets, and the SUB_BITS bits below the most significant one
+ * select the bucket within the group.
+ */
+static unsigned
+histogram_index(unsigned value) {
+    if (value < 2 * HISTOGRAM_SUB_COUNT)
+        return value;
+
+    unsigned shift = (31 - __builtin_clz(value)) - HISTOGRAM_SUB_BITS;
+    return (shift + 1) * HISTOGRAM_SUB_COUNT
+        + (value >> shift) - HISTOGRAM_SUB_COUNT;
+}
+
+/**
+ * histogram_highest
+ *
+ * Largest value (us) counted in the bucket at [index] -- the inverse of
+ * histogram_index().
+ */
+static unsigned
+histogram_highest(unsigned index) {
+    if (index < 2 * HISTOGRAM_SUB_COUNT)
+        return index;
+
+    unsigned shift = index / HISTOGRAM_SUB_COUNT - 1;
+    return ((HISTOGRAM_SUB_COUNT + index % HISTOGRAM_SUB_COUNT + 1) << shift)
+        - 1;
+}
+
+/**
+ * histogram_record
+ *
+ * Counts a sample of [nsec] nanoseconds. Samples beyond the range of the
+ * histogram are counted in the last bucket.
+ */
+void
+histogram_record(mdrive_histogram_t * histogram, long long nsec) {
+    unsigned value, max;
+
+    if (nsec < 0)
+        nsec = 0;
+    else if (nsec / 1000 >= 1LL << HISTOGRAM_MAX_BITS)
+        nsec = ((1LL << HISTOGRAM_MAX_BITS) - 1) * 1000;
+    value = nsec / 1000;
+
+    __atomic_add_fetch(&histogram->buckets[histogram_index(value)], 1,
+        __ATOMIC_RELAXED);
+    __atomic_add_fetch(&histogram->count, 1, __ATOMIC_RELAXED);
+
+    max = __atomic_load_n(&histogram->max, __ATOMIC_RELAXED);
+    while (value > max && !__atomic_compare_exchange_n(&histogram->max, &max,
+            value, true, __ATOMIC_RELAXED, __ATOMIC_RELAXED));
+}
+
+/**
+ * histogram_percentile
+ *
+ * Retrieves the value (us) at or below which the given share of the
+ * samples fall. The [percentile] is given in hundredths of a percent, so
+ * 9900 is the 99th percentile and 9990 the 99.9th. The value reported is
+ * the top of the bucket the percentile falls in, but not above the largest
+ * sample recorded.
+ *
+ * Returns:
+ * (unsigned) value in microseconds, 0 if nothing was recorded
+ */
+unsigned
+histogram_percentile(mdrive_histogram_t * histogram, unsigned percentile) {
+    unsigned long long target, seen = 0;
+    unsigned i, count, max, highest;
+
+    count = __atomic_load_n(&histogram->count, __ATOMIC_RELAXED);
+    max = __atomic_load_n(&histogram->max, __ATOMIC_RELAXED);
+    if (count == 0)
+        return 0;
+    else if (percentile >= 10000)
+        return max;
+
+    // Rank of the sample sought (rounded up), at least the first one
+    target = ((unsigned long long) count * percentile + 9999) / 10000;
+    if (target == 0)
+        target = 1;
+
+    for (i = 0; i < HISTOGRAM_BUCKETS; i++) {
+        seen += __atomic_load_n(&histogram->buckets[i], __ATOMIC_RELAXED);
+        if (seen >= target)
+            break;
+    }
+
+    highest = histogram_highest(i < HISTOGRAM_BUCKETS ? i : i - 1);
+    return (highest < max) ? highest : max;
+}
+
+void
+histogram_reset(mdrive_histogram_t * histogram) {
+    unsigned i;
+
+    for (i = 0; i < HISTOGRAM_BUCKETS; i++)
+        __atomic_store_n(&histogram->buckets[i], 0, __ATOMIC_RELAXED);
+    __atomic_store_n(&histogram->count, 0, __ATOMIC_RELAXED);
+    __atomic_store_n(&histogram->max, 0, __ATOMIC_RELAXED);
+}
@@ -0,0 +1,34 @@
+#ifndef HISTOGRAM
+#define HISTOGRAM
+
+/*
+ * Latency distributions are kept in log-linear (HDR-style) histograms. The
+ * values (microseconds) are bucketed by their power of two, and each power
+ * of two is split linearly into 2^HISTOGRAM_SUB_BITS buckets. So the bucket
+ * width grows with the value, and any value is known within 1/16 (6%)
+ * regardless of its magnitude -- from single microseconds up to a minute
+ * -- with a fixed amount of memory. Values below 2^(HISTOGRAM_SUB_BITS+1)
+ * are counted exactly.
+ *
+ * Samples can be recorded by any thread. The counters are updated
+ * atomically, but a reader of the histogram might see a sample counted in
+ * the total and not (yet) in its bucket.
+ */
+#define HISTOGRAM_SUB_BITS  4
+#define HISTOGRAM_SUB_COUNT (1 << HISTOGRAM_SUB_BITS)
+#define HISTOGRAM_MAX_BITS  26      // Values are clamped to 2^26 us (67s)
+#define HISTOGRAM_BUCKETS \
+    ((HISTOGRAM_MAX_BITS - HISTOGRAM_SUB_BITS + 1) * HISTOGRAM_SUB_COUNT)
+
+typedef struct mdrive_histogram mdrive_histogram_t;
+struct mdrive_histogram {
+    unsigned            count;      // Samples recorded
+    unsigned            max;        // Largest sample (us)
+    unsigned            buckets[HISTOGRAM_BUCKETS];
+};
+
+extern void histogram_record(mdrive_histogram_t *, long long);
+extern unsigned histogram_percentile(mdrive_histogram_t *, unsigned);
+extern void histogram_reset(mdrive_histogram_t *);
+
+#endif
@@ -0,0 +1,212 @@
+#include "mdrive.h"
+#include "serial.h"
+#include "io.h"
+
+#include <errno.h>
+
+/*
+ * Transactions can be submitted to the I/O threads of their port instead
+ * of being run by the calling thread, which then does not block on the
+ * port (or on the other threads using it). The caller either waits for the
+ * completion of the request later, with mdrive_request_wait, or has a
+ * callback run by the I/O thread when complete. The reads for the
+ * completion of moves (see motion.c) are submitted, so that the timer
+ * thread running their callbacks is not held up on the port.
+ *
+ * Requests are pushed onto the [submitted] stack of the port with a
+ * compare-and-swap, and an I/O thread is woken with a semaphore, so that
+ * submitting takes no lock. The semaphore counts the requests not yet
+ * taken up by an I/O thread. A thread woken moves the whole stack to the
+ * [pending] list of the port, by priority class, and runs the first
+ * request of the list to a unit not busy with another request.
+ *
+ * An I/O thread runs one transaction at a time. So that the pipeline of
+ * the port is kept full, the port has as many I/O threads as requests are
+ * allowed in flight, started as requests are submitted. Requests are
+ * otherwise subject to the same scheduling as the ones sent directly (see
+ * mdrive_transaction_send).
+ */
+
+/**
+ * mdrive_io_next
+ *
+ * Takes the requests submitted to the port since last taken into the
+ * [pending] list, by priority class, and returns the first in line to a
+ * unit not busy with another request -- which would only hold up the I/O
+ * thread, since a unit has one transaction at a time. Waits for a unit
+ * if all of those pending are busy. Requests of the same class are kept
+ * in the order submitted. The comm device's rxlock must be held.
+ *
+ * Returns:
+ * (mdrive_request_t *) request to run, NULL if none (when stopping)
+ */
+static mdrive_request_t *
+mdrive_io_next(mdrive_comm_device_t * comm) {
+    mdrive_request_t * submitted, * request, * reversed = NULL, ** line;
+    int priority;
+
+again:
+    submitted = __atomic_exchange_n(&comm->submitted, NULL, __ATOMIC_ACQUIRE);
+
+    // Newest first on the stack
+    while ((request = submitted)) {
+        submitted = request->next;
+        request->next = reversed;
+        reversed = request;
+    }
+
+    while ((request = reversed)) {
+        reversed = request->next;
+        priority = mdrive_priority(&request->options);
+        for (line = &comm->pending; *line
+                && mdrive_priority(&(*line)->options) <= priority;
+                line = &(*line)->next);
+        request->next = *line;
+        *line = request;
+    }
+
+    for (line = &comm->pending; *line; line = &(*line)->next) {
+        if (!(*line)->device->io_busy) {
+            request = *line;
+            *line = request->next;
+            request->device->io_busy = true;
+            return request;
+        }
+    }
+    if (comm->pending) {
+        pthread_cond_wait(&comm->has_data, &comm->rxlock);
+        goto again;
+    }
+
+    return NULL;
+}
+
+/**
+ * mdrive_io_thread
+ *
+ * Body of an I/O thread of a port. Runs the requests submitted, and
+ * signals their completion. Runs until the port is stopped.
+ */
+static void *
+mdrive_io_thread(void * arg) {
+    mdrive_comm_device_t * comm = arg;
+    mdrive_request_t * request;
+
+    while (true) {
+        while (sem_wait(&comm->io_wake) && errno == EINTR);
+
+        pthread_mutex_lock(&comm->rxlock);
+        request = mdrive_io_next(comm);
+        pthread_mutex_unlock(&comm->rxlock);
+
+        if (request == NULL) {
+            // Posted to stop the thread
+            if (comm->io_stopping)
+                break;
+            continue;
+        }
+
+        request->options.result = &request->result;
+        request->status = mdrive_communicate(request->device,
+            request->command, &request->options);
+
+        pthread_mutex_lock(&comm->rxlock);
+        request->device->io_busy = false;
+        pthread_cond_broadcast(&comm->has_data);
+        pthread_mutex_unlock(&comm->rxlock);
+
+        // The request is the caller's from here on
+        if (request->callback)
+            request->callback(request, request->arg);
+        else
+            sem_post(&request->done);
+    }
+
+    return NULL;
+}
+
+/**
+ * mdrive_submit
+ *
+ * Submits a request to the I/O threads of the port of the device. The
+ * [command] and [options] of the [request] are as for mdrive_communicate.
+ * The request is run in the background, and is completed by calling its
+ * [callback] from the I/O thread -- which should not block on the port
+ * (for instance by waiting for another request). If no callback is given,
+ * the completion is waited for with mdrive_request_wait.
+ *
+ * Returns:
+ * (int) 0 upon success, EINVAL if the device is not connected, errno from
+ * pthread_create otherwise
+ */
+int
+mdrive_submit(mdrive_device_t * device, mdrive_request_t * request) {
+    mdrive_comm_device_t * comm = device->comm;
+    int status = 0;
+
+    if (comm == NULL)
+        return EINVAL;
+
+    // Another I/O thread for each request allowed in flight
+    if (__atomic_load_n(&comm->io_count, __ATOMIC_ACQUIRE) < comm->pipeline) {
+        pthread_mutex_lock(&comm->rxlock);
+        if (comm->io_count < comm->pipeline && !comm->io_stopping) {
+            status = pthread_create(&comm->io_threads[comm->io_count], NULL,
+                mdrive_io_thread, comm);
+            if (status == 0)
+                __atomic_add_fetch(&comm->io_count, 1, __ATOMIC_RELEASE);
+        }
+        pthread_mutex_unlock(&comm->rxlock);
+        if (status && comm->io_count == 0)
+            return status;
+    }
+
+    request->device = device;
+    if (request->callback == NULL)
+        sem_init(&request->done, 0, 0);
+
+    request->next = __atomic_load_n(&comm->submitted, __ATOMIC_RELAXED);
+    while (!__atomic_compare_exchange_n(&comm->submitted, &request->next,
+            request, true, __ATOMIC_RELEASE, __ATOMIC_RELAXED));
+    sem_post(&comm->io_wake);
+
+    return 0;
+}
+
+/**
+ * mdrive_request_wait
+ *
+ * Waits for the completion of a request submitted without a callback.
+ *
+ * Returns:
+ * (int) status of the request (enum mdrive_response_class)
+ */
+int
+mdrive_request_wait(mdrive_request_t * request) {
+    while (sem_wait(&request->done) && errno == EINTR);
+    sem_destroy(&request->done);
+
+    return request->status;
+}
+
+/**
+ * mdrive_io_stop
+ *
+ * Stops the I/O threads of the port, after the requests submitted are
+ * completed.
+ */
+void
+mdrive_io_stop(mdrive_comm_device_t * comm) {
+    int i;
+
+    pthread_mutex_lock(&comm->rxlock);
+    comm->io_stopping = true;
+    pthread_mutex_unlock(&comm->rxlock);
+
+    // The requests still submitted are posted ahead
+    for (i = 0; i < comm->io_count; i++)
+        sem_post(&comm->io_wake);
+    for (i = 0; i < comm->io_count; i++)
+        pthread_join(comm->io_threads[i], NULL);
+    comm->io_count = 0;
+}
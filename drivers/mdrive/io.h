@@ -0,0 +1,36 @@
+#ifndef IO_H
+#define IO_H
+
+#include <semaphore.h>
+
+typedef struct mdrive_request mdrive_request_t;
+
+// Called by the I/O thread of the port when a request is complete
+typedef void (*mdrive_request_callback_t)(mdrive_request_t *, void * arg);
+
+// A transaction submitted to the I/O threads of a port (see io.c). The
+// request belongs to the caller, and must be kept until completed
+struct mdrive_request {
+    char                command[60];    // As for mdrive_communicate
+    struct mdrive_send_opts options;    // (the result is ignored)
+    mdrive_request_callback_t callback; // Completion routine, or NULL to
+    void *              arg;            // wait with mdrive_request_wait
+
+    // Filled in by the driver
+    mdrive_device_t *   device;
+    int                 status;         // enum mdrive_response_class
+    mdrive_response_t   result;         // Response of the unit
+    sem_t               done;           // Posted when complete (no callback)
+    mdrive_request_t *  next;
+};
+
+extern int
+mdrive_submit(mdrive_device_t *, mdrive_request_t *);
+
+extern int
+mdrive_request_wait(mdrive_request_t *);
+
+extern void
+mdrive_io_stop(mdrive_comm_device_t *);
+
+#endif
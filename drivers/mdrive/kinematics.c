@@ -0,0 +1,138 @@
+#include "kinematics.h"
+
+#include <errno.h>
+#include <math.h>
+
+/**
+ * kinematics_plan
+ *
+ * Plans a move of [distance] (either direction) with the profile given.
+ * If the ramps up to [vmax] and back down take more than the distance, the
+ * unit turns to decelerate where the ramps meet, at
+ *
+ *   vpeak^2 = vstart^2 + 2 * distance * accel * decel / (accel + decel)
+ *
+ * An initial velocity above [vmax] is taken as [vmax], as the unit does.
+ *
+ * Returns:
+ * (int) 0 upon success, EINVAL if [vmax], [accel] or [decel] is not
+ * positive
+ */
+int
+kinematics_plan(kinematics_t * plan, double distance, double vstart,
+        double vmax, double accel, double decel) {
+    double ramps, cruise = 0;
+
+    if (!(vmax > 0 && accel > 0 && decel > 0))
+        return EINVAL;
+
+    distance = fabs(distance);
+    vstart = fmax(0, fmin(vstart, vmax));
+
+    *plan = (kinematics_t) {
+        .distance = distance,
+        .vstart = vstart,
+        .vpeak = vmax,
+        .accel = accel,
+        .decel = decel
+    };
+
+    // Distance covered by the ramps up to vmax and back down
+    ramps = (vmax * vmax - vstart * vstart) * (1 / accel + 1 / decel) / 2;
+    if (ramps <= distance)
+        cruise = (distance - ramps) / vmax;
+    else
+        plan->vpeak = sqrt(vstart * vstart
+            + 2 * distance * accel * decel / (accel + decel));
+
+    plan->t_peak = (plan->vpeak - vstart) / accel;
+    plan->t_decel = plan->t_peak + cruise;
+    plan->t_rest = plan->t_decel + (plan->vpeak - vstart) / decel;
+
+    return 0;
+}
+
+/**
+ * kinematics_position
+ *
+ * Returns:
+ * (double) distance traveled [t] into the move
+ */
+double
+kinematics_position(const kinematics_t * plan, double t) {
+    double ramp = (plan->vpeak * plan->vpeak - plan->vstart * plan->vstart)
+        / (2 * plan->accel);
+
+    if (t <= 0)
+        return 0;
+    else if (t >= plan->t_rest)
+        return plan->distance;
+    else if (t < plan->t_peak)
+        return t * (plan->vstart + plan->accel * t / 2);
+    else if (t < plan->t_decel)
+        return ramp + plan->vpeak * (t - plan->t_peak);
+
+    // Decelerating: what is left to travel down to the end of the move
+    t = plan->t_rest - t;
+    return plan->distance - t * (plan->vstart + plan->decel * t / 2);
+}
+
+/**
+ * kinematics_velocity
+ *
+ * Returns:
+ * (double) velocity [t] into the move, zero once at rest
+ */
+double
+kinematics_velocity(const kinematics_t * plan, double t) {
+    if (t < 0 || t >= plan->t_rest)
+        return 0;
+    else if (t < plan->t_peak)
+        return plan->vstart + plan->accel * t;
+    else if (t < plan->t_decel)
+        return plan->vpeak;
+
+    return plan->vpeak - plan->decel * (t - plan->t_decel);
+}
+
+/**
+ * kinematics_time_to_rest
+ *
+ * Returns:
+ * (double) time left in the move [t] into it
+ */
+double
+kinematics_time_to_rest(const kinematics_t * plan, double t) {
+    return fmax(0, plan->t_rest - fmax(0, t));
+}
+
+/**
+ * kinematics_stopping_time
+ *
+ * Returns:
+ * (double) time taken to come to rest from velocity [v] (magnitude) by
+ * decelerating down to the initial velocity
+ */
+double
+kinematics_stopping_time(const kinematics_t * plan, double v) {
+    v = fabs(v);
+    if (v <= plan->vstart)
+        return 0;
+
+    return (v - plan->vstart) / plan->decel;
+}
+
+/**
+ * kinematics_stopping_distance
+ *
+ * Returns:
+ * (double) distance traveled coming to rest from velocity [v] (magnitude)
+ */
+double
+kinematics_stopping_distance(const kinematics_t * plan, double v) {
+    v = fabs(v);
+    if (v <= plan->vstart)
+        return 0;
+
+    return (v * v - plan->vstart * plan->vstart) / (2 * plan->decel);
+}
@@ -0,0 +1,43 @@
+#ifndef KINEMATICS_H
+#define KINEMATICS_H
+
+/*
+ * Motion of a unit through a move, as planned by its trapezoidal profile.
+ * The unit starts at the initial velocity (VI), accelerates (A) up to the
+ * maximum velocity (VM) -- or as far as the distance of the move allows --
+ * runs at that velocity, then decelerates (D) back down to VI, where it
+ * stops. Any units can be used, as long as they are consistent (the driver
+ * uses microrevs and seconds).
+ *
+ *   v ^
+ *     |      +--------+
+ *     |     /          \
+ *     |    /            \
+ *  VI |   +              +
+ *     |   |              |
+ *     +---+----+--------+-+-> t
+ *         0  peak  decel  rest
+ */
+typedef struct kinematics kinematics_t;
+struct kinematics {
+    double              distance;   // Of the move (magnitude)
+    double              vstart;     // Initial (and final) velocity
+    double              vpeak;      // Top velocity reached
+    double              accel;
+    double              decel;
+
+    // Times from the start of the move
+    double              t_peak;     // End of the acceleration
+    double              t_decel;    // Start of the deceleration
+    double              t_rest;     // End of the move
+};
+
+extern int kinematics_plan(kinematics_t *, double distance, double vstart,
+    double vmax, double accel, double decel);
+extern double kinematics_position(const kinematics_t *, double t);
+extern double kinematics_velocity(const kinematics_t *, double t);
+extern double kinematics_time_to_rest(const kinematics_t *, double t);
+extern double kinematics_stopping_time(const kinematics_t *, double v);
+extern double kinematics_stopping_distance(const kinematics_t *, double v);
+
+#endif
@@ -7,6 +7,7 @@
 #define _POSIX_SOURCE 1
 
 #include <pthread.h>
+#include <semaphore.h>
 #include <stdbool.h>
 #include <stdint.h>
 #include <stdlib.h>
@@ -15,6 +16,9 @@
 #include <time.h>
 #include <unistd.h>
 
+#include "histogram.h"
+#include "kinematics.h"
+
 #define DEFAULT_PORT_SPEED 9600
 
 // Maximum times event_subscribe can be called for various event handler
@@ -27,6 +31,9 @@ struct mdrive_response {
     unsigned        txid;
     char            address;            // Address of unit emitting an event
     uint8_t         ack_location;       // Where the ack was found (for CK>0)
+    uint8_t         sum;                // Sum of the chars received
+    uint8_t         sum_head;           // ... up to the first char
+    uint8_t         sum_ack;            // ... up to the last ACK
     unsigned        received        :7; // Total chars received from unit
     unsigned        length          :7; // Length of buffer
     unsigned        code            :8; // Error/event code indicated by the unit
@@ -40,6 +47,8 @@ struct mdrive_response {
     unsigned        prompt          :1; // Response included a '>' char
     unsigned        crlf            :1; // CRLF received in response
     unsigned        in_error        :1; // Internal to response processor
+    unsigned        in_address      :1; // Internal to response processor
+    struct timespec started;            // Arrival of the first char
 };
 
 enum mdrive_response_class {
@@ -62,6 +71,34 @@ struct event_callback {
     driver_event_callback_t callback;
 };
 
+// Round-trip time estimate (nanoseconds)
+typedef struct mdrive_rtt mdrive_rtt_t;
+struct mdrive_rtt {
+    int                 srtt;       // Smoothed round-trip time
+    int                 rttvar;     // Variation of the round-trip time
+    int                 rto;        // Timeout for the first response
+};
+
+// Priority classes of transactions, most urgent first. Transactions
+// waiting for a port are sent in the order of their class
+enum mdrive_priority {
+    MDRIVE_PRIORITY_DEFAULT = 0,        // By the kind of request
+    MDRIVE_PRIORITY_EMERGENCY,          // Stops and resets
+    MDRIVE_PRIORITY_MOTION,             // Commands
+    MDRIVE_PRIORITY_QUERY,              // Reads (PR)
+    MDRIVE_PRIORITY_BULK,               // Microcode and firmware upload
+    MDRIVE_PRIORITIES
+};
+
+// Communication settings (EM, CK) a unit is configured with, selected
+// with ?profile= in the connection string (see mdrive_config_wire)
+enum mdrive_wire_profile {
+    MDRIVE_WIRE_FAST = 0,               // EM=1, CK=1 (default)
+    MDRIVE_WIRE_PLAIN,                  // EM=0, CK=0 (as for a terminal)
+    MDRIVE_WIRE_KEEP,                   // As found on the unit
+    MDRIVE_WIRE_PROFILES
+};
+
 typedef struct mdrive_stats mdrive_stats_t;
 struct mdrive_stats {
     // Communication stats
@@ -75,9 +112,28 @@ struct mdrive_stats {
     unsigned            resends;
     unsigned            bad_checksums;
     unsigned            overflows;  // Error 63's received when talking to this unit
+    unsigned            queue_overflows; // Responses lost to a full queue
     unsigned            waittime;   // Milliseconds spent waiting XXX: Useful?
     unsigned            latency;    // Average latency (nanoseconds) over last
                                     // 20 transmissions
+    mdrive_rtt_t        rtt_short;  // Commands answered with ACK or prompt
+    mdrive_rtt_t        rtt_data;   // Commands returning data (PR)
+
+    // Latency distributions
+    mdrive_histogram_t  rtt_histogram;    // Request sent to first response
+    mdrive_histogram_t  txlock_histogram; // Waiting for the port
+    mdrive_histogram_t  frame_histogram;  // First char to frame completion
+    mdrive_histogram_t  queue_histogram[MDRIVE_PRIORITIES];
+                                          // Waiting for the port, by class
+    mdrive_histogram_t  write_histogram;  // Blocked writing a request
+    unsigned long long  writetime;  // Time (ns) blocked writing requests
+
+    // Traffic by the wire profile in effect
+    struct mdrive_wire_stats {
+        unsigned        transactions;
+        unsigned long long bytes;   // Sent and received
+        unsigned long long time;    // Time (ns) in transactions
+    } wire[MDRIVE_WIRE_PROFILES];
 
     // Operational stats
     unsigned            stalls;
@@ -98,6 +154,7 @@ struct motion_details {
     long                decel_us;       // Estimated start of decel ramp
                                         // -- usecs rel to start
     struct timespec     projected;      // Estimated time of completion (abs)
+    kinematics_t        plan;           // Planned travel (microrevs)
 
     // Target information
     enum move_type      type;           // Move type (MCABSOLUTE, etc)
@@ -112,27 +169,152 @@ struct motion_details {
     bool                moving;         // Stall event occured since start
 };
 
+// Status of an axis sampled by the poller of its port (see poller.c)
+struct mdrive_status {
+    struct timespec     taken;          // Time sampled (zero if none)
+    struct timespec     due;            // Time of the next poll
+    bool                kicked;         // Sample discarded since polled
+    int                 position;       // P (steps)
+    int                 velocity;       // V (steps/s)
+    int                 moving;         // MV
+    int                 stalled;        // ST
+};
+
+// Position of an axis confirmed by the unit, for estimating it from the
+// motion planned since (see estimate.c)
+struct mdrive_estimate {
+    struct timespec     confirmed;      // Time position read (zero if never)
+    int                 position;       // P then (steps)
+    struct timespec     lost;           // Time unit last set moving (other
+                                        // than by mdrive_move), stopped
+                                        // or stalled
+    struct timespec     rested;         // Time unit last read at rest
+    int                 error;          // Of the last position answered
+    bool                answered;       // and not yet read (steps)
+    int                 correction;     // Read the unit if the position was
+                                        // confirmed longer ago (ms), or 0
+};
+
 #include "queue.h"
 
+typedef struct mdrive_device_list mdrive_device_t;
+
+// Maximum number of requests allowed on the wire at once on one port
+#define MDRIVE_MAX_PIPELINE 16
+
+// Motion profiles the microcode can hold for the host (see profiles.mtx),
+// selected by number (1-based) with a move
+#define MDRIVE_PROFILE_SLOTS 7
+
+// Amount (steps) a packed move can carry along with its mode in R1
+#define MDRIVE_PACKED_STEPS (1 << 24)
+
+// One exchange with a unit (including its retries). Transactions are kept
+// in the comm device's list from the first transmission until the caller
+// is finished with the response
+typedef struct mdrive_transaction mdrive_transaction_t;
+struct mdrive_transaction {
+    mdrive_device_t *   device;
+    const char *        request;        // Request as sent
+    int                 length;
+    int                 text_length;    // Without checksum and EOL (for
+                                        // echo detection)
+    bool                expect_data;
+    int                 priority;       // Class (enum mdrive_priority)
+    int                 window;         // Max in flight, if not [pipeline]
+    pthread_t           owner;          // Thread performing the exchange
+
+    unsigned            txid;           // Transaction id of the last send
+    int                 sends;          // Times sent
+    bool                inflight;       // Sent, awaiting the response
+    bool                acked;          // ACK or NACK received
+    struct timespec     sent;           // Time of the last send
+    struct timespec     first;          // Time it was first in line
+    queue_t             frames;         // Responses received
+    pthread_cond_t      turn;           // Signaled to reconsider its turn
+    mdrive_transaction_t * waiting;     // Next in line for the wire
+
+    mdrive_transaction_t * next;
+};
+
 typedef struct mdrive_comm_device_list mdrive_comm_device_t;
 struct mdrive_comm_device_list {
-    pthread_mutex_t     txlock;
     pthread_mutex_t     rxlock;
     char                name[32];       // Name of device (serial port)
     int                 fd;
     int                 speed;
     int                 active_axes;    // Reference counting to detect when
                                         // connection can be freed
+    mdrive_device_t *   axes;           // Axes connected through the port
+    mdrive_device_t *   by_address[256]; // Axes by unit address, for events
+    int                 negotiated;     // Speed all the units on the port
+                                        // were moved to (@auto), if any
     //struct termios      termios;        // Saved terminal settings
 
     int                 txid;           // Current transactionid
-    struct timespec     lasttx;         // Time of last transmission
+    struct timespec     lasttx;         // Time of last transmission (its
+                                        // estimated end unless [drain])
+    bool                drain;          // Wait for each request to leave
+                                        // the port (tcdrain)
     struct timespec     lastActivity;   // Time of last tx or rx
     pthread_cond_t      has_data;
 
-    queue_t             queue;
+    // Transactions in progress. Responses are matched, in the order sent,
+    // to the transactions in flight. At most one transaction per address
+    // is in flight, and up to [pipeline] in total
+    mdrive_transaction_t * transactions;
+    int                 pipeline;       // Max transactions in flight
+    int                 inflight;       // Transactions in flight
+    bool                exclusive;      // In-flight transaction must be
+                                        // alone on the wire
+    unsigned            abandoned;      // Transactions given up on
+    int                 resync;         // Transmissions to send alone
+    int                 guard;          // Quiet time (ns) before resyncing
+
+    // Transactions take turns on the wire by priority class
+    mdrive_transaction_t * waiters;     // In line for the wire
+    bool                sending;        // A request is being written
+    pthread_t           reserver;       // Thread keeping the port to itself
+    int                 reserved;       // Nesting of the reservation
+
+    // Responses are allocated from here by the receive thread
+    mdrive_response_pool_t pool;
+
+    // Background status poller (see poller.c)
+    pthread_t           poll_thread;
+    pthread_cond_t      poll_wake;      // Interval changed or axis kicked
+    int                 poll_interval;  // Period (ms) for axes in motion,
+                                        // zero if not polling
+    mdrive_device_t *   polling;        // Axis being polled
+
+    // Capture of the traffic into a ring file (see capture.h)
+    struct mdrive_capture * capture;
+    unsigned            capture_users;  // Threads recording into it
+
+    // I/O threads running the transactions submitted to the port (see
+    // io.c), one per request allowed in flight
+    pthread_t           io_threads[MDRIVE_MAX_PIPELINE];
+    int                 io_count;       // I/O threads started
+    bool                io_stopping;
+    struct mdrive_request * submitted;  // Pushed without locking, newest
+                                        // first
+    struct mdrive_request * pending;    // Taken, by priority class
+    sem_t               io_wake;        // Posted for each submission
+
     pthread_t           read_thread;
 
+    // Receive thread statistics
+    struct {
+        unsigned        wakeups;        // Returns from poll() with data
+        unsigned        bytes;          // Bytes read from the port
+        unsigned        frames;         // Responses completed
+        unsigned        idle_closes;    // Partial frames closed when the
+                                        // line went idle
+        unsigned        dropped;        // Responses not matched to a
+                                        // transaction
+        unsigned long long idletime;    // Time (us) blocked awaiting data
+    } rxstats;
+
     mdrive_comm_device_t * next;
 };
 
@@ -165,7 +347,6 @@ struct mdrive_io_config {
     bool                wide_range;     // For the analog input
 };
 
-typedef struct mdrive_device_list mdrive_device_t;
 struct mdrive_device_list {
     mdrive_comm_device_t * comm;
     char                serial_number[16];
@@ -178,8 +359,12 @@ struct mdrive_device_list {
                                         // retrieving error codes from unit
     short               checksum;       // Comm checksum mode
     short               echo;           // Comm echo mode
+    short               wire_profile;   // EM, CK settings to configure
     bool                upgrade_mode;   // Unit is in upgrade mode
     bool                ignore_errors;  // Don't auto-fetch error number
+    bool                offline;        // Classify responses without
+                                        // talking to the unit (replay)
+    bool                io_busy;        // Request run by an I/O thread
 
     int                 speed;          // Speed of this device, which allows
                                         // axes to share a port and operate
@@ -192,6 +377,8 @@ struct mdrive_device_list {
     int                 position;       // Last known position
     Profile             profile;        // Current profile represented on the device
     struct motion_details movement;     // Information of last movement
+    struct mdrive_status status;        // Last status polled
+    struct mdrive_estimate estimate;    // Last position confirmed
     int                 cb_complete;    // Callback ID for completion event
     int                 drive_enabled;  // DE=0
 
@@ -236,17 +423,29 @@ struct mdrive_device_list {
         struct {
             bool        following_error;
             bool        move;
+            int         profiles;       // Slots for the host's profiles
+            bool        packed_move;
         } features;
 
+        // Profiles installed into the slots (mdrive_profile_install)
+        Profile         slots[MDRIVE_PROFILE_SLOTS];
+        unsigned        installed;      // Bit (1 << number) per slot
+
+        // Labels of the program last installed (see microcode.c)
+        struct mdrive_program * program;
+
         struct {
             char        home[3];
             char        move[3];
+            char        packed_move[3];
             char        following_error[3];
             char        jitter[3];
         } labels;
     } microcode;
 
     Driver *            driver;         // Driver for the device (useful for signaling events)
+
+    mdrive_device_t *   next_axis;      // Next axis sharing the comm port
 };
 
 typedef struct mdrive_address mdrive_address_t;
@@ -285,7 +484,34 @@ enum mdrive_read_variable {
     // Odd settings (last mile)
     MDRIVE_ENCODER,
     MDRIVE_VARIABLE,            // Peek/poke a variable
-    MDRIVE_EXECUTE              // Call a label (poke)
+    MDRIVE_EXECUTE,             // Call a label (poke)
+
+    // Port settings
+    MDRIVE_PIPELINE,            // Requests allowed in flight on the port
+    MDRIVE_POLL_INTERVAL,       // Status polling period (ms) on the port
+    MDRIVE_CAPTURE,             // Ring file capturing the port traffic
+    MDRIVE_TX_DRAIN,            // Wait for requests to leave the port
+    MDRIVE_WIRE_PROFILE,        // EM, CK settings (enum mdrive_wire_profile)
+    MDRIVE_ESTIMATE_CORRECTION, // Period (ms) of reads correcting the
+                                // MCPOSITION_ESTIMATED model
+
+    // Port statistics
+    MDRIVE_STATS_WAKEUPS,       // Receive thread wakeups (per port)
+    MDRIVE_STATS_IDLE,          // Frames closed by the idle timer (per port)
+    MDRIVE_STATS_QUEUE_OVERFLOWS, // Responses lost to a full queue
+    MDRIVE_STATS_ALLOCS,        // Responses allocated from the heap (per port)
+    MDRIVE_STATS_RTO,           // Response timeout (us), commands
+    MDRIVE_STATS_RTO_DATA,      // Response timeout (us), data (PR) commands
+    MDRIVE_STATS_LATENCY_RTT,   // Latency percentiles (us) -- round trip,
+    MDRIVE_STATS_LATENCY_TXLOCK, // waiting for the port,
+    MDRIVE_STATS_LATENCY_FRAME, // and receiving a response
+    MDRIVE_STATS_QUEUE_EMERGENCY, // Waiting for the port (us) by class,
+    MDRIVE_STATS_QUEUE_MOTION,  // percentiles like the latencies
+    MDRIVE_STATS_QUEUE_QUERY,
+    MDRIVE_STATS_QUEUE_BULK,
+    MDRIVE_STATS_LATENCY_WRITE, // Blocked writing a request (us)
+    MDRIVE_STATS_WIRE_BYTES,    // Bytes per transaction (hundredths) and
+    MDRIVE_STATS_WIRE_RATE      // transactions per second, by profile
 };
 
 // Error codes
@@ -13,119 +13,156 @@
 #include <ctype.h>
 #include <errno.h>
 #include <stdio.h>
+#include <stdlib.h>
+
+// Variables kept on the unit by the loader, holding the digest of the
+// microcode installed, of its program, and the address past the program
+// (see mdrive_microcode_load)
+#define MDRIVE_MICROCODE_DIGEST "ZH"
+#define MDRIVE_MICROCODE_PROGRAM "ZP"
+#define MDRIVE_MICROCODE_END "ZE"
+
+// Longest microcode line accepted by the unit
+#define MDRIVE_MICROCODE_LINE 64
+
+// Most labels the unit can hold
+#define MDRIVE_MICROCODE_LABELS 192
+
+// A line of microcode, as sent to the unit
+struct mdrive_microcode_line {
+    char                text[MDRIVE_MICROCODE_LINE];
+    bool                program;        // Stored as program (PG to PG)
+};
+
+// A label of the program, with the digest of its lines
+struct mdrive_microcode_label {
+    char                name[3];
+    unsigned            digest;
+    bool                falls;          // Into the next label
+    int                 first;          // Lines of the label (LB included)
+    int                 end;
+};
+
+// Microcode file, as sent to the unit
+struct mdrive_microcode {
+    struct mdrive_microcode_line * lines;
+    int                 count;
+    int                 size;           // Lines allocated
+    unsigned            digest;         // Of the lines, FNV-1a
+    unsigned            program;        // Of the program lines only
+    int                 base;           // Address of the program
+    int                 length;         // Bytes of program lines sent
+    bool                relocatable;    // Labels can be installed apart
+
+    // Labels as read, and as listed in the manifest of the compiler
+    struct mdrive_microcode_label labels[MDRIVE_MICROCODE_LABELS];
+    struct mdrive_microcode_label manifest[MDRIVE_MICROCODE_LABELS];
+    int                 nlabels;
+    int                 nmanifest;
+};
 
 /**
- * mdrive_microcode_load
- * Driver-Entry: load_microcode
+ * mdrive_microcode_fnv
  *
- * Installs microcode from the given file onto the device specified.
- * Basically, the commands from the MCode file are reliably sent to the
- * device.
+ * Returns:
+ * (unsigned) [digest] (FNV-1a) continued over [text] and the CR ending it
+ * on the wire
+ */
+static unsigned
+mdrive_microcode_fnv(unsigned digest, const char * text) {
+    for (; *text; text++)
+        digest = (digest ^ (unsigned char) *text) * 16777619u;
+
+    return (digest ^ '\r') * 16777619u;
+}
+
+// Program installed by the loader, so that a later load can install the
+// labels changed only (see mdrive_microcode_patch)
+struct mdrive_program {
+    unsigned            digest;         // Of the program, as ZP
+    int                 base;           // Address of the program
+    int                 end;            // Past the last line, as ZE
+    int                 nlabels;
+    struct mdrive_microcode_label labels[MDRIVE_MICROCODE_LABELS];
+};
+
+/**
+ * mdrive_microcode_ends_block
  *
- * Variables, if already in existance on the motor, cannot be cleared by the
- * CP command. Therefore, to alleviate a hard reset of the motor, variable
- * replacement is auto-sensed by this routine, and if a variable being
- * defined already exists on the device, the default value specified in the
- * new microcode is assigned as the default of the already-existing
- * variable.
+ * Returns:
+ * (bool) true if the program cannot fall through past [text] -- E, RT or
+ * an unconditional BR (as ends_block() of the compiler's optimizer)
+ */
+static bool
+mdrive_microcode_ends_block(const char * text) {
+    return strcmp(text, "E") == 0 || strcmp(text, "RT") == 0
+        || (strncmp(text, "BR ", 3) == 0 && strchr(text, ',') == NULL);
+}
+
+/**
+ * mdrive_microcode_append
  *
- * Caveats:
- * CP is executed prior to microcode loading. Any microcode previously on
- * the device will be cleared. This approach will also make split microcode
- * files impossible, because microcode is cleared for every call to this
- * routine.
+ * Adds a line to the microcode to be sent.
  *
- * No validation is performed on the file-to-be-loaded. Error code raised by
- * the unit will be returned if the file contains bad or unsupported
- * microcode.
+ * Returns:
+ * (struct mdrive_microcode_line *) the line added, NULL if out of memory
+ */
+static struct mdrive_microcode_line *
+mdrive_microcode_append(struct mdrive_microcode * code, const char * text,
+        bool program) {
+    struct mdrive_microcode_line * line;
+
+    if (code->count == code->size) {
+        code->size = code->size ? 2 * code->size : 64;
+        line = realloc(code->lines, code->size * sizeof *code->lines);
+        if (line == NULL)
+            return NULL;
+        code->lines = line;
+    }
+    line = &code->lines[code->count++];
+    snprintf(line->text, sizeof line->text, "%s", text);
+    line->program = program;
+
+    return line;
+}
+
+/**
+ * mdrive_microcode_read
  *
- * Whitespace and comments are stripped from the microcode file and are not
- * sent to the unit. This routine is intented to install production code.
+ * Reads the microcode file into memory, as it will be sent to the unit.
+ * Whitespace and comments are stripped, blank lines are dropped, and so
+ * are auto-saves ([S]) -- the configuration is committed by the loader.
+ * The digest of the lines is computed along, so that a microcode file
+ * differing only by comments or indentation has the same digest. So is
+ * the digest of the program lines (from PG <address> to PG), and of each
+ * label of the program (up to the next, declarations aside).
  *
- * This routine will take a while. IP, CP, and S are all issued to install
- * the microcode, and comm settings are re-inspected/reset after the ending
- * mdrive_config_commit() call.
- *
- * Side-Effects:
- * Regardless of exit condition, device should be cleared from program mode.
+ * The program is relocatable if it is a single section of labels, without
+ * declarations, so that its labels can be installed apart from each other
+ * (see mdrive_microcode_patch).
  *
- * Parameters:
- * self - (Driver *) driver instance data
- * filename - (const char *) microcode file to load
+ * The manifest of a compiled microcode file, if any, is read from its
+ * comments ("'@ LB <name> <digest>") to be checked against the labels.
  *
  * Returns:
- * (int) 0 upon success, ER_BAD_FILE if the specified filename could not
- * possibly be a microcode text file, EIO if unable to communicate with the
- * device, MDRIVE_ECLOBBER if unable to install a label or variable defined
- * in the microcode file.
+ * (int) 0 upon success, ENOMEM, or E2BIG if a line is too long for the
+ * unit or the program has too many labels
  */
-int
-mdrive_microcode_load(Driver * self, const char * filename) {
-    mdrive_device_t * device = self->internal;
-
-    mcTraceF(10, MDRIVE_CHANNEL, "Loading microcode from: %s", filename);
-    
-    // Attempt to open firmware file before switching into upgrade mode
-    FILE * file = fopen(filename, "rt");
-    if (file == NULL) {
-        switch (errno) {
-            case ENOENT:
-            case EISDIR:
-            case ENAMETOOLONG:
-            case ENOTDIR:
-                return ER_BAD_FILE;
-            default:
-                return errno;
-        }
-    }
-
-    // Reset any unsaved changes (comm configuration, etc)
-    if (!mdrive_config_rollback(device))
-        return EIO;
-
-    // Clear stored microcode
-    struct timespec longtime = { .tv_nsec = 900e6 };
-    struct mdrive_send_opts opts = { .waittime = &longtime };
-    if (mdrive_communicate(device, "CP", &opts) != RESPONSE_OK)
-        return EIO;
-
-    // Read data from the input file
-    char ch, buffer[64], *bol, *eol;
-    bool skipchar = false;
-
-    // Handle errors (like 28 -- ECLOBBER) here
-    int tries;
-    struct mdrive_response result;
-    opts.result = &result;
-
-    // Config vars not to be reset at [S]ave time
-    struct mdrive_config_flags preserve = {0};
+static int
+mdrive_microcode_read(FILE * file, struct mdrive_microcode * code) {
+    char ch, buffer[256], *bol, *eol;
+    bool programming = false, program;
+    struct mdrive_microcode_label * label = NULL, * entry;
 
-    // Keep track of entry- and exit from program mode
-    bool programming = false;
-
-    // Exit status
-    int status = 0;
+    code->digest = code->program = 2166136261u;
+    code->relocatable = true;
 
     do {
-        // Reset the buffer position (for file reads)
+        // Read a line
         eol = buffer;
-        // New line, don't skip anything until an apostrophe is found
-        skipchar = false;
-
-        while (true) {
-            ch = getc(file);
-            if (ch == '\n' || ch == '\r' || ch == EOF)
-                break;
-
-            // Skip comments (apostrophe to end of line)
-            else if (ch == '\x27')
-                skipchar = true;
-
-            if (!skipchar)
+        while ((ch = getc(file)) != '\n' && ch != '\r' && ch != EOF)
+            if (eol < buffer + sizeof buffer - 1)
                 *eol++ = ch;
-        }
-        // Null-terminate
         *eol = 0;
 
         // Advance line past initial whitespace
@@ -133,6 +170,22 @@ mdrive_microcode_load(Driver * self, const char * filename) {
         while (bol < eol && isspace(*bol))
             bol++;
 
+        // Manifest entry, in a comment
+        if (strncmp("\x27@", bol, 2) == 0) {
+            if (code->nmanifest == MDRIVE_MICROCODE_LABELS)
+                return E2BIG;
+            entry = &code->manifest[code->nmanifest];
+            if (sscanf(bol + 2, " LB %2s %x", entry->name, &entry->digest) == 2)
+                code->nmanifest++;
+            continue;
+        }
+
+        // Skip comments (apostrophe to end of line)
+        if ((eol = strchr(bol, '\x27')))
+            *eol = 0;
+        else
+            eol = bol + strlen(bol);
+
         // Skip blank lines
         if (*bol == 0)
             continue;
@@ -149,8 +202,276 @@ mdrive_microcode_load(Driver * self, const char * filename) {
         if (strncmp("S", bol, 2) == 0)
             continue;
 
-        // XXX: Check line length. Anything over 64 chars will not be
-        //      accepted by the unit
+        // Anything over 64 chars will not be accepted by the unit
+        if (eol - bol >= MDRIVE_MICROCODE_LINE) {
+            mcTraceF(10, MDRIVE_CHANNEL, "Microcode line too long: %s", bol);
+            return E2BIG;
+        }
+
+        // Program mode is entered with an address after the 'PG', and
+        // left with a bare 'PG'
+        program = programming;
+        if (strncmp("PG", bol, 2) == 0 && (bol[2] == 0 || isspace(bol[2]))) {
+            if (label) {
+                label->end = code->count;
+                label->falls = !mdrive_microcode_ends_block(
+                    code->lines[code->count - 1].text);
+            }
+            programming = strtol(bol + 2, NULL, 10) > 0;
+            if (programming && code->base)
+                // Another section
+                code->relocatable = false;
+            else if (programming)
+                code->base = strtol(bol + 2, NULL, 10);
+            program = true;
+            label = NULL;
+        }
+        else if (programming && strncmp("LB ", bol, 3) == 0) {
+            if (code->nlabels == MDRIVE_MICROCODE_LABELS)
+                return E2BIG;
+            if (label) {
+                label->end = code->count;
+                label->falls = !mdrive_microcode_ends_block(
+                    code->lines[code->count - 1].text);
+            }
+            label = &code->labels[code->nlabels++];
+            snprintf(label->name, sizeof label->name, "%s", bol + 3);
+            label->digest = 2166136261u;
+            label->first = code->count;
+            code->length += eol - bol + 1;
+        }
+        else if (programming) {
+            code->length += eol - bol + 1;
+            if (label == NULL || strncmp("VA ", bol, 3) == 0)
+                code->relocatable = false;
+        }
+
+        if (!mdrive_microcode_append(code, bol, program))
+            return ENOMEM;
+
+        // The line and its end, as sent
+        code->digest = mdrive_microcode_fnv(code->digest, bol);
+        if (program)
+            code->program = mdrive_microcode_fnv(code->program, bol);
+        if (label && strncmp("VA ", bol, 3) != 0)
+            label->digest = mdrive_microcode_fnv(label->digest, bol);
+
+    } while (ch != EOF);
+
+    if (programming)
+        // Never left program mode
+        code->relocatable = false;
+
+    return 0;
+}
+
+/**
+ * mdrive_microcode_run
+ *
+ * Returns:
+ * (int) index past the run of [labels] starting at [first] -- a label and
+ * the ones it falls through into
+ */
+static int
+mdrive_microcode_run(const struct mdrive_microcode_label * labels,
+        int count, int first) {
+    while (first < count && labels[first++].falls);
+    return first;
+}
+
+/**
+ * mdrive_microcode_find
+ *
+ * Returns:
+ * (int) index of the label [name] among the [count] [labels], -1 if none
+ */
+static int
+mdrive_microcode_find(const struct mdrive_microcode_label * labels,
+        int count, const char * name) {
+    int i;
+
+    for (i = 0; i < count; i++)
+        if (strcmp(labels[i].name, name) == 0)
+            return i;
+    return -1;
+}
+
+/**
+ * mdrive_microcode_kept
+ *
+ * Returns:
+ * (bool) true if the [count] labels of the [run] are a run of the
+ * [installed] program as they are
+ */
+static bool
+mdrive_microcode_kept(const struct mdrive_microcode_label * run, int count,
+        const struct mdrive_program * installed) {
+    int i, at = mdrive_microcode_find(installed->labels, installed->nlabels,
+        run->name);
+
+    if (at < 0 || (at > 0 && installed->labels[at - 1].falls)
+            || mdrive_microcode_run(installed->labels, installed->nlabels,
+                at) - at != count)
+        return false;
+
+    for (i = 0; i < count; i++)
+        if (strcmp(run[i].name, installed->labels[at + i].name)
+                || run[i].digest != installed->labels[at + i].digest)
+            return false;
+    return true;
+}
+
+/**
+ * mdrive_microcode_patch
+ *
+ * Builds into [patch] the lines of the (relocatable) [code] for a unit
+ * holding the [installed] program. The labels installed which are not
+ * kept are cleared (CP <label>), and the labels of [code] changed or new
+ * are appended past the installed program. A label is kept only along
+ * with the labels it falls through into, or is fallen into from, since
+ * they must stay in order. The lines outside of the program are sent as
+ * they are.
+ *
+ * Returns:
+ * (int) bytes of program lines in the patch, -1 if out of memory
+ */
+static int
+mdrive_microcode_patch(struct mdrive_microcode * code,
+        const struct mdrive_program * installed,
+        struct mdrive_microcode * patch) {
+    bool keep[MDRIVE_MICROCODE_LABELS] = { false };
+    char buffer[MDRIVE_MICROCODE_LINE];
+    const char * text;
+    int i, j, end, length = 0;
+
+    for (i = 0; i < code->nlabels; i = end) {
+        end = mdrive_microcode_run(code->labels, code->nlabels, i);
+        if (mdrive_microcode_kept(&code->labels[i], end - i, installed))
+            for (j = i; j < end; j++)
+                keep[j] = true;
+    }
+
+    for (i = 0; i < installed->nlabels; i++) {
+        j = mdrive_microcode_find(code->labels, code->nlabels,
+            installed->labels[i].name);
+        if (j >= 0 && keep[j])
+            continue;
+        snprintf(buffer, sizeof buffer, "CP %s", installed->labels[i].name);
+        if (!mdrive_microcode_append(patch, buffer, false))
+            return -1;
+    }
+
+    for (i = j = 0; i < code->count; i++) {
+        text = code->lines[i].text;
+        while (j < code->nlabels && code->labels[j].end <= i)
+            j++;
+
+        if (!code->lines[i].program)
+            ;
+        else if (j == code->nlabels || i < code->labels[j].first) {
+            // PG <address> or the closing PG (the other lines are in
+            // labels)
+            if (strcmp(text, "PG") != 0) {
+                snprintf(buffer, sizeof buffer, "PG %d", installed->end);
+                text = buffer;
+            }
+        }
+        else if (keep[j])
+            continue;
+        else
+            length += strlen(text) + 1;
+
+        if (!mdrive_microcode_append(patch, text, code->lines[i].program))
+            return -1;
+    }
+
+    return length;
+}
+
+/**
+ * mdrive_microcode_sign
+ *
+ * Appends the declarations of the digests of [code] and of the [end] of
+ * its program to [lines], to be sent after the microcode.
+ *
+ * Returns:
+ * (bool) false if out of memory
+ */
+static bool
+mdrive_microcode_sign(struct mdrive_microcode * lines,
+        const struct mdrive_microcode * code, int end) {
+    char buffer[MDRIVE_MICROCODE_LINE];
+
+    snprintf(buffer, sizeof buffer, "VA %s=%d", MDRIVE_MICROCODE_PROGRAM,
+        (int) code->program);
+    if (!mdrive_microcode_append(lines, buffer, false))
+        return false;
+    snprintf(buffer, sizeof buffer, "VA %s=%d", MDRIVE_MICROCODE_END, end);
+    if (!mdrive_microcode_append(lines, buffer, false))
+        return false;
+    snprintf(buffer, sizeof buffer, "VA %s=%d", MDRIVE_MICROCODE_DIGEST,
+        (int) code->digest);
+    return mdrive_microcode_append(lines, buffer, false) != NULL;
+}
+
+/**
+ * mdrive_microcode_record
+ *
+ * Keeps the labels of [code], installed up to [end] on the unit, for the
+ * next load onto the device.
+ */
+static void
+mdrive_microcode_record(mdrive_device_t * device,
+        const struct mdrive_microcode * code, int end) {
+    struct mdrive_program * installed = device->microcode.program;
+
+    if (installed == NULL)
+        installed = malloc(sizeof *installed);
+    if (installed == NULL)
+        return;
+
+    installed->digest = code->program;
+    installed->base = code->base;
+    installed->end = end;
+    installed->nlabels = code->nlabels;
+    memcpy(installed->labels, code->labels,
+        code->nlabels * sizeof *code->labels);
+
+    device->microcode.program = installed;
+}
+
+/**
+ * mdrive_microcode_send
+ *
+ * Reliably sends the lines of [code] to the unit. The lines from [first]
+ * on are sent out of program mode.
+ *
+ * Returns:
+ * (int) 0 upon success, EIO if unable to communicate with the device, or
+ * the error code raised by the unit for a line
+ */
+static int
+mdrive_microcode_send(mdrive_device_t * device,
+        struct mdrive_microcode * code, int first,
+        struct mdrive_config_flags * preserve) {
+    int status = 0, i;
+    char * bol;
+
+    // Handle errors (like 28 -- ECLOBBER) here
+    int tries;
+    struct mdrive_response result;
+    struct timespec longtime = { .tv_nsec = 900e6 };
+    struct mdrive_send_opts opts = {
+        .waittime = &longtime,
+        .priority = MDRIVE_PRIORITY_BULK,
+        .result = &result
+    };
+
+    // Keep track of entry- and exit from program mode
+    bool programming = false;
+
+    for (i = 0; i < code->count; i++) {
+        bol = code->lines[i].text;
 
         // Write microcode to the device
         tries = 2;
@@ -178,41 +499,291 @@ mdrive_microcode_load(Driver * self, const char * filename) {
                 }
             }
             if (tries == 0) {
-                // TODO: Trace the offending line
+                mcTraceF(10, MDRIVE_CHANNEL, "Unable to install: %s", bol);
                 // Return actual MDrive error code if available
                 status = (result.code) ? result.code : EIO;
                 goto safe_bail;
             }
         }
         if (strncmp("EM", bol, 2) == 0)
-            preserve.echo = true;
+            preserve->echo = true;
         else if (strncmp("CK", bol, 2) == 0)
-            preserve.checksum = true;
+            preserve->checksum = true;
         else if (strncmp("PG", bol, 2) == 0) {
             // See if there is an address after the 'PG'
             errno = 0;
             int address = strtol(bol+2, NULL, 10);
             programming = (errno == 0) && (address > 0);
         }
-    } while (ch != EOF);
 
+        // Leave program mode before declaring the digests
+        if (i + 1 == first && programming) {
+            // Bogus microcode -- it entered program mode but didn't exit.
+            // TODO: Come up with some nicely-worded error code to return
+            if (RESPONSE_OK == mdrive_send(device, "PG"))
+                programming = false;
+        }
+    }
+
+safe_bail:
     if (programming)
-        // Bogus microcode -- it entered program mode but didn't exit.
-        // TODO: Come up with some nicely-worded error code to return
-        if (RESPONSE_OK == mdrive_send(device, "PG"))
-            programming = false;
+        mdrive_send(device, "PG");
 
-    // Commit the new microcode and settings to NVRAM
-    if (mdrive_config_commit(device, &preserve)) 
+    return status;
+}
+
+/**
+ * mdrive_microcode_load
+ * Driver-Entry: load_microcode
+ *
+ * Installs microcode from the given file onto the device specified.
+ * Basically, the commands from the MCode file are reliably sent to the
+ * device.
+ *
+ * Variables, if already in existance on the motor, cannot be cleared by the
+ * CP command. Therefore, to alleviate a hard reset of the motor, variable
+ * replacement is auto-sensed by this routine, and if a variable being
+ * defined already exists on the device, the default value specified in the
+ * new microcode is assigned as the default of the already-existing
+ * variable.
+ *
+ * Caveats:
+ * CP is executed prior to microcode loading, unless the program is
+ * patched (see below). Any microcode previously on the device will be
+ * cleared. This approach will also make split microcode
+ * files impossible, because microcode is cleared for every call to this
+ * routine.
+ *
+ * No validation is performed on the file-to-be-loaded. Error code raised by
+ * the unit will be returned if the file contains bad or unsupported
+ * microcode.
+ *
+ * Whitespace and comments are stripped from the microcode file and are not
+ * sent to the unit. This routine is intented to install production code.
+ *
+ * The digest of the microcode sent is kept on the unit, in a variable
+ * declared after the microcode (MDRIVE_MICROCODE_DIGEST). If the unit
+ * already has the digest of the file, the upload is skipped altogether --
+ * starting a plant does not reinstall unchanged microcode on every axis.
+ * Since whitespace and comments are not sent, they do not change the
+ * digest. Microcode installed by other means is not detected, unless it
+ * clears the variable.
+ *
+ * The digest of the program alone (the lines from PG <address> to PG) is
+ * kept too (MDRIVE_MICROCODE_PROGRAM). If only the declarations and
+ * settings outside of the program changed, the program is left on the
+ * unit, and CP and the program lines are skipped. The labels are checked
+ * against the manifest of the compiler, if the file has one, and the
+ * labels which changed are traced.
+ *
+ * If the program changed, and the labels of the program on the unit are
+ * known -- installed by this driver, or the program of the file -- only
+ * the labels changed are replaced (see mdrive_microcode_patch), past the
+ * address kept on the unit (MDRIVE_MICROCODE_END). A line is assumed to
+ * take no more room on the unit than it takes on the wire. The program is
+ * installed whole again instead when the labels left behind would take
+ * as much room as the program, or if the patch is refused.
+ *
+ * This routine will take a while. IP, CP, and S are all issued to install
+ * the microcode, and comm settings are re-inspected/reset after the ending
+ * mdrive_config_commit() call.
+ *
+ * Side-Effects:
+ * Regardless of exit condition, device should be cleared from program mode.
+ *
+ * Parameters:
+ * self - (Driver *) driver instance data
+ * filename - (const char *) microcode file to load
+ *
+ * Returns:
+ * (int) 0 upon success (or if already installed), ER_BAD_FILE if the
+ * specified filename could not possibly be a microcode text file, E2BIG if
+ * a line is too long for the unit, EIO if unable to communicate with the
+ * device, MDRIVE_ECLOBBER if unable to install a label or variable defined
+ * in the microcode file.
+ */
+int
+mdrive_microcode_load(Driver * self, const char * filename) {
+    mdrive_device_t * device = self->internal;
+    struct mdrive_microcode code = { .count = 0 }, patch = { .count = 0 },
+        * send = &code;
+    struct mdrive_program * installed = device->microcode.program;
+    int status, digest = 0, program = 0, end = 0, length, first, i, j;
+    bool have_digest, have_program;
+
+    // Config vars not to be reset at [S]ave time
+    struct mdrive_config_flags preserve = {0};
+
+    struct timespec longtime = { .tv_nsec = 900e6 };
+    struct mdrive_send_opts opts = {
+        .waittime = &longtime,
+        .priority = MDRIVE_PRIORITY_BULK
+    };
+
+    mcTraceF(10, MDRIVE_CHANNEL, "Loading microcode from: %s", filename);
+    
+    FILE * file = fopen(filename, "rt");
+    if (file == NULL) {
+        switch (errno) {
+            case ENOENT:
+            case EISDIR:
+            case ENAMETOOLONG:
+            case ENOTDIR:
+                return ER_BAD_FILE;
+            default:
+                return errno;
+        }
+    }
+    status = mdrive_microcode_read(file, &code);
+    fclose(file);
+    if (status)
+        goto exit;
+
+    // Labels changed since compiled, or by the compiler
+    for (i = 0; i < code.nmanifest; i++) {
+        for (j = 0; j < code.nlabels; j++)
+            if (strcmp(code.manifest[i].name, code.labels[j].name) == 0)
+                break;
+        if (j == code.nlabels)
+            mcTraceF(20, MDRIVE_CHANNEL, "Label %s of the manifest is missing",
+                code.manifest[i].name);
+        else if (code.manifest[i].digest != code.labels[j].digest)
+            mcTraceF(20, MDRIVE_CHANNEL, "Label %s differs from the manifest",
+                code.manifest[i].name);
+    }
+
+    have_digest = mdrive_get_integer(device, MDRIVE_MICROCODE_DIGEST,
+        &digest) == 0;
+    have_program = mdrive_get_integer(device, MDRIVE_MICROCODE_PROGRAM,
+        &program) == 0;
+
+    // The labels kept from the last load are of use while the unit has the
+    // same program
+    if (installed && !(have_program
+            && (unsigned) program == installed->digest)) {
+        free(installed);
+        installed = device->microcode.program = NULL;
+    }
+
+    if (have_program && (unsigned) program == code.program) {
+        // The program of the file is the one on the unit
+        if (installed)
+            end = installed->end;
+        else if (code.relocatable
+                && mdrive_get_integer(device, MDRIVE_MICROCODE_END, &end) == 0
+                && end > 0)
+            mdrive_microcode_record(device, &code, end);
+        else
+            end = 0;
+    }
+
+    // Skip the upload if the unit has the same microcode installed
+    if (have_digest && (unsigned) digest == code.digest) {
+        mcTraceF(10, MDRIVE_CHANNEL, "Microcode %08x already installed, "
+            "skipping upload", code.digest);
+        goto exit;
+    }
+
+    if (have_program && (unsigned) program == code.program) {
+        mcTraceF(10, MDRIVE_CHANNEL, "Unit has microcode %08x, installing "
+            "%08x (program unchanged)", (unsigned) digest, code.digest);
+
+        // Keep the program on the unit
+        for (i = j = 0; i < code.count; i++)
+            if (!code.lines[i].program)
+                code.lines[j++] = code.lines[i];
+        code.count = j;
+    }
+    else {
+        // Install the program whole, unless the labels changed can be
+        // sent alone
+        end = code.relocatable ? code.base + code.length : 0;
+
+        if (installed && code.relocatable && code.base == installed->base) {
+            length = mdrive_microcode_patch(&code, installed, &patch);
+            if (length < 0) {
+                status = ENOMEM;
+                goto exit;
+            }
+            if (installed->end + length <= code.base + 2 * code.length) {
+                send = &patch;
+                end = installed->end + length;
+            }
+        }
+        mcTraceF(10, MDRIVE_CHANNEL, "Unit has microcode %08x, installing "
+            "%08x%s", (unsigned) digest, code.digest,
+            (send == &patch) ? " (changed labels)" : "");
+
+        // The program on the unit is changed from here on
+        free(device->microcode.program);
+        device->microcode.program = NULL;
+    }
+
+    // Reset any unsaved changes (comm configuration, etc)
+    if (!mdrive_config_rollback(device)) {
+        status = EIO;
         goto exit;
-    else
+    }
+
+    if (have_program && (unsigned) program == code.program)
+        goto install;
+
+    // Clear the stored digests before the stored microcode, so that an
+    // interrupted load is not taken for an installed one later
+    if (((have_digest && digest) || (have_program && program))
+            && (!mdrive_set_variable(device, MDRIVE_MICROCODE_DIGEST, 0)
+                || !mdrive_set_variable(device, MDRIVE_MICROCODE_PROGRAM, 0)
+                || !mdrive_config_commit(device, NULL))) {
         status = EIO;
+        goto exit;
+    }
 
-safe_bail:
-    if (programming)
-        mdrive_send(device, "PG");
+    // Clear stored microcode
+    if (send == &code
+            && mdrive_communicate(device, "CP", &opts) != RESPONSE_OK) {
+        status = EIO;
+        goto exit;
+    }
+
+install:
+    // The digests go with the microcode, declared as the last lines
+    first = send->count;
+    if (!mdrive_microcode_sign(send, &code, end)) {
+        status = ENOMEM;
+        goto exit;
+    }
+    status = mdrive_microcode_send(device, send, first, &preserve);
+
+    if (status && send == &patch) {
+        mcTraceF(10, MDRIVE_CHANNEL, "Unable to patch the program (%d), "
+            "installing it whole", status);
+        end = code.base + code.length;
+        first = code.count;
+        if (mdrive_communicate(device, "CP", &opts) != RESPONSE_OK) {
+            status = EIO;
+            goto exit;
+        }
+        if (!mdrive_microcode_sign(&code, &code, end)) {
+            status = ENOMEM;
+            goto exit;
+        }
+        status = mdrive_microcode_send(device, &code, first, &preserve);
+    }
+    if (status)
+        goto exit;
+
+    // Commit the new microcode and settings to NVRAM
+    if (!mdrive_config_commit(device, &preserve)) {
+        status = EIO;
+        goto exit;
+    }
+
+    if (end > 0)
+        mdrive_microcode_record(device, &code, end);
 
 exit:
+    free(code.lines);
+    free(patch.lines);
     return status;
 }
 
@@ -252,12 +823,14 @@ mdrive_microcode_inspect(mdrive_device_t * device) {
 
     // Response string is formatted as follows
     //
-    // <ver> ... <move> <fe>
+    // <ver> ... <move> <fe> <profiles> <packed>
     //
     // Where:
     // ver - (int) microcode interface version number
     // move - (label) of the move routine
     // fe - (variable) of the following error if computed
+    // profiles - (int) slots for profiles installed by the host (0x0002)
+    // packed - (label) of the packed move routine (0x0003)
     //
     // Any of the variables and labels can be set to "-" to indicate that
     // the microcode doesn't support such a feature
@@ -295,6 +868,27 @@ mdrive_microcode_inspect(mdrive_device_t * device) {
                 device->microcode.features.following_error = true;
         }
     }
+    // The slots are emptied along with the variables of the unit when the
+    // microcode is (re)loaded
+    device->microcode.features.profiles = 0;
+    device->microcode.installed = 0;
+    if (version >= 0x0002) {
+        next = strtok_r(head, " ", &head);
+        if (next && *next != '-')
+            device->microcode.features.profiles = atoi(next);
+        if (device->microcode.features.profiles > MDRIVE_PROFILE_SLOTS)
+            device->microcode.features.profiles = MDRIVE_PROFILE_SLOTS;
+    }
+    device->microcode.features.packed_move = false;
+    if (version >= 0x0003) {
+        next = strtok_r(head, " ", &head);
+        if (next) {
+            snprintf(device->microcode.labels.packed_move,
+                sizeof device->microcode.labels.packed_move, "%s", next);
+            if (*device->microcode.labels.packed_move != '-')
+                device->microcode.features.packed_move = true;
+        }
+    }
     mcTraceF(50, MDRIVE_CHANNEL, "Unit uses move label %s",
         device->microcode.labels.move);
     mcTraceF(50, MDRIVE_CHANNEL, "Unit uses fe var %s",
@@ -0,0 +1,248 @@
+"""
+Size-optimizing passes over compiled microcode. The passes work on the
+lines emitted by the compiler, in the order they are sent to the unit, and
+are run in the order registered. Smaller microcode uploads faster and
+leaves more room on the unit.
+
+Labels and variables used by the host only (with EX or PR) cannot be told
+from dead ones, so the passes eliminating names only run if the names used
+by the host are given (the `entries` config variable). Names mentioned in
+strings are kept too -- the CF routine prints the labels and variables
+for the driver to use.
+
+Identifiers are not shortened: the grammar already limits names to the two
+characters understood by the unit.
+"""
+import re
+
+def size(lines):
+    """
+    Bytes sent to the unit for the lines, each ended with a CR
+
+    >>> size(['PG 100', 'E', 'PG'])
+    12
+    """
+    return sum(len(x) + 1 for x in lines)
+
+def words(line):
+    """
+    Names mentioned in a line, including the ones within strings
+
+    >>> sorted(words('PR "1 MV -"'))
+    ['1', 'MV', 'PR']
+    """
+    return set(re.findall(r'\w+', line))
+
+def label_of(line):
+    if line.startswith('LB '):
+        return line.split()[1]
+
+def is_program_bound(line):
+    # PG <address> or the closing PG
+    return line.split()[:1] == ['PG']
+
+def ends_block(line):
+    """
+    True if the program cannot fall through past the line
+
+    >>> ends_block('BR G8'), ends_block('BR G8, ST <> 1'), ends_block('RT')
+    (True, False, True)
+    """
+    return line in ('E', 'RT') or (line.startswith('BR ')
+        and ',' not in line)
+
+def blocks(lines):
+    """
+    Splits the lines into (label, first, end) blocks. A block runs from its
+    LB line up to the next label or the end of the program. The lines
+    outside of labels have a label of None
+    """
+    start, label = 0, None
+    for i, line in enumerate(lines):
+        if label_of(line) or is_program_bound(line):
+            if i > start:
+                yield label, start, i
+            start, label = i, label_of(line)
+    if start < len(lines):
+        yield label, start, len(lines)
+
+def fold(expression):
+    """
+    Evaluates an expression of integer constants, left to right, as the
+    unit does. Returns the expression unchanged if it is not constant or
+    the result would not fit the 32 bits of the unit
+
+    >>> fold('63000 * 2'), fold('8192 * 3 / 2'), fold('Q1 + 1')
+    ('126000', '12288', 'Q1 + 1')
+    >>> fold('-7 / 2'), fold('1 / 0'), fold('2147483647 + 1')
+    ('-3', '1 / 0', '2147483647 + 1')
+    >>> fold('- 2048'), fold('- 2048 * 2'), fold('R4 * - 1')
+    ('-2048', '-4096', 'R4 * - 1')
+    """
+    tokens = expression.split()
+    if tokens[:1] == ['-'] and len(tokens) > 1:
+        tokens[:2] = ['-' + tokens[1]]
+    if len(tokens) == 1 and tokens[0].lstrip('-').isdigit():
+        return tokens[0]
+    if len(tokens) < 3 or len(tokens) % 2 == 0:
+        return expression
+    try:
+        value = int(tokens[0])
+        for op, operand in zip(tokens[1::2], tokens[2::2]):
+            operand = int(operand)
+            if op == '+':   value += operand
+            elif op == '-': value -= operand
+            elif op == '*': value *= operand
+            elif op == '&': value &= operand
+            elif op == '|': value |= operand
+            elif op == '^': value ^= operand
+            elif op == '/' and operand:
+                quotient = abs(value) // abs(operand)
+                value = quotient if (value < 0) == (operand < 0) else -quotient
+            else:
+                return expression
+            if not -2**31 <= value < 2**31:
+                return expression
+    except ValueError:
+        return expression
+    return str(value)
+
+class Optimizer(object):
+    passes = []
+
+    def __init__(self, lines, entries=None):
+        self.lines = list(lines)
+        self.entries = set(entries or ())
+        self.report = []
+
+    @classmethod
+    def add_pass(cls, what):
+        cls.passes.append(what)
+        return what
+
+    def optimize(self):
+        """
+        Runs the passes over the lines. The size of the microcode before
+        and after each pass is kept in [report] as (pass, before, after)
+        """
+        for each in self.passes:
+            before = size(self.lines)
+            self.lines = each(self, self.lines)
+            self.report.append((each.__name__, before, size(self.lines)))
+        return self.lines
+
+    def mentions(self, lines, name, exclude=None):
+        # Times the name is mentioned other than by the excluded line
+        return sum(1 for i, x in enumerate(lines)
+            if i != exclude and name in words(x))
+
+@Optimizer.add_pass
+def fold_constants(self, lines):
+    """
+    Folds the constant arguments of assignments and commands, such as the
+    config values substituted by the compiler
+    """
+    result = []
+    for line in lines:
+        if '"' in line or line.startswith(('LB ', 'PG', 'VA ')):
+            result.append(line)
+            continue
+        if ' = ' in line:
+            head, args = line.split(' = ', 1)
+            head += ' = '
+        elif ' ' in line:
+            head, args = line.split(' ', 1)
+            head += ' '
+        else:
+            result.append(line)
+            continue
+        args = [x.strip() for x in args.split(',')]
+        # A compare is not folded, nor is the label of a branch or call
+        result.append(head + ', '.join(fold(x) if not re.search(
+            r'[<>=]', x) else x for x in args))
+    return result
+
+@Optimizer.add_pass
+def dead_labels(self, lines):
+    """
+    Removes the labels not referenced anywhere, unless the program could
+    fall into one from the code before it. Repeated as removing a label
+    can leave others unreferenced
+    """
+    if not self.entries:
+        return lines
+    while True:
+        for label, start, end in blocks(lines):
+            if not label or label in self.entries \
+                    or self.mentions(lines, label, exclude=start):
+                continue
+            elif start == 0 or not (ends_block(lines[start - 1])
+                    or is_program_bound(lines[start - 1])):
+                continue
+            lines = lines[:start] + lines[end:]
+            break
+        else:
+            return lines
+
+@Optimizer.add_pass
+def dead_variables(self, lines):
+    """
+    Removes the declarations of variables not mentioned anywhere else
+    """
+    if not self.entries:
+        return lines
+    return [x for i, x in enumerate(lines) if not (x.startswith('VA ')
+        and x.split()[1] not in self.entries
+        and not self.mentions(lines, x.split()[1], exclude=i))]
+
+@Optimizer.add_pass
+def inline_labels(self, lines):
+    """
+    Inlines the labels called once, unconditionally, and not referenced
+    otherwise. The body of the label must end with its only RT (followed by
+    the E closing the label, if any) and must not branch, so that returning
+    is the only way out of it. As compiled:
+
+    >>> import sys, tempfile
+    >>> from compile.parse import Parser
+    >>> source = tempfile.NamedTemporaryFile(mode='w', suffix='.mxt')
+    >>> _ = source.write('PG 100\\nLB M0\\n CL P0\\n VM = 10\\nE\\n'
+    ...     'LB P0\\n A = 100\\n D = 100\\n RT\\nE\\nPG\\n')
+    >>> source.flush()
+    >>> argv, parser = sys.argv[:], Parser()
+    >>> _ = parser.parse(source.name); _ = parser.compile()
+    >>> sys.argv[:] = argv
+    >>> print('; '.join(parser.r))
+    PG 100; LB M0; CL P0; VM = 10; E; LB P0; A = 100; D = 100; RT; E; PG
+    >>> print('; '.join(inline_labels(Optimizer([], ['M0']), parser.r)))
+    PG 100; LB M0; A = 100; D = 100; VM = 10; E; PG
+    """
+    # Labels run by the host only would look called once (or never)
+    if not self.entries:
+        return lines
+    while True:
+        for label, start, end in blocks(lines):
+            if not label or label in self.entries:
+                continue
+            body = lines[start + 1:end]
+            if body[-2:] == ['RT', 'E']:
+                body = body[:-1]
+            if not body or body[-1] != 'RT' or 'RT' in body[:-1] \
+                    or 'E' in body[:-1] \
+                    or any(x.startswith(('BR ', 'LB ', 'VA ')) for x in body):
+                continue
+            elif start == 0 or not (ends_block(lines[start - 1])
+                    or is_program_bound(lines[start - 1])):
+                continue
+            calls = [i for i, x in enumerate(lines) if x == 'CL ' + label]
+            if len(calls) != 1 or self.mentions(lines, label,
+                    exclude=start) != 1 or start < calls[0] < end:
+                continue
+            call = calls[0]
+            lines = lines[:start] + lines[end:]
+            if call > start:
+                call -= end - start
+            lines = lines[:call] + body[:-1] + lines[call + 1:]
+            break
+        else:
+            return lines
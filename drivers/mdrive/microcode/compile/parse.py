@@ -2,6 +2,7 @@ from __future__ import print_function
 
 from . import overloaded
 from .compiler import Compiler
+from .optimize import Optimizer
 from .grammar import language
 
 from .pyPEG import parse
@@ -31,12 +32,56 @@ class Parser(object):
         self.r.extend(self.compiler.compile(self.ast))
         return self.r
 
+    def optimize(self, entries=None):
+        """
+        Runs the size-optimizing passes over the compiled microcode (see
+        optimize.py). [entries] are the labels and variables used by the
+        host, without which the dead ones are not removed. Returns the size
+        of the microcode before and after each pass, as (pass, before,
+        after)
+        """
+        optimizer = Optimizer(self.r, entries)
+        self.r = optimizer.optimize()
+        return optimizer.report
+
+    def report_optimize(self, report, where):
+        for name, before, after in report:
+            where.write("{0}: {1} -> {2} bytes\n".format(name, before, after))
+
     def compose(self, where, declarations=False):
         self.compiler.check()
         for line in self.r:
             if line.startswith('VA') == declarations:
                 where.write(line + '\n')
 
+    def manifest(self):
+        """
+        Returns the labels of the compiled microcode, in order, with the
+        digest of the lines of each (up to the next label or the end of
+        the program, declarations aside). The digest is the FNV-1a hash of
+        the lines as sent to the unit by the loader, each ended with a CR
+        (see drivers/mdrive/microcode.c)
+        """
+        labels = []
+        for line in self.r:
+            if line.startswith('LB '):
+                labels.append([line.split()[1], 2166136261])
+            elif line.split()[:1] == ['PG']:
+                labels.append(None)
+            if not labels or labels[-1] is None or line.startswith('VA') \
+                    or line == 'S':
+                continue
+            for c in bytearray((line + '\r').encode('ascii')):
+                labels[-1][1] = ((labels[-1][1] ^ c) * 16777619) & 0xffffffff
+        return [tuple(x) for x in labels if x is not None]
+
+    def compose_manifest(self, where):
+        """
+        Writes the manifest of the labels as comments, read by the loader
+        """
+        for name, digest in self.manifest():
+            where.write("'@ LB {0} {1:08x}\n".format(name, digest))
+
     def has_program_entry(self):
         """
         Returns true if the parsed microcode has a line with 'PG XX'
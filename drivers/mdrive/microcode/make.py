@@ -41,5 +41,10 @@ for axis in config.sections():
 
     p.parse(*modules)
     p.compile()
+    if vars.get('optimize'):
+        p.report_optimize(p.optimize(vars.get('entries', '').split()),
+            sys.stdout)
 
-    p.compose(open('{0}-axis.mtx'.format(axis), 'wt'))
+    output = open('{0}-axis.mtx'.format(axis), 'wt')
+    p.compose_manifest(output)
+    p.compose(output)
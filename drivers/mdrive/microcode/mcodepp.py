@@ -2,13 +2,24 @@ from __future__ import print_function
 
 from compile import parse
 
+import getopt
 import sys
 
+opts, files = getopt.getopt(sys.argv[1:], 'Oe:')
+opts = dict(opts)
+
 p = parse.Parser(environ={'DEBUG': False})
 
-p.parse(*sys.argv[1:])
+p.parse(*files)
 p.compile()
 
+# Optimize for size (-O), with the names used by the host (-e "A B ...")
+if '-O' in opts:
+    p.report_optimize(p.optimize(opts.get('-e', '').split()), sys.stderr)
+
+# Manifest of the labels, for the loader
+p.compose_manifest(sys.stdout)
+
 # Send declarations
 p.compose(sys.stdout, declarations=True)
 
@@ -1,8 +1,11 @@
 #include "mdrive.h"
 
+#include "estimate.h"
 #include "events.h"
 #include "motion.h"
+#include "poller.h"
 #include "serial.h"
+#include "io.h"
 #include "profile.h"
 
 #include <errno.h>
@@ -58,24 +61,32 @@ mdrive_move(Driver * self, motion_instruction_t * command) {
             return ENOTSUP;
     }
 
-    int status = mdrive_drive_enable(device);
-    if (status)
-        return status;
+    int status;
 
     device->movement = move_info;
     clock_gettime(CLOCK_REALTIME, &device->movement.start);
 
     if (device->microcode.features.move) {
+        // The move routine energizes the coils itself
         status = mdrive_move_assisted(device, command, steps);
         if (status)
             return status;
+        device->drive_enabled = true;
     }
     else {
-        mdrive_set_profile(device, &command->profile);
+        status = mdrive_drive_enable(device);
+        if (status)
+            return status;
+        status = mdrive_set_profile(device, &command->profile);
+        if (status)
+            return status;
         if (RESPONSE_OK != mdrive_send(device, buffer))
             return EIO;
     }
 
+    // A status polled before the move is of no use
+    mdrive_poller_kick(device);
+
     // Signal completion event -- cancel in-progress one first
     mdrive_async_complete_cancel(device);
     if (command->type != MCSLEW)
@@ -113,79 +124,51 @@ mdrive_move_assisted(mdrive_device_t * device, motion_instruction_t * command,
     }
 
     // Configure hardware profile if current motor profile has the hardware
-    // flag set
-    if (command->profile.attrs.hardware)
+    // flag set. Slots for the host's profiles must have been installed
+    int number = command->profile.attrs.number;
+    if (command->profile.attrs.hardware && (!device->microcode.features.profiles
+            || device->microcode.installed & (1 << number)))
         R1.profile = command->profile.attrs.number;
-    else
-        mdrive_set_profile(device, &command->profile);
+    else {
+        int status = mdrive_set_profile(device, &command->profile);
+        if (status)
+            return status;
+    }
 
+    int op = R1.mode + (R1.profile << 3) + (R1.reset_pos << 6);
     char buffer[64];
-    snprintf(buffer, sizeof buffer, "R1=%d", R1.mode + (R1.profile << 3)
-        + (R1.reset_pos << 6));
-    if (mdrive_send(device, buffer))
-        return EIO;
 
-    snprintf(buffer, sizeof buffer, "R2=%d", steps);
-    if (mdrive_send(device, buffer))
-        return EIO;
+    // The packed move routine takes the amount along with the mode in R1
+    // (as R1 / 128), so that the move is a single assignment and the EX.
+    // Otherwise, the mode and the amount are assigned separately
+    if (device->microcode.features.packed_move
+            && steps >= -MDRIVE_PACKED_STEPS && steps < MDRIVE_PACKED_STEPS) {
+        snprintf(buffer, sizeof buffer, "R1=%lld", op + steps * 128LL);
+        if (mdrive_send(device, buffer))
+            return EIO;
 
-    snprintf(buffer, sizeof buffer, "EX %s", device->microcode.labels.move);
-    if (mdrive_send(device, buffer))
-        return EIO;
+        snprintf(buffer, sizeof buffer, "EX %s",
+            device->microcode.labels.packed_move);
+    }
+    else {
+        snprintf(buffer, sizeof buffer, "R1=%d", op);
+        if (mdrive_send(device, buffer))
+            return EIO;
 
-    return 0;
-}
+        snprintf(buffer, sizeof buffer, "R2=%d", steps);
+        if (mdrive_send(device, buffer))
+            return EIO;
 
-struct travel_time_info {
-    double  accel_time;
-    double  decel_time;
-};
+        snprintf(buffer, sizeof buffer, "EX %s",
+            device->microcode.labels.move);
+    }
+    if (mdrive_send(device, buffer))
+        return EIO;
 
-/**
- * travel_to_time
- *
- * Estimates the unit's travel time for the specified travel distance.
- *
- * If the unit does not reach the maximum velocity, the unit's velocity
- * curve will look like
- *
- *   v ^
- *     |       /\
- *     |     /    \
- *     |   /        \
- * VI _| /            \
- *     | |              \
- *     +-+------+--------+-> t
- *       t=0   t@VM     t@rest
- *
- * Where the unit will start from VI, accelerate to some maximum velocity
- * and then decelerate to a complete stop. The area under this curve
- * represents the distance traveled, and the total time (t@rest) is what is
- * sought.
- *
- * Patameters:
- * info - (struct travel_time_info *) which will receive the information
- *      about the travel time including the amount of time spent
- *      accelerating and the amount of time spent decelerating.
- *
- * Returns:
- * EINVAL if the unit will reach the current profile's vmax. 0 upon success.
- */
-static int
-travel_to_time(mdrive_device_t * device, long long urevs,
-        struct travel_time_info * info) {
-    double A = device->profile.accel.value;
-    double D = device->profile.decel.value;
-    double VI = device->profile.vstart.value;
-    double VM = sqrt(((urevs * 2 * A * D) - (D * VI * VI)) / (A + D));
-
-    if (VM > device->profile.vmax.value)
-        return EINVAL;
+    // The unit now has the profile of the slot
+    if (R1.profile)
+        mdrive_profile_selected(device, R1.profile);
 
-    *info = (struct travel_time_info) {
-        .accel_time = ((VM - VI) / A),
-        .decel_time = (VM / D)
-    };
     return 0;
 }
 
@@ -193,15 +176,16 @@ travel_to_time(mdrive_device_t * device, long long urevs,
  * mdrive_project_completion
  *
  * Estimates the resting time, from the start of the move operation, of the
- * motor for the move descrived in the the given motion_details. Projected
- * time of completion is stored as an absolute (struct timespec) value into
- * the detail->projected member. Also, the parts of the move are broken down
- * in to time spent accelerating and time spent decelerating. Those pieces
- * are saved into the details->vmax_us and details->decel_us respectively.
- * The times will reflect the time when the motor is expected to reach the
- * maximum velocity of the move and the time when the motor is expected to
- * start decelerating. Both figures are in micro-seconds from the start of
- * the move (details->start).
+ * motor for the move descrived in the the given motion_details. The travel
+ * of the unit is planned with the device's profile (see kinematics.h) into
+ * details->plan. Projected time of completion is stored as an absolute
+ * (struct timespec) value into the detail->projected member. Also, the
+ * parts of the move are broken down in to time spent accelerating and time
+ * spent decelerating. Those pieces are saved into the details->vmax_us and
+ * details->decel_us respectively. The times will reflect the time when the
+ * motor is expected to reach the maximum velocity of the move and the time
+ * when the motor is expected to start decelerating. Both figures are in
+ * micro-seconds from the start of the move (details->start).
  *
  * If the unit will never reach the profile VMAX, the vmax_us and decel_us
  * times will have the same value, because the unit will start decelerating
@@ -218,40 +202,18 @@ travel_to_time(mdrive_device_t * device, long long urevs,
 int
 mdrive_project_completion(mdrive_device_t * device,
         struct motion_details * details) {
-    // Acceleration ramp
-    double ramp = device->profile.vmax.value - device->profile.vstart.value,
-    // Acceleration ramp and distance traveled during accel
-           t1 = ramp / device->profile.accel.value,
-           distance = ((ramp / 2) + device->profile.vstart.value) * t1,
-    // Time at VM
-           t2,
-    // Deceleration ramp and distance traveled during decel
-           t3 = 1. * device->profile.vmax.value / device->profile.decel.value;
-    distance += (device->profile.vmax.value >> 1) * t3;
-
-    // And the remaining distance, performed at vmax
-    double rem = fabs(details->urevs) - distance;
-
-    // Now total time (in nano-seconds) is t1 + t2 + t3
-    long long total;
-
-    if (rem < 0) {
-        // Unit will never reach vmax and will start decelerating at the
-        // intersection of the acceleration and deceleration curves.
-        struct travel_time_info info;
-        if (travel_to_time(device, abs(details->urevs), &info))
-            return EINVAL;
-
-        details->vmax_us = details->decel_us = info.accel_time * 1e6;
-        total = (info.accel_time + info.decel_time) * 1e9;
-    }
-    else {
-        t2 = rem / device->profile.vmax.value;
+    kinematics_t * plan = &details->plan;
 
-        details->vmax_us = t1 * 1e6;
-        details->decel_us = (t1 + t2) * 1e6;
-        total = (t1 + t2 + t3) * 1e9;
-    }
+    if (kinematics_plan(plan, details->urevs, device->profile.vstart.value,
+            device->profile.vmax.value, device->profile.accel.value,
+            device->profile.decel.value))
+        return EINVAL;
+
+    details->vmax_us = plan->t_peak * 1e6;
+    details->decel_us = plan->t_decel * 1e6;
+
+    // Total time in nano-seconds
+    long long total = plan->t_rest * 1e9;
 
     struct timespec duration = {
         .tv_sec =   total / (int)1e9,
@@ -266,87 +228,79 @@ mdrive_project_completion(mdrive_device_t * device,
     return 0;
 }
 
+/**
+ * mdrive_estimate_position_at
+ *
+ * Estimates the travel of the unit [when] microseconds into the move
+ * planned by mdrive_project_completion.
+ *
+ * Returns:
+ * (int) steps traveled from the start of the move, in the direction of
+ * the move
+ */
 int
 mdrive_estimate_position_at(mdrive_device_t * device,
         struct motion_details * details, int when) {
+    double urevs = kinematics_position(&details->plan, when / 1e6);
 
-    // Travel time is time in microseconds into the device movement. See if
-    // we are traveling at vmax, decelerating or still accelerating
-    int phase, dt_us;
-    long long pos_urev=0;
-    // TODO: Add case for motion already completed
-    if (details->decel_us < when)
-        // Unit is now decelerating
-        phase = 3;
-    else if (details->vmax_us < when)
-        // Unit is traveling at vmax
-        phase = 2;
-    else 
-        // Unit is accelerating
-        phase = 1;
-
-    switch (phase) {
-        case 3:
-            // Add decel ramp time. Change in position is velocity * time.
-            // Velocity is vmax - (decel * dt)
-            dt_us = when - details->decel_us;
-            pos_urev += dt_us
-                * (device->profile.decel.value * dt_us)
-                / (int)2e6;
-        case 2:
-            // Add travel time at vmax
-            pos_urev += device->profile.vmax.value
-                * (min(when, details->decel_us) - details->vmax_us);
-        case 1:
-            // Add accel ramp time
-            dt_us = min(when, details->vmax_us);
-            pos_urev += dt_us
-                * (device->profile.vstart.value
-                    + (device->profile.accel.value * dt_us))
-                / (int)2e6;
-    }
-    return mdrive_microrevs_to_steps(device, pos_urev / (int)1e6);
+    if (details->urevs < 0)
+        urevs = -urevs;
+
+    return mdrive_microrevs_to_steps(device, llround(urevs));
 }
 
+static void *
+mdrive_async_completion_correct(void * arg);
+
+// Read of the unit taken for the completion of a move. It is submitted to
+// the I/O threads of the port, so that the (single) timer thread is not
+// held up on the port while other callbacks are due
+struct mdrive_completion_read {
+    mdrive_request_t    request;
+    int                 callback_id;    // Of the correction taking it
+    struct timespec     taken;          // Time the correction was called
+    int                 count;          // Of variables read
+};
+
 /**
- * 
- * (Callback) mdrive_async_completion_correct
+ * mdrive_completion_check
  *
- * Called at (half of the) device latency seconds before the expected
- * completion of a movement. This routine should collect the current device
- * position and compare it against the expected device position. From there,
- * estimated following error can be projected, and the estimated time of
- * completion can be adjusted based on the position error.
+ * Compares the position read by [read] against the expected device
+ * position. From there, estimated following error can be projected, and
+ * the estimated time of completion can be adjusted based on the position
+ * error.
+ *
+ * If the motor is at rest when read (optimal), the EV_MOTION event will be
+ * signaled and the details about the move will be included with the event
+ * data.
  *
- * If the motor is at rest when the callback is performed (optimal), the
- * EV_MOTION event will be signaled and the details about the move will be
- * included with the event data.
+ * Returns:
+ * (bool) true if the unit is to be read again (the read failed)
  */
-static void *
-mdrive_async_completion_correct(void * arg) {
-    mdrive_device_t * device = arg;
+static bool
+mdrive_completion_check(struct mdrive_completion_read * read) {
+    mdrive_device_t * device = read->request.device;
+    int stalled, pos, vel, error,
+        * vals[] = { &stalled, &pos, &vel, &error };
 
-    // Detect if this callback is canceled while in progress
-    int callback_id = device->cb_complete;
+    // Check for possible race. If a callback has been scheduled since the
+    // read was taken, than anoter, completely new move is in progress, and
+    // this move should be abandoned.
+    // XXX: Consider a lock on cb_complete to make this easier to manage
+    if (read->callback_id != device->cb_complete)
+        return false;
 
-    struct timespec now;
-    clock_gettime(CLOCK_REALTIME, &now);
+    if (read->request.status != RESPONSE_OK
+            || mdrive_parse_integers(&read->request.result, vals, read->count))
+        return true;
 
     // Estimate error
     // Estimate current position
     // Compute time in travel (in microseconds)
-    int travel_time = (now.tv_sec - device->movement.start.tv_sec) * (int)1e6;
-    travel_time += (now.tv_nsec - device->movement.start.tv_nsec) / 1000;
-
-    const char * vars[] = {"ST", "P", "V",
-        device->microcode.labels.following_error };
-    int stalled, pos, vel, error, count = 4,
-        * vals[] = { &stalled, &pos, &vel, &error };
-
-    if (!device->microcode.features.following_error)
-        count--;
-
-    while (mdrive_get_integers(device, vars, vals, count));
+    int travel_time = (read->taken.tv_sec - device->movement.start.tv_sec)
+        * (int)1e6;
+    travel_time += (read->taken.tv_nsec - device->movement.start.tv_nsec)
+        / 1000;
 
     if (!device->microcode.features.following_error) {
         // Add (half-of) comm latency time (ns -> us)
@@ -359,12 +313,6 @@ mdrive_async_completion_correct(void * arg) {
         expected += device->movement.pstart;
         error = pos - expected;
     }
-    // Check for possible race. If a callback has been scheduled since we
-    // started at the top of this procedure, than anoter, completely new
-    // move is in progress, and this move should be abandoned.
-    // XXX: Consider a lock on cb_complete to make this easier to manage
-    if (callback_id != device->cb_complete)
-        return NULL;
 
     bool completed = true;
 
@@ -386,10 +334,9 @@ mdrive_async_completion_correct(void * arg) {
         //
         // The change in time is the base of the triangle. The slope of the
         // decel line is the unit's decel value, which will also equal the
-        // rise over the run or v / dt. Therefore, dt = v / D, if D is
-        // considered a positive value.
-        double dt = 1. * mdrive_steps_to_microrevs(device, abs(vel))
-            / device->profile.decel.value;
+        // rise over the run or v / dt -- down to VI, where the unit stops.
+        double urev_vel = mdrive_steps_to_microrevs(device, abs(vel)),
+            dt = kinematics_stopping_time(&device->movement.plan, urev_vel);
         struct timespec callback = {
             .tv_sec = (int)dt,
             .tv_nsec = (int)1e9 * (dt - (int)dt)
@@ -398,11 +345,12 @@ mdrive_async_completion_correct(void * arg) {
             // For all intents and purposes, the unit is stopped, because we
             // won't be able to communicate with it again until well after
             // it stops. Estimate the resting position of the unit and move
-            // on.  dt is units of seconds and vel is units of steps per
-            // second.  The area under the above triangle will be the
-            // distance travelled by the unit, which is 1/2 * b * h
-            // or 1/2 * dt * v
-            device->position = pos + dt * (vel >> 1);
+            // on. The area under the above ramp will be the distance
+            // travelled by the unit
+            device->position = pos + ((vel < 0) ? -1 : 1)
+                * mdrive_microrevs_to_steps(device, llround(
+                    kinematics_stopping_distance(&device->movement.plan,
+                        urev_vel)));
         else {
             mcTraceF(50, MDRIVE_CHANNEL, "Early. Callback in %dns",
 		        callback.tv_nsec);
@@ -420,9 +368,12 @@ mdrive_async_completion_correct(void * arg) {
         }
     }
     // Record the last-known position
-    else
+    else {
         // Device is rested and current position is known
         device->position = pos;
+        device->movement.moving = false;
+        mdrive_estimate_confirm(device, pos, true);
+    }
 
     if (completed) {
         // Disarm the timer
@@ -440,6 +391,86 @@ mdrive_async_completion_correct(void * arg) {
         mcTrace(10, MDRIVE_CHANNEL, "Signalling EV_MOTION event");
         mdrive_signal_event(device, EV_MOTION, &data);
     }
+    return false;
+}
+
+/**
+ * mdrive_completion_read
+ *
+ * Submits [read] to the I/O threads of the port of the [device], or takes
+ * it from the calling thread if it cannot be submitted. The read is freed
+ * once checked.
+ */
+static void
+mdrive_completion_read(mdrive_device_t * device,
+        struct mdrive_completion_read * read) {
+    if (mdrive_submit(device, &read->request) == 0)
+        return;
+
+    // No I/O thread to run it
+    read->request.device = device;
+    read->request.options.result = &read->request.result;
+    do {
+        read->request.status = mdrive_communicate(device,
+            read->request.command, &read->request.options);
+    } while (mdrive_completion_check(read));
+    free(read);
+}
+
+/**
+ * (Callback) mdrive_completion_read_done
+ *
+ * Called by the I/O thread of the port when a read submitted by
+ * mdrive_async_completion_correct is complete.
+ */
+static void
+mdrive_completion_read_done(mdrive_request_t * request, void * arg) {
+    struct mdrive_completion_read * read = arg;
+
+    if (mdrive_completion_check(read))
+        mdrive_completion_read(request->device, read);
+    else
+        free(read);
+}
+
+/**
+ * 
+ * (Callback) mdrive_async_completion_correct
+ *
+ * Called at (half of the) device latency seconds before the expected
+ * completion of a movement. This routine collects the current device
+ * position, velocity and stall flag (and following error, if the microcode
+ * tracks it), which are compared against the expected device position by
+ * mdrive_completion_check when read.
+ */
+static void *
+mdrive_async_completion_correct(void * arg) {
+    mdrive_device_t * device = arg;
+    struct mdrive_completion_read * read;
+
+    const char * vars[] = {"ST", "P", "V",
+        device->microcode.labels.following_error };
+
+    read = calloc(1, sizeof *read);
+    if (read == NULL)
+        return NULL;
+
+    // Detect if this callback is canceled while in progress
+    read->callback_id = device->cb_complete;
+    clock_gettime(CLOCK_REALTIME, &read->taken);
+
+    read->count = 4;
+    if (!device->microcode.features.following_error)
+        read->count--;
+
+    mdrive_integers_command(read->request.command,
+        sizeof read->request.command, vars, read->count);
+    read->request.options.expect_data = true;
+    read->request.callback = mdrive_completion_read_done;
+    read->request.arg = read;
+
+    mdrive_completion_read(device, read);
+
     return NULL;        // Just for compiler warnings
 }
 
@@ -515,6 +546,7 @@ mdrive_drive_enable(mdrive_device_t * device) {
         return EINVAL;
     else if (!device->drive_enabled && !mdrive_set_variable(device, "DE", 1))
         return EIO;
+    device->drive_enabled = true;
     return 0;
 }
 
@@ -524,6 +556,7 @@ mdrive_drive_disable(mdrive_device_t * device) {
         return EINVAL;
     else if (device->drive_enabled && !mdrive_set_variable(device, "DE", 0))
         return EIO;
+    device->drive_enabled = false;
     return 0;
 }
 
@@ -584,28 +617,35 @@ mdrive_stop(Driver * self, enum stop_type type) {
     mdrive_device_t * device = self->internal;
     mdrive_device_t global;
 
-    // Unit won't be moving any more
+    // Stops go out ahead of the other traffic waiting for the port
+    struct mdrive_send_opts options = {
+        .priority = MDRIVE_PRIORITY_EMERGENCY
+    };
+
+    // Unit won't be moving any more, and will come to rest somewhere
     bzero(&device->movement, sizeof device->movement);
+    mdrive_estimate_lost(device);
+    mdrive_poller_kick(device);
 
     // Cancel motion completion callback event if any
     mdrive_async_complete_cancel(device);
 
     switch (type) {
         case MCSTOP:
-            return mdrive_send(device, "SL 0");
+            return mdrive_communicate(device, "SL 0", &options);
         case MCHALT:
             // Handle non-addressed mode (ES) where multiple responses will
             // be received from this command.
-            return mdrive_send(device, "\x1b");
+            return mdrive_communicate(device, "\x1b", &options);
         case MCESTOP:
             global = *device;
             global.address = '*';
             // XXX: Detect if the targeted device does not have party mode
             // XXX: Send with checksum toggled too, for safety
-            if (mdrive_send(&global, "\x1b"))
+            if (mdrive_communicate(&global, "\x1b", &options))
                 return EIO;
             // XXX: DE the motors too
-            if (mdrive_send(&global, "DE=0"))
+            if (mdrive_communicate(&global, "DE=0", &options))
                 return EIO;
         default:
             return ENOTSUP;
@@ -618,12 +658,18 @@ mdrive_home(Driver * self, enum home_type type, enum home_direction dir) {
         return EINVAL;
 
     mdrive_device_t * motor = self->internal;
+    int status;
 
     switch (type) {
         case MCHOMEDEF:
             // XXX: Move to configuration or to firmware:
             // "EX CF" -> "xx xx M1 ..." <-- #3 is homing label
-            return mdrive_send(motor, "EX M1");
+            status = mdrive_send(motor, "EX M1");
+            // A status polled before homing is of no use, and the unit
+            // will rest somewhere unplanned
+            mdrive_poller_kick(motor);
+            mdrive_estimate_lost(motor);
+            return status;
         case MCHOMESTOP:
             // TODO: Home to hard stop, use microcode if supported
         default:
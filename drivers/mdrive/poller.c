@@ -0,0 +1,264 @@
+#include "mdrive.h"
+#include "poller.h"
+
+#include "serial.h"
+
+#include <errno.h>
+#include <strings.h>
+#include <time.h>
+
+// XXX: Use a stinkin' header file include
+extern void tsAdd(const struct timespec *, const struct timespec *,
+    struct timespec *);
+extern long long nsecDiff(struct timespec *, struct timespec *);
+
+/*
+ * The status of the axes of a port can be sampled in the background, so
+ * that reads of the position, velocity and motion state are answered from
+ * the last sample rather than with a round-trip each. Clients polling the
+ * same axes then cost one transaction per axis per poll period in total,
+ * regardless of their number.
+ *
+ * One thread per port polls the axes round-robin, each with a single
+ * combined PR. Axes in motion are polled every [poll_interval]
+ * milliseconds; idle ones MDRIVE_POLL_IDLE_FACTOR times less often. Moves
+ * started (by mdrive_move, mdrive_home or an executed label) and variables
+ * set through the driver discard the last sample of the axis and have it
+ * polled right away.
+ */
+
+// Idle axes are polled this many times less often than moving ones
+#define MDRIVE_POLL_IDLE_FACTOR 10
+
+static const char * poll_variables[] = { "P", "V", "MV", "ST" };
+
+static long long
+mdrive_poll_period(mdrive_device_t * device) {
+    long long period = device->comm->poll_interval * 1000000LL;
+
+    return device->status.moving ? period : period * MDRIVE_POLL_IDLE_FACTOR;
+}
+
+/**
+ * mdrive_poller
+ *
+ * Body of the poller thread of a port. Polls the axis due first, and
+ * sleeps until the next one is due. Runs until the interval of the port
+ * is set to zero.
+ */
+static void *
+mdrive_poller(void * arg) {
+    mdrive_comm_device_t * comm = arg;
+    mdrive_device_t * axis, * next;
+    struct mdrive_status sample;
+    struct timespec now, period;
+    int * values[] = { &sample.position, &sample.velocity, &sample.moving,
+        &sample.stalled };
+    long long nsec;
+    int status;
+
+    pthread_mutex_lock(&comm->rxlock);
+    while (comm->poll_interval) {
+        // Units don't reply to the global address
+        for (axis = comm->axes, next = NULL; axis; axis = axis->next_axis)
+            if (axis->address != '*' && (next == NULL
+                    || nsecDiff(&axis->status.due, &next->status.due) < 0))
+                next = axis;
+
+        clock_gettime(CLOCK_REALTIME, &now);
+        if (next == NULL) {
+            pthread_cond_wait(&comm->poll_wake, &comm->rxlock);
+            continue;
+        }
+        else if (nsecDiff(&next->status.due, &now) > 0) {
+            pthread_cond_timedwait(&comm->poll_wake, &comm->rxlock,
+                &next->status.due);
+            continue;
+        }
+
+        // The axis cannot be disconnected while being polled
+        comm->polling = next;
+        next->status.kicked = false;
+        pthread_mutex_unlock(&comm->rxlock);
+
+        status = mdrive_get_integers(next, poll_variables, values,
+            sizeof values / sizeof *values);
+        clock_gettime(CLOCK_REALTIME, &now);
+
+        pthread_mutex_lock(&comm->rxlock);
+        // Kicked while being polled -- the sample might predate the kick,
+        // and the axis is due again
+        if (!next->status.kicked) {
+            if (status == 0) {
+                sample.taken = now;
+                sample.kicked = false;
+                next->status = sample;
+            }
+            nsec = mdrive_poll_period(next);
+            period = (struct timespec) {
+                .tv_sec = nsec / 1000000000, .tv_nsec = nsec % 1000000000 };
+            tsAdd(&now, &period, &next->status.due);
+        }
+        comm->polling = NULL;
+        pthread_cond_broadcast(&comm->has_data);
+    }
+    pthread_mutex_unlock(&comm->rxlock);
+
+    return NULL;
+}
+
+/**
+ * mdrive_poller_start
+ *
+ * Starts polling the status of the axes on the port, or changes the
+ * period of the polling. Axes in motion are polled every [interval]
+ * milliseconds. An [interval] of zero stops the poller.
+ *
+ * Returns:
+ * (int) 0 upon success, EINVAL for a negative interval, errno from
+ * pthread_create otherwise
+ */
+int
+mdrive_poller_start(mdrive_comm_device_t * comm, int interval) {
+    int status = 0;
+
+    if (interval < 0)
+        return EINVAL;
+    else if (interval == 0) {
+        mdrive_poller_stop(comm);
+        return 0;
+    }
+
+    pthread_mutex_lock(&comm->rxlock);
+    if (comm->poll_interval == 0)
+        status = pthread_create(&comm->poll_thread, NULL, mdrive_poller, comm);
+    if (status == 0)
+        comm->poll_interval = interval;
+    pthread_cond_signal(&comm->poll_wake);
+    pthread_mutex_unlock(&comm->rxlock);
+
+    return status;
+}
+
+void
+mdrive_poller_stop(mdrive_comm_device_t * comm) {
+    mdrive_device_t * axis;
+    bool running;
+
+    pthread_mutex_lock(&comm->rxlock);
+    running = comm->poll_interval != 0;
+    comm->poll_interval = 0;
+    pthread_cond_signal(&comm->poll_wake);
+    pthread_mutex_unlock(&comm->rxlock);
+
+    if (running)
+        pthread_join(comm->poll_thread, NULL);
+
+    // Samples are not refreshed any more
+    pthread_mutex_lock(&comm->rxlock);
+    for (axis = comm->axes; axis; axis = axis->next_axis)
+        bzero(&axis->status, sizeof axis->status);
+    pthread_mutex_unlock(&comm->rxlock);
+}
+
+/**
+ * mdrive_poller_kick
+ *
+ * Discards the last sample of the status of the device, and has the
+ * device polled right away. Used when the device was just told to move or
+ * had its status changed otherwise.
+ */
+void
+mdrive_poller_kick(mdrive_device_t * device) {
+    mdrive_comm_device_t * comm = device->comm;
+
+    if (comm == NULL)
+        return;
+
+    pthread_mutex_lock(&comm->rxlock);
+    device->status = (struct mdrive_status) { .kicked = true };
+    if (comm->poll_interval)
+        pthread_cond_signal(&comm->poll_wake);
+    pthread_mutex_unlock(&comm->rxlock);
+}
+
+/**
+ * mdrive_poller_lookup
+ *
+ * Answers a read of the position (steps), velocity, motion or stall state
+ * of the device from the last status sampled by the poller of its port.
+ * The sample is used if taken no more than [max_age] milliseconds ago. If
+ * [max_age] is zero, the sample is used if taken within twice the period
+ * the device is polled at. If negative, the sample is not used.
+ *
+ * Returns:
+ * (bool) TRUE if [value] was set from the sample, FALSE if the device
+ * should be read instead
+ */
+bool
+mdrive_poller_lookup(mdrive_device_t * device, motor_query_t query,
+        int max_age, int * value) {
+    mdrive_comm_device_t * comm = device->comm;
+    struct timespec now;
+    long long age, limit;
+    bool found = false;
+
+    if (comm == NULL || comm->poll_interval == 0 || max_age < 0)
+        return false;
+
+    clock_gettime(CLOCK_REALTIME, &now);
+
+    pthread_mutex_lock(&comm->rxlock);
+    if (device->status.taken.tv_sec == 0 || comm->poll_interval == 0)
+        goto out;
+
+    age = nsecDiff(&now, &device->status.taken);
+    limit = max_age ? max_age * 1000000LL : 2 * mdrive_poll_period(device);
+    if (age > limit)
+        goto out;
+
+    found = true;
+    switch (query) {
+        case MCPOSITION:
+            *value = device->status.position;
+            break;
+        case MCVELOCITY:
+            *value = device->status.velocity;
+            break;
+        case MCMOVING:
+            *value = device->status.moving;
+            break;
+        case MCSTALLED:
+            *value = device->status.stalled;
+            break;
+        default:
+            found = false;
+    }
+
+out:
+    pthread_mutex_unlock(&comm->rxlock);
+    return found;
+}
+
+/**
+ * mdrive_poller_sample
+ *
+ * Copies the last status sampled by the poller for the device, whatever
+ * its age, into [sample].
+ *
+ * Returns:
+ * (bool) TRUE if the device was sampled since last kicked
+ */
+bool
+mdrive_poller_sample(mdrive_device_t * device, struct mdrive_status * sample) {
+    mdrive_comm_device_t * comm = device->comm;
+
+    if (comm == NULL)
+        return false;
+
+    pthread_mutex_lock(&comm->rxlock);
+    *sample = device->status;
+    pthread_mutex_unlock(&comm->rxlock);
+
+    return sample->taken.tv_sec != 0;
+}
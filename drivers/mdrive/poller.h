@@ -0,0 +1,16 @@
+
+extern int
+mdrive_poller_start(mdrive_comm_device_t *, int interval);
+
+extern void
+mdrive_poller_stop(mdrive_comm_device_t *);
+
+extern void
+mdrive_poller_kick(mdrive_device_t *);
+
+extern bool
+mdrive_poller_sample(mdrive_device_t *, struct mdrive_status *);
+
+extern bool
+mdrive_poller_lookup(mdrive_device_t *, motor_query_t, int max_age,
+    int * value);
@@ -4,9 +4,15 @@
 #include "serial.h"
 #include "motion.h"
 #include "config.h"
+#include "estimate.h"
 
 #include <errno.h>
+#include <stddef.h>
 #include <stdio.h>
+#include <string.h>
+
+// XXX: Use a stinkin' header file include
+extern void mcTraceF(int level, int channel, const char * fmt, ...);
 
 /**
  * mdrive_lazyload_profile
@@ -63,175 +69,205 @@ mdrive_lazyload_profile(mdrive_device_t * device) {
     device->profile.current_hold = HC;
 
     device->position = P;
+    mdrive_estimate_confirm(device, P, false);
 
     device->loaded.profile = true;
     return 0;
 }
 
-int
-mdrive_profile_accel(mdrive_device_t * device, long long accel) {
-    mdrive_lazyload_profile(device);
-
-    if (device->profile.accel.value == accel)
-        return 0;
+// Variables of the unit making up a motion profile, in the order sent --
+// those held by the profile slots of the microcode first
+static const struct mdrive_profile_variable {
+    const char *        name;
+    size_t              offset;         // Of the setting in the profile
+    bool                current;        // Percentage (not a measurement)
+    bool                encoder;        // Only honored in encoder mode
+    const char *        slot;           // Variable holding it for a slot
+} mdrive_profile_variables[] = {
+    { "A",  offsetof(Profile, accel), .slot = "Y%d" },
+    { "D",  offsetof(Profile, decel), .slot = "U%d" },
+    { "VM", offsetof(Profile, vmax), .slot = "N%d" },
+    { "VI", offsetof(Profile, vstart), .slot = "L%d" },
+    { "SF", offsetof(Profile, slip_max), .encoder = true },
+    { "DB", offsetof(Profile, accuracy), .encoder = true },
+    { "RC", offsetof(Profile, current_run), .current = true },
+    { "HC", offsetof(Profile, current_hold), .current = true },
+    { NULL }
+};
 
-    if (accel < 1)
-        return EINVAL;
+/**
+ * mdrive_profile_value
+ *
+ * Returns:
+ * (long long) setting of the [profile] for [var], in the terms of the unit
+ * (steps rather than microrevs)
+ */
+static long long
+mdrive_profile_value(mdrive_device_t * device,
+        const struct mdrive_profile_variable * var, Profile * profile) {
+    char * field = (char *) profile + var->offset;
 
-    if (!mdrive_set_variable(device, "A",
-            mdrive_microrevs_to_steps(device, accel)))
-        return EIO;
+    if (var->current)
+        return *(unsigned char *) field;
 
-    device->profile.accel.value = accel;
-    return 0;
+    return mdrive_microrevs_to_steps(device,
+        ((struct measurement *) field)->value);
 }
 
-int
-mdrive_profile_decel(mdrive_device_t * device, long long decel) {
-    mdrive_lazyload_profile(device);
-
-    if (device->profile.decel.value == decel)
-        return 0;
-
-    if (decel < 1)
-        return EINVAL;
+/**
+ * mdrive_profile_unset
+ *
+ * Returns:
+ * (bool) TRUE if the [profile] leaves the setting for [var] unset (zero),
+ * as the settings not given by clients are
+ */
+static bool
+mdrive_profile_unset(const struct mdrive_profile_variable * var,
+        Profile * profile) {
+    char * field = (char *) profile + var->offset;
 
-    if (!mdrive_set_variable(device, "D",
-            mdrive_microrevs_to_steps(device, decel)))
-        return EIO;
+    if (var->current)
+        return *(unsigned char *) field == 0;
 
-    device->profile.decel.value = decel;
-    return 0;
+    return ((struct measurement *) field)->value == 0;
 }
 
+/**
+ * mdrive_set_profile
+ *
+ * Brings the motion profile of the unit in line with [profile]. The
+ * requested profile is compared with the one cached for the device, in the
+ * terms of the unit, and only the variables which differ are sent -- so a
+ * move with an unchanged profile costs no transaction at all. MCode takes
+ * a single assignment per line, so each variable changed is a transaction
+ * of its own.
+ *
+ * The settings are all validated before anything is sent. Settings left
+ * unset (zero) keep the value of the unit, and those honored in encoder
+ * mode only (SF and DB) are left alone if the unit is not in encoder mode. The cached profile is updated with each variable the unit
+ * accepts, so that it always reflects the unit.
+ *
+ * Returns:
+ * (int) 0 upon success, EINVAL if a setting is out of range, EIO if the
+ * profile could not be read from, or a variable set on, the unit
+ */
 int
-mdrive_profile_vmax(mdrive_device_t * device, long long vmax) {
-    mdrive_lazyload_profile(device);
-
-    if (device->profile.vmax.value == vmax)
-        return 0;
-
-    if (vmax < 1)
-        return EINVAL;
+mdrive_set_profile(mdrive_device_t * device, struct motion_profile * profile) {
+    const struct mdrive_profile_variable * var;
+    long long values[8];
+    bool changed[8];
+    int i;
 
-    if (!mdrive_set_variable(device, "VM",
-            mdrive_microrevs_to_steps(device, vmax)))
+    // XXX: Check units for each measurable item is MICRO_REVS
+    if (mdrive_lazyload_profile(device))
         return EIO;
 
-    device->profile.vmax.value = vmax;
-    return 0;
-}
-
-int
-mdrive_profile_vstart(mdrive_device_t * device, long long vstart) {
-    mdrive_lazyload_profile(device);
-
-    if (device->profile.vstart.value == vstart)
-        return 0;
+    for (var = mdrive_profile_variables, i = 0; var->name; var++, i++) {
+        changed[i] = false;
+        if (mdrive_profile_unset(var, profile))
+            // Keep the setting of the unit
+            continue;
+        else if (var->encoder) {
+            mdrive_lazyload_motion_config(device);
+            // Device will only honor SF and DB in encoder mode
+            if (!device->encoder)
+                continue;
+        }
+
+        values[i] = mdrive_profile_value(device, var, profile);
+        if (values[i] == mdrive_profile_value(device, var, &device->profile))
+            continue;
+        else if (var->current && (values[i] < 10 || values[i] > 100))
+            return EINVAL;
+        else if (!var->current && values[i] < 1)
+            return EINVAL;
+        changed[i] = true;
+    }
+
+    for (var = mdrive_profile_variables, i = 0; var->name; var++, i++) {
+        if (!changed[i])
+            continue;
+        else if (!mdrive_set_variable(device, var->name, values[i]))
+            return EIO;
+
+        memcpy((char *) &device->profile + var->offset,
+            (char *) profile + var->offset, var->current
+                ? sizeof profile->current_run : sizeof profile->accel);
+    }
 
-    if (vstart < 1)
-        return EINVAL;
-
-    if (!mdrive_set_variable(device, "VI",
-            mdrive_microrevs_to_steps(device, vstart)))
-        return EIO;
-
-    device->profile.vstart.value = vstart;
     return 0;
 }
 
+/**
+ * mdrive_profile_install
+ *
+ * Installs [profile] into slot [number] (1-based) of the microcode (see
+ * profiles.mtx), so that moves can select it by number rather than having
+ * A, D, VM and VI sent. The slots are held in variables of the unit, and
+ * only the variables which differ from the profile last installed into the
+ * slot are sent. The slots are emptied when the microcode is reloaded.
+ *
+ * Returns:
+ * (int) 0 upon success, ENOTSUP if the microcode has no such slot, EINVAL
+ * if a setting is out of range, EIO if a variable could not be set
+ */
 int
-mdrive_profile_slipmax(mdrive_device_t * device, long long slipmax) {
-    mdrive_lazyload_profile(device);
-
-    if (device->profile.slip_max.value == slipmax)
-        return 0;
-
-    mdrive_lazyload_motion_config(device);
-    if (!device->encoder)
-        // Device will only honor stall factor (SF) in encoder mode
-        return ENOTSUP;
-
-    if (slipmax < 1)
-        return EINVAL;
-
-    if (!mdrive_set_variable(device, "SF",
-            mdrive_microrevs_to_steps(device, slipmax)))
-        return EIO;
-
-    device->profile.slip_max.value = slipmax;
-    return 0;
-}
-
-int
-mdrive_profile_accuracy(mdrive_device_t * device, long long accuracy) {
-    mdrive_lazyload_profile(device);
-
-    if (device->profile.accuracy.value == accuracy)
-        return 0;
-
-    mdrive_lazyload_motion_config(device);
-    if (!device->encoder)
-        // Device will only honor stall factor (DB) in encoder mode
+mdrive_profile_install(mdrive_device_t * device, int number,
+        struct motion_profile * profile) {
+    const struct mdrive_profile_variable * var;
+    Profile * slot;
+    char name[4];
+    long long value;
+    bool installed;
+
+    if (number < 1 || number > device->microcode.features.profiles)
         return ENOTSUP;
 
-    if (accuracy < 1)
-        return EINVAL;
+    slot = &device->microcode.slots[number - 1];
+    installed = device->microcode.installed & (1 << number);
 
-    if (!mdrive_set_variable(device, "DB",
-            mdrive_microrevs_to_steps(device, accuracy)))
-        return EIO;
+    for (var = mdrive_profile_variables; var->slot; var++)
+        if (mdrive_profile_value(device, var, profile) < 1)
+            return EINVAL;
 
-    device->profile.accuracy.value = accuracy;
-    return 0;
-}
+    // The slot is unusable until all of it is installed
+    device->microcode.installed &= ~(1 << number);
 
-int
-mdrive_profile_irun(mdrive_device_t * device, int irun) {
-    mdrive_lazyload_profile(device);
+    for (var = mdrive_profile_variables; var->slot; var++) {
+        value = mdrive_profile_value(device, var, profile);
+        if (installed && value == mdrive_profile_value(device, var, slot))
+            continue;
 
-    if (device->profile.current_run == irun)
-        return 0;
+        snprintf(name, sizeof name, var->slot, number);
+        if (!mdrive_set_variable(device, name, value))
+            return EIO;
+    }
 
-    if (irun < 10 || irun > 100)
-        return EINVAL;
+    *slot = *profile;
+    slot->attrs.hardware = true;
+    slot->attrs.number = number;
+    device->microcode.installed |= 1 << number;
 
-    if (!mdrive_set_variable(device, "RC", irun))
-        return EIO;
-
-    device->profile.current_run = irun;
+    mcTraceF(30, MDRIVE_CHANNEL, "Installed profile %d", number);
     return 0;
 }
 
-int
-mdrive_profile_ihold(mdrive_device_t * device, int ihold) {
-    mdrive_lazyload_profile(device);
-
-    if (device->profile.current_hold == ihold)
-        return 0;
-
-    if (ihold < 10 || ihold > 100)
-        return EINVAL;
-
-    if (!mdrive_set_variable(device, "HC", ihold))
-        return EIO;
-
-    device->profile.current_hold = ihold;
-    return 0;
-}
+/**
+ * mdrive_profile_selected
+ *
+ * Called once a move selecting profile slot [number] of the microcode is
+ * sent, which has the unit apply the profile of the slot. Updates the
+ * profile cached for the device to match.
+ */
+void
+mdrive_profile_selected(mdrive_device_t * device, int number) {
+    const struct mdrive_profile_variable * var;
 
-int
-mdrive_set_profile(mdrive_device_t * device, struct motion_profile * profile) {
-    // TODO: Add error checking
-    // XXX: Check units for each measurable item is MICRO_REVS
-    mdrive_profile_accel(device, profile->accel.value);
-    mdrive_profile_decel(device, profile->decel.value);
-    mdrive_profile_vmax(device, profile->vmax.value);
-    mdrive_profile_vstart(device, profile->vstart.value);
-    mdrive_profile_slipmax(device, profile->slip_max.value);
-    mdrive_profile_accuracy(device, profile->accuracy.value);
-    mdrive_profile_irun(device, profile->current_run);
-    mdrive_profile_ihold(device, profile->current_hold);
+    if (!(device->microcode.installed & (1 << number)))
+        return;
 
-    return 0;
+    for (var = mdrive_profile_variables; var->slot; var++)
+        memcpy((char *) &device->profile + var->offset,
+            (char *) &device->microcode.slots[number - 1] + var->offset,
+            sizeof device->profile.accel);
 }
@@ -4,3 +4,10 @@ mdrive_set_profile(mdrive_device_t * device, struct motion_profile * profile);
 
 extern int
 mdrive_lazyload_profile(mdrive_device_t * device);
+
+extern int
+mdrive_profile_install(mdrive_device_t * device, int number,
+    struct motion_profile * profile);
+
+extern void
+mdrive_profile_selected(mdrive_device_t * device, int number);
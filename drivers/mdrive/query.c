@@ -1,9 +1,12 @@
 #include "mdrive.h"
 #include "query.h"
 
+#include "capture.h"
 #include "config.h"
+#include "estimate.h"
 #include "firmware.h"
 #include "motion.h"
+#include "poller.h"
 #include "profile.h"
 #include "serial.h"
 
@@ -21,6 +24,8 @@ static PEEK(mdrive_sn_peek);
 static PEEK(mdrive_vr_peek);
 static PEEK(mdrive_pn_peek);
 static PEEK(mdrive_profile_peek);
+static PEEK(mdrive_slot_peek);
+static POKE(mdrive_slot_poke);
 static POKE(mdrive_ee_poke);
 static PEEK(mdrive_var_peek);
 static POKE(mdrive_var_poke);
@@ -28,6 +33,23 @@ static POKE(mdrive_ex_poke);
 static POKE(mdrive_io_poke);
 static POKE(mdrive_fd_poke);
 static PEEK(mdrive_ug_peek);
+static PEEK(mdrive_stats_peek);
+static PEEK(mdrive_latency_peek);
+static POKE(mdrive_latency_poke);
+static PEEK(mdrive_pipeline_peek);
+static POKE(mdrive_pipeline_poke);
+static PEEK(mdrive_estimate_peek);
+static PEEK(mdrive_correction_peek);
+static POKE(mdrive_correction_poke);
+static PEEK(mdrive_poll_peek);
+static POKE(mdrive_poll_poke);
+static PEEK(mdrive_capture_peek);
+static POKE(mdrive_capture_poke);
+static PEEK(mdrive_drain_peek);
+static POKE(mdrive_drain_poke);
+static PEEK(mdrive_wire_peek);
+static POKE(mdrive_wire_poke);
+static PEEK(mdrive_wire_stats_peek);
 
 static struct query_variable query_xref[] = {
     { 9, MCPOSITION,        "P",    NULL,   mdrive_write_simple },
@@ -37,8 +59,11 @@ static struct query_variable query_xref[] = {
     { 1, MCSTALLED,         "ST",   NULL,   mdrive_write_simple },
     { 3, MCINPUT,           "I%d",  NULL,   NULL },
     { 19, MCOUTPUT,         "O%d",  NULL,   mdrive_write_simple },
+    { 5, MCPOSITION_ESTIMATED, NULL, mdrive_estimate_peek, NULL },
+    { 5, MCPOSITION_ERROR,  NULL,   mdrive_estimate_peek, NULL },
 
     // Profile peeks
+    { 5, MCPROFILE,         NULL,   mdrive_slot_peek, mdrive_slot_poke },
     { 5, MCACCEL,           NULL,   mdrive_profile_peek, NULL },
     { 5, MCDECEL,           NULL,   mdrive_profile_peek, NULL },
     { 5, MCVMAX,            NULL,   mdrive_profile_peek, NULL },
@@ -64,6 +89,41 @@ static struct query_variable query_xref[] = {
     { 1, MDRIVE_CHECKSUM,   "CK",   NULL,   mdrive_checksum_poke },
     { 1, MDRIVE_ECHO,       "EM",   NULL,   NULL },
     { 5, MDRIVE_UG_MODE,    "UG",   mdrive_ug_peek, NULL },
+    { 5, MDRIVE_PIPELINE,   NULL,   mdrive_pipeline_peek,
+                                    mdrive_pipeline_poke },
+    { 5, MDRIVE_POLL_INTERVAL, NULL, mdrive_poll_peek, mdrive_poll_poke },
+    { 5, MDRIVE_CAPTURE,    NULL,   mdrive_capture_peek, mdrive_capture_poke },
+    { 5, MDRIVE_TX_DRAIN,   NULL,   mdrive_drain_peek, mdrive_drain_poke },
+    { 5, MDRIVE_WIRE_PROFILE, NULL, mdrive_wire_peek, mdrive_wire_poke },
+    { 5, MDRIVE_ESTIMATE_CORRECTION, NULL, mdrive_correction_peek,
+                                    mdrive_correction_poke },
+
+    { 5, MDRIVE_STATS_RX,   NULL,   mdrive_stats_peek, NULL },
+    { 5, MDRIVE_STATS_TX,   NULL,   mdrive_stats_peek, NULL },
+    { 5, MDRIVE_STATS_WAKEUPS, NULL, mdrive_stats_peek, NULL },
+    { 5, MDRIVE_STATS_IDLE, NULL,   mdrive_stats_peek, NULL },
+    { 5, MDRIVE_STATS_QUEUE_OVERFLOWS, NULL, mdrive_stats_peek, NULL },
+    { 5, MDRIVE_STATS_ALLOCS, NULL, mdrive_stats_peek, NULL },
+    { 5, MDRIVE_STATS_RTO,  NULL,   mdrive_stats_peek, NULL },
+    { 5, MDRIVE_STATS_RTO_DATA, NULL, mdrive_stats_peek, NULL },
+    { 5, MDRIVE_STATS_LATENCY_RTT, NULL, mdrive_latency_peek,
+                                    mdrive_latency_poke },
+    { 5, MDRIVE_STATS_LATENCY_TXLOCK, NULL, mdrive_latency_peek,
+                                    mdrive_latency_poke },
+    { 5, MDRIVE_STATS_LATENCY_FRAME, NULL, mdrive_latency_peek,
+                                    mdrive_latency_poke },
+    { 5, MDRIVE_STATS_QUEUE_EMERGENCY, NULL, mdrive_latency_peek,
+                                    mdrive_latency_poke },
+    { 5, MDRIVE_STATS_QUEUE_MOTION, NULL, mdrive_latency_peek,
+                                    mdrive_latency_poke },
+    { 5, MDRIVE_STATS_QUEUE_QUERY, NULL, mdrive_latency_peek,
+                                    mdrive_latency_poke },
+    { 5, MDRIVE_STATS_QUEUE_BULK, NULL, mdrive_latency_peek,
+                                    mdrive_latency_poke },
+    { 5, MDRIVE_STATS_LATENCY_WRITE, NULL, mdrive_latency_peek,
+                                    mdrive_latency_poke },
+    { 5, MDRIVE_STATS_WIRE_BYTES, NULL, mdrive_wire_stats_peek, NULL },
+    { 5, MDRIVE_STATS_WIRE_RATE, NULL, mdrive_wire_stats_peek, NULL },
 
     { 2, MDRIVE_ADDRESS,    "DN",   NULL,   mdrive_address_poke },
     { 6, MDRIVE_NAME,       NULL,   NULL,   mdrive_name_poke },
@@ -91,8 +151,15 @@ mdrive_read_variable(Driver * self, struct motor_query * query) {
     switch (q->type) {
         case 1:
         case 9:
-            if (mdrive_get_integer(motor, q->variable, &intval))
-                return EIO;
+            // The item is the age (ms) of a polled status accepted instead
+            // (see mdrive_poller_lookup)
+            if (!mdrive_poller_lookup(motor, q->query, query->arg.number,
+                    &intval)) {
+                if (mdrive_get_integer(motor, q->variable, &intval))
+                    return EIO;
+                if (q->query == MCPOSITION)
+                    mdrive_estimate_confirm(motor, intval, false);
+            }
             if (q->type == 9)
                 query->value.number = mdrive_steps_to_microrevs(motor, intval);
             else
@@ -174,6 +241,12 @@ mdrive_write_simple(mdrive_device_t * device, struct motor_query * query,
     if (RESPONSE_OK != mdrive_send(device, cmd))
         return EIO;
 
+    if (query->query == MCPOSITION)
+        mdrive_estimate_confirm(device, value, false);
+
+    if (query->query == MCPOSITION || query->query == MCSTALLED)
+        mdrive_poller_kick(device);
+
     return 0;
 }
 
@@ -421,6 +494,48 @@ mdrive_profile_peek(mdrive_device_t * device, struct motor_query * query,
 
 }
 
+/**
+ * mdrive_slot_peek
+ *
+ * Retrieves the profile installed into the profile slot of the microcode
+ * numbered by the query's item, into the profile given with the query.
+ *
+ * Returns:
+ * (int) ENOENT if no profile is installed into the slot
+ */
+static int
+mdrive_slot_peek(mdrive_device_t * device, struct motor_query * query,
+        struct query_variable * q) {
+    int number = query->arg.number;
+
+    if (device == NULL || query->value.profile == NULL)
+        return EINVAL;
+    else if (number < 1 || number > device->microcode.features.profiles)
+        return ENOTSUP;
+    else if (!(device->microcode.installed & (1 << number)))
+        return ENOENT;
+
+    *query->value.profile = device->microcode.slots[number - 1];
+    return 0;
+}
+
+/**
+ * mdrive_slot_poke
+ *
+ * Installs the profile given with the query into the profile slot of the
+ * microcode numbered by the query's item (see mdrive_profile_install).
+ */
+static int
+mdrive_slot_poke(mdrive_device_t * device, struct motor_query * query,
+        struct query_variable * q) {
+
+    if (device == NULL || query->value.profile == NULL)
+        return EINVAL;
+
+    return mdrive_profile_install(device, query->arg.number,
+        query->value.profile);
+}
+
 static int
 mdrive_ex_poke(mdrive_device_t * device, struct motor_query * query,
         struct query_variable * q) {
@@ -428,7 +543,11 @@ mdrive_ex_poke(mdrive_device_t * device, struct motor_query * query,
     char buffer[64];
     snprintf(buffer, sizeof buffer, "EX %2.2s", query->value.string.buffer);
 
-    return mdrive_send(device, buffer);
+    int status = mdrive_send(device, buffer);
+    // The routine can move the unit or change its state
+    mdrive_poller_kick(device);
+    mdrive_estimate_lost(device);
+    return status;
 }
 
 static int
@@ -454,6 +573,9 @@ mdrive_var_poke(mdrive_device_t * device, struct motor_query * query,
     if (mdrive_send(device, buffer))
         return EIO;
 
+    // The variable can be the position or start a move
+    mdrive_poller_kick(device);
+    mdrive_estimate_lost(device);
     return 0;
 }
 
@@ -639,3 +761,405 @@ mdrive_ug_peek(mdrive_device_t * device, struct motor_query * query,
 
     return query->value.string.size;
 }
+
+/**
+ * mdrive_stats_peek
+ *
+ * Retrieves communication statistics for the device. The receive thread
+ * statistics (wakeups, idle) and the heap allocations of responses (allocs)
+ * are kept for the comm port and are shared by all the devices on the port.
+ * The response timeouts (rto) are reported in microseconds, and are zero
+ * until the round-trip time of the unit has been sampled.
+ */
+static int
+mdrive_stats_peek(mdrive_device_t * device, struct motor_query * query,
+        struct query_variable * q) {
+
+    if (device == NULL || device->comm == NULL)
+        return EINVAL;
+
+    switch ((enum mdrive_read_variable)query->query) {
+        case MDRIVE_STATS_RX:
+            query->value.number = device->stats.rx;
+            break;
+        case MDRIVE_STATS_TX:
+            query->value.number = device->stats.tx;
+            break;
+        case MDRIVE_STATS_WAKEUPS:
+            query->value.number = device->comm->rxstats.wakeups;
+            break;
+        case MDRIVE_STATS_IDLE:
+            query->value.number = device->comm->rxstats.idle_closes;
+            break;
+        case MDRIVE_STATS_QUEUE_OVERFLOWS:
+            query->value.number = device->stats.queue_overflows;
+            break;
+        case MDRIVE_STATS_ALLOCS:
+            query->value.number = device->comm->pool.allocs;
+            break;
+        case MDRIVE_STATS_RTO:
+            query->value.number = device->stats.rtt_short.rto / 1000;
+            break;
+        case MDRIVE_STATS_RTO_DATA:
+            query->value.number = device->stats.rtt_data.rto / 1000;
+            break;
+        default:
+            return EINVAL;
+    }
+    return 0;
+}
+
+static mdrive_histogram_t *
+mdrive_latency_histogram(mdrive_device_t * device, int query) {
+    switch ((enum mdrive_read_variable)query) {
+        case MDRIVE_STATS_LATENCY_RTT:
+            return &device->stats.rtt_histogram;
+        case MDRIVE_STATS_LATENCY_TXLOCK:
+            return &device->stats.txlock_histogram;
+        case MDRIVE_STATS_LATENCY_FRAME:
+            return &device->stats.frame_histogram;
+        case MDRIVE_STATS_QUEUE_EMERGENCY:
+        case MDRIVE_STATS_QUEUE_MOTION:
+        case MDRIVE_STATS_QUEUE_QUERY:
+        case MDRIVE_STATS_QUEUE_BULK:
+            return &device->stats.queue_histogram[MDRIVE_PRIORITY_EMERGENCY
+                + query - MDRIVE_STATS_QUEUE_EMERGENCY];
+        case MDRIVE_STATS_LATENCY_WRITE:
+            return &device->stats.write_histogram;
+        default:
+            return NULL;
+    }
+}
+
+/**
+ * mdrive_latency_peek
+ *
+ * Retrieves a percentile (microseconds) of one of the latency histograms
+ * of the device. The percentile is given as the item of the query in
+ * hundredths of a percent -- 9900 for the 99th percentile, 9990 for the
+ * 99.9th, and 10000 for the largest latency recorded. An item of zero
+ * retrieves the number of samples recorded instead.
+ */
+static int
+mdrive_latency_peek(mdrive_device_t * device, struct motor_query * query,
+        struct query_variable * q) {
+
+    if (device == NULL)
+        return EINVAL;
+
+    mdrive_histogram_t * histogram =
+        mdrive_latency_histogram(device, query->query);
+    if (histogram == NULL)
+        return EINVAL;
+    else if (query->arg.number < 0 || query->arg.number > 10000)
+        return EINVAL;
+
+    if (query->arg.number == 0)
+        query->value.number = histogram->count;
+    else
+        query->value.number = histogram_percentile(histogram,
+            query->arg.number);
+    return 0;
+}
+
+/**
+ * mdrive_latency_poke
+ *
+ * Clears one of the latency histograms of the device. The value poked is
+ * not used.
+ */
+static int
+mdrive_latency_poke(mdrive_device_t * device, struct motor_query * query,
+        struct query_variable * q) {
+
+    if (device == NULL)
+        return EINVAL;
+
+    mdrive_histogram_t * histogram =
+        mdrive_latency_histogram(device, query->query);
+    if (histogram == NULL)
+        return EINVAL;
+
+    histogram_reset(histogram);
+    return 0;
+}
+
+static int
+mdrive_pipeline_peek(mdrive_device_t * device, struct motor_query * query,
+        struct query_variable * q) {
+
+    if (device == NULL || device->comm == NULL)
+        return EINVAL;
+
+    query->value.number = device->comm->pipeline;
+    return 0;
+}
+
+/**
+ * mdrive_pipeline_poke
+ *
+ * Sets the number of requests allowed in flight on the port of the device
+ * (at most one per party-mode address). Responses are matched to requests
+ * by their order, so this should only be raised above one for buses where
+ * the units answer in turn -- the host talks on its own pair (4-wire
+ * RS-422) and the units share the same processing latency.
+ */
+static int
+mdrive_pipeline_poke(mdrive_device_t * device, struct motor_query * query,
+        struct query_variable * q) {
+
+    if (device == NULL || device->comm == NULL)
+        return EINVAL;
+    else if (query->value.number < 1
+            || query->value.number > MDRIVE_MAX_PIPELINE)
+        return EINVAL;
+
+    pthread_mutex_lock(&device->comm->rxlock);
+    device->comm->pipeline = query->value.number;
+    pthread_cond_broadcast(&device->comm->has_data);
+    pthread_mutex_unlock(&device->comm->rxlock);
+
+    return 0;
+}
+
+/**
+ * mdrive_estimate_peek
+ *
+ * Answers the position of the device estimated from the motion planned
+ * (MCPOSITION_ESTIMATED), or the bound on the error of the estimate
+ * (MCPOSITION_ERROR), in microrevs. The unit is only read as explained in
+ * mdrive_estimate_position.
+ *
+ * The error answered is the one of the last position estimated, so that
+ * reading the position then the error gives a matching pair, even if the
+ * unit was read for the position. The error is estimated afresh if read
+ * again, or without a position read first.
+ */
+static int
+mdrive_estimate_peek(mdrive_device_t * device, struct motor_query * query,
+        struct query_variable * q) {
+    struct mdrive_estimate * e;
+    int position, error, status;
+
+    if (device == NULL)
+        return EINVAL;
+
+    e = &device->estimate;
+    if (query->query == MCPOSITION_ERROR && e->answered) {
+        e->answered = false;
+        query->value.number = mdrive_steps_to_microrevs(device, e->error);
+        return 0;
+    }
+
+    status = mdrive_estimate_position(device, &position, &error);
+    if (status)
+        return status;
+
+    if (query->query == MCPOSITION_ERROR)
+        query->value.number = mdrive_steps_to_microrevs(device, error);
+    else {
+        e->error = error;
+        e->answered = true;
+        query->value.number = mdrive_steps_to_microrevs(device, position);
+    }
+    return 0;
+}
+
+static int
+mdrive_correction_peek(mdrive_device_t * device, struct motor_query * query,
+        struct query_variable * q) {
+
+    if (device == NULL)
+        return EINVAL;
+
+    query->value.number = device->estimate.correction;
+    return 0;
+}
+
+/**
+ * mdrive_correction_poke
+ *
+ * Sets the period (milliseconds) after which the position estimated for
+ * the device is corrected by reading the unit. Zero (the default) leaves
+ * the estimate to the reads made otherwise.
+ */
+static int
+mdrive_correction_poke(mdrive_device_t * device, struct motor_query * query,
+        struct query_variable * q) {
+
+    if (device == NULL)
+        return EINVAL;
+    else if (query->value.number < 0)
+        return EINVAL;
+
+    device->estimate.correction = query->value.number;
+    return 0;
+}
+
+static int
+mdrive_poll_peek(mdrive_device_t * device, struct motor_query * query,
+        struct query_variable * q) {
+
+    if (device == NULL || device->comm == NULL)
+        return EINVAL;
+
+    query->value.number = device->comm->poll_interval;
+    return 0;
+}
+
+/**
+ * mdrive_poll_poke
+ *
+ * Sets the period (milliseconds) at which the axes in motion on the port
+ * of the device have their status polled in the background. Idle axes are
+ * polled less often. Zero stops the polling. While polled, reads of the
+ * position, velocity, motion and stall state are answered from the last
+ * status polled (see mdrive_poller_lookup).
+ */
+static int
+mdrive_poll_poke(mdrive_device_t * device, struct motor_query * query,
+        struct query_variable * q) {
+
+    if (device == NULL || device->comm == NULL)
+        return EINVAL;
+
+    return mdrive_poller_start(device->comm, query->value.number);
+}
+
+static int
+mdrive_capture_peek(mdrive_device_t * device, struct motor_query * query,
+        struct query_variable * q) {
+
+    if (device == NULL || device->comm == NULL)
+        return EINVAL;
+
+    query->value.string.size = mdrive_capture_path(device->comm,
+        query->value.string.buffer, sizeof query->value.string.buffer);
+    return 0;
+}
+
+/**
+ * mdrive_capture_poke
+ *
+ * Starts capturing the traffic of the port of the device into the ring
+ * file named by the value poked (see capture.h), or stops the capture if
+ * the name is empty. The item, if given, is the number of records in the
+ * ring.
+ */
+static int
+mdrive_capture_poke(mdrive_device_t * device, struct motor_query * query,
+        struct query_variable * q) {
+
+    if (device == NULL || device->comm == NULL)
+        return EINVAL;
+
+    if (*query->value.string.buffer == 0) {
+        mdrive_capture_stop(device->comm);
+        return 0;
+    }
+    return mdrive_capture_start(device->comm, query->value.string.buffer,
+        query->arg.number);
+}
+
+static int
+mdrive_drain_peek(mdrive_device_t * device, struct motor_query * query,
+        struct query_variable * q) {
+
+    if (device == NULL || device->comm == NULL)
+        return EINVAL;
+
+    query->value.number = device->comm->drain;
+    return 0;
+}
+
+/**
+ * mdrive_drain_poke
+ *
+ * Sets whether the requests sent on the port of the device are waited for
+ * to leave the port (the default). If not, the sending thread returns as
+ * soon as the request is handed to the kernel, and the response is timed
+ * from the estimated end of the transmission (see mdrive_write_buffer).
+ */
+static int
+mdrive_drain_poke(mdrive_device_t * device, struct motor_query * query,
+        struct query_variable * q) {
+
+    if (device == NULL || device->comm == NULL)
+        return EINVAL;
+
+    device->comm->drain = query->value.number != 0;
+
+    return 0;
+}
+
+static int
+mdrive_wire_peek(mdrive_device_t * device, struct motor_query * query,
+        struct query_variable * q) {
+
+    if (device == NULL)
+        return EINVAL;
+
+    query->value.number = device->wire_profile;
+    return 0;
+}
+
+/**
+ * mdrive_wire_poke
+ *
+ * Selects the wire profile of the device (enum mdrive_wire_profile), and
+ * configures the echo and checksum modes of the unit after it (see
+ * mdrive_config_wire).
+ */
+static int
+mdrive_wire_poke(mdrive_device_t * device, struct motor_query * query,
+        struct query_variable * q) {
+
+    if (device == NULL)
+        return EINVAL;
+    else if (query->value.number < 0
+            || query->value.number >= MDRIVE_WIRE_PROFILES)
+        return EINVAL;
+
+    device->wire_profile = query->value.number;
+    if (!mdrive_config_wire(device))
+        return EIO;
+
+    return 0;
+}
+
+/**
+ * mdrive_wire_stats_peek
+ *
+ * Retrieves the bytes sent and received per transaction (in hundredths of
+ * a byte), or the transactions completed per second of communicating
+ * with the unit, while in the wire profile given as the item of the
+ * query. Zero if no transactions were made in the profile.
+ */
+static int
+mdrive_wire_stats_peek(mdrive_device_t * device, struct motor_query * query,
+        struct query_variable * q) {
+
+    if (device == NULL)
+        return EINVAL;
+    else if (query->arg.number < 0
+            || query->arg.number >= MDRIVE_WIRE_PROFILES)
+        return EINVAL;
+
+    struct mdrive_wire_stats * wire = &device->stats.wire[query->arg.number];
+    query->value.number = 0;
+    switch ((enum mdrive_read_variable)query->query) {
+        case MDRIVE_STATS_WIRE_BYTES:
+            if (wire->transactions)
+                query->value.number = wire->bytes * 100 / wire->transactions;
+            break;
+        case MDRIVE_STATS_WIRE_RATE:
+            if (wire->time)
+                query->value.number = wire->transactions * 1000000000ULL
+                    / wire->time;
+            break;
+        default:
+            return EINVAL;
+    }
+
+    return 0;
+}
@@ -3,47 +3,134 @@
 
 #include <stdio.h>
 
+#if MDRIVE_POOL_SIZE > 64
+#error "MDRIVE_POOL_SIZE is limited by the width of the availability bitmap"
+#endif
+
+/**
+ * queue_init
+ *
+ * Prepares a queue with the given [slots]. The number of slots must be a
+ * power of two, so the head and tail indexes can run freely and wrap
+ * around with the unsigned arithmetic.
+ */
 void
-mdrive_response_queue_init(queue_t * queue) {
-    queue->head = calloc(16, sizeof *queue->head);
-    queue->size = 16;
-    queue->length = 0;
+queue_init(queue_t * queue, mdrive_response_t ** slots, unsigned size) {
+    *queue = (queue_t) { .size = size, .slots = slots };
 }
 
-void
+/**
+ * queue_push
+ *
+ * Places a response at the tail of the queue. Only to be called by the
+ * (single) producer.
+ *
+ * Returns:
+ * (bool) true if queued, false if the queue is full. The response is still
+ * owned by the caller in the latter case
+ */
+bool
 queue_push(queue_t * queue, mdrive_response_t * response) {
-    if (queue->size - queue->length <= 0) {
-        // XXX: Perhaps resize the queue under some conditions ?
+    unsigned tail = queue->tail,
+             head = __atomic_load_n(&queue->head, __ATOMIC_ACQUIRE);
+
+    if (tail - head >= queue->size) {
         mcTraceF(1, MDRIVE_CHANNEL_RX, "!!! Unable to queue response: %d, %d",
-            queue->size, queue->length);
-        return;
+            queue->size, tail - head);
+        return false;
     }
-    queue->head[queue->length++] = response;
+    queue->slots[tail & (queue->size - 1)] = response;
+    __atomic_store_n(&queue->tail, tail + 1, __ATOMIC_RELEASE);
+    return true;
 }
 
 mdrive_response_t *
 queue_peek(queue_t * queue) {
-    if (queue->length < 1)
+    unsigned head = queue->head;
+
+    if (head == __atomic_load_n(&queue->tail, __ATOMIC_ACQUIRE))
         return NULL;
-    return queue->head[queue->length-1];
+    return queue->slots[head & (queue->size - 1)];
 }
 
+/**
+ * queue_pop
+ *
+ * Removes the oldest response from the queue. Only to be called by the
+ * (single) consumer.
+ */
 mdrive_response_t *
 queue_pop(queue_t * queue) {
-    if (queue->length < 1)
+    unsigned head = queue->head;
+    mdrive_response_t * response;
+
+    if (head == __atomic_load_n(&queue->tail, __ATOMIC_ACQUIRE))
         return NULL;
-    return queue->head[--queue->length];
+    response = queue->slots[head & (queue->size - 1)];
+    __atomic_store_n(&queue->head, head + 1, __ATOMIC_RELEASE);
+    return response;
 }
 
 int
 queue_length(queue_t * queue) {
     if (queue == NULL)
         return 0;
-    return queue->length;
+    return __atomic_load_n(&queue->tail, __ATOMIC_ACQUIRE)
+        - __atomic_load_n(&queue->head, __ATOMIC_ACQUIRE);
 }
 
 void
-queue_flush(queue_t * queue) {
-    while (queue_length(queue))
-        free(queue_pop(queue));
+queue_flush(queue_t * queue, mdrive_response_pool_t * pool) {
+    mdrive_response_t * response;
+
+    while ((response = queue_pop(queue)))
+        mdrive_response_free(pool, response);
+}
+
+void
+mdrive_response_pool_init(mdrive_response_pool_t * pool) {
+    pool->available = (MDRIVE_POOL_SIZE == 64)
+        ? ~(uint64_t) 0 : ((uint64_t) 1 << MDRIVE_POOL_SIZE) - 1;
+    pool->allocs = 0;
+}
+
+/**
+ * mdrive_response_alloc
+ *
+ * Retrieves a cleared response from the [pool]. Any thread may allocate
+ * from and return responses to the pool. Responses are only allocated from
+ * the heap if the pool is exhausted, which is counted in ->allocs.
+ */
+mdrive_response_t *
+mdrive_response_alloc(mdrive_response_pool_t * pool) {
+    uint64_t available = __atomic_load_n(&pool->available, __ATOMIC_RELAXED),
+             bit;
+    mdrive_response_t * response;
+
+    while (available) {
+        bit = available & -available;
+        if (__atomic_compare_exchange_n(&pool->available, &available,
+                available & ~bit, false, __ATOMIC_ACQUIRE, __ATOMIC_RELAXED)) {
+            response = &pool->responses[__builtin_ctzll(bit)];
+            bzero(response, sizeof *response);
+            return response;
+        }
+    }
+
+    __atomic_add_fetch(&pool->allocs, 1, __ATOMIC_RELAXED);
+    return calloc(1, sizeof *response);
+}
+
+void
+mdrive_response_free(mdrive_response_pool_t * pool,
+        mdrive_response_t * response) {
+    if (response == NULL)
+        return;
+
+    if (response >= pool->responses
+            && response < pool->responses + MDRIVE_POOL_SIZE)
+        __atomic_or_fetch(&pool->available,
+            (uint64_t) 1 << (response - pool->responses), __ATOMIC_RELEASE);
+    else
+        free(response);
 }
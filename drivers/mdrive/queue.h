@@ -1,18 +1,44 @@
 #ifndef QUEUE
 #define QUEUE
 
+/*
+ * Responses handed from the receive thread to the thread waiting for them
+ * travel through a queue_t. It is a bounded single-producer,
+ * single-consumer FIFO ring: the receive thread pushes, and the transaction
+ * owner pops. The head and tail indexes are only ever advanced by one side
+ * each, so neither side needs a lock to use the ring.
+ *
+ * The responses themselves come from a per-port pool, so that receiving a
+ * response does not allocate memory. The pool falls back to the heap if
+ * exhausted.
+ */
 typedef struct queue queue_t;
 struct queue {
-    int                 size;       // Max number of items
-    int                 length;     // # of items queued
-    mdrive_response_t ** head;
+    unsigned            size;       // Max number of items (power of two)
+    unsigned            head;       // Next item to pop (consumer)
+    unsigned            tail;       // Next slot to push to (producer)
+    mdrive_response_t ** slots;
 };
 
-extern void mdrive_response_queue_init(queue_t *);
-extern void queue_push(queue_t *, mdrive_response_t *);
+#define MDRIVE_POOL_SIZE 64
+
+typedef struct mdrive_response_pool mdrive_response_pool_t;
+struct mdrive_response_pool {
+    uint64_t            available;  // Bitmap of free responses
+    unsigned            allocs;     // Responses allocated from the heap
+    mdrive_response_t   responses[MDRIVE_POOL_SIZE];
+};
+
+extern void queue_init(queue_t *, mdrive_response_t **, unsigned);
+extern bool queue_push(queue_t *, mdrive_response_t *);
 extern mdrive_response_t * queue_peek(queue_t *);
 extern mdrive_response_t * queue_pop(queue_t *);
 extern int queue_length(queue_t *);
-extern void queue_flush(queue_t *);
+extern void queue_flush(queue_t *, mdrive_response_pool_t *);
+
+extern void mdrive_response_pool_init(mdrive_response_pool_t *);
+extern mdrive_response_t * mdrive_response_alloc(mdrive_response_pool_t *);
+extern void mdrive_response_free(mdrive_response_pool_t *,
+    mdrive_response_t *);
 
 #endif
@@ -1,5 +1,6 @@
 #include "mdrive.h"
 #include "serial.h"
+#include "search.h"
 
 #include <dirent.h>
 #include <regex.h>
@@ -27,13 +28,15 @@ mdrive_enum_serial_ports(void) {
         REG_EXTENDED);
     if (status != 0) {
         mcTraceF(1, MDRIVE_CHANNEL, "FAILED to compile regex");
+        closedir(dp);
         return NULL;
     }
 
     char ** list = calloc(32, sizeof(char *));
     char ** this = list;
 
-    while ((ep = readdir(dp))) {
+    // The list is NULL-terminated
+    while (this < list + 31 && (ep = readdir(dp))) {
         // Filter out console ttys
         status = regexec(&filter, ep->d_name, 0, NULL, 0);
         if (status == 0)
@@ -45,84 +48,208 @@ mdrive_enum_serial_ports(void) {
     }
 
     regfree(&filter);
+    closedir(dp);
     return list;
 }
 
-mdrive_address_t *
-mdrive_enum_motors_on_port(const char * port) {
+/**
+ * mdrive_search_speed
+ *
+ * Asks the units on the port, at each address, for their serial number and
+ * address, at the baud rate [speed]. Calls [found] for each unit which
+ * answers.
+ *
+ * Returns:
+ * (int) number of units found, -1 if the port cannot be opened
+ */
+static int
+mdrive_search_speed(const char * port, const struct baud_rate * speed,
+        mdrive_search_callback_t found, void * arg) {
     static char * command = "%sFD%c"; //PR DN%c";
     static struct timespec timeout = { .tv_nsec=18e6 };
 
-    int fd, length;
+    int fd, length, count = 0;
     char rxbuf[256], txbuf[64];
     char address[4];
-    mdrive_address_t * list = calloc(63, sizeof(mdrive_address_t));
-    mdrive_address_t * results = list;
+    mdrive_address_t result;
+    struct termios tty;
 
-    for (baud_rate_t * s = baud_rates; s->human; s++) {
-        if (fd) close(fd);
-        fd = mdrive_initialize_port(port, s->human, false);
-        if (fd < 0)
-            continue;
-        mcTraceF(20, MDRIVE_CHANNEL, "Search at %d baud", s->human);
-        struct termios tty;
+    fd = mdrive_initialize_port(port, speed->human, false);
+    if (fd < 0)
+        return -1;
+    mcTraceF(20, MDRIVE_CHANNEL, "Search %s at %d baud", port, speed->human);
 
-        tcgetattr(fd, &tty);
+    tcgetattr(fd, &tty);
 
-        cfsetispeed(&tty, s->constant);
-        cfsetospeed(&tty, s->constant);
+    cfsetispeed(&tty, speed->constant);
+    cfsetospeed(&tty, speed->constant);
 
-        tcsetattr(fd, TCSAFLUSH, &tty);
+    tcsetattr(fd, TCSAFLUSH, &tty);
 
-        for (char ** addr = addresses; *addr; addr++) {
-            // Request the motor at this address to give the serial number
-            // followed by '$' and its party address
-            length = snprintf(txbuf, sizeof txbuf, command, *addr,
-                (strlen(*addr) ? '\n' : '\r'));
+    for (char ** addr = addresses; *addr; addr++) {
+        // Request the motor at this address to give the serial number
+        // followed by '$' and its party address
+        length = snprintf(txbuf, sizeof txbuf, command, *addr,
+            (strlen(*addr) ? '\n' : '\r'));
 
-            // Assume checksum mode
-            txbuf[length] = txbuf[length-1];
-            txbuf[length-1] = 0;
-            txbuf[length-1] = mdrive_calc_checksum(txbuf, length-1);
-            txbuf[++length] = 0;
+        // Assume checksum mode
+        txbuf[length] = txbuf[length-1];
+        txbuf[length-1] = 0;
+        txbuf[length-1] = mdrive_calc_checksum(txbuf, length-1);
+        txbuf[++length] = 0;
 
-            write(fd, txbuf, length);
-            tcdrain(fd);
-            nanosleep(&timeout, NULL);
-        }
+        write(fd, txbuf, length);
+        tcdrain(fd);
         nanosleep(&timeout, NULL);
+    }
+    nanosleep(&timeout, NULL);
 
-        for (;;) {
-            // fd is NONBLOCK, so it will return immediately and set errno
-            // at EAGAIN if there is no data for the read.
-            if ((length = read(fd, rxbuf, sizeof rxbuf)) <= 0)
-                break;
-            else
-                rxbuf[length] = 0;
-
-            strtok(rxbuf, "?>");
-
-            if (strncmp(rxbuf, &txbuf[3], 3) == 0
-                    || strncmp(rxbuf, &txbuf[4], 3) == 0)
-                // Echo mode is enabled (EM=0)
-                continue;
-
-            if (strlen(rxbuf) < 8)
-                // Response too short to be valid
-                continue;
-
-            if (sscanf(rxbuf, "%*[^%%]%s", address)) {
-                snprintf(results->port, sizeof results->port, "%s", port);
-                mcTraceF(40, MDRIVE_CHANNEL, "%s: Found %s@%d:%c",
-                    rxbuf, port, s->human, address[1]);
-                results->address = address[1];
-                results->speed = s->human;
-                results++;
-            }
+    for (;;) {
+        // fd is NONBLOCK, so it will return immediately and set errno
+        // at EAGAIN if there is no data for the read.
+        if ((length = read(fd, rxbuf, sizeof rxbuf - 1)) <= 0)
+            break;
+        else
+            rxbuf[length] = 0;
+
+        strtok(rxbuf, "?>");
+
+        if (strncmp(rxbuf, &txbuf[3], 3) == 0
+                || strncmp(rxbuf, &txbuf[4], 3) == 0)
+            // Echo mode is enabled (EM=0)
+            continue;
+
+        if (strlen(rxbuf) < 8)
+            // Response too short to be valid
+            continue;
+
+        if (sscanf(rxbuf, "%*[^%%]%3s", address)) {
+            mcTraceF(40, MDRIVE_CHANNEL, "%s: Found %s@%d:%c",
+                rxbuf, port, speed->human, address[1]);
+            result = (mdrive_address_t) {
+                .speed = speed->human,
+                .address = address[1]
+            };
+            snprintf(result.port, sizeof result.port, "%s", port);
+            found(&result, arg);
+            count++;
         }
     }
-    if (fd) close(fd);
+    close(fd);
+
+    return count;
+}
+
+/**
+ * mdrive_enum_motors_on_port
+ *
+ * Searches the port for units, calling [found] for each unit as it is
+ * found. Units come from the factory at DEFAULT_PORT_SPEED, which is tried
+ * first. The other baud rates are tried in turn only until units answer at
+ * one of them -- the units sharing a port are expected at the same speed.
+ *
+ * Returns:
+ * (int) number of units found
+ */
+int
+mdrive_enum_motors_on_port(const char * port, mdrive_search_callback_t found,
+        void * arg) {
+    const struct baud_rate * s;
+    int count = 0;
+
+    for (s = baud_rates; s->human; s++)
+        if (s->human == DEFAULT_PORT_SPEED)
+            count = mdrive_search_speed(port, s, found, arg);
+
+    for (s = baud_rates; s->human && count == 0; s++)
+        if (s->human != DEFAULT_PORT_SPEED)
+            count = mdrive_search_speed(port, s, found, arg);
+
+    if (count < 0)
+        return 0;
+
     // Wait for motors to reboot
-    if (results != list) sleep(1);
-    return list;
+    if (count) sleep(1);
+    return count;
+}
+
+// State shared by the threads of a search
+struct mdrive_search {
+    char **             ports;
+    int                 nports;
+    int                 next;           // Index of the next port to scan
+    int                 count;          // Units found
+    pthread_mutex_t     lock;           // Serializes the [found] calls
+    mdrive_search_callback_t found;
+    void *              arg;
+};
+
+static void
+mdrive_search_found(const mdrive_address_t * address, void * arg) {
+    struct mdrive_search * search = arg;
+
+    pthread_mutex_lock(&search->lock);
+    search->count++;
+    search->found(address, search->arg);
+    pthread_mutex_unlock(&search->lock);
+}
+
+static void *
+mdrive_search_thread(void * arg) {
+    struct mdrive_search * search = arg;
+    int index;
+
+    // Threads keep taking indexes after the last port is taken, so the
+    // list is not read past its end
+    while ((index = __atomic_fetch_add(&search->next, 1, __ATOMIC_RELAXED))
+            < search->nports)
+        mdrive_enum_motors_on_port(search->ports[index], mdrive_search_found,
+            search);
+
+    return NULL;
+}
+
+/**
+ * mdrive_search_ports
+ *
+ * Searches the (NULL-terminated) list of [ports] for units, with up to
+ * [threads] ports scanned at once (MDRIVE_SEARCH_THREADS if zero). The
+ * [found] routine is called for each unit as it is found; the calls are
+ * not concurrent, but come from the threads of the search.
+ *
+ * Returns:
+ * (int) number of units found
+ */
+int
+mdrive_search_ports(char ** ports, int threads,
+        mdrive_search_callback_t found, void * arg) {
+    struct mdrive_search search = {
+        .ports = ports,
+        .found = found,
+        .arg = arg
+    };
+    pthread_t pool[MDRIVE_SEARCH_THREADS];
+    int i, started, nports;
+
+    for (nports = 0; ports[nports]; nports++);
+    search.nports = nports;
+    if (threads <= 0 || threads > MDRIVE_SEARCH_THREADS)
+        threads = MDRIVE_SEARCH_THREADS;
+    if (threads > nports)
+        threads = nports;
+
+    pthread_mutex_init(&search.lock, NULL);
+    for (started = 0; started < threads; started++)
+        if (pthread_create(&pool[started], NULL, mdrive_search_thread,
+                &search))
+            break;
+
+    // Scan in this thread if none could be started
+    if (started == 0)
+        mdrive_search_thread(&search);
+    for (i = 0; i < started; i++)
+        pthread_join(pool[i], NULL);
+    pthread_mutex_destroy(&search.lock);
+
+    return search.count;
 }
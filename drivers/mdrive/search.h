@@ -0,0 +1,16 @@
+// Ports scanned at once by mdrive_search_ports, unless given
+#define MDRIVE_SEARCH_THREADS 8
+
+// Called for each unit found, as found
+typedef void (*mdrive_search_callback_t)(const mdrive_address_t *, void *);
+
+extern char **
+mdrive_enum_serial_ports(void);
+
+extern int
+mdrive_enum_motors_on_port(const char * port, mdrive_search_callback_t found,
+    void * arg);
+
+extern int
+mdrive_search_ports(char ** ports, int threads,
+    mdrive_search_callback_t found, void * arg);
@@ -1,14 +1,20 @@
 #include "mdrive.h"
 #include "serial.h"
 
+#include "capture.h"
 #include "config.h"
 #include "events.h"
+#include "io.h"
+#include "poller.h"
 #include "queue.h"
 
 #include <errno.h>
 #include <signal.h>
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
 #include <stdio.h>
-#include <sys/select.h>
+#include <poll.h>
 #include <termios.h>
 #include <time.h>
 
@@ -20,6 +26,20 @@ static const int MAX_RETRIES = 1;
 // following transaction on the same comm channel
 static const int MIN_TX_GAP_NSEC = 0e6;
 
+// Time the line is allowed to be quiet between two chars of a response
+// before the response is considered to be complete (plus a few char times)
+static const int FRAME_IDLE_NSEC = 20e6;
+
+// Bounds of the estimated time to wait for the first response from a unit
+// (retransmission timeout). The initial value is used until the round-trip
+// time of the unit has been sampled
+static const int RTO_MIN_NSEC = 8e6;
+static const int RTO_MAX_NSEC = 500e6;
+static const int RTO_INITIAL_NSEC = 55e6;
+
+// Clock granularity -- the smallest deviation allowed in the timeout
+static const int RTO_GRANULARITY_NSEC = 1e6;
+
 // XXX: Use a stinkin' header file include
 extern void tsAdd(const struct timespec *, const struct timespec *,
     struct timespec *);
@@ -81,6 +101,50 @@ mdrive_get_integer(mdrive_device_t * device, const char * variable, int * value)
     return errno;
 }
 
+/**
+ * mdrive_integers_command
+ *
+ * Formats into [buffer] the command reading the [count] variables [vars]
+ * from the unit at once, as sent by mdrive_get_integers.
+ */
+void
+mdrive_integers_command(char * buffer, size_t size, const char * vars[],
+    int count) {
+
+    char * pbuf = buffer;
+
+    pbuf += snprintf(buffer, size, "PR %s", *vars++);
+    while (--count)
+        pbuf += snprintf(pbuf, size + buffer - pbuf, ",\" \",%s", *vars++);
+}
+
+/**
+ * mdrive_parse_integers
+ *
+ * Loads the [count] numbers of the [result] of a command formatted by
+ * mdrive_integers_command into [values].
+ *
+ * Returns:
+ * (int) 0 upon success, EIO if the response is not understood
+ */
+int
+mdrive_parse_integers(mdrive_response_t * result, int * values[],
+    int count) {
+
+    char * pbuf = result->buffer;
+
+    errno = 0;
+    while (count--) {
+        // Load the next number into the next int * and increment the int *
+        // array index. Use strtol() to calculate the position of the
+        // end-of-this-/beginning-of-the-next number.
+        **values++ = strtol(pbuf, &pbuf, 10);
+        if (errno == EINVAL)
+            return EIO;
+    }
+    return 0;
+}
+
 /**
  * mdrive_get_integers
  *
@@ -91,14 +155,10 @@ int
 mdrive_get_integers(mdrive_device_t * device, const char * vars[],
     int * values[], int count) {
 
-    char buffer[64], * pbuf = buffer;
-    int cValues = count;
+    char buffer[64];
     mdrive_response_t result = { .txid = 0 };
 
-    pbuf += snprintf(buffer, sizeof buffer, "PR %s", *vars++);
-    while (--count)
-        pbuf += snprintf(pbuf, sizeof buffer + pbuf - buffer,
-            ",\" \",%s", *vars++);
+    mdrive_integers_command(buffer, sizeof buffer, vars, count);
 
     struct mdrive_send_opts options = {
         .expect_data = true,
@@ -107,17 +167,7 @@ mdrive_get_integers(mdrive_device_t * device, const char * vars[],
     if (mdrive_communicate(device, buffer, &options) != RESPONSE_OK)
         return EIO;
 
-    errno = 0;
-    pbuf = result.buffer;
-    while (cValues--) {
-        // Load the next number into the next int * and increment the int *
-        // array index. Use strtol() to calculate the position of the
-        // end-of-this-/beginning-of-the-next number.
-        **values++ = strtol(pbuf, &pbuf, 10);
-        if (errno == EINVAL)
-            return EIO;
-    }
-    return 0;
+    return mdrive_parse_integers(&result, values, count);
 }
 
 /**
@@ -251,7 +301,7 @@ mdrive_classify_response(mdrive_device_t * device, mdrive_response_t * response)
         else if (response->nack)
             return RESPONSE_NACK;
         else if (!response->nack && !response->ack) {
-            if (device->txnest == 1)
+            if (device->txnest == 1 && !device->offline)
                 mdrive_config_after_reboot(device);
             // Fall through to non checksum-mode checks
         }
@@ -267,12 +317,13 @@ mdrive_classify_response(mdrive_device_t * device, mdrive_response_t * response)
             if (device->txnest == 1 && !device->ignore_errors)
                 response->code = mdrive_get_error(device);
         }
-        else
+        else if (!device->offline)
             // Unit sent the error code, so clear the error on the unit
             mdrive_clear_error(device);
 
         if (response->code) {
-            mdrive_signal_error_event(device, response->code);
+            if (!device->offline)
+                mdrive_signal_error_event(device, response->code);
             if (response->code == MDRIVE_EOVERRUN
                     || response->code == MDRIVE_EWHAT)
                 return RESPONSE_RETRY;
@@ -304,22 +355,92 @@ mdrive_classify_response(mdrive_device_t * device, mdrive_response_t * response)
     return RESPONSE_UNKNOWN;
 }
 
+// Chars which are not simply copied into the response buffer (in addition
+// to the ones with the high bit set, which might be checksums)
+static const bool mdrive_control_chars[128] = {
+    ['\n'] = true, ['\r'] = true, ['\x06'] = true, ['\x15'] = true,
+    ['?'] = true, ['>'] = true, ['!'] = true, ['"'] = true,
+};
+
 /**
- * mdrive_process_response
+ * mdrive_scan_plain
  *
- * Processes the partial response from a unit. This function can/should be
- * called multiple times with different buffers and the same response. Each
- * time, the response will be processed to either the perceived end of
- * transmission indicated in the response, or a null character, whichever is
- * found first. If the response is believed to be complete, the ->processed
- * member of the response will be set.
+ * Finds the length of the run of ordinary chars at the start of [buffer],
+ * which are copied into the response as they are. The run ends at the
+ * first control char or char with the high bit set. Where SSE2 is
+ * available, sixteen chars are examined at once.
+ */
+static int
+mdrive_scan_plain(const char * buffer, int length) {
+    int run = 0;
+
+#ifdef __SSE2__
+    const __m128i lf = _mm_set1_epi8('\n'), cr = _mm_set1_epi8('\r'),
+        ack = _mm_set1_epi8('\x06'), nack = _mm_set1_epi8('\x15'),
+        error = _mm_set1_epi8('?'), prompt = _mm_set1_epi8('>'),
+        event = _mm_set1_epi8('!'), quote = _mm_set1_epi8('"');
+    __m128i chars, found;
+    int mask;
+
+    for (; run + 16 <= length; run += 16) {
+        chars = _mm_loadu_si128((const __m128i *) (buffer + run));
+        found = _mm_or_si128(
+            _mm_or_si128(
+                _mm_or_si128(_mm_cmpeq_epi8(chars, lf),
+                    _mm_cmpeq_epi8(chars, cr)),
+                _mm_or_si128(_mm_cmpeq_epi8(chars, ack),
+                    _mm_cmpeq_epi8(chars, nack))),
+            _mm_or_si128(
+                _mm_or_si128(_mm_cmpeq_epi8(chars, error),
+                    _mm_cmpeq_epi8(chars, prompt)),
+                _mm_or_si128(_mm_cmpeq_epi8(chars, event),
+                    _mm_cmpeq_epi8(chars, quote))));
+        // The high bit of each char is its own mark
+        mask = _mm_movemask_epi8(found) | _mm_movemask_epi8(chars);
+        if (mask)
+            return run + __builtin_ctz(mask);
+    }
+#endif
+
+    while (run < length && !(buffer[run] & 128)
+            && !mdrive_control_chars[(int) buffer[run]])
+        run++;
+
+    return run;
+}
+
+/**
+ * mdrive_sum
  *
- * Returns:
- * (int) number of characters processed in the received buffer.
+ * Adds the chars between [from] and [to] to the 8-bit [sum].
  */
-int
-mdrive_process_response(char * buffer, mdrive_response_t * response,
-        int length) {
+static inline unsigned char
+mdrive_sum(unsigned char sum, const char * from, const char * to) {
+    while (from < to)
+        sum += *from++;
+    return sum;
+}
+
+/**
+ * mdrive_process_response_
+ *
+ * Implementation of mdrive_process_response(). If [scan] is not set, each
+ * char is examined in turn, and every candidate checksum char is checked
+ * by summing the response from its start. This is the original and
+ * simplest form of the parser, kept as the reference for the fast one.
+ *
+ * With [scan] set, runs of ordinary chars are found with
+ * mdrive_scan_plain() and copied at once. A running sum of the chars
+ * received is kept in the response (->sum), along with the sum up to the
+ * first char (->sum_head) and up to the last ACK (->sum_ack), where the
+ * checksummed data can start. So a checksum is checked without revisiting
+ * the chars before it, and each char is summed once. The chars are summed
+ * lazily -- only when a checksum is to be checked, and at the end of the
+ * buffer.
+ */
+static int
+mdrive_process_response_(char * buffer, mdrive_response_t * response,
+        int length, bool scan) {
     if (length < 1)
         return 0;
 
@@ -328,8 +449,41 @@ mdrive_process_response(char * buffer, mdrive_response_t * response,
     // TODO: Handle solitary ACK followed by event ('!') ...
     // Setup a pointer to the end of the response buffer
     char * target = response->buffer + response->length;
-    char * bufc = buffer, * start;
+    char * bufc = buffer, * start, * summed = buffer;
+    unsigned char base;
+    int run, offset;
+
+    if (scan && !response->received)
+        response->sum_head = *buffer;
+
     while (length-- && !response->processed) {
+        if (response->in_address && !response->address) {
+            response->address = *bufc++;
+            continue;
+        }
+
+        // Copy runs of ordinary chars at once. Anything else is examined
+        // one char at a time below
+        if (scan && !response->in_error
+                && (run = mdrive_scan_plain(bufc, length + 1))) {
+            if (run > sizeof response->buffer - 1 - response->length)
+                run = sizeof response->buffer - 1 - response->length;
+            memcpy(target, bufc, run);
+            target += run;
+            bufc += run;
+            length -= run - 1;
+            response->length += run;
+            if (response->length == sizeof response->buffer - 1)
+                response->processed = true;
+            continue;
+        }
+        // A second [N]ACK before any data opens the response to the next
+        // (pipelined) transaction. Leave it for the next response
+        if ((*bufc == '\x06' || *bufc == '\x15') && !response->length
+                && (response->ack || response->nack) && !response->event) {
+            response->processed = true;
+            break;
+        }
         switch (*bufc) {
             case '\n':
                 // End of transmission marker -- the motor will send CRLF,
@@ -349,11 +503,13 @@ mdrive_process_response(char * buffer, mdrive_response_t * response,
                         response->error = true;
                         bufc++;
                     }
-                    else if (*(bufc+1) == '\x06') {
-                        // If a procedure as EX'd and it printed something,
-                        // in checksum mode, the ACK will follow the CRLF
-                        bufc++;
-                    }
+                    // NOTE: If a procedure was EX'd and it printed
+                    //       something, in checksum mode, the ACK will
+                    //       follow the CRLF. It is not consumed here,
+                    //       because with pipelining it can also open the
+                    //       response to the next transaction. A stray ACK
+                    //       is dropped when matched to no transaction
+
                     // Stock firmwares will not send the prompt in EM=1;
                     // however, CRLF (\r\n) indicates command accepted.
                     // TODO: Check firmware version
@@ -388,6 +544,11 @@ mdrive_process_response(char * buffer, mdrive_response_t * response,
             case '\x06':
                 response->ack = true;
                 response->ack_location = bufc - buffer + response->received;
+                if (scan) {
+                    response->sum_ack = response->sum =
+                        mdrive_sum(response->sum, summed, bufc);
+                    summed = bufc;
+                }
             case '\x15':
                 if (*bufc == '\x15')
                     response->nack = true;
@@ -447,15 +608,36 @@ mdrive_process_response(char * buffer, mdrive_response_t * response,
                 }
                 goto normal_char;
             case '"':
-                // Marks the start/end of the device name string for events
-                if (response->event && !response->address && !response->length) {
-                    response->address = *(++bufc);
-                    bufc++; // Skip the trailing "
+                // Marks the start/end of the device name string for events.
+                // The name (address) char might arrive in the next read
+                if (response->event && !response->length
+                        && (!response->address || response->in_address)) {
+                    response->in_address = !response->address;
                     break;
                 }
             default:
                 // Detect and parse checksum chars
-                if ((*bufc & 128) && !response->checksum_good) {
+                if ((*bufc & 128) && !response->checksum_good && scan) {
+                    response->sum = mdrive_sum(response->sum, summed, bufc);
+                    summed = bufc;
+                    if (response->ack_location) {
+                        offset = response->ack_location;
+                        base = response->sum_ack;
+                    }
+                    else if (response->ack | response->nack) {
+                        offset = 1;
+                        base = response->sum_head;
+                    }
+                    else
+                        offset = base = 0;
+                    if (bufc - buffer + response->received > offset
+                            && *bufc == (char) (((unsigned char)
+                                ~(response->sum - base) + 1) | 128)) {
+                        response->checksum_good = true;
+                        break;
+                    }
+                }
+                else if ((*bufc & 128) && !response->checksum_good) {
                     if (response->ack_location)
                         start = buffer - response->received
                             + response->ack_location;
@@ -499,11 +681,263 @@ normal_char:
         // Reboot sends an single '$' char
         response->processed = true;
 
+    if (scan)
+        response->sum = mdrive_sum(response->sum, summed, bufc);
+
     // Return number of chars processed
     response->received += bufc - buffer;
     return bufc - buffer;
 }
 
+/**
+ * mdrive_process_response
+ *
+ * Processes the partial response from a unit. This function can/should be
+ * called multiple times with different buffers and the same response. Each
+ * time, the response will be processed to either the perceived end of
+ * transmission indicated in the response, or a null character, whichever is
+ * found first. If the response is believed to be complete, the ->processed
+ * member of the response will be set.
+ *
+ * Returns:
+ * (int) number of characters processed in the received buffer.
+ */
+int
+mdrive_process_response(char * buffer, mdrive_response_t * response,
+        int length) {
+    return mdrive_process_response_(buffer, response, length, true);
+}
+
+/**
+ * mdrive_process_response_reference
+ *
+ * Same as mdrive_process_response(), one char at a time (see
+ * mdrive_process_response_). The responses are the same, except for the
+ * running sums.
+ */
+int
+mdrive_process_response_reference(char * buffer, mdrive_response_t * response,
+        int length) {
+    return mdrive_process_response_(buffer, response, length, false);
+}
+
+/**
+ * mdrive_frame_idle_time
+ *
+ * Time the line can remain quiet in the middle of a response before the
+ * partial response is considered complete. Units send a response back to
+ * back, so this only happens with garbage or a truncated transmission.
+ * The margin allows for USB-serial adapters, which hold received bytes for
+ * their latency timer (16ms on FTDI parts) before passing them up.
+ *
+ * Returns:
+ * (int) idle time in nanoseconds at the current port speed
+ */
+int
+mdrive_frame_idle_time(mdrive_comm_device_t * dev) {
+    return FRAME_IDLE_NSEC + mdrive_xmit_time(dev, 4);
+}
+
+/**
+ * mdrive_response_echo
+ *
+ * In echo mode (EM=0), the unit sends the request back before the actual
+ * response. The echo is also sent for the command which switches the unit
+ * out of echo mode, so the device's current echo setting is not
+ * considered. The \r, \n, >, ? and checksum chars are not part of the
+ * response buffer, so the request text is compared without them.
+ *
+ * Returns:
+ * (bool) TRUE if the response is the echo of the transaction's request
+ */
+static bool
+mdrive_response_echo(mdrive_transaction_t * tx, mdrive_response_t * response) {
+    return response->length && response->length == tx->text_length
+        && strncmp(response->buffer, tx->request, response->length) == 0;
+}
+
+/**
+ * mdrive_response_pending
+ *
+ * Decides if more of the response to a transaction is to be expected after
+ * the received (partial) response. This is the case if the unit only
+ * acknowledged a command expected to return data, or if the received data
+ * is the unit's echo of the request.
+ *
+ * Returns:
+ * (bool) TRUE if the transaction is still awaiting data from the unit
+ */
+static bool
+mdrive_response_pending(mdrive_transaction_t * tx,
+        mdrive_response_t * response) {
+    if (mdrive_response_echo(tx, response))
+        return true;
+
+    else if (tx->expect_data && !response->length
+            && (response->ack | response->nack | response->crlf))
+        // Unless the unit indicated an error already
+        return !response->code;
+
+    return false;
+}
+
+/**
+ * mdrive_port_wake
+ *
+ * Lets the transaction next in line for the wire reconsider its turn, after
+ * the wire or room in the pipeline was freed. Only the first waiting
+ * transaction can take the turn -- unless the port is reserved, when the
+ * transactions of the thread holding the reservation go first wherever
+ * they are in line. The comm device's rxlock must be held.
+ */
+static void
+mdrive_port_wake(mdrive_comm_device_t * comm) {
+    mdrive_transaction_t * tx;
+
+    for (tx = comm->waiters; tx; tx = tx->waiting) {
+        pthread_cond_signal(&tx->turn);
+        if (!comm->reserved)
+            break;
+    }
+}
+
+/**
+ * mdrive_transaction_retire
+ *
+ * Takes a transaction off the wire, which frees up its slot in the
+ * pipeline for the next transmission on the port. If the transaction is
+ * [abandon]ed (it timed out), data still being received for it is scratched
+ * by the receive thread, and the port is resynchronized (see
+ * mdrive_transaction_send). The comm device's rxlock must be held.
+ */
+static void
+mdrive_transaction_retire(mdrive_comm_device_t * comm,
+        mdrive_transaction_t * tx, bool abandon) {
+    if (!tx->inflight)
+        return;
+
+    tx->inflight = false;
+    if (--comm->inflight == 0)
+        comm->exclusive = false;
+    if (abandon) {
+        comm->abandoned++;
+        comm->resync = comm->pipeline;
+    }
+
+    // If this was the first transaction in line, the unit answering the
+    // next one can be heard from now on
+    mdrive_transaction_t * next, * oldest = NULL;
+    for (next = comm->transactions; next; next = next->next)
+        if (next->inflight && (!oldest || next->txid < oldest->txid))
+            oldest = next;
+    if (oldest && oldest->txid > tx->txid)
+        clock_gettime(CLOCK_REALTIME, &oldest->first);
+
+    pthread_cond_broadcast(&comm->has_data);
+    mdrive_port_wake(comm);
+}
+
+/**
+ * mdrive_transaction_queued
+ *
+ * Returns true if an older transaction is still in flight ahead of [tx],
+ * in which case the unit addressed by [tx] cannot be heard yet. The rxlock
+ * must be held.
+ */
+static bool
+mdrive_transaction_queued(mdrive_comm_device_t * comm,
+        mdrive_transaction_t * tx) {
+    mdrive_transaction_t * other;
+
+    for (other = comm->transactions; other; other = other->next)
+        if (other->inflight && other->txid < tx->txid)
+            return true;
+
+    return false;
+}
+
+/**
+ * mdrive_async_queue
+ *
+ * Hands a completed response to the transaction it belongs to and wakes up
+ * the thread waiting for it. Units in party mode do not address their
+ * responses, but they answer in the order the requests were sent, so the
+ * response goes to the oldest transaction in flight. If no more data is
+ * expected for the transaction, it is retired so that the next request
+ * can be sent. Event indications are signaled instead of being queued. The
+ * response is owned by the transaction (or freed) after the call.
+ */
+static void
+mdrive_async_queue(mdrive_comm_device_t * dev, mdrive_response_t * response) {
+    mdrive_transaction_t * tx, * oldest = NULL;
+    struct timespec now;
+
+    response->buffer[response->length] = 0;
+    dev->rxstats.frames++;
+
+    if (response->event) {
+        mdrive_signal_event_device(dev, response->address, response->code);
+        mdrive_response_free(&dev->pool, response);
+        return;
+    }
+
+    pthread_mutex_lock(&dev->rxlock);
+    for (tx = dev->transactions; tx; tx = tx->next)
+        if (tx->inflight && (!oldest || tx->txid < oldest->txid))
+            oldest = tx;
+
+    // In checksum mode, every response starts with an ACK or NACK. If
+    // another one is received, the unit is finished with the oldest
+    // transaction (for instance it NACKed a request for data), and the
+    // response is for the next one
+    if (oldest && oldest->acked && oldest->device->checksum
+            && (response->ack || response->nack)) {
+        mdrive_transaction_retire(dev, oldest, false);
+        for (tx = dev->transactions, oldest = NULL; tx; tx = tx->next)
+            if (tx->inflight && (!oldest || tx->txid < oldest->txid))
+                oldest = tx;
+    }
+
+    // Checksummed data without the ACK it follows is left over from a
+    // transaction that was given up on. (Units which rebooted out of
+    // checksum mode don't send a checksum, and pass through here)
+    if (oldest && oldest->device->checksum && !oldest->acked
+            && !(response->ack || response->nack) && response->checksum_good
+            && !mdrive_response_echo(oldest, response))
+        oldest = NULL;
+
+    mdrive_capture(dev, MDRIVE_CAPTURE_MATCH, oldest ? oldest->device->address
+        : 0, oldest ? oldest->txid : 0, response->buffer, response->length);
+
+    if (oldest) {
+        // Record the transaction id
+        response->txid = oldest->txid;
+        clock_gettime(CLOCK_REALTIME, &now);
+        histogram_record(&oldest->device->stats.frame_histogram,
+            nsecDiff(&now, &response->started));
+        if (!queue_push(&oldest->frames, response)) {
+            oldest->device->stats.queue_overflows++;
+            oldest = NULL;
+        }
+    }
+
+    if (oldest) {
+        oldest->acked |= response->ack || response->nack;
+        if (!mdrive_response_pending(oldest, response))
+            mdrive_transaction_retire(dev, oldest, false);
+        // Signal that data is ready
+        pthread_cond_broadcast(&dev->has_data);
+    }
+    else {
+        mcTraceF(30, MDRIVE_CHANNEL_RX, "Dropping unsolicited response: %s",
+            response->buffer);
+        dev->rxstats.dropped++;
+        dev->resync = dev->pipeline;
+        mdrive_response_free(&dev->pool, response);
+    }
+    pthread_mutex_unlock(&dev->rxlock);
+}
+
 /**
  * mdrive_async_read
  *
@@ -512,6 +946,14 @@ normal_char:
  * ->has_data condition member when a response has been placed on the queue
  * for that device.
  *
+ * The thread sleeps in poll() until data arrives on the port, and the
+ * received bytes are processed immediately, so a response is handed to the
+ * waiting transaction as soon as its last byte is read. While a response is
+ * partially received, poll() is given the inter-byte idle time as its
+ * timeout. Should the line go quiet before the response is complete, the
+ * partial response is closed and queued so that the transaction does not
+ * have to wait out its full timeout.
+ *
  * Should more than one response be received for one transaction id, the
  * best attempt will be made to queue all the items related to the
  * transaction before signaling the has_data condition.
@@ -519,60 +961,110 @@ normal_char:
 void *
 mdrive_async_read(void * arg) {
     mdrive_comm_device_t * dev = arg;
-    mdrive_response_t * response = calloc(1, sizeof *response);
+    mdrive_response_t * response = mdrive_response_alloc(&dev->pool);
 
-    // Wait time for a single char at the device speed
-    // XXX: dev->speed is allowed to be changed on the fly
-    struct timespec now,
-        onechartime = { .tv_nsec = mdrive_xmit_time(dev, 2) };
+    struct timespec now, before, idle, * timeout;
+    struct pollfd pfd = { .fd = dev->fd, .events = POLLIN };
 
-    int length;
+    int length, status;
     char buffer[512];
     // Where the load and process pieces are in the buffer space
     char * load = buffer, * process = buffer;
-    int txid = 0;
-
-    fd_set fds;
-    FD_ZERO(&fds);
-    FD_SET(dev->fd, &fds);
+    unsigned abandoned = 0;
 
     while (true) {
 
-        // Try to read more than one char at a time
-        nanosleep(&onechartime, NULL);
-        length = read(dev->fd, load, sizeof buffer - (int)(load - buffer));
+        // Block until data arrives. If a response is partially received,
+        // only wait for the inter-byte idle time. NOTE: dev->speed is
+        // allowed to be changed on the fly
+        if (response->received) {
+            idle = (struct timespec) { .tv_nsec = mdrive_frame_idle_time(dev) };
+            timeout = &idle;
+        }
+        else
+            timeout = NULL;
+
+        clock_gettime(CLOCK_MONOTONIC, &before);
+        status = ppoll(&pfd, 1, timeout, NULL);
+        clock_gettime(CLOCK_MONOTONIC, &now);
+        dev->rxstats.idletime += nsecDiff(&now, &before) / 1000;
+
+        if (status == -1) {
+            if (errno == EINTR)
+                continue;
+            mcTraceF(1, MDRIVE_CHANNEL_RX, "Unable to poll port: %d", errno);
+            break;
+        }
+        else if (status == 0) {
+            // Line went idle with a partial response. Close it and hand it
+            // to the transaction for classification. Stray prompt chars
+            // carry nothing of interest and are just dropped
+            mcTraceF(30, MDRIVE_CHANNEL_RX, "Line idle with %d chars received",
+                response->received);
+            dev->rxstats.idle_closes++;
+            if (response->length || response->error) {
+                response->processed = true;
+                mdrive_async_queue(dev, response);
+                response = mdrive_response_alloc(&dev->pool);
+            }
+            else
+                bzero(response, sizeof *response);
+            process = load = buffer;
+            continue;
+        }
+        else if (pfd.revents & POLLNVAL)
+            // Bad file number -- fd is not opened properly
+            break;
 
-        // If the txid's changed while this thread was asleep, scratch the
-        // received data
-        if (txid && txid != dev->txid)
+        dev->rxstats.wakeups++;
+        length = read(dev->fd, load, sizeof buffer - 1 - (int)(load - buffer));
+
+        // If a transaction was given up on while this thread was asleep,
+        // scratch the received data
+        if (abandoned != dev->abandoned && response->received) {
             bzero(response, sizeof *response);
-        txid = dev->txid;
+            if (length > 0)
+                // Move the newly read data to the beginning of the buffer
+                memmove(buffer, load, length);
+            process = load = buffer;
+        }
+        abandoned = dev->abandoned;
 
-        // Don't acquire txlock because it would create a deadlock. Just
-        // make sure writes to the dev members are atomic.
-        clock_gettime(CLOCK_REALTIME, &now);
-        dev->lastActivity = now;
+        // Don't acquire rxlock for this. Just make sure writes to the dev
+        // members are atomic.
+        clock_gettime(CLOCK_REALTIME, &dev->lastActivity);
 
         if (length == -1) {
             mcTraceF(1, MDRIVE_CHANNEL_RX, "Recieved error: %d", errno);
-            if (errno == 9)
+            if (errno == EBADF)
                 // Bad file number -- fd is not opened properly
                 break;
             else
                 continue;
         }
+        else if (length == 0) {
+            // Hangup (the other end of a pseudo-terminal closed) or the
+            // buffer is full of garbage. Drop what has been received
+            if (!(pfd.revents & POLLIN) || load - buffer >= sizeof buffer - 1) {
+                bzero(response, sizeof *response);
+                process = load = buffer;
+                nanosleep(&(struct timespec) { .tv_nsec = FRAME_IDLE_NSEC },
+                    NULL);
+            }
+            continue;
+        }
 
-        // TODO: Keep track of the time the first byte was received for this
-        // response. After some amount of time (say 1 sec), we can close the
-        // response because there's no way the bytes go with the same
-        // transmission.
-
+        dev->rxstats.bytes += length;
         mcTraceBuffer(50, MDRIVE_CHANNEL_RX, load, length);
+        mdrive_capture(dev, MDRIVE_CAPTURE_RX, 0, dev->txid, load, length);
 
         load += length;     // Advance load pointer to end of input
         *load = 0;          // Null-terminate
 
         while (process < load) {
+            if (!response->received)
+                response->started = dev->lastActivity;
+
             // (Continue to) process the response, advance the process pointer
             process += mdrive_process_response(process, response, load-process);
 
@@ -580,31 +1072,18 @@ mdrive_async_read(void * arg) {
             // roll in.
             if ((response->length == 0 && (response->ack || response->nack))
                     || response->processed) {
-                response->buffer[response->length] = 0;
-
-                if (response->event) {
-                    // TODO: Signal the event
-                    mdrive_signal_event_device(dev, response->address, response->code);
                 // If the process and load pointers match up, then we've
                 // processed all the current input and can reset the
-                // pointers
-                } else if (process == load) {
+                // pointers. Several responses can arrive in one read when
+                // transactions are pipelined -- queue each of them
+                if (process == load)
                     process = load = buffer;
-
-                    pthread_mutex_lock(&dev->rxlock);
-                    // Record the transaction id
-                    response->txid = dev->txid;
-                    queue_push(&dev->queue, response);
-                    // Signal that data is ready
-                    pthread_cond_signal(&dev->has_data);
-                    pthread_mutex_unlock(&dev->rxlock);
-                } else {
-                    free(response);
-                }
-                response = calloc(1, sizeof *response);
+                mdrive_async_queue(dev, response);
+                response = mdrive_response_alloc(&dev->pool);
             }
         }
     }
+    mdrive_response_free(&dev->pool, response);
     return NULL;
 }
 
@@ -646,9 +1125,16 @@ mdrive_combine_response(mdrive_response_t * a, mdrive_response_t * b) {
  * mdrive_write_buffer
  *
  * Sends the requested buffer to the requested device and updates device
- * statistics concerning the device timings and statistics. The routine will
- * block until the data has bee flushed to the device in order to eliminate
- * the transmission tx timing from the rx timeout.
+ * statistics concerning the device timings and statistics.
+ *
+ * If the port is set to [drain], the routine blocks until the data has
+ * been flushed to the device in order to eliminate the transmission tx
+ * timing from the rx timeout. Otherwise, the data is left to the kernel
+ * to transmit, and the time the last char will be on the wire is
+ * estimated from the length and the port speed -- behind whatever was
+ * still queued for the wire. Either way, the end of the transmission is
+ * kept in the comm device's lasttx member, from which the response is
+ * timed.
  *
  * This routine will ensure that a minimum transmission space is maintained
  * for the device to assist in keeping reboots and overflows to a minimum. 
@@ -659,54 +1145,331 @@ mdrive_combine_response(mdrive_response_t * a, mdrive_response_t * b) {
  */
 int
 mdrive_write_buffer(mdrive_device_t * device, const char * buffer, int length) {
-    struct timespec txwait, now,
+    mdrive_comm_device_t * comm = device->comm;
+    struct timespec txwait, before, now,
         txspacetime = { .tv_nsec = MIN_TX_GAP_NSEC };
 
     mcTraceBuffer(50, MDRIVE_CHANNEL_TX, buffer, length);
+    clock_gettime(CLOCK_REALTIME, &before);
 
     // NOTE: There needs to be at least a 10-20ms space between sends on
     // the wire. We need to wait here until it's safe to send more data.
     // The device maintains a time of last send in the lasttx member of
     // the device structure.
-    clock_gettime(CLOCK_REALTIME, &now);
-    tsAdd(&device->comm->lastActivity, &txspacetime, &txwait);
+    if (MIN_TX_GAP_NSEC) {
+        tsAdd(&comm->lastActivity, &txspacetime, &txwait);
+        // Don't bother checking if [txwait] is in the past, because
+        // clock_nanosleep() will too. No need checking twice
+        clock_nanosleep(CLOCK_REALTIME, TIMER_ABSTIME, &txwait, NULL);
+    }
 
     // Set baudrate speed on device->comm to device->speed. This
     // allows motors on the same comm channel to be at different speeds.
     // This doesn't make great sense for production units; however, it make
-    // diagnostics and motor setup much easier.
-    mdrive_set_baudrate(device->comm, device->speed);
-
-    // Don't bother checking if [txwait] is in the past, because
-    // clock_nanosleep() will too. No need checking twice
-    clock_nanosleep(CLOCK_REALTIME, TIMER_ABSTIME, &txwait, NULL);
+    // diagnostics and motor setup much easier. (The output still queued
+    // is drained before the speed is changed)
+    mdrive_set_baudrate(comm, device->speed);
 
     int pos = 0, written;
     // Write data to the file descriptor. If interrupted and not all data
     // was written out, loop and continue writing the rest of the
     // transmission
     do {
-        written = write(device->comm->fd, buffer + pos, length - pos);
+        written = write(comm->fd, buffer + pos, length - pos);
         if (written == -1)
             return errno;
         pos += written;
     } while (pos < length);
 
-    // There's no point in considering the transmission time in the
-    // receive timeout
-    tcdrain(device->comm->fd);
+    mdrive_capture(comm, MDRIVE_CAPTURE_TX, device->address, comm->txid,
+        buffer, length);
 
-    // Log the time of last transmission
-    clock_gettime(CLOCK_REALTIME, &device->comm->lasttx);
-    device->comm->lastActivity = device->comm->lasttx;
+    if (comm->drain) {
+        // There's no point in considering the transmission time in the
+        // receive timeout
+        tcdrain(comm->fd);
+
+        // Log the time of last transmission
+        clock_gettime(CLOCK_REALTIME, &comm->lasttx);
+        now = comm->lasttx;
+    }
+    else {
+        // The request goes on the wire after the ones still in the output
+        // queue of the port
+        clock_gettime(CLOCK_REALTIME, &now);
+        if (nsecDiff(&comm->lasttx, &now) < 0)
+            comm->lasttx = now;
+        tsAdd(&comm->lasttx, &(struct timespec) {
+            .tv_nsec = mdrive_xmit_time(comm, length) }, &comm->lasttx);
+    }
+    comm->lastActivity = comm->lasttx;
 
     // Update device statistics
     device->stats.tx++;
     device->stats.txbytes += length;
+    device->stats.writetime += nsecDiff(&now, &before);
+    histogram_record(&device->stats.write_histogram, nsecDiff(&now, &before));
 
     return 0;
 }
 
+/**
+ * mdrive_address_busy
+ *
+ * Only one thread at a time is allowed to exchange data with a unit, since
+ * the device state (txnest, comm settings, etc) is shared by the exchange.
+ * Nested transactions from the same thread (for automatic error retrieval)
+ * are allowed. The comm device's rxlock must be held.
+ *
+ * Returns:
+ * (bool) TRUE if another thread is communicating with [address]
+ */
+static bool
+mdrive_address_busy(mdrive_comm_device_t * comm, char address) {
+    mdrive_transaction_t * tx;
+
+    for (tx = comm->transactions; tx; tx = tx->next)
+        if (tx->device->address == address
+                && !pthread_equal(tx->owner, pthread_self()))
+            return true;
+
+    return false;
+}
+
+/**
+ * mdrive_port_turn
+ *
+ * Decides if [tx] can take its turn on the wire. Another thread might be
+ * writing to the port, or might have the port reserved (see
+ * mdrive_port_reserve). Otherwise, the transactions waiting go in line by
+ * their priority class. The comm device's rxlock must be held.
+ */
+static bool
+mdrive_port_turn(mdrive_comm_device_t * comm, mdrive_transaction_t * tx) {
+    if (comm->sending)
+        return false;
+    else if (comm->reserved)
+        return pthread_equal(comm->reserver, pthread_self());
+
+    return comm->waiters == tx;
+}
+
+/**
+ * mdrive_port_reserve
+ *
+ * Keeps the port to the calling thread, until released, for a series of
+ * exchanges which must not be interleaved with others (such as moving the
+ * units to another baud rate). Reservations nest.
+ */
+void
+mdrive_port_reserve(mdrive_comm_device_t * comm) {
+    pthread_mutex_lock(&comm->rxlock);
+    while (comm->reserved && !pthread_equal(comm->reserver, pthread_self()))
+        pthread_cond_wait(&comm->has_data, &comm->rxlock);
+    comm->reserver = pthread_self();
+    comm->reserved++;
+    pthread_mutex_unlock(&comm->rxlock);
+}
+
+void
+mdrive_port_release(mdrive_comm_device_t * comm) {
+    pthread_mutex_lock(&comm->rxlock);
+    if (--comm->reserved == 0) {
+        pthread_cond_broadcast(&comm->has_data);
+        mdrive_port_wake(comm);
+    }
+    pthread_mutex_unlock(&comm->rxlock);
+}
+
+/**
+ * mdrive_transaction_send
+ *
+ * Puts a transaction on the wire. The transmission waits until there is
+ * room in the pipeline of the port (or in the [window] of the transaction,
+ * see mdrive_stream). An [exclusive] transaction waits for
+ * the wire to be clear and holds it to itself until retired. Responses
+ * from a previous attempt of the transaction are discarded.
+ *
+ * Transactions waiting for the wire are sent by their priority class, so
+ * a stop goes out when the frame being written is finished rather than
+ * behind the queries and upload lines of other threads. Transactions of
+ * the same class go in the order they were requested. Only the first in
+ * line is woken when the wire is freed. The time waited is recorded in the
+ * histogram of the class.
+ *
+ * Since responses carry no address, a response arriving late for a
+ * transaction given up on, or one lost on the wire, would shift the
+ * matching of every response after it while the pipeline stays full. So
+ * the next few transmissions after such an event are sent alone on the
+ * wire, where a stray response is dropped rather than matched. After a
+ * timeout, the first of them also waits for the line to be quiet for the
+ * [guard] time of the port.
+ *
+ * Returns:
+ * (int) 0 upon success, errno from mdrive_write_buffer otherwise
+ */
+static int
+mdrive_transaction_send(mdrive_device_t * device, mdrive_transaction_t * tx,
+        bool exclusive) {
+    mdrive_comm_device_t * comm = device->comm;
+    struct timespec before, now;
+    int status;
+
+    clock_gettime(CLOCK_REALTIME, &before);
+    pthread_mutex_lock(&comm->rxlock);
+
+    // A previous attempt not completed by the unit
+    mdrive_transaction_retire(comm, tx, true);
+    queue_flush(&tx->frames, &comm->pool);
+    tx->acked = false;
+
+    // Units listening at another speed than the one in flight would only
+    // receive garbage. The port can need resyncing after any wait
+    bool resync = false;
+    int guard = 0;
+
+    // Get in line behind the transactions of the same or a more urgent
+    // class
+    mdrive_transaction_t ** line = &comm->waiters;
+    while (*line && (*line)->priority <= tx->priority)
+        line = &(*line)->waiting;
+    tx->waiting = *line;
+    *line = tx;
+
+    while (true) {
+        if (mdrive_port_turn(comm, tx)) {
+            if (!resync && comm->resync > 0) {
+                comm->resync--;
+                resync = exclusive = true;
+                guard = comm->guard;
+                comm->guard = 0;
+            }
+            if (!comm->inflight || !(exclusive || comm->exclusive
+                    || comm->inflight >= (tx->window ? tx->window
+                        : comm->pipeline)
+                    || device->speed != comm->speed))
+                break;
+        }
+        pthread_cond_wait(&tx->turn, &comm->rxlock);
+    }
+    for (line = &comm->waiters; *line != tx; line = &(*line)->waiting);
+    *line = tx->waiting;
+
+    // Hold the wire so that the order of the transactions in flight is the
+    // order of the requests on the wire
+    comm->sending = true;
+
+    clock_gettime(CLOCK_REALTIME, &now);
+    histogram_record(&device->stats.txlock_histogram,
+        nsecDiff(&now, &before));
+    histogram_record(&device->stats.queue_histogram[tx->priority],
+        nsecDiff(&now, &before));
+
+    if (guard) {
+        // Let the line be quiet for [guard] nanoseconds, so that a late
+        // response to a transaction given up on is received (and dropped)
+        // before the request is sent. Nothing is sent meanwhile since the
+        // wire is held
+        pthread_mutex_unlock(&comm->rxlock);
+        long long idle;
+        while (true) {
+            clock_gettime(CLOCK_REALTIME, &now);
+            idle = nsecDiff(&now, &comm->lastActivity);
+            if (idle >= guard)
+                break;
+            nanosleep(&(struct timespec) { .tv_nsec = guard - idle }, NULL);
+        }
+        pthread_mutex_lock(&comm->rxlock);
+    }
+
+    // txid is incremented for every transmit to incidate that any
+    // previously-received data is now invalid and does not belong to this
+    // transaction.
+    tx->txid = ++comm->txid;
+    tx->first = (struct timespec) { 0 };
+    tx->sends++;
+    tx->inflight = true;
+    comm->inflight++;
+    comm->exclusive = exclusive;
+    pthread_mutex_unlock(&comm->rxlock);
+
+    status = mdrive_write_buffer(device, tx->request, tx->length);
+    tx->sent = comm->lasttx;
+
+    pthread_mutex_lock(&comm->rxlock);
+    if (status)
+        mdrive_transaction_retire(comm, tx, true);
+    comm->sending = false;
+    mdrive_port_wake(comm);
+    pthread_mutex_unlock(&comm->rxlock);
+
+    return status;
+}
+
+/**
+ * mdrive_rtt_sample
+ *
+ * Adds a round-trip time [sample] (nanoseconds) to the estimate, after
+ * Jacobson and Karels (RFC 6298). The smoothed RTT moves 1/8 of the way
+ * toward the sample and the variation 1/4 of the way toward the deviation
+ * of the sample. The retransmission timeout allows for four times the
+ * variation.
+ */
+static void
+mdrive_rtt_sample(mdrive_rtt_t * rtt, int sample) {
+    // The end of the transmission might have been estimated (see
+    // mdrive_write_buffer) and beaten by the response
+    if (sample < 0)
+        sample = 0;
+
+    if (rtt->srtt == 0) {
+        rtt->srtt = sample;
+        rtt->rttvar = sample / 2;
+    }
+    else {
+        rtt->rttvar += (abs(rtt->srtt - sample) - rtt->rttvar) / 4;
+        rtt->srtt += (sample - rtt->srtt) / 8;
+    }
+
+    rtt->rto = rtt->srtt + ((4 * rtt->rttvar > RTO_GRANULARITY_NSEC)
+        ? 4 * rtt->rttvar : RTO_GRANULARITY_NSEC);
+    if (rtt->rto < RTO_MIN_NSEC)
+        rtt->rto = RTO_MIN_NSEC;
+    else if (rtt->rto > RTO_MAX_NSEC)
+        rtt->rto = RTO_MAX_NSEC;
+}
+
+/**
+ * mdrive_rtt_backoff
+ *
+ * Doubles the retransmission timeout after the unit failed to respond in
+ * time. It stays backed off until a new sample is taken.
+ */
+static void
+mdrive_rtt_backoff(mdrive_rtt_t * rtt) {
+    int rto = rtt->rto ? rtt->rto : RTO_INITIAL_NSEC;
+
+    rtt->rto = (rto > RTO_MAX_NSEC / 2) ? RTO_MAX_NSEC : 2 * rto;
+}
+
+/**
+ * mdrive_priority
+ *
+ * Priority class of a transaction. Unless given in the [options], raw
+ * requests (control chars such as escape and ^C) are emergencies, requests
+ * returning data are queries, and the others are motion commands.
+ */
+int
+mdrive_priority(const struct mdrive_send_opts * options) {
+    if (options->priority)
+        return options->priority;
+    else if (options->raw)
+        return MDRIVE_PRIORITY_EMERGENCY;
+    else if (options->expect_data)
+        return MDRIVE_PRIORITY_QUERY;
+    return MDRIVE_PRIORITY_MOTION;
+}
+
 /**
  * mdrive_communicate
  *
@@ -714,12 +1477,15 @@ mdrive_write_buffer(mdrive_device_t * device, const char * buffer, int length) {
  * communicate with the unit, the transmission will be automatically retried
  * up to MAX_RETRIES times.
  *
- * The timeout period for the received response is autosensed at 55ms. This
- * value will float as the current latency of the unit plus 40ms. If an
- * incomplete response is received, an additional 25ms + the time to receive
- * the rest of the buffer (62 chars) will be added to the timeout time. In
- * order to make use of the delayed response detection, set the
- * <expects_data> flag.
+ * The timeout period for the first response is estimated from the
+ * round-trip times of the unit (see mdrive_rtt_sample), separately for
+ * commands returning data (<expect_data>) and for other commands. It
+ * starts at 55ms and doubles for each timeout. Round trips of retried
+ * transmissions are not sampled, since the response cannot be attributed
+ * to either attempt (Karn's algorithm). If an incomplete response is
+ * received, an additional 15ms + the time to receive the rest of the
+ * buffer (62 chars) will be added to the timeout time. In order to make
+ * use of the delayed response detection, set the <expects_data> flag.
  *
  * Parameters:
  * device - Mdrive device to communicate with
@@ -743,8 +1509,15 @@ mdrive_write_buffer(mdrive_device_t * device, const char * buffer, int length) {
  *     raw - (bool) omit the trailing \r or \n char
  *     tries - (short) attempt the transmission this number of times (rather
  *          than the default value of 1 + MAX_RETRIES)
+ *     priority - (enum mdrive_priority) class of the transmission, if not
+ *          the default for the kind of request (see mdrive_priority)
  * }
  *
+ * On party-mode ports, requests to different units can be in flight at the
+ * same time. See the [pipeline] member of the comm device. Commands sent
+ * globally, raw commands, and commands to units not in party mode (or at a
+ * different port speed) wait for the wire to be clear.
+ *
  * Returns:
  * (enum mdrive_response_class) classification of the response. See the
  * documentation of mdrive_classify_response for details.
@@ -753,9 +1526,15 @@ int
 mdrive_communicate(mdrive_device_t * device, const char * command,
         const struct mdrive_send_opts * options) {
 
-    int i, status=0, length, txid;
+    int i, status=0, length;
     char buffer[63];
-    mdrive_response_t * response = NULL;
+    mdrive_response_t * response = NULL, * frames[8];
+    mdrive_comm_device_t * comm = device->comm;
+    long long queued, extended = 0;
+    unsigned traffic = device->stats.txbytes + device->stats.rxbytes;
+    struct timespec began;
+
+    clock_gettime(CLOCK_REALTIME, &began);
 
     // Split the receive timeout in half. The first timeout will await the
     // first char from the device (ACK if in checksum mode), and the second
@@ -787,30 +1566,49 @@ mdrive_communicate(mdrive_device_t * device, const char * command,
         buffer[++length] = 0;
     }
 
-    // Use 55ms waittime if no waittime is specified in the options
     if (device->stats.latency == 0 || device->echo == EM_QUIET)
         // Start with a reasonable value (15ms)
         device->stats.latency = (int)15e6;
+
+    // Use the estimated timeout if no waittime is specified in the options.
+    // Units in quiet mode don't respond to most commands, and there is
+    // nothing to sample
+    mdrive_rtt_t * rtt = options->expect_data
+        ? &device->stats.rtt_data : &device->stats.rtt_short;
+    bool estimated = !options->waittime && device->echo != EM_QUIET;
     if (options->waittime)
         first_waittime = *options->waittime;
-    else
-        // Allow for a 40ms deviation in latency
-        first_waittime.tv_nsec = device->stats.latency + (int)40e6;
-
-    // The [txlock] is really more of a transaction lock, so it should be
-    // held the entire time communicating to the device or waiting or
-    // processing a response from the device. Ultimately, no other devices
-    // on this comm channel should be communicated with while the command is
-    // issued to this device
-    pthread_mutex_lock(&device->comm->txlock);
-
-    // If txnest == 0, flush the device queue since there are no other
-    // expected responses (?)
-    if (device->txnest == 0) {
-        pthread_mutex_lock(&device->comm->rxlock);
-        queue_flush(&device->comm->queue);
-        pthread_mutex_unlock(&device->comm->rxlock);
-    }
+    else if (!estimated || !rtt->rto)
+        first_waittime.tv_nsec = RTO_INITIAL_NSEC;
+
+    // The transaction is kept in the current stack frame for distinction
+    // against recursive calls to mdrive_communicate...(). Responses from the
+    // unit are placed in its [frames] by the receive thread, and are
+    // taken out in the order received. (The ring size must be a power of
+    // two.)
+    mdrive_transaction_t tx = {
+        .device = device,
+        .request = buffer,
+        .length = length,
+        .text_length = strlen(command) + (device->party_mode ? 1 : 0),
+        .expect_data = options->expect_data,
+        .priority = mdrive_priority(options),
+        .owner = pthread_self(),
+        .frames = { .size = sizeof frames / sizeof *frames, .slots = frames }
+    };
+
+    // Responses can only be told apart by their order when all the units
+    // in flight are addressed individually
+    bool exclusive = !device->party_mode || device->address == '*'
+        || options->raw || device->upgrade_mode;
+    pthread_cond_init(&tx.turn, NULL);
+
+    pthread_mutex_lock(&comm->rxlock);
+    while (mdrive_address_busy(comm, device->address))
+        pthread_cond_wait(&comm->has_data, &comm->rxlock);
+    tx.next = comm->transactions;
+    comm->transactions = &tx;
+    pthread_mutex_unlock(&comm->rxlock);
 
     // Detect send/receive recursions -- used by automatic error detection
     device->txnest++;
@@ -819,19 +1617,19 @@ mdrive_communicate(mdrive_device_t * device, const char * command,
     i = (options->tries) ? options->tries : 1 + MAX_RETRIES;
     while (i--) {
 
-        // Store in current stack frame for distinction against recursive
-        // calls to mdrive_communicate...(). txid is incremented for every
-        // transmit to incidate that any previously-received data is now
-        // invalid and does not belong to this transaction.
-        txid = ++device->comm->txid;
-
-        if (mdrive_write_buffer(device, buffer, length)) {
+        if (mdrive_transaction_send(device, &tx, exclusive)) {
             status = RESPONSE_IOERROR;
             goto finish;
         }
+        if (estimated && rtt->rto)
+            first_waittime.tv_nsec = rtt->rto;
 
-        clock_gettime(CLOCK_REALTIME, &now);
-        tsAdd(&now, &first_waittime, &timeout);
+        // A timeout of the previous try must not cut this one short
+        status = RESPONSE_OK;
+
+        // Time the response from the end of the transmission
+        tsAdd(&tx.sent, &first_waittime, &timeout);
+        extended = 0;
 
         // If device is not in checksum mode, add the more_waittime to the
         // timeout to since the unit will not send the early ACK of the
@@ -840,27 +1638,70 @@ mdrive_communicate(mdrive_device_t * device, const char * command,
             tsAdd(&timeout, &more_waittime, &timeout);
 
 wait_longer:
-        pthread_mutex_lock(&device->comm->rxlock);
-
-        while (!queue_length(&device->comm->queue)) {
-            if (ETIMEDOUT == pthread_cond_timedwait(&device->comm->has_data,
-                    &device->comm->rxlock, &timeout)) {
-
-                pthread_mutex_unlock(&device->comm->rxlock);
-                if ((device->echo == EM_QUIET || device->address == '*')
-                        && !options->expect_data) {
-                    // No response from unit. If the unit is EM=2
-                    // (EM_QUIET), this is likely just a command with no
-                    // response, which indicates success -- even if checksum
-                    // is enabled
-                    //
-                    // Globally addressed devices will usually not respond
-                    // to commands
+        pthread_mutex_lock(&comm->rxlock);
+
+        while (!queue_length(&tx.frames)) {
+            if (response && !tx.inflight) {
+                // Retired by the receive thread, which received the
+                // response to the next transaction in flight. Nothing more
+                // will be received for this one
+                pthread_mutex_unlock(&comm->rxlock);
+                status = RESPONSE_TIMEOUT;
+                goto process;
+            }
+            if (ETIMEDOUT == pthread_cond_timedwait(&comm->has_data,
+                    &comm->rxlock, &timeout)
+                    // The response might have been queued as the timer ran
+                    // out (before this thread was scheduled)
+                    && !queue_length(&tx.frames)) {
+
+                // Responses to the transactions ahead in line have to be
+                // received before the unit can be heard. Time the response
+                // from when this transaction was first in line. The ones
+                // ahead time out on their own
+                if (tx.inflight && !tx.first.tv_sec
+                        && mdrive_transaction_queued(comm, &tx)) {
+                    tsAdd(&timeout, &first_waittime, &timeout);
+                    continue;
+                }
+                queued = nsecDiff(&tx.first, &tx.sent);
+                if (tx.inflight && queued > extended) {
+                    tsAdd(&timeout, &(struct timespec) {
+                        .tv_sec = (queued - extended) / (long long)1e9,
+                        .tv_nsec = (queued - extended) % (long long)1e9
+                    }, &timeout);
+                    extended = queued;
+                    continue;
+                }
+
+                // No response from unit. If the unit is EM=2 (EM_QUIET),
+                // this is likely just a command with no response, which
+                // indicates success -- even if checksum is enabled
+                //
+                // Globally addressed devices will usually not respond to
+                // commands
+                bool silent = (device->echo == EM_QUIET
+                        || device->address == '*')
+                    && !options->expect_data;
+
+                if (!silent) {
+                    // Non-responsive unit. The response might just be late
+                    // -- have the line quiet for the (backed off) timeout
+                    // before the next transmission
+                    if (estimated)
+                        mdrive_rtt_backoff(rtt);
+                    comm->guard = estimated ? rtt->rto
+                        : first_waittime.tv_nsec;
+                }
+
+                // Data received from here on is not for this transaction
+                mdrive_transaction_retire(comm, &tx, true);
+                pthread_mutex_unlock(&comm->rxlock);
+                if (silent) {
                     status = RESPONSE_OK;
                     goto finish;
                 }
 
-                // Non-responsive unit
                 device->stats.timeouts++;
                 mcTraceF(30, MDRIVE_CHANNEL_RX, "Timed out: %d", device->echo);
                 // XXX: response if existing is not classified and status is
@@ -872,23 +1713,28 @@ wait_longer:
 
         // Combine previously-received response
         if (response) {
-            mdrive_response_t * response2 = queue_pop(&device->comm->queue);
+            mdrive_response_t * response2 = queue_pop(&tx.frames);
             mdrive_combine_response(response, response2);
-            free(response2);
+            mdrive_response_free(&comm->pool, response2);
         } else {
-            response = queue_pop(&device->comm->queue);
+            response = queue_pop(&tx.frames);
             // Record latency of the first response. Average over 32 xmits
             clock_gettime(CLOCK_REALTIME, &now);
+            histogram_record(&device->stats.rtt_histogram,
+                nsecDiff(&now, &tx.sent));
+            if (estimated && tx.sends == 1)
+                mdrive_rtt_sample(rtt, nsecDiff(&now,
+                    nsecDiff(&tx.first, &tx.sent) > 0 ? &tx.first : &tx.sent));
             device->stats.latency = 
                   ((31 * device->stats.latency) >> 5)
                 + ((
                        // Don't consider receive time in latency
-                       nsecDiff(&now, &device->comm->lasttx)
+                       nsecDiff(&now, &tx.sent)
                      - response->received * onechartime
                   ) >> 5);
         }
 
-        pthread_mutex_unlock(&device->comm->rxlock);
+        pthread_mutex_unlock(&comm->rxlock);
 
 process:
         if (!response)
@@ -906,14 +1752,27 @@ process:
                 response->length,
                 response->buffer);
 
-        if (response->txid != txid) {
+        if (response->txid != tx.txid) {
             // Response is not for the transaction expected
             mcTraceF(10, MDRIVE_CHANNEL, "Invalid TXID received: %d / %d",
-                txid, response->txid);
+                tx.txid, response->txid);
             goto resend;
         }
 
-        if (options->expect_data && !response->length && 
+        // Detect remote echo
+        if (mdrive_response_echo(&tx, response)) {
+            // Clear the buffer and set the echo flag. On [swift OSes], the
+            // response will be closed after the echo is received, but
+            // before the real data is received.
+            *response->buffer = 0;
+            response->length = 0;
+            response->echo = true;
+            if (status != RESPONSE_TIMEOUT) {
+                tsAdd(&timeout, &more_waittime, &timeout);
+                goto wait_longer;
+            }
+        }
+        else if (options->expect_data && !response->length && 
                 (response->ack | response->nack | response->crlf)) {
             // A response was expected but not received -- wait longer. Add
             // the additional wait time to the timeout and wait longer.
@@ -927,24 +1786,13 @@ process:
                 goto wait_longer;
             }
         }
-        // Detect remote echo
-        else if (options->expect_data && device->echo == EM_ON
-                && response->length) {
-            // In echo mode, then unit will send the request back in the
-            // response. On [swift OSes], the response will be closed after
-            // the echo is received, but before the real data is received.
-            // Be careful not to consider the \r, \n, >, ? or checksum
-            // chars, as none of them will exist in the response buffer
-            if (strncmp(response->buffer, buffer, response->length) == 0) {
-                // Clear the buffer and set the echo flag
-                *response->buffer = 0;
-                response->length = 0;
-                response->echo = true;
-                tsAdd(&timeout, &more_waittime, &timeout);
-                goto wait_longer;
-            }
-        }
-            
+
+        // Nothing more is awaited from the unit. Free up the wire before
+        // classifying, which might talk to the unit again
+        pthread_mutex_lock(&comm->rxlock);
+        mdrive_transaction_retire(comm, &tx, false);
+        pthread_mutex_unlock(&comm->rxlock);
+
         if (response->ack) device->stats.acks++;
         if (response->nack) device->stats.nacks++;
 
@@ -977,7 +1825,7 @@ resend:
             device->stats.rx++;
             device->stats.rxbytes += response->received;
 
-            free(response);
+            mdrive_response_free(&comm->pool, response);
             response = NULL;
         }
         device->stats.resends++;
@@ -991,7 +1839,7 @@ finish:
         // Copy out response to the caller
         if (options->result)
             *options->result = *response;
-        free(response);
+        mdrive_response_free(&comm->pool, response);
     }
     else if (i == 0) {
         // Motor refused to ACK the command (no response)
@@ -1001,7 +1849,32 @@ finish:
 
     device->txnest--;
 
-    pthread_mutex_unlock(&device->comm->txlock);
+    // Account the traffic of the exchange (with the nested ones) to the
+    // wire profile in effect
+    if (device->txnest == 0 && device->wire_profile < MDRIVE_WIRE_PROFILES) {
+        struct mdrive_wire_stats * wire =
+            &device->stats.wire[device->wire_profile];
+        clock_gettime(CLOCK_REALTIME, &now);
+        wire->transactions++;
+        wire->bytes += device->stats.txbytes + device->stats.rxbytes - traffic;
+        wire->time += nsecDiff(&now, &began);
+    }
+
+    // Drop the transaction. Frames received after the response was
+    // classified are of no interest
+    pthread_mutex_lock(&comm->rxlock);
+    mdrive_transaction_retire(comm, &tx, false);
+    mdrive_transaction_t ** ptx;
+    for (ptx = &comm->transactions; *ptx; ptx = &(*ptx)->next) {
+        if (*ptx == &tx) {
+            *ptx = tx.next;
+            break;
+        }
+    }
+    queue_flush(&tx.frames, &comm->pool);
+    pthread_cond_broadcast(&comm->has_data);
+    pthread_mutex_unlock(&comm->rxlock);
+    pthread_cond_destroy(&tx.turn);
 
     mcTraceF(50, MDRIVE_CHANNEL_RX, "Status is %d", status);
     return status;
@@ -1015,6 +1888,258 @@ int mdrive_send(mdrive_device_t * device, const char * command) {
     return mdrive_communicate(device, command, &opts);
 }
 
+/**
+ * mdrive_stream
+ *
+ * Sends a series of raw lines to the unit, keeping up to [window] of them
+ * in flight, for units which acknowledge each line in turn without
+ * returning data -- such as the bootloader of a unit in upgrade mode. The
+ * port is reserved for the stream, so the lines go out back to back.
+ *
+ * The stream starts with one line in flight, and the window grows by one
+ * line after a window of lines is acknowledged in a row. If a line is
+ * NACKed, or not acknowledged in time, the lines sent after it are given
+ * up on, and are resent from the line on, one at a time again (go-back-N).
+ * Since the acknowledgements carry no reference to the line, they are
+ * matched to the lines by their order, as responses are on a pipelined
+ * port. The timeout is estimated from the round trips of the stream
+ * itself, which include the time the unit takes to process a line.
+ *
+ * The [progress] routine of the stream, if any, is called after each line
+ * acknowledged.
+ *
+ * Returns:
+ * (int) 0 upon success, EIO if a line could not be sent or was not
+ * acknowledged in [tries] attempts, EINVAL if not connected
+ */
+int
+mdrive_stream(mdrive_device_t * device, struct mdrive_stream * stream) {
+    mdrive_comm_device_t * comm = device->comm;
+    mdrive_transaction_t txs[MDRIVE_MAX_PIPELINE], * tx;
+    mdrive_response_t * frames[MDRIVE_MAX_PIPELINE][4], * response;
+    mdrive_rtt_t rtt = { .rto = RTO_INITIAL_NSEC };
+    struct timespec timeout, now, * since;
+    int i, status = 0, sent = 0, window = 1, clean = 0, tries, limit;
+
+    if (comm == NULL)
+        return EINVAL;
+
+    limit = stream->window;
+    if (limit < 1)
+        limit = 1;
+    else if (limit > MDRIVE_MAX_PIPELINE)
+        limit = MDRIVE_MAX_PIPELINE;
+
+    // A transaction for each line in flight, reused round-robin
+    for (i = 0; i < limit; i++) {
+        txs[i] = (mdrive_transaction_t) {
+            .device = device,
+            .priority = MDRIVE_PRIORITY_BULK,
+            .window = limit,
+            .owner = pthread_self(),
+            .frames = { .size = sizeof frames[i] / sizeof *frames[i],
+                .slots = frames[i] }
+        };
+        pthread_cond_init(&txs[i].turn, NULL);
+    }
+
+    mdrive_port_reserve(comm);
+    pthread_mutex_lock(&comm->rxlock);
+    while (mdrive_address_busy(comm, device->address))
+        pthread_cond_wait(&comm->has_data, &comm->rxlock);
+    for (i = 0; i < limit; i++) {
+        txs[i].next = comm->transactions;
+        comm->transactions = &txs[i];
+    }
+    pthread_mutex_unlock(&comm->rxlock);
+
+    device->txnest++;
+    stream->acked = stream->resent = 0;
+    tries = (stream->tries) ? stream->tries : 1 + MAX_RETRIES;
+
+    while (stream->acked < stream->count) {
+        // Fill the window
+        while (sent < stream->count && sent - stream->acked < window) {
+            tx = &txs[sent % limit];
+            tx->request = stream->lines[sent];
+            tx->length = tx->text_length = strlen(tx->request);
+            tx->sends = 0;
+            if (mdrive_transaction_send(device, tx, false)) {
+                status = EIO;
+                goto finish;
+            }
+            sent++;
+        }
+
+        // Await the acknowledgement of the oldest line, timed from when it
+        // was first in line
+        tx = &txs[stream->acked % limit];
+        pthread_mutex_lock(&comm->rxlock);
+        since = (nsecDiff(&tx->first, &tx->sent) > 0) ? &tx->first : &tx->sent;
+        tsAdd(since, &(struct timespec) { .tv_nsec = rtt.rto }, &timeout);
+        while (!queue_length(&tx->frames)) {
+            if (ETIMEDOUT == pthread_cond_timedwait(&comm->has_data,
+                    &comm->rxlock, &timeout) && !queue_length(&tx->frames))
+                break;
+            since = (nsecDiff(&tx->first, &tx->sent) > 0)
+                ? &tx->first : &tx->sent;
+            tsAdd(since, &(struct timespec) { .tv_nsec = rtt.rto }, &timeout);
+        }
+        response = queue_pop(&tx->frames);
+        pthread_mutex_unlock(&comm->rxlock);
+
+        if (response) {
+            device->stats.rx++;
+            device->stats.rxbytes += response->received;
+        }
+
+        if (response && response->ack) {
+            device->stats.acks++;
+            clock_gettime(CLOCK_REALTIME, &now);
+            if (tx->sends == 1)
+                mdrive_rtt_sample(&rtt, nsecDiff(&now, since));
+            mdrive_response_free(&comm->pool, response);
+
+            stream->acked++;
+            tries = (stream->tries) ? stream->tries : 1 + MAX_RETRIES;
+            if (window < limit && ++clean >= window) {
+                window++;
+                clean = 0;
+            }
+            if (stream->progress)
+                stream->progress(stream, stream->arg);
+            continue;
+        }
+
+        // The line was NACKed or not acknowledged: give up on the ones
+        // sent after it too, and send them again one at a time
+        if (response) {
+            device->stats.nacks++;
+            mdrive_response_free(&comm->pool, response);
+        }
+        else {
+            device->stats.timeouts++;
+            mdrive_rtt_backoff(&rtt);
+        }
+        mcTraceF(30, MDRIVE_CHANNEL_TX, "Stream %s at line %d, resending %d",
+            response ? "NACKed" : "timed out", stream->acked,
+            sent - stream->acked);
+
+        pthread_mutex_lock(&comm->rxlock);
+        for (i = 0; i < limit; i++) {
+            mdrive_transaction_retire(comm, &txs[i], true);
+            queue_flush(&txs[i].frames, &comm->pool);
+        }
+        comm->guard = rtt.rto;
+        pthread_mutex_unlock(&comm->rxlock);
+
+        device->stats.resends += sent - stream->acked;
+        stream->resent += sent - stream->acked;
+        sent = stream->acked;
+        window = 1;
+        clean = 0;
+        if (--tries == 0) {
+            status = EIO;
+            break;
+        }
+    }
+
+finish:
+    device->txnest--;
+
+    pthread_mutex_lock(&comm->rxlock);
+    for (i = 0; i < limit; i++) {
+        mdrive_transaction_retire(comm, &txs[i], false);
+        queue_flush(&txs[i].frames, &comm->pool);
+    }
+    mdrive_transaction_t ** ptx = &comm->transactions;
+    while (*ptx) {
+        if (*ptx >= txs && *ptx < txs + limit)
+            *ptx = (*ptx)->next;
+        else
+            ptx = &(*ptx)->next;
+    }
+    pthread_cond_broadcast(&comm->has_data);
+    pthread_mutex_unlock(&comm->rxlock);
+    mdrive_port_release(comm);
+
+    for (i = 0; i < limit; i++)
+        pthread_cond_destroy(&txs[i].turn);
+
+    return status;
+}
+
+/**
+ * mdrive_axis_index
+ *
+ * Files [device] in the address table of its port, or takes it out if
+ * [remove]. Another axis at the same address (on a port not in party mode,
+ * all are at '!') takes over its place when it is taken out. The comm
+ * device's rxlock must be held.
+ */
+static void
+mdrive_axis_index(mdrive_device_t * device, bool remove) {
+    mdrive_comm_device_t * comm = device->comm;
+    mdrive_device_t ** slot, * axis;
+
+    slot = &comm->by_address[(unsigned char) device->address];
+
+    if (!remove) {
+        *slot = device;
+        return;
+    }
+    else if (*slot != device)
+        return;
+
+    *slot = NULL;
+    for (axis = comm->axes; axis; axis = axis->next_axis) {
+        if (axis != device && axis->address == device->address) {
+            *slot = axis;
+            break;
+        }
+    }
+}
+
+/**
+ * mdrive_set_address
+ *
+ * Changes the address the driver uses for the unit, and the address it is
+ * filed under for event delivery.
+ */
+void
+mdrive_set_address(mdrive_device_t * device, char address) {
+    mdrive_comm_device_t * comm = device->comm;
+
+    if (comm == NULL) {
+        device->address = address;
+        return;
+    }
+
+    pthread_mutex_lock(&comm->rxlock);
+    mdrive_axis_index(device, true);
+    device->address = address;
+    mdrive_axis_index(device, false);
+    pthread_mutex_unlock(&comm->rxlock);
+}
+
+/**
+ * mdrive_axis_at
+ *
+ * Returns:
+ * (mdrive_device_t *) axis connected through the port at [address], NULL
+ * if none
+ */
+mdrive_device_t *
+mdrive_axis_at(mdrive_comm_device_t * comm, char address) {
+    mdrive_device_t * device;
+
+    pthread_mutex_lock(&comm->rxlock);
+    device = comm->by_address[(unsigned char) address];
+    pthread_mutex_unlock(&comm->rxlock);
+
+    return device;
+}
+
 int
 mdrive_connect(mdrive_address_t * address, mdrive_device_t * device) {
     // Transfer the motor's address ('a' for instance)
@@ -1036,7 +2161,12 @@ mdrive_connect(mdrive_address_t * address, mdrive_device_t * device) {
                 sizeof(current_port->name)) == 0) {
             // This device is already initialized. Just link it to the device
             device->comm = current_port;
+            pthread_mutex_lock(&current_port->rxlock);
             current_port->active_axes++;
+            device->next_axis = current_port->axes;
+            current_port->axes = device;
+            mdrive_axis_index(device, false);
+            pthread_mutex_unlock(&current_port->rxlock);
             return 0;
         }
         tail = current_port;
@@ -1062,18 +2192,19 @@ mdrive_connect(mdrive_address_t * address, mdrive_device_t * device) {
     if (new_port->fd < 0)
         return new_port->fd;
     device->comm = new_port;
+    new_port->axes = device;
+    mdrive_axis_index(device, false);
 
     pthread_mutex_init(&new_port->rxlock, NULL);
     pthread_cond_init(&new_port->has_data, NULL);
+    pthread_cond_init(&new_port->poll_wake, NULL);
+    sem_init(&new_port->io_wake, 0, 0);
 
-    // Allow reentry on the txlock
-    pthread_mutexattr_t attrs;
-    pthread_mutexattr_init(&attrs);
-    pthread_mutexattr_settype(&attrs, PTHREAD_MUTEX_RECURSIVE);
-    pthread_mutex_init(&new_port->txlock, &attrs);
-
-    // Setup the device RX queue (well, stack really)
-    mdrive_response_queue_init(&new_port->queue);
+    // Requests are sent one at a time unless configured otherwise, and
+    // the driver waits for each of them to leave the port
+    new_port->pipeline = 1;
+    new_port->drain = true;
+    mdrive_response_pool_init(&new_port->pool);
 
     // Start async receive on the device
     pthread_attr_t attr;
@@ -1097,23 +2228,39 @@ mdrive_disconnect(mdrive_device_t * device) {
     if (!channel)
         return;
 
+    mdrive_device_t ** axis;
+    pthread_mutex_lock(&channel->rxlock);
+    for (axis = &channel->axes; *axis; axis = &(*axis)->next_axis) {
+        if (*axis == device) {
+            *axis = device->next_axis;
+            break;
+        }
+    }
+    mdrive_axis_index(device, true);
+    // The poller might be using it
+    while (channel->polling == device)
+        pthread_cond_wait(&channel->has_data, &channel->rxlock);
+
     // Decrement active_axes counter for this device and cleanup the device
     // itself if there are no more active motors on this device
-    if (--channel->active_axes != 0)
+    int remaining = --channel->active_axes;
+    pthread_mutex_unlock(&channel->rxlock);
+    if (remaining != 0)
         return;
 
+    mdrive_poller_stop(channel);
+    mdrive_io_stop(channel);
     pthread_cancel(channel->read_thread);
+    mdrive_capture_stop(channel);
 
     pthread_mutex_destroy(&channel->rxlock);
-    pthread_mutex_destroy(&channel->txlock);
     pthread_cond_destroy(&channel->has_data);
+    pthread_cond_destroy(&channel->poll_wake);
+    sem_destroy(&channel->io_wake);
 
     // tcsetattr(fd, TCSAFLUSH, &device->termios);
     close(channel->fd);
 
-    // Free items retrieved from the queue
-    queue_flush(&channel->queue);
-
     // Drop device from the list of port infos
     if (channel == all_port_infos) {
         // device is the head of the all_port_infos list, so advance
@@ -1157,6 +2304,11 @@ mdrive_initialize_port(const char * port, int speed, bool async) {
     tty.c_oflag &= ~OPOST;                          // Raw output processing
     tty.c_lflag &= ~(ICANON | ECHO | ECHOE | ISIG); // Raw input processing
 
+    // Return from read() as soon as a char is available. Detection of the
+    // end of a response is done in mdrive_async_read()
+    tty.c_cc[VMIN] = 1;
+    tty.c_cc[VTIME] = 0;
+
     tcflush(fd, TCIFLUSH);
     if (tcsetattr(fd, TCSAFLUSH, &tty)) {
         mcTraceF(1, MDRIVE_CHANNEL, "Unable to configure tty: %d", errno);
@@ -19,18 +19,45 @@ struct mdrive_send_opts {
                                         // for retrieving the current error)
     bool                raw;            // Don't send EOL char
     unsigned short      tries;          // Number of tries (other than def)
+    enum mdrive_priority priority;      // Class (other than by kind)
 };
 
 extern int
 mdrive_communicate(mdrive_device_t *, const char *,
     const struct mdrive_send_opts *);
 
+extern int
+mdrive_priority(const struct mdrive_send_opts *);
+
+// A series of lines sent with mdrive_stream
+struct mdrive_stream {
+    const char * const * lines;         // Raw lines (with EOL)
+    int                 count;
+    int                 window;         // Max lines in flight
+    unsigned short      tries;          // Per line (other than def)
+    void (*progress)(struct mdrive_stream *, void *);
+    void *              arg;            // For the progress routine
+
+    // Filled in by the driver
+    int                 acked;          // Lines acknowledged so far
+    int                 resent;         // Lines sent again
+};
+
+extern int
+mdrive_stream(mdrive_device_t *, struct mdrive_stream *);
+
 extern int
 mdrive_connect(mdrive_address_t *, mdrive_device_t *);
 
 extern void
 mdrive_disconnect(mdrive_device_t *);
 
+extern void
+mdrive_set_address(mdrive_device_t *, char);
+
+extern mdrive_device_t *
+mdrive_axis_at(mdrive_comm_device_t *, char);
+
 extern int
 mdrive_initialize_port(const char * port, int speed, bool async);
 
@@ -47,14 +74,37 @@ mdrive_get_integer(mdrive_device_t * device, const char * variable, int * value)
 extern int
 mdrive_get_integers(mdrive_device_t * device, const char *[], int *[], int count);
 
+extern void
+mdrive_integers_command(char *, size_t, const char *[], int count);
+
+extern int
+mdrive_parse_integers(mdrive_response_t *, int *[], int count);
+
 extern int
 mdrive_set_baudrate(mdrive_comm_device_t * comm, int speed);
 
+extern void
+mdrive_port_reserve(mdrive_comm_device_t * comm);
+
+extern void
+mdrive_port_release(mdrive_comm_device_t * comm);
+
 extern char
 mdrive_calc_checksum(const char * buffer, int length);
 
+extern int
+mdrive_process_response(char * buffer, mdrive_response_t * response,
+    int length);
+
+extern int
+mdrive_process_response_reference(char * buffer, mdrive_response_t * response,
+    int length);
+
 extern int
 mdrive_xmit_time(mdrive_comm_device_t * comm, int chars);
 
+extern int
+mdrive_frame_idle_time(mdrive_comm_device_t * comm);
+
 extern void
 mdrive_clear_error(mdrive_device_t *);
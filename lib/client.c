@@ -0,0 +1,2763 @@
+
+/**
+ ** Automatically generated file -- do not modify directly
+ **
+ ** This file is generated by client.c.py which will compile the list of
+ ** exported proxy functions from the given header files.
+ **
+ **/
+
+#include <errno.h>
+#include <stdbool.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "../drivers/driver.h"
+#include "../motor.h"
+#include "message.h"
+#include "dispatch.h"
+#include "client.h"
+
+// Default timeout for send/receive is defined here. The time should
+// consider the send, remote process, remote send, and receive times
+// together.
+static struct timespec timeout = { .tv_nsec = 250e6 }; // 250ms
+
+void
+mcClientTimeoutSet(const struct timespec * new_timeout,
+        struct timespec * old_timeout) {
+    if (old_timeout != NULL)
+        *old_timeout = timeout;
+    timeout = *new_timeout;
+}
+
+static enum mcCallMode call_mode = MC_CALL_CROSS_PROCESS;
+
+void
+mcClientCallModeSet(enum mcCallMode mode) {
+    call_mode = mode;
+}
+
+enum mcCallMode
+mcClientCallModeGet(void) {
+    return call_mode;
+}
+
+#include "query.h"
+#include "locks.h"
+#include "motor.h"
+#include "motion.h"
+#include "events.h"
+#include "profile.h"
+#include "trace.h"
+#include "firmware.h"
+
+int mcConnectOutOfProc( String * connection, OUT MOTOR motor_t * motor,
+    bool recovery) {
+    if (connection == NULL) return -EINVAL;
+    if (motor == NULL) return -EINVAL;
+    struct _mcConnect_args args = {
+        .outofproc = true,
+        .connection = *connection,
+        .motor = *motor,
+        .recovery = recovery
+    };
+    response_message_t response;
+    struct timespec * waittime = NULL;
+    int size = mcMessageSendWait(motor, TYPE_mcConnect, &args,
+        sizeof args, PRIORITY_CMD, &response, waittime);
+
+    switch (size) {
+        case -ENOENT:
+        case -EAGAIN:
+            return -ER_NO_DAEMON;
+        case -ETIMEDOUT:
+            return -ER_DAEMON_BUSY;
+    }
+
+    struct _mcConnect_args * payload = (struct _mcConnect_args *)(char *) response.payload;
+
+    memcpy(motor, &payload->motor, sizeof(MOTOR motor_t));
+    return payload->returned;
+}
+
+int mcConnectInProc( String * connection, OUT MOTOR motor_t * motor,
+    bool recovery) {
+    request_message_t message = {
+        .id = 0,
+        .pid = getpid(),
+        .motor_id = motor,
+    };
+    struct _mcConnect_args args = {
+        .inproc = true,
+        .connection = *connection,
+        .motor = *motor,
+        .recovery = recovery
+    };
+    memcpy(message.payload, &args, sizeof(args));
+    mcConnectImpl(&message);
+    struct _mcConnect_args * payload = (struct _mcConnect_args *)(char *) message.payload;
+    memcpy(motor, &payload->motor, sizeof(MOTOR motor_t));
+    return payload->returned;
+}
+
+int mcConnect( String * connection, OUT MOTOR motor_t * motor,
+    bool recovery) {
+    if (call_mode == MC_CALL_CROSS_PROCESS)
+        return mcConnectOutOfProc(connection,motor,recovery);
+    else
+        return mcConnectInProc(connection,motor,recovery);
+}
+
+
+int mcDisconnectOutOfProc(motor_t motor) {
+    
+    struct _mcDisconnect_args args = {
+        .outofproc = true,
+        
+    };
+    response_message_t response;
+    struct timespec * waittime = &timeout;
+    int size = mcMessageSendWait(motor, TYPE_mcDisconnect, &args,
+        sizeof args, PRIORITY_CMD, &response, waittime);
+
+    switch (size) {
+        case -ENOENT:
+        case -EAGAIN:
+            return -ER_NO_DAEMON;
+        case -ETIMEDOUT:
+            return -ER_DAEMON_BUSY;
+    }
+
+    struct _mcDisconnect_args * payload = (struct _mcDisconnect_args *)(char *) response.payload;
+
+    
+    return payload->returned;
+}
+
+int mcDisconnectInProc(motor_t motor) {
+    request_message_t message = {
+        .id = 0,
+        .pid = getpid(),
+        .motor_id = motor,
+    };
+    struct _mcDisconnect_args args = {
+        .inproc = true,
+        
+    };
+    memcpy(message.payload, &args, sizeof(args));
+    mcDisconnectImpl(&message);
+    struct _mcDisconnect_args * payload = (struct _mcDisconnect_args *)(char *) message.payload;
+    
+    return payload->returned;
+}
+
+int mcDisconnect(motor_t motor) {
+    if (call_mode == MC_CALL_CROSS_PROCESS)
+        return mcDisconnectOutOfProc(motor);
+    else
+        return mcDisconnectInProc(motor);
+}
+
+
+int mcEStopOutOfProc(motor_t motor) {
+    
+    struct _mcEStop_args args = {
+        .outofproc = true,
+        
+    };
+    response_message_t response;
+    struct timespec * waittime = &timeout;
+    int size = mcMessageSendWait(motor, TYPE_mcEStop, &args,
+        sizeof args, PRIORITY_HIGH, &response, waittime);
+
+    switch (size) {
+        case -ENOENT:
+        case -EAGAIN:
+            return -ER_NO_DAEMON;
+        case -ETIMEDOUT:
+            return -ER_DAEMON_BUSY;
+    }
+
+    struct _mcEStop_args * payload = (struct _mcEStop_args *)(char *) response.payload;
+
+    
+    return payload->returned;
+}
+
+int mcEStopInProc(motor_t motor) {
+    request_message_t message = {
+        .id = 0,
+        .pid = getpid(),
+        .motor_id = motor,
+    };
+    struct _mcEStop_args args = {
+        .inproc = true,
+        
+    };
+    memcpy(message.payload, &args, sizeof(args));
+    mcEStopImpl(&message);
+    struct _mcEStop_args * payload = (struct _mcEStop_args *)(char *) message.payload;
+    
+    return payload->returned;
+}
+
+int mcEStop(motor_t motor) {
+    if (call_mode == MC_CALL_CROSS_PROCESS)
+        return mcEStopOutOfProc(motor);
+    else
+        return mcEStopInProc(motor);
+}
+
+
+int mcEventRegisterOutOfProc(motor_t motor, int event) {
+    
+    struct _mcEventRegister_args args = {
+        .outofproc = true,
+        .event = event
+    };
+    response_message_t response;
+    struct timespec * waittime = &timeout;
+    int size = mcMessageSendWait(motor, TYPE_mcEventRegister, &args,
+        sizeof args, PRIORITY_CMD, &response, waittime);
+
+    switch (size) {
+        case -ENOENT:
+        case -EAGAIN:
+            return -ER_NO_DAEMON;
+        case -ETIMEDOUT:
+            return -ER_DAEMON_BUSY;
+    }
+
+    struct _mcEventRegister_args * payload = (struct _mcEventRegister_args *)(char *) response.payload;
+
+    
+    return payload->returned;
+}
+
+int mcEventRegisterInProc(motor_t motor, int event) {
+    request_message_t message = {
+        .id = 0,
+        .pid = getpid(),
+        .motor_id = motor,
+    };
+    struct _mcEventRegister_args args = {
+        .inproc = true,
+        .event = event
+    };
+    memcpy(message.payload, &args, sizeof(args));
+    mcEventRegisterImpl(&message);
+    struct _mcEventRegister_args * payload = (struct _mcEventRegister_args *)(char *) message.payload;
+    
+    return payload->returned;
+}
+
+int mcEventRegister(motor_t motor, int event) {
+    if (call_mode == MC_CALL_CROSS_PROCESS)
+        return mcEventRegisterOutOfProc(motor,event);
+    else
+        return mcEventRegisterInProc(motor,event);
+}
+
+
+int mcEventUnregisterOutOfProc(motor_t motor, int event) {
+    
+    struct _mcEventUnregister_args args = {
+        .outofproc = true,
+        .event = event
+    };
+    response_message_t response;
+    struct timespec * waittime = &timeout;
+    int size = mcMessageSendWait(motor, TYPE_mcEventUnregister, &args,
+        sizeof args, PRIORITY_CMD, &response, waittime);
+
+    switch (size) {
+        case -ENOENT:
+        case -EAGAIN:
+            return -ER_NO_DAEMON;
+        case -ETIMEDOUT:
+            return -ER_DAEMON_BUSY;
+    }
+
+    struct _mcEventUnregister_args * payload = (struct _mcEventUnregister_args *)(char *) response.payload;
+
+    
+    return payload->returned;
+}
+
+int mcEventUnregisterInProc(motor_t motor, int event) {
+    request_message_t message = {
+        .id = 0,
+        .pid = getpid(),
+        .motor_id = motor,
+    };
+    struct _mcEventUnregister_args args = {
+        .inproc = true,
+        .event = event
+    };
+    memcpy(message.payload, &args, sizeof(args));
+    mcEventUnregisterImpl(&message);
+    struct _mcEventUnregister_args * payload = (struct _mcEventUnregister_args *)(char *) message.payload;
+    
+    return payload->returned;
+}
+
+int mcEventUnregister(motor_t motor, int event) {
+    if (call_mode == MC_CALL_CROSS_PROCESS)
+        return mcEventUnregisterOutOfProc(motor,event);
+    else
+        return mcEventUnregisterInProc(motor,event);
+}
+
+
+int mcFirmwareLoadOutOfProc(motor_t motor, String * filename) {
+    if (filename == NULL) return -EINVAL;
+    struct _mcFirmwareLoad_args args = {
+        .outofproc = true,
+        .filename = *filename
+    };
+    response_message_t response;
+    struct timespec * waittime = NULL;
+    int size = mcMessageSendWait(motor, TYPE_mcFirmwareLoad, &args,
+        sizeof args, PRIORITY_CMD, &response, waittime);
+
+    switch (size) {
+        case -ENOENT:
+        case -EAGAIN:
+            return -ER_NO_DAEMON;
+        case -ETIMEDOUT:
+            return -ER_DAEMON_BUSY;
+    }
+
+    struct _mcFirmwareLoad_args * payload = (struct _mcFirmwareLoad_args *)(char *) response.payload;
+
+    
+    return payload->returned;
+}
+
+int mcFirmwareLoadInProc(motor_t motor, String * filename) {
+    request_message_t message = {
+        .id = 0,
+        .pid = getpid(),
+        .motor_id = motor,
+    };
+    struct _mcFirmwareLoad_args args = {
+        .inproc = true,
+        .filename = *filename
+    };
+    memcpy(message.payload, &args, sizeof(args));
+    mcFirmwareLoadImpl(&message);
+    struct _mcFirmwareLoad_args * payload = (struct _mcFirmwareLoad_args *)(char *) message.payload;
+    
+    return payload->returned;
+}
+
+int mcFirmwareLoad(motor_t motor, String * filename) {
+    if (call_mode == MC_CALL_CROSS_PROCESS)
+        return mcFirmwareLoadOutOfProc(motor,filename);
+    else
+        return mcFirmwareLoadInProc(motor,filename);
+}
+
+
+int mcHaltOutOfProc(motor_t motor) {
+    
+    struct _mcHalt_args args = {
+        .outofproc = true,
+        
+    };
+    response_message_t response;
+    struct timespec * waittime = &timeout;
+    int size = mcMessageSendWait(motor, TYPE_mcHalt, &args,
+        sizeof args, PRIORITY_HIGH, &response, waittime);
+
+    switch (size) {
+        case -ENOENT:
+        case -EAGAIN:
+            return -ER_NO_DAEMON;
+        case -ETIMEDOUT:
+            return -ER_DAEMON_BUSY;
+    }
+
+    struct _mcHalt_args * payload = (struct _mcHalt_args *)(char *) response.payload;
+
+    
+    return payload->returned;
+}
+
+int mcHaltInProc(motor_t motor) {
+    request_message_t message = {
+        .id = 0,
+        .pid = getpid(),
+        .motor_id = motor,
+    };
+    struct _mcHalt_args args = {
+        .inproc = true,
+        
+    };
+    memcpy(message.payload, &args, sizeof(args));
+    mcHaltImpl(&message);
+    struct _mcHalt_args * payload = (struct _mcHalt_args *)(char *) message.payload;
+    
+    return payload->returned;
+}
+
+int mcHalt(motor_t motor) {
+    if (call_mode == MC_CALL_CROSS_PROCESS)
+        return mcHaltOutOfProc(motor);
+    else
+        return mcHaltInProc(motor);
+}
+
+
+int mcHomeOutOfProc(motor_t motor, enum home_type type, enum home_direction direction) {
+    
+    struct _mcHome_args args = {
+        .outofproc = true,
+        .type = type,
+        .direction = direction
+    };
+    response_message_t response;
+    struct timespec * waittime = &timeout;
+    int size = mcMessageSendWait(motor, TYPE_mcHome, &args,
+        sizeof args, PRIORITY_CMD, &response, waittime);
+
+    switch (size) {
+        case -ENOENT:
+        case -EAGAIN:
+            return -ER_NO_DAEMON;
+        case -ETIMEDOUT:
+            return -ER_DAEMON_BUSY;
+    }
+
+    struct _mcHome_args * payload = (struct _mcHome_args *)(char *) response.payload;
+
+    
+    return payload->returned;
+}
+
+int mcHomeInProc(motor_t motor, enum home_type type, enum home_direction direction) {
+    request_message_t message = {
+        .id = 0,
+        .pid = getpid(),
+        .motor_id = motor,
+    };
+    struct _mcHome_args args = {
+        .inproc = true,
+        .type = type,
+        .direction = direction
+    };
+    memcpy(message.payload, &args, sizeof(args));
+    mcHomeImpl(&message);
+    struct _mcHome_args * payload = (struct _mcHome_args *)(char *) message.payload;
+    
+    return payload->returned;
+}
+
+int mcHome(motor_t motor, enum home_type type, enum home_direction direction) {
+    if (call_mode == MC_CALL_CROSS_PROCESS)
+        return mcHomeOutOfProc(motor,type,direction);
+    else
+        return mcHomeInProc(motor,type,direction);
+}
+
+
+int mcMicrocodeLoadOutOfProc(motor_t motor, String * filename) {
+    if (filename == NULL) return -EINVAL;
+    struct _mcMicrocodeLoad_args args = {
+        .outofproc = true,
+        .filename = *filename
+    };
+    response_message_t response;
+    struct timespec * waittime = NULL;
+    int size = mcMessageSendWait(motor, TYPE_mcMicrocodeLoad, &args,
+        sizeof args, PRIORITY_CMD, &response, waittime);
+
+    switch (size) {
+        case -ENOENT:
+        case -EAGAIN:
+            return -ER_NO_DAEMON;
+        case -ETIMEDOUT:
+            return -ER_DAEMON_BUSY;
+    }
+
+    struct _mcMicrocodeLoad_args * payload = (struct _mcMicrocodeLoad_args *)(char *) response.payload;
+
+    
+    return payload->returned;
+}
+
+int mcMicrocodeLoadInProc(motor_t motor, String * filename) {
+    request_message_t message = {
+        .id = 0,
+        .pid = getpid(),
+        .motor_id = motor,
+    };
+    struct _mcMicrocodeLoad_args args = {
+        .inproc = true,
+        .filename = *filename
+    };
+    memcpy(message.payload, &args, sizeof(args));
+    mcMicrocodeLoadImpl(&message);
+    struct _mcMicrocodeLoad_args * payload = (struct _mcMicrocodeLoad_args *)(char *) message.payload;
+    
+    return payload->returned;
+}
+
+int mcMicrocodeLoad(motor_t motor, String * filename) {
+    if (call_mode == MC_CALL_CROSS_PROCESS)
+        return mcMicrocodeLoadOutOfProc(motor,filename);
+    else
+        return mcMicrocodeLoadInProc(motor,filename);
+}
+
+
+bool mcMotorIsLockedOutOfProc(motor_t motor) {
+    
+    struct _mcMotorIsLocked_args args = {
+        .outofproc = true,
+        
+    };
+    response_message_t response;
+    struct timespec * waittime = &timeout;
+    int size = mcMessageSendWait(motor, TYPE_mcMotorIsLocked, &args,
+        sizeof args, PRIORITY_CMD, &response, waittime);
+
+    switch (size) {
+        case -ENOENT:
+        case -EAGAIN:
+            return -ER_NO_DAEMON;
+        case -ETIMEDOUT:
+            return -ER_DAEMON_BUSY;
+    }
+
+    struct _mcMotorIsLocked_args * payload = (struct _mcMotorIsLocked_args *)(char *) response.payload;
+
+    
+    return payload->returned;
+}
+
+bool mcMotorIsLockedInProc(motor_t motor) {
+    request_message_t message = {
+        .id = 0,
+        .pid = getpid(),
+        .motor_id = motor,
+    };
+    struct _mcMotorIsLocked_args args = {
+        .inproc = true,
+        
+    };
+    memcpy(message.payload, &args, sizeof(args));
+    mcMotorIsLockedImpl(&message);
+    struct _mcMotorIsLocked_args * payload = (struct _mcMotorIsLocked_args *)(char *) message.payload;
+    
+    return payload->returned;
+}
+
+bool mcMotorIsLocked(motor_t motor) {
+    if (call_mode == MC_CALL_CROSS_PROCESS)
+        return mcMotorIsLockedOutOfProc(motor);
+    else
+        return mcMotorIsLockedInProc(motor);
+}
+
+
+int mcMotorLockOutOfProc(motor_t motor, int for_motor_id, lock_mode_t mode) {
+    
+    struct _mcMotorLock_args args = {
+        .outofproc = true,
+        .for_motor_id = for_motor_id,
+        .mode = mode
+    };
+    response_message_t response;
+    struct timespec * waittime = &timeout;
+    int size = mcMessageSendWait(motor, TYPE_mcMotorLock, &args,
+        sizeof args, PRIORITY_CMD, &response, waittime);
+
+    switch (size) {
+        case -ENOENT:
+        case -EAGAIN:
+            return -ER_NO_DAEMON;
+        case -ETIMEDOUT:
+            return -ER_DAEMON_BUSY;
+    }
+
+    struct _mcMotorLock_args * payload = (struct _mcMotorLock_args *)(char *) response.payload;
+
+    
+    return payload->returned;
+}
+
+int mcMotorLockInProc(motor_t motor, int for_motor_id, lock_mode_t mode) {
+    request_message_t message = {
+        .id = 0,
+        .pid = getpid(),
+        .motor_id = motor,
+    };
+    struct _mcMotorLock_args args = {
+        .inproc = true,
+        .for_motor_id = for_motor_id,
+        .mode = mode
+    };
+    memcpy(message.payload, &args, sizeof(args));
+    mcMotorLockImpl(&message);
+    struct _mcMotorLock_args * payload = (struct _mcMotorLock_args *)(char *) message.payload;
+    
+    return payload->returned;
+}
+
+int mcMotorLock(motor_t motor, int for_motor_id, lock_mode_t mode) {
+    if (call_mode == MC_CALL_CROSS_PROCESS)
+        return mcMotorLockOutOfProc(motor,for_motor_id,mode);
+    else
+        return mcMotorLockInProc(motor,for_motor_id,mode);
+}
+
+
+int mcMotorUnlockOutOfProc(motor_t motor, int for_motor_id) {
+    
+    struct _mcMotorUnlock_args args = {
+        .outofproc = true,
+        .for_motor_id = for_motor_id
+    };
+    response_message_t response;
+    struct timespec * waittime = &timeout;
+    int size = mcMessageSendWait(motor, TYPE_mcMotorUnlock, &args,
+        sizeof args, PRIORITY_CMD, &response, waittime);
+
+    switch (size) {
+        case -ENOENT:
+        case -EAGAIN:
+            return -ER_NO_DAEMON;
+        case -ETIMEDOUT:
+            return -ER_DAEMON_BUSY;
+    }
+
+    struct _mcMotorUnlock_args * payload = (struct _mcMotorUnlock_args *)(char *) response.payload;
+
+    
+    return payload->returned;
+}
+
+int mcMotorUnlockInProc(motor_t motor, int for_motor_id) {
+    request_message_t message = {
+        .id = 0,
+        .pid = getpid(),
+        .motor_id = motor,
+    };
+    struct _mcMotorUnlock_args args = {
+        .inproc = true,
+        .for_motor_id = for_motor_id
+    };
+    memcpy(message.payload, &args, sizeof(args));
+    mcMotorUnlockImpl(&message);
+    struct _mcMotorUnlock_args * payload = (struct _mcMotorUnlock_args *)(char *) message.payload;
+    
+    return payload->returned;
+}
+
+int mcMotorUnlock(motor_t motor, int for_motor_id) {
+    if (call_mode == MC_CALL_CROSS_PROCESS)
+        return mcMotorUnlockOutOfProc(motor,for_motor_id);
+    else
+        return mcMotorUnlockInProc(motor,for_motor_id);
+}
+
+
+int mcMoveAbsoluteOutOfProc(motor_t motor, int distance) {
+    
+    struct _mcMoveAbsolute_args args = {
+        .outofproc = true,
+        .distance = distance
+    };
+    response_message_t response;
+    struct timespec * waittime = &timeout;
+    int size = mcMessageSendWait(motor, TYPE_mcMoveAbsolute, &args,
+        sizeof args, PRIORITY_CMD, &response, waittime);
+
+    switch (size) {
+        case -ENOENT:
+        case -EAGAIN:
+            return -ER_NO_DAEMON;
+        case -ETIMEDOUT:
+            return -ER_DAEMON_BUSY;
+    }
+
+    struct _mcMoveAbsolute_args * payload = (struct _mcMoveAbsolute_args *)(char *) response.payload;
+
+    
+    return payload->returned;
+}
+
+int mcMoveAbsoluteInProc(motor_t motor, int distance) {
+    request_message_t message = {
+        .id = 0,
+        .pid = getpid(),
+        .motor_id = motor,
+    };
+    struct _mcMoveAbsolute_args args = {
+        .inproc = true,
+        .distance = distance
+    };
+    memcpy(message.payload, &args, sizeof(args));
+    mcMoveAbsoluteImpl(&message);
+    struct _mcMoveAbsolute_args * payload = (struct _mcMoveAbsolute_args *)(char *) message.payload;
+    
+    return payload->returned;
+}
+
+int mcMoveAbsolute(motor_t motor, int distance) {
+    if (call_mode == MC_CALL_CROSS_PROCESS)
+        return mcMoveAbsoluteOutOfProc(motor,distance);
+    else
+        return mcMoveAbsoluteInProc(motor,distance);
+}
+
+
+int mcMoveAbsoluteUnitsOutOfProc(motor_t motor, int distance, unit_type_t units) {
+    
+    struct _mcMoveAbsoluteUnits_args args = {
+        .outofproc = true,
+        .distance = distance,
+        .units = units
+    };
+    response_message_t response;
+    struct timespec * waittime = &timeout;
+    int size = mcMessageSendWait(motor, TYPE_mcMoveAbsoluteUnits, &args,
+        sizeof args, PRIORITY_CMD, &response, waittime);
+
+    switch (size) {
+        case -ENOENT:
+        case -EAGAIN:
+            return -ER_NO_DAEMON;
+        case -ETIMEDOUT:
+            return -ER_DAEMON_BUSY;
+    }
+
+    struct _mcMoveAbsoluteUnits_args * payload = (struct _mcMoveAbsoluteUnits_args *)(char *) response.payload;
+
+    
+    return payload->returned;
+}
+
+int mcMoveAbsoluteUnitsInProc(motor_t motor, int distance, unit_type_t units) {
+    request_message_t message = {
+        .id = 0,
+        .pid = getpid(),
+        .motor_id = motor,
+    };
+    struct _mcMoveAbsoluteUnits_args args = {
+        .inproc = true,
+        .distance = distance,
+        .units = units
+    };
+    memcpy(message.payload, &args, sizeof(args));
+    mcMoveAbsoluteUnitsImpl(&message);
+    struct _mcMoveAbsoluteUnits_args * payload = (struct _mcMoveAbsoluteUnits_args *)(char *) message.payload;
+    
+    return payload->returned;
+}
+
+int mcMoveAbsoluteUnits(motor_t motor, int distance, unit_type_t units) {
+    if (call_mode == MC_CALL_CROSS_PROCESS)
+        return mcMoveAbsoluteUnitsOutOfProc(motor,distance,units);
+    else
+        return mcMoveAbsoluteUnitsInProc(motor,distance,units);
+}
+
+
+int mcMoveRelativeOutOfProc(motor_t motor, int distance) {
+    
+    struct _mcMoveRelative_args args = {
+        .outofproc = true,
+        .distance = distance
+    };
+    response_message_t response;
+    struct timespec * waittime = &timeout;
+    int size = mcMessageSendWait(motor, TYPE_mcMoveRelative, &args,
+        sizeof args, PRIORITY_CMD, &response, waittime);
+
+    switch (size) {
+        case -ENOENT:
+        case -EAGAIN:
+            return -ER_NO_DAEMON;
+        case -ETIMEDOUT:
+            return -ER_DAEMON_BUSY;
+    }
+
+    struct _mcMoveRelative_args * payload = (struct _mcMoveRelative_args *)(char *) response.payload;
+
+    
+    return payload->returned;
+}
+
+int mcMoveRelativeInProc(motor_t motor, int distance) {
+    request_message_t message = {
+        .id = 0,
+        .pid = getpid(),
+        .motor_id = motor,
+    };
+    struct _mcMoveRelative_args args = {
+        .inproc = true,
+        .distance = distance
+    };
+    memcpy(message.payload, &args, sizeof(args));
+    mcMoveRelativeImpl(&message);
+    struct _mcMoveRelative_args * payload = (struct _mcMoveRelative_args *)(char *) message.payload;
+    
+    return payload->returned;
+}
+
+int mcMoveRelative(motor_t motor, int distance) {
+    if (call_mode == MC_CALL_CROSS_PROCESS)
+        return mcMoveRelativeOutOfProc(motor,distance);
+    else
+        return mcMoveRelativeInProc(motor,distance);
+}
+
+
+int mcMoveRelativeUnitsOutOfProc(motor_t motor, int distance, unit_type_t units) {
+    
+    struct _mcMoveRelativeUnits_args args = {
+        .outofproc = true,
+        .distance = distance,
+        .units = units
+    };
+    response_message_t response;
+    struct timespec * waittime = &timeout;
+    int size = mcMessageSendWait(motor, TYPE_mcMoveRelativeUnits, &args,
+        sizeof args, PRIORITY_CMD, &response, waittime);
+
+    switch (size) {
+        case -ENOENT:
+        case -EAGAIN:
+            return -ER_NO_DAEMON;
+        case -ETIMEDOUT:
+            return -ER_DAEMON_BUSY;
+    }
+
+    struct _mcMoveRelativeUnits_args * payload = (struct _mcMoveRelativeUnits_args *)(char *) response.payload;
+
+    
+    return payload->returned;
+}
+
+int mcMoveRelativeUnitsInProc(motor_t motor, int distance, unit_type_t units) {
+    request_message_t message = {
+        .id = 0,
+        .pid = getpid(),
+        .motor_id = motor,
+    };
+    struct _mcMoveRelativeUnits_args args = {
+        .inproc = true,
+        .distance = distance,
+        .units = units
+    };
+    memcpy(message.payload, &args, sizeof(args));
+    mcMoveRelativeUnitsImpl(&message);
+    struct _mcMoveRelativeUnits_args * payload = (struct _mcMoveRelativeUnits_args *)(char *) message.payload;
+    
+    return payload->returned;
+}
+
+int mcMoveRelativeUnits(motor_t motor, int distance, unit_type_t units) {
+    if (call_mode == MC_CALL_CROSS_PROCESS)
+        return mcMoveRelativeUnitsOutOfProc(motor,distance,units);
+    else
+        return mcMoveRelativeUnitsInProc(motor,distance,units);
+}
+
+
+int mcPokeIntegerOutOfProc(motor_t motor, motor_query_t query, int value) {
+    
+    struct _mcPokeInteger_args args = {
+        .outofproc = true,
+        .query = query,
+        .value = value
+    };
+    response_message_t response;
+    struct timespec * waittime = NULL;
+    int size = mcMessageSendWait(motor, TYPE_mcPokeInteger, &args,
+        sizeof args, PRIORITY_CMD, &response, waittime);
+
+    switch (size) {
+        case -ENOENT:
+        case -EAGAIN:
+            return -ER_NO_DAEMON;
+        case -ETIMEDOUT:
+            return -ER_DAEMON_BUSY;
+    }
+
+    struct _mcPokeInteger_args * payload = (struct _mcPokeInteger_args *)(char *) response.payload;
+
+    
+    return payload->returned;
+}
+
+int mcPokeIntegerInProc(motor_t motor, motor_query_t query, int value) {
+    request_message_t message = {
+        .id = 0,
+        .pid = getpid(),
+        .motor_id = motor,
+    };
+    struct _mcPokeInteger_args args = {
+        .inproc = true,
+        .query = query,
+        .value = value
+    };
+    memcpy(message.payload, &args, sizeof(args));
+    mcPokeIntegerImpl(&message);
+    struct _mcPokeInteger_args * payload = (struct _mcPokeInteger_args *)(char *) message.payload;
+    
+    return payload->returned;
+}
+
+int mcPokeInteger(motor_t motor, motor_query_t query, int value) {
+    if (call_mode == MC_CALL_CROSS_PROCESS)
+        return mcPokeIntegerOutOfProc(motor,query,value);
+    else
+        return mcPokeIntegerInProc(motor,query,value);
+}
+
+
+int mcPokeIntegerUnitsOutOfProc(motor_t motor, motor_query_t query, int value,
+    unit_type_t units) {
+    
+    struct _mcPokeIntegerUnits_args args = {
+        .outofproc = true,
+        .query = query,
+        .value = value,
+        .units = units
+    };
+    response_message_t response;
+    struct timespec * waittime = &timeout;
+    int size = mcMessageSendWait(motor, TYPE_mcPokeIntegerUnits, &args,
+        sizeof args, PRIORITY_CMD, &response, waittime);
+
+    switch (size) {
+        case -ENOENT:
+        case -EAGAIN:
+            return -ER_NO_DAEMON;
+        case -ETIMEDOUT:
+            return -ER_DAEMON_BUSY;
+    }
+
+    struct _mcPokeIntegerUnits_args * payload = (struct _mcPokeIntegerUnits_args *)(char *) response.payload;
+
+    
+    return payload->returned;
+}
+
+int mcPokeIntegerUnitsInProc(motor_t motor, motor_query_t query, int value,
+    unit_type_t units) {
+    request_message_t message = {
+        .id = 0,
+        .pid = getpid(),
+        .motor_id = motor,
+    };
+    struct _mcPokeIntegerUnits_args args = {
+        .inproc = true,
+        .query = query,
+        .value = value,
+        .units = units
+    };
+    memcpy(message.payload, &args, sizeof(args));
+    mcPokeIntegerUnitsImpl(&message);
+    struct _mcPokeIntegerUnits_args * payload = (struct _mcPokeIntegerUnits_args *)(char *) message.payload;
+    
+    return payload->returned;
+}
+
+int mcPokeIntegerUnits(motor_t motor, motor_query_t query, int value,
+    unit_type_t units) {
+    if (call_mode == MC_CALL_CROSS_PROCESS)
+        return mcPokeIntegerUnitsOutOfProc(motor,query,value,units);
+    else
+        return mcPokeIntegerUnitsInProc(motor,query,value,units);
+}
+
+
+int mcPokeIntegerWithIntegerItemOutOfProc(motor_t motor, motor_query_t query, int value,
+    int item) {
+    
+    struct _mcPokeIntegerWithIntegerItem_args args = {
+        .outofproc = true,
+        .query = query,
+        .value = value,
+        .item = item
+    };
+    response_message_t response;
+    struct timespec * waittime = &timeout;
+    int size = mcMessageSendWait(motor, TYPE_mcPokeIntegerWithIntegerItem, &args,
+        sizeof args, PRIORITY_CMD, &response, waittime);
+
+    switch (size) {
+        case -ENOENT:
+        case -EAGAIN:
+            return -ER_NO_DAEMON;
+        case -ETIMEDOUT:
+            return -ER_DAEMON_BUSY;
+    }
+
+    struct _mcPokeIntegerWithIntegerItem_args * payload = (struct _mcPokeIntegerWithIntegerItem_args *)(char *) response.payload;
+
+    
+    return payload->returned;
+}
+
+int mcPokeIntegerWithIntegerItemInProc(motor_t motor, motor_query_t query, int value,
+    int item) {
+    request_message_t message = {
+        .id = 0,
+        .pid = getpid(),
+        .motor_id = motor,
+    };
+    struct _mcPokeIntegerWithIntegerItem_args args = {
+        .inproc = true,
+        .query = query,
+        .value = value,
+        .item = item
+    };
+    memcpy(message.payload, &args, sizeof(args));
+    mcPokeIntegerWithIntegerItemImpl(&message);
+    struct _mcPokeIntegerWithIntegerItem_args * payload = (struct _mcPokeIntegerWithIntegerItem_args *)(char *) message.payload;
+    
+    return payload->returned;
+}
+
+int mcPokeIntegerWithIntegerItem(motor_t motor, motor_query_t query, int value,
+    int item) {
+    if (call_mode == MC_CALL_CROSS_PROCESS)
+        return mcPokeIntegerWithIntegerItemOutOfProc(motor,query,value,item);
+    else
+        return mcPokeIntegerWithIntegerItemInProc(motor,query,value,item);
+}
+
+
+int mcPokeIntegerWithStringItemOutOfProc(motor_t motor, motor_query_t query, int value,
+    String * item) {
+    if (item == NULL) return -EINVAL;
+    struct _mcPokeIntegerWithStringItem_args args = {
+        .outofproc = true,
+        .query = query,
+        .value = value,
+        .item = *item
+    };
+    response_message_t response;
+    struct timespec * waittime = &timeout;
+    int size = mcMessageSendWait(motor, TYPE_mcPokeIntegerWithStringItem, &args,
+        sizeof args, PRIORITY_CMD, &response, waittime);
+
+    switch (size) {
+        case -ENOENT:
+        case -EAGAIN:
+            return -ER_NO_DAEMON;
+        case -ETIMEDOUT:
+            return -ER_DAEMON_BUSY;
+    }
+
+    struct _mcPokeIntegerWithStringItem_args * payload = (struct _mcPokeIntegerWithStringItem_args *)(char *) response.payload;
+
+    
+    return payload->returned;
+}
+
+int mcPokeIntegerWithStringItemInProc(motor_t motor, motor_query_t query, int value,
+    String * item) {
+    request_message_t message = {
+        .id = 0,
+        .pid = getpid(),
+        .motor_id = motor,
+    };
+    struct _mcPokeIntegerWithStringItem_args args = {
+        .inproc = true,
+        .query = query,
+        .value = value,
+        .item = *item
+    };
+    memcpy(message.payload, &args, sizeof(args));
+    mcPokeIntegerWithStringItemImpl(&message);
+    struct _mcPokeIntegerWithStringItem_args * payload = (struct _mcPokeIntegerWithStringItem_args *)(char *) message.payload;
+    
+    return payload->returned;
+}
+
+int mcPokeIntegerWithStringItem(motor_t motor, motor_query_t query, int value,
+    String * item) {
+    if (call_mode == MC_CALL_CROSS_PROCESS)
+        return mcPokeIntegerWithStringItemOutOfProc(motor,query,value,item);
+    else
+        return mcPokeIntegerWithStringItemInProc(motor,query,value,item);
+}
+
+
+int mcPokeStringOutOfProc(motor_t motor, motor_query_t query, String * value) {
+    if (value == NULL) return -EINVAL;
+    struct _mcPokeString_args args = {
+        .outofproc = true,
+        .query = query,
+        .value = *value
+    };
+    response_message_t response;
+    struct timespec * waittime = &timeout;
+    int size = mcMessageSendWait(motor, TYPE_mcPokeString, &args,
+        sizeof args, PRIORITY_CMD, &response, waittime);
+
+    switch (size) {
+        case -ENOENT:
+        case -EAGAIN:
+            return -ER_NO_DAEMON;
+        case -ETIMEDOUT:
+            return -ER_DAEMON_BUSY;
+    }
+
+    struct _mcPokeString_args * payload = (struct _mcPokeString_args *)(char *) response.payload;
+
+    
+    return payload->returned;
+}
+
+int mcPokeStringInProc(motor_t motor, motor_query_t query, String * value) {
+    request_message_t message = {
+        .id = 0,
+        .pid = getpid(),
+        .motor_id = motor,
+    };
+    struct _mcPokeString_args args = {
+        .inproc = true,
+        .query = query,
+        .value = *value
+    };
+    memcpy(message.payload, &args, sizeof(args));
+    mcPokeStringImpl(&message);
+    struct _mcPokeString_args * payload = (struct _mcPokeString_args *)(char *) message.payload;
+    
+    return payload->returned;
+}
+
+int mcPokeString(motor_t motor, motor_query_t query, String * value) {
+    if (call_mode == MC_CALL_CROSS_PROCESS)
+        return mcPokeStringOutOfProc(motor,query,value);
+    else
+        return mcPokeStringInProc(motor,query,value);
+}
+
+
+int mcPokeStringWithStringItemOutOfProc(motor_t motor, motor_query_t query,
+    String * value, String * item) {
+    if (value == NULL) return -EINVAL;
+    if (item == NULL) return -EINVAL;
+    struct _mcPokeStringWithStringItem_args args = {
+        .outofproc = true,
+        .query = query,
+        .value = *value,
+        .item = *item
+    };
+    response_message_t response;
+    struct timespec * waittime = NULL;
+    int size = mcMessageSendWait(motor, TYPE_mcPokeStringWithStringItem, &args,
+        sizeof args, PRIORITY_CMD, &response, waittime);
+
+    switch (size) {
+        case -ENOENT:
+        case -EAGAIN:
+            return -ER_NO_DAEMON;
+        case -ETIMEDOUT:
+            return -ER_DAEMON_BUSY;
+    }
+
+    struct _mcPokeStringWithStringItem_args * payload = (struct _mcPokeStringWithStringItem_args *)(char *) response.payload;
+
+    
+    return payload->returned;
+}
+
+int mcPokeStringWithStringItemInProc(motor_t motor, motor_query_t query,
+    String * value, String * item) {
+    request_message_t message = {
+        .id = 0,
+        .pid = getpid(),
+        .motor_id = motor,
+    };
+    struct _mcPokeStringWithStringItem_args args = {
+        .inproc = true,
+        .query = query,
+        .value = *value,
+        .item = *item
+    };
+    memcpy(message.payload, &args, sizeof(args));
+    mcPokeStringWithStringItemImpl(&message);
+    struct _mcPokeStringWithStringItem_args * payload = (struct _mcPokeStringWithStringItem_args *)(char *) message.payload;
+    
+    return payload->returned;
+}
+
+int mcPokeStringWithStringItem(motor_t motor, motor_query_t query,
+    String * value, String * item) {
+    if (call_mode == MC_CALL_CROSS_PROCESS)
+        return mcPokeStringWithStringItemOutOfProc(motor,query,value,item);
+    else
+        return mcPokeStringWithStringItemInProc(motor,query,value,item);
+}
+
+
+int mcProfileGetOutOfProc(motor_t motor, OUT Profile * profile) {
+    if (profile == NULL) return -EINVAL;
+    struct _mcProfileGet_args args = {
+        .outofproc = true,
+        .profile = *profile
+    };
+    response_message_t response;
+    struct timespec * waittime = &timeout;
+    int size = mcMessageSendWait(motor, TYPE_mcProfileGet, &args,
+        sizeof args, PRIORITY_CMD, &response, waittime);
+
+    switch (size) {
+        case -ENOENT:
+        case -EAGAIN:
+            return -ER_NO_DAEMON;
+        case -ETIMEDOUT:
+            return -ER_DAEMON_BUSY;
+    }
+
+    struct _mcProfileGet_args * payload = (struct _mcProfileGet_args *)(char *) response.payload;
+
+    memcpy(profile, &payload->profile, sizeof(Profile));
+    return payload->returned;
+}
+
+int mcProfileGetInProc(motor_t motor, OUT Profile * profile) {
+    request_message_t message = {
+        .id = 0,
+        .pid = getpid(),
+        .motor_id = motor,
+    };
+    struct _mcProfileGet_args args = {
+        .inproc = true,
+        .profile = *profile
+    };
+    memcpy(message.payload, &args, sizeof(args));
+    mcProfileGetImpl(&message);
+    struct _mcProfileGet_args * payload = (struct _mcProfileGet_args *)(char *) message.payload;
+    memcpy(profile, &payload->profile, sizeof(Profile));
+    return payload->returned;
+}
+
+int mcProfileGet(motor_t motor, OUT Profile * profile) {
+    if (call_mode == MC_CALL_CROSS_PROCESS)
+        return mcProfileGetOutOfProc(motor,profile);
+    else
+        return mcProfileGetInProc(motor,profile);
+}
+
+
+int mcProfileGetAccelOutOfProc(motor_t motor, Profile * profile, unit_type_t units,
+    OUT int * value) {
+    if (profile == NULL) return -EINVAL;
+    if (value == NULL) return -EINVAL;
+    struct _mcProfileGetAccel_args args = {
+        .outofproc = true,
+        .profile = *profile,
+        .units = units,
+        .value = *value
+    };
+    response_message_t response;
+    struct timespec * waittime = &timeout;
+    int size = mcMessageSendWait(motor, TYPE_mcProfileGetAccel, &args,
+        sizeof args, PRIORITY_CMD, &response, waittime);
+
+    switch (size) {
+        case -ENOENT:
+        case -EAGAIN:
+            return -ER_NO_DAEMON;
+        case -ETIMEDOUT:
+            return -ER_DAEMON_BUSY;
+    }
+
+    struct _mcProfileGetAccel_args * payload = (struct _mcProfileGetAccel_args *)(char *) response.payload;
+
+    memcpy(value, &payload->value, sizeof(int));
+    return payload->returned;
+}
+
+int mcProfileGetAccelInProc(motor_t motor, Profile * profile, unit_type_t units,
+    OUT int * value) {
+    request_message_t message = {
+        .id = 0,
+        .pid = getpid(),
+        .motor_id = motor,
+    };
+    struct _mcProfileGetAccel_args args = {
+        .inproc = true,
+        .profile = *profile,
+        .units = units,
+        .value = *value
+    };
+    memcpy(message.payload, &args, sizeof(args));
+    mcProfileGetAccelImpl(&message);
+    struct _mcProfileGetAccel_args * payload = (struct _mcProfileGetAccel_args *)(char *) message.payload;
+    memcpy(value, &payload->value, sizeof(int));
+    return payload->returned;
+}
+
+int mcProfileGetAccel(motor_t motor, Profile * profile, unit_type_t units,
+    OUT int * value) {
+    if (call_mode == MC_CALL_CROSS_PROCESS)
+        return mcProfileGetAccelOutOfProc(motor,profile,units,value);
+    else
+        return mcProfileGetAccelInProc(motor,profile,units,value);
+}
+
+
+int mcProfileGetDeadbandOutOfProc(motor_t motor, Profile * profile, unit_type_t units,
+    OUT int * value) {
+    if (profile == NULL) return -EINVAL;
+    if (value == NULL) return -EINVAL;
+    struct _mcProfileGetDeadband_args args = {
+        .outofproc = true,
+        .profile = *profile,
+        .units = units,
+        .value = *value
+    };
+    response_message_t response;
+    struct timespec * waittime = &timeout;
+    int size = mcMessageSendWait(motor, TYPE_mcProfileGetDeadband, &args,
+        sizeof args, PRIORITY_CMD, &response, waittime);
+
+    switch (size) {
+        case -ENOENT:
+        case -EAGAIN:
+            return -ER_NO_DAEMON;
+        case -ETIMEDOUT:
+            return -ER_DAEMON_BUSY;
+    }
+
+    struct _mcProfileGetDeadband_args * payload = (struct _mcProfileGetDeadband_args *)(char *) response.payload;
+
+    memcpy(value, &payload->value, sizeof(int));
+    return payload->returned;
+}
+
+int mcProfileGetDeadbandInProc(motor_t motor, Profile * profile, unit_type_t units,
+    OUT int * value) {
+    request_message_t message = {
+        .id = 0,
+        .pid = getpid(),
+        .motor_id = motor,
+    };
+    struct _mcProfileGetDeadband_args args = {
+        .inproc = true,
+        .profile = *profile,
+        .units = units,
+        .value = *value
+    };
+    memcpy(message.payload, &args, sizeof(args));
+    mcProfileGetDeadbandImpl(&message);
+    struct _mcProfileGetDeadband_args * payload = (struct _mcProfileGetDeadband_args *)(char *) message.payload;
+    memcpy(value, &payload->value, sizeof(int));
+    return payload->returned;
+}
+
+int mcProfileGetDeadband(motor_t motor, Profile * profile, unit_type_t units,
+    OUT int * value) {
+    if (call_mode == MC_CALL_CROSS_PROCESS)
+        return mcProfileGetDeadbandOutOfProc(motor,profile,units,value);
+    else
+        return mcProfileGetDeadbandInProc(motor,profile,units,value);
+}
+
+
+int mcProfileGetDecelOutOfProc(motor_t motor, Profile * profile, unit_type_t units,
+    OUT int * value) {
+    if (profile == NULL) return -EINVAL;
+    if (value == NULL) return -EINVAL;
+    struct _mcProfileGetDecel_args args = {
+        .outofproc = true,
+        .profile = *profile,
+        .units = units,
+        .value = *value
+    };
+    response_message_t response;
+    struct timespec * waittime = &timeout;
+    int size = mcMessageSendWait(motor, TYPE_mcProfileGetDecel, &args,
+        sizeof args, PRIORITY_CMD, &response, waittime);
+
+    switch (size) {
+        case -ENOENT:
+        case -EAGAIN:
+            return -ER_NO_DAEMON;
+        case -ETIMEDOUT:
+            return -ER_DAEMON_BUSY;
+    }
+
+    struct _mcProfileGetDecel_args * payload = (struct _mcProfileGetDecel_args *)(char *) response.payload;
+
+    memcpy(value, &payload->value, sizeof(int));
+    return payload->returned;
+}
+
+int mcProfileGetDecelInProc(motor_t motor, Profile * profile, unit_type_t units,
+    OUT int * value) {
+    request_message_t message = {
+        .id = 0,
+        .pid = getpid(),
+        .motor_id = motor,
+    };
+    struct _mcProfileGetDecel_args args = {
+        .inproc = true,
+        .profile = *profile,
+        .units = units,
+        .value = *value
+    };
+    memcpy(message.payload, &args, sizeof(args));
+    mcProfileGetDecelImpl(&message);
+    struct _mcProfileGetDecel_args * payload = (struct _mcProfileGetDecel_args *)(char *) message.payload;
+    memcpy(value, &payload->value, sizeof(int));
+    return payload->returned;
+}
+
+int mcProfileGetDecel(motor_t motor, Profile * profile, unit_type_t units,
+    OUT int * value) {
+    if (call_mode == MC_CALL_CROSS_PROCESS)
+        return mcProfileGetDecelOutOfProc(motor,profile,units,value);
+    else
+        return mcProfileGetDecelInProc(motor,profile,units,value);
+}
+
+
+int mcProfileGetInitialVOutOfProc(motor_t motor, Profile * profile, unit_type_t units,
+    OUT int * value) {
+    if (profile == NULL) return -EINVAL;
+    if (value == NULL) return -EINVAL;
+    struct _mcProfileGetInitialV_args args = {
+        .outofproc = true,
+        .profile = *profile,
+        .units = units,
+        .value = *value
+    };
+    response_message_t response;
+    struct timespec * waittime = &timeout;
+    int size = mcMessageSendWait(motor, TYPE_mcProfileGetInitialV, &args,
+        sizeof args, PRIORITY_CMD, &response, waittime);
+
+    switch (size) {
+        case -ENOENT:
+        case -EAGAIN:
+            return -ER_NO_DAEMON;
+        case -ETIMEDOUT:
+            return -ER_DAEMON_BUSY;
+    }
+
+    struct _mcProfileGetInitialV_args * payload = (struct _mcProfileGetInitialV_args *)(char *) response.payload;
+
+    memcpy(value, &payload->value, sizeof(int));
+    return payload->returned;
+}
+
+int mcProfileGetInitialVInProc(motor_t motor, Profile * profile, unit_type_t units,
+    OUT int * value) {
+    request_message_t message = {
+        .id = 0,
+        .pid = getpid(),
+        .motor_id = motor,
+    };
+    struct _mcProfileGetInitialV_args args = {
+        .inproc = true,
+        .profile = *profile,
+        .units = units,
+        .value = *value
+    };
+    memcpy(message.payload, &args, sizeof(args));
+    mcProfileGetInitialVImpl(&message);
+    struct _mcProfileGetInitialV_args * payload = (struct _mcProfileGetInitialV_args *)(char *) message.payload;
+    memcpy(value, &payload->value, sizeof(int));
+    return payload->returned;
+}
+
+int mcProfileGetInitialV(motor_t motor, Profile * profile, unit_type_t units,
+    OUT int * value) {
+    if (call_mode == MC_CALL_CROSS_PROCESS)
+        return mcProfileGetInitialVOutOfProc(motor,profile,units,value);
+    else
+        return mcProfileGetInitialVInProc(motor,profile,units,value);
+}
+
+
+int mcProfileGetMaxSlipOutOfProc(motor_t motor, Profile * profile, unit_type_t units,
+    OUT int * value) {
+    if (profile == NULL) return -EINVAL;
+    if (value == NULL) return -EINVAL;
+    struct _mcProfileGetMaxSlip_args args = {
+        .outofproc = true,
+        .profile = *profile,
+        .units = units,
+        .value = *value
+    };
+    response_message_t response;
+    struct timespec * waittime = &timeout;
+    int size = mcMessageSendWait(motor, TYPE_mcProfileGetMaxSlip, &args,
+        sizeof args, PRIORITY_CMD, &response, waittime);
+
+    switch (size) {
+        case -ENOENT:
+        case -EAGAIN:
+            return -ER_NO_DAEMON;
+        case -ETIMEDOUT:
+            return -ER_DAEMON_BUSY;
+    }
+
+    struct _mcProfileGetMaxSlip_args * payload = (struct _mcProfileGetMaxSlip_args *)(char *) response.payload;
+
+    memcpy(value, &payload->value, sizeof(int));
+    return payload->returned;
+}
+
+int mcProfileGetMaxSlipInProc(motor_t motor, Profile * profile, unit_type_t units,
+    OUT int * value) {
+    request_message_t message = {
+        .id = 0,
+        .pid = getpid(),
+        .motor_id = motor,
+    };
+    struct _mcProfileGetMaxSlip_args args = {
+        .inproc = true,
+        .profile = *profile,
+        .units = units,
+        .value = *value
+    };
+    memcpy(message.payload, &args, sizeof(args));
+    mcProfileGetMaxSlipImpl(&message);
+    struct _mcProfileGetMaxSlip_args * payload = (struct _mcProfileGetMaxSlip_args *)(char *) message.payload;
+    memcpy(value, &payload->value, sizeof(int));
+    return payload->returned;
+}
+
+int mcProfileGetMaxSlip(motor_t motor, Profile * profile, unit_type_t units,
+    OUT int * value) {
+    if (call_mode == MC_CALL_CROSS_PROCESS)
+        return mcProfileGetMaxSlipOutOfProc(motor,profile,units,value);
+    else
+        return mcProfileGetMaxSlipInProc(motor,profile,units,value);
+}
+
+
+int mcProfileGetMaxVOutOfProc(motor_t motor, Profile * profile, unit_type_t units,
+    OUT int * value) {
+    if (profile == NULL) return -EINVAL;
+    if (value == NULL) return -EINVAL;
+    struct _mcProfileGetMaxV_args args = {
+        .outofproc = true,
+        .profile = *profile,
+        .units = units,
+        .value = *value
+    };
+    response_message_t response;
+    struct timespec * waittime = &timeout;
+    int size = mcMessageSendWait(motor, TYPE_mcProfileGetMaxV, &args,
+        sizeof args, PRIORITY_CMD, &response, waittime);
+
+    switch (size) {
+        case -ENOENT:
+        case -EAGAIN:
+            return -ER_NO_DAEMON;
+        case -ETIMEDOUT:
+            return -ER_DAEMON_BUSY;
+    }
+
+    struct _mcProfileGetMaxV_args * payload = (struct _mcProfileGetMaxV_args *)(char *) response.payload;
+
+    memcpy(value, &payload->value, sizeof(int));
+    return payload->returned;
+}
+
+int mcProfileGetMaxVInProc(motor_t motor, Profile * profile, unit_type_t units,
+    OUT int * value) {
+    request_message_t message = {
+        .id = 0,
+        .pid = getpid(),
+        .motor_id = motor,
+    };
+    struct _mcProfileGetMaxV_args args = {
+        .inproc = true,
+        .profile = *profile,
+        .units = units,
+        .value = *value
+    };
+    memcpy(message.payload, &args, sizeof(args));
+    mcProfileGetMaxVImpl(&message);
+    struct _mcProfileGetMaxV_args * payload = (struct _mcProfileGetMaxV_args *)(char *) message.payload;
+    memcpy(value, &payload->value, sizeof(int));
+    return payload->returned;
+}
+
+int mcProfileGetMaxV(motor_t motor, Profile * profile, unit_type_t units,
+    OUT int * value) {
+    if (call_mode == MC_CALL_CROSS_PROCESS)
+        return mcProfileGetMaxVOutOfProc(motor,profile,units,value);
+    else
+        return mcProfileGetMaxVInProc(motor,profile,units,value);
+}
+
+
+int mcProfileSetOutOfProc(motor_t motor, Profile * profile) {
+    if (profile == NULL) return -EINVAL;
+    struct _mcProfileSet_args args = {
+        .outofproc = true,
+        .profile = *profile
+    };
+    response_message_t response;
+    struct timespec * waittime = &timeout;
+    int size = mcMessageSendWait(motor, TYPE_mcProfileSet, &args,
+        sizeof args, PRIORITY_CMD, &response, waittime);
+
+    switch (size) {
+        case -ENOENT:
+        case -EAGAIN:
+            return -ER_NO_DAEMON;
+        case -ETIMEDOUT:
+            return -ER_DAEMON_BUSY;
+    }
+
+    struct _mcProfileSet_args * payload = (struct _mcProfileSet_args *)(char *) response.payload;
+
+    
+    return payload->returned;
+}
+
+int mcProfileSetInProc(motor_t motor, Profile * profile) {
+    request_message_t message = {
+        .id = 0,
+        .pid = getpid(),
+        .motor_id = motor,
+    };
+    struct _mcProfileSet_args args = {
+        .inproc = true,
+        .profile = *profile
+    };
+    memcpy(message.payload, &args, sizeof(args));
+    mcProfileSetImpl(&message);
+    struct _mcProfileSet_args * payload = (struct _mcProfileSet_args *)(char *) message.payload;
+    
+    return payload->returned;
+}
+
+int mcProfileSet(motor_t motor, Profile * profile) {
+    if (call_mode == MC_CALL_CROSS_PROCESS)
+        return mcProfileSetOutOfProc(motor,profile);
+    else
+        return mcProfileSetInProc(motor,profile);
+}
+
+
+int mcQueryFloatOutOfProc(motor_t motor, motor_query_t query, OUT double * value) {
+    if (value == NULL) return -EINVAL;
+    struct _mcQueryFloat_args args = {
+        .outofproc = true,
+        .query = query,
+        .value = *value
+    };
+    response_message_t response;
+    struct timespec * waittime = &timeout;
+    int size = mcMessageSendWait(motor, TYPE_mcQueryFloat, &args,
+        sizeof args, PRIORITY_CMD, &response, waittime);
+
+    switch (size) {
+        case -ENOENT:
+        case -EAGAIN:
+            return -ER_NO_DAEMON;
+        case -ETIMEDOUT:
+            return -ER_DAEMON_BUSY;
+    }
+
+    struct _mcQueryFloat_args * payload = (struct _mcQueryFloat_args *)(char *) response.payload;
+
+    memcpy(value, &payload->value, sizeof(double));
+    return payload->returned;
+}
+
+int mcQueryFloatInProc(motor_t motor, motor_query_t query, OUT double * value) {
+    request_message_t message = {
+        .id = 0,
+        .pid = getpid(),
+        .motor_id = motor,
+    };
+    struct _mcQueryFloat_args args = {
+        .inproc = true,
+        .query = query,
+        .value = *value
+    };
+    memcpy(message.payload, &args, sizeof(args));
+    mcQueryFloatImpl(&message);
+    struct _mcQueryFloat_args * payload = (struct _mcQueryFloat_args *)(char *) message.payload;
+    memcpy(value, &payload->value, sizeof(double));
+    return payload->returned;
+}
+
+int mcQueryFloat(motor_t motor, motor_query_t query, OUT double * value) {
+    if (call_mode == MC_CALL_CROSS_PROCESS)
+        return mcQueryFloatOutOfProc(motor,query,value);
+    else
+        return mcQueryFloatInProc(motor,query,value);
+}
+
+
+int mcQueryFloatUnitsOutOfProc(motor_t motor, motor_query_t query, OUT double * value,
+    unit_type_t units) {
+    if (value == NULL) return -EINVAL;
+    struct _mcQueryFloatUnits_args args = {
+        .outofproc = true,
+        .query = query,
+        .value = *value,
+        .units = units
+    };
+    response_message_t response;
+    struct timespec * waittime = &timeout;
+    int size = mcMessageSendWait(motor, TYPE_mcQueryFloatUnits, &args,
+        sizeof args, PRIORITY_CMD, &response, waittime);
+
+    switch (size) {
+        case -ENOENT:
+        case -EAGAIN:
+            return -ER_NO_DAEMON;
+        case -ETIMEDOUT:
+            return -ER_DAEMON_BUSY;
+    }
+
+    struct _mcQueryFloatUnits_args * payload = (struct _mcQueryFloatUnits_args *)(char *) response.payload;
+
+    memcpy(value, &payload->value, sizeof(double));
+    return payload->returned;
+}
+
+int mcQueryFloatUnitsInProc(motor_t motor, motor_query_t query, OUT double * value,
+    unit_type_t units) {
+    request_message_t message = {
+        .id = 0,
+        .pid = getpid(),
+        .motor_id = motor,
+    };
+    struct _mcQueryFloatUnits_args args = {
+        .inproc = true,
+        .query = query,
+        .value = *value,
+        .units = units
+    };
+    memcpy(message.payload, &args, sizeof(args));
+    mcQueryFloatUnitsImpl(&message);
+    struct _mcQueryFloatUnits_args * payload = (struct _mcQueryFloatUnits_args *)(char *) message.payload;
+    memcpy(value, &payload->value, sizeof(double));
+    return payload->returned;
+}
+
+int mcQueryFloatUnits(motor_t motor, motor_query_t query, OUT double * value,
+    unit_type_t units) {
+    if (call_mode == MC_CALL_CROSS_PROCESS)
+        return mcQueryFloatUnitsOutOfProc(motor,query,value,units);
+    else
+        return mcQueryFloatUnitsInProc(motor,query,value,units);
+}
+
+
+int mcQueryIntegerOutOfProc(motor_t motor, motor_query_t query, OUT int * value) {
+    if (value == NULL) return -EINVAL;
+    struct _mcQueryInteger_args args = {
+        .outofproc = true,
+        .query = query,
+        .value = *value
+    };
+    response_message_t response;
+    struct timespec * waittime = &timeout;
+    int size = mcMessageSendWait(motor, TYPE_mcQueryInteger, &args,
+        sizeof args, PRIORITY_CMD, &response, waittime);
+
+    switch (size) {
+        case -ENOENT:
+        case -EAGAIN:
+            return -ER_NO_DAEMON;
+        case -ETIMEDOUT:
+            return -ER_DAEMON_BUSY;
+    }
+
+    struct _mcQueryInteger_args * payload = (struct _mcQueryInteger_args *)(char *) response.payload;
+
+    memcpy(value, &payload->value, sizeof(int));
+    return payload->returned;
+}
+
+int mcQueryIntegerInProc(motor_t motor, motor_query_t query, OUT int * value) {
+    request_message_t message = {
+        .id = 0,
+        .pid = getpid(),
+        .motor_id = motor,
+    };
+    struct _mcQueryInteger_args args = {
+        .inproc = true,
+        .query = query,
+        .value = *value
+    };
+    memcpy(message.payload, &args, sizeof(args));
+    mcQueryIntegerImpl(&message);
+    struct _mcQueryInteger_args * payload = (struct _mcQueryInteger_args *)(char *) message.payload;
+    memcpy(value, &payload->value, sizeof(int));
+    return payload->returned;
+}
+
+int mcQueryInteger(motor_t motor, motor_query_t query, OUT int * value) {
+    if (call_mode == MC_CALL_CROSS_PROCESS)
+        return mcQueryIntegerOutOfProc(motor,query,value);
+    else
+        return mcQueryIntegerInProc(motor,query,value);
+}
+
+
+int mcQueryIntegerUnitsOutOfProc(motor_t motor, motor_query_t query, OUT int * value,
+    unit_type_t units) {
+    if (value == NULL) return -EINVAL;
+    struct _mcQueryIntegerUnits_args args = {
+        .outofproc = true,
+        .query = query,
+        .value = *value,
+        .units = units
+    };
+    response_message_t response;
+    struct timespec * waittime = &timeout;
+    int size = mcMessageSendWait(motor, TYPE_mcQueryIntegerUnits, &args,
+        sizeof args, PRIORITY_CMD, &response, waittime);
+
+    switch (size) {
+        case -ENOENT:
+        case -EAGAIN:
+            return -ER_NO_DAEMON;
+        case -ETIMEDOUT:
+            return -ER_DAEMON_BUSY;
+    }
+
+    struct _mcQueryIntegerUnits_args * payload = (struct _mcQueryIntegerUnits_args *)(char *) response.payload;
+
+    memcpy(value, &payload->value, sizeof(int));
+    return payload->returned;
+}
+
+int mcQueryIntegerUnitsInProc(motor_t motor, motor_query_t query, OUT int * value,
+    unit_type_t units) {
+    request_message_t message = {
+        .id = 0,
+        .pid = getpid(),
+        .motor_id = motor,
+    };
+    struct _mcQueryIntegerUnits_args args = {
+        .inproc = true,
+        .query = query,
+        .value = *value,
+        .units = units
+    };
+    memcpy(message.payload, &args, sizeof(args));
+    mcQueryIntegerUnitsImpl(&message);
+    struct _mcQueryIntegerUnits_args * payload = (struct _mcQueryIntegerUnits_args *)(char *) message.payload;
+    memcpy(value, &payload->value, sizeof(int));
+    return payload->returned;
+}
+
+int mcQueryIntegerUnits(motor_t motor, motor_query_t query, OUT int * value,
+    unit_type_t units) {
+    if (call_mode == MC_CALL_CROSS_PROCESS)
+        return mcQueryIntegerUnitsOutOfProc(motor,query,value,units);
+    else
+        return mcQueryIntegerUnitsInProc(motor,query,value,units);
+}
+
+
+int mcQueryIntegerWithIntegerItemOutOfProc(motor_t motor, motor_query_t query,
+    OUT int * value, int item) {
+    if (value == NULL) return -EINVAL;
+    struct _mcQueryIntegerWithIntegerItem_args args = {
+        .outofproc = true,
+        .query = query,
+        .value = *value,
+        .item = item
+    };
+    response_message_t response;
+    struct timespec * waittime = &timeout;
+    int size = mcMessageSendWait(motor, TYPE_mcQueryIntegerWithIntegerItem, &args,
+        sizeof args, PRIORITY_CMD, &response, waittime);
+
+    switch (size) {
+        case -ENOENT:
+        case -EAGAIN:
+            return -ER_NO_DAEMON;
+        case -ETIMEDOUT:
+            return -ER_DAEMON_BUSY;
+    }
+
+    struct _mcQueryIntegerWithIntegerItem_args * payload = (struct _mcQueryIntegerWithIntegerItem_args *)(char *) response.payload;
+
+    memcpy(value, &payload->value, sizeof(int));
+    return payload->returned;
+}
+
+int mcQueryIntegerWithIntegerItemInProc(motor_t motor, motor_query_t query,
+    OUT int * value, int item) {
+    request_message_t message = {
+        .id = 0,
+        .pid = getpid(),
+        .motor_id = motor,
+    };
+    struct _mcQueryIntegerWithIntegerItem_args args = {
+        .inproc = true,
+        .query = query,
+        .value = *value,
+        .item = item
+    };
+    memcpy(message.payload, &args, sizeof(args));
+    mcQueryIntegerWithIntegerItemImpl(&message);
+    struct _mcQueryIntegerWithIntegerItem_args * payload = (struct _mcQueryIntegerWithIntegerItem_args *)(char *) message.payload;
+    memcpy(value, &payload->value, sizeof(int));
+    return payload->returned;
+}
+
+int mcQueryIntegerWithIntegerItem(motor_t motor, motor_query_t query,
+    OUT int * value, int item) {
+    if (call_mode == MC_CALL_CROSS_PROCESS)
+        return mcQueryIntegerWithIntegerItemOutOfProc(motor,query,value,item);
+    else
+        return mcQueryIntegerWithIntegerItemInProc(motor,query,value,item);
+}
+
+
+int mcQueryIntegerWithStringItemOutOfProc(motor_t motor, motor_query_t query,
+    OUT int * value, String * item) {
+    if (value == NULL) return -EINVAL;
+    if (item == NULL) return -EINVAL;
+    struct _mcQueryIntegerWithStringItem_args args = {
+        .outofproc = true,
+        .query = query,
+        .value = *value,
+        .item = *item
+    };
+    response_message_t response;
+    struct timespec * waittime = &timeout;
+    int size = mcMessageSendWait(motor, TYPE_mcQueryIntegerWithStringItem, &args,
+        sizeof args, PRIORITY_CMD, &response, waittime);
+
+    switch (size) {
+        case -ENOENT:
+        case -EAGAIN:
+            return -ER_NO_DAEMON;
+        case -ETIMEDOUT:
+            return -ER_DAEMON_BUSY;
+    }
+
+    struct _mcQueryIntegerWithStringItem_args * payload = (struct _mcQueryIntegerWithStringItem_args *)(char *) response.payload;
+
+    memcpy(value, &payload->value, sizeof(int));
+    return payload->returned;
+}
+
+int mcQueryIntegerWithStringItemInProc(motor_t motor, motor_query_t query,
+    OUT int * value, String * item) {
+    request_message_t message = {
+        .id = 0,
+        .pid = getpid(),
+        .motor_id = motor,
+    };
+    struct _mcQueryIntegerWithStringItem_args args = {
+        .inproc = true,
+        .query = query,
+        .value = *value,
+        .item = *item
+    };
+    memcpy(message.payload, &args, sizeof(args));
+    mcQueryIntegerWithStringItemImpl(&message);
+    struct _mcQueryIntegerWithStringItem_args * payload = (struct _mcQueryIntegerWithStringItem_args *)(char *) message.payload;
+    memcpy(value, &payload->value, sizeof(int));
+    return payload->returned;
+}
+
+int mcQueryIntegerWithStringItem(motor_t motor, motor_query_t query,
+    OUT int * value, String * item) {
+    if (call_mode == MC_CALL_CROSS_PROCESS)
+        return mcQueryIntegerWithStringItemOutOfProc(motor,query,value,item);
+    else
+        return mcQueryIntegerWithStringItemInProc(motor,query,value,item);
+}
+
+
+int mcQueryStringOutOfProc(motor_t motor, motor_query_t query, OUT String * value) {
+    if (value == NULL) return -EINVAL;
+    struct _mcQueryString_args args = {
+        .outofproc = true,
+        .query = query,
+        .value = *value
+    };
+    response_message_t response;
+    struct timespec * waittime = &timeout;
+    int size = mcMessageSendWait(motor, TYPE_mcQueryString, &args,
+        sizeof args, PRIORITY_CMD, &response, waittime);
+
+    switch (size) {
+        case -ENOENT:
+        case -EAGAIN:
+            return -ER_NO_DAEMON;
+        case -ETIMEDOUT:
+            return -ER_DAEMON_BUSY;
+    }
+
+    struct _mcQueryString_args * payload = (struct _mcQueryString_args *)(char *) response.payload;
+
+    memcpy(value, &payload->value, sizeof(String));
+    return payload->returned;
+}
+
+int mcQueryStringInProc(motor_t motor, motor_query_t query, OUT String * value) {
+    request_message_t message = {
+        .id = 0,
+        .pid = getpid(),
+        .motor_id = motor,
+    };
+    struct _mcQueryString_args args = {
+        .inproc = true,
+        .query = query,
+        .value = *value
+    };
+    memcpy(message.payload, &args, sizeof(args));
+    mcQueryStringImpl(&message);
+    struct _mcQueryString_args * payload = (struct _mcQueryString_args *)(char *) message.payload;
+    memcpy(value, &payload->value, sizeof(String));
+    return payload->returned;
+}
+
+int mcQueryString(motor_t motor, motor_query_t query, OUT String * value) {
+    if (call_mode == MC_CALL_CROSS_PROCESS)
+        return mcQueryStringOutOfProc(motor,query,value);
+    else
+        return mcQueryStringInProc(motor,query,value);
+}
+
+
+int mcSearchOutOfProc(motor_t motor, String * driver, OUT String * results) {
+    if (driver == NULL) return -EINVAL;
+    if (results == NULL) return -EINVAL;
+    struct _mcSearch_args args = {
+        .outofproc = true,
+        .driver = *driver,
+        .results = *results
+    };
+    response_message_t response;
+    struct timespec * waittime = &timeout;
+    int size = mcMessageSendWait(motor, TYPE_mcSearch, &args,
+        sizeof args, PRIORITY_CMD, &response, waittime);
+
+    switch (size) {
+        case -ENOENT:
+        case -EAGAIN:
+            return -ER_NO_DAEMON;
+        case -ETIMEDOUT:
+            return -ER_DAEMON_BUSY;
+    }
+
+    struct _mcSearch_args * payload = (struct _mcSearch_args *)(char *) response.payload;
+
+    memcpy(results, &payload->results, sizeof(String));
+    return payload->returned;
+}
+
+int mcSearchInProc(motor_t motor, String * driver, OUT String * results) {
+    request_message_t message = {
+        .id = 0,
+        .pid = getpid(),
+        .motor_id = motor,
+    };
+    struct _mcSearch_args args = {
+        .inproc = true,
+        .driver = *driver,
+        .results = *results
+    };
+    memcpy(message.payload, &args, sizeof(args));
+    mcSearchImpl(&message);
+    struct _mcSearch_args * payload = (struct _mcSearch_args *)(char *) message.payload;
+    memcpy(results, &payload->results, sizeof(String));
+    return payload->returned;
+}
+
+int mcSearch(motor_t motor, String * driver, OUT String * results) {
+    if (call_mode == MC_CALL_CROSS_PROCESS)
+        return mcSearchOutOfProc(motor,driver,results);
+    else
+        return mcSearchInProc(motor,driver,results);
+}
+
+
+int mcSlewOutOfProc(motor_t motor, int rate) {
+    
+    struct _mcSlew_args args = {
+        .outofproc = true,
+        .rate = rate
+    };
+    response_message_t response;
+    struct timespec * waittime = &timeout;
+    int size = mcMessageSendWait(motor, TYPE_mcSlew, &args,
+        sizeof args, PRIORITY_CMD, &response, waittime);
+
+    switch (size) {
+        case -ENOENT:
+        case -EAGAIN:
+            return -ER_NO_DAEMON;
+        case -ETIMEDOUT:
+            return -ER_DAEMON_BUSY;
+    }
+
+    struct _mcSlew_args * payload = (struct _mcSlew_args *)(char *) response.payload;
+
+    
+    return payload->returned;
+}
+
+int mcSlewInProc(motor_t motor, int rate) {
+    request_message_t message = {
+        .id = 0,
+        .pid = getpid(),
+        .motor_id = motor,
+    };
+    struct _mcSlew_args args = {
+        .inproc = true,
+        .rate = rate
+    };
+    memcpy(message.payload, &args, sizeof(args));
+    mcSlewImpl(&message);
+    struct _mcSlew_args * payload = (struct _mcSlew_args *)(char *) message.payload;
+    
+    return payload->returned;
+}
+
+int mcSlew(motor_t motor, int rate) {
+    if (call_mode == MC_CALL_CROSS_PROCESS)
+        return mcSlewOutOfProc(motor,rate);
+    else
+        return mcSlewInProc(motor,rate);
+}
+
+
+int mcSlewUnitsOutOfProc(motor_t motor, int rate, unit_type_t units) {
+    
+    struct _mcSlewUnits_args args = {
+        .outofproc = true,
+        .rate = rate,
+        .units = units
+    };
+    response_message_t response;
+    struct timespec * waittime = &timeout;
+    int size = mcMessageSendWait(motor, TYPE_mcSlewUnits, &args,
+        sizeof args, PRIORITY_CMD, &response, waittime);
+
+    switch (size) {
+        case -ENOENT:
+        case -EAGAIN:
+            return -ER_NO_DAEMON;
+        case -ETIMEDOUT:
+            return -ER_DAEMON_BUSY;
+    }
+
+    struct _mcSlewUnits_args * payload = (struct _mcSlewUnits_args *)(char *) response.payload;
+
+    
+    return payload->returned;
+}
+
+int mcSlewUnitsInProc(motor_t motor, int rate, unit_type_t units) {
+    request_message_t message = {
+        .id = 0,
+        .pid = getpid(),
+        .motor_id = motor,
+    };
+    struct _mcSlewUnits_args args = {
+        .inproc = true,
+        .rate = rate,
+        .units = units
+    };
+    memcpy(message.payload, &args, sizeof(args));
+    mcSlewUnitsImpl(&message);
+    struct _mcSlewUnits_args * payload = (struct _mcSlewUnits_args *)(char *) message.payload;
+    
+    return payload->returned;
+}
+
+int mcSlewUnits(motor_t motor, int rate, unit_type_t units) {
+    if (call_mode == MC_CALL_CROSS_PROCESS)
+        return mcSlewUnitsOutOfProc(motor,rate,units);
+    else
+        return mcSlewUnitsInProc(motor,rate,units);
+}
+
+
+int mcStopOutOfProc(motor_t motor) {
+    
+    struct _mcStop_args args = {
+        .outofproc = true,
+        
+    };
+    response_message_t response;
+    struct timespec * waittime = &timeout;
+    int size = mcMessageSendWait(motor, TYPE_mcStop, &args,
+        sizeof args, PRIORITY_HIGH, &response, waittime);
+
+    switch (size) {
+        case -ENOENT:
+        case -EAGAIN:
+            return -ER_NO_DAEMON;
+        case -ETIMEDOUT:
+            return -ER_DAEMON_BUSY;
+    }
+
+    struct _mcStop_args * payload = (struct _mcStop_args *)(char *) response.payload;
+
+    
+    return payload->returned;
+}
+
+int mcStopInProc(motor_t motor) {
+    request_message_t message = {
+        .id = 0,
+        .pid = getpid(),
+        .motor_id = motor,
+    };
+    struct _mcStop_args args = {
+        .inproc = true,
+        
+    };
+    memcpy(message.payload, &args, sizeof(args));
+    mcStopImpl(&message);
+    struct _mcStop_args * payload = (struct _mcStop_args *)(char *) message.payload;
+    
+    return payload->returned;
+}
+
+int mcStop(motor_t motor) {
+    if (call_mode == MC_CALL_CROSS_PROCESS)
+        return mcStopOutOfProc(motor);
+    else
+        return mcStopInProc(motor);
+}
+
+
+int mcTraceChannelEnumOutOfProc(motor_t motor, OUT String * channels) {
+    if (channels == NULL) return -EINVAL;
+    struct _mcTraceChannelEnum_args args = {
+        .outofproc = true,
+        .channels = *channels
+    };
+    response_message_t response;
+    struct timespec * waittime = &timeout;
+    int size = mcMessageSendWait(motor, TYPE_mcTraceChannelEnum, &args,
+        sizeof args, PRIORITY_CMD, &response, waittime);
+
+    switch (size) {
+        case -ENOENT:
+        case -EAGAIN:
+            return -ER_NO_DAEMON;
+        case -ETIMEDOUT:
+            return -ER_DAEMON_BUSY;
+    }
+
+    struct _mcTraceChannelEnum_args * payload = (struct _mcTraceChannelEnum_args *)(char *) response.payload;
+
+    memcpy(channels, &payload->channels, sizeof(String));
+    return payload->returned;
+}
+
+int mcTraceChannelEnumInProc(motor_t motor, OUT String * channels) {
+    request_message_t message = {
+        .id = 0,
+        .pid = getpid(),
+        .motor_id = motor,
+    };
+    struct _mcTraceChannelEnum_args args = {
+        .inproc = true,
+        .channels = *channels
+    };
+    memcpy(message.payload, &args, sizeof(args));
+    mcTraceChannelEnumImpl(&message);
+    struct _mcTraceChannelEnum_args * payload = (struct _mcTraceChannelEnum_args *)(char *) message.payload;
+    memcpy(channels, &payload->channels, sizeof(String));
+    return payload->returned;
+}
+
+int mcTraceChannelEnum(motor_t motor, OUT String * channels) {
+    if (call_mode == MC_CALL_CROSS_PROCESS)
+        return mcTraceChannelEnumOutOfProc(motor,channels);
+    else
+        return mcTraceChannelEnumInProc(motor,channels);
+}
+
+
+int mcTraceChannelGetNameRemoteOutOfProc(motor_t motor, int id, OUT String * buffer) {
+    if (buffer == NULL) return -EINVAL;
+    struct _mcTraceChannelGetNameRemote_args args = {
+        .outofproc = true,
+        .id = id,
+        .buffer = *buffer
+    };
+    response_message_t response;
+    struct timespec * waittime = &timeout;
+    int size = mcMessageSendWait(motor, TYPE_mcTraceChannelGetNameRemote, &args,
+        sizeof args, PRIORITY_CMD, &response, waittime);
+
+    switch (size) {
+        case -ENOENT:
+        case -EAGAIN:
+            return -ER_NO_DAEMON;
+        case -ETIMEDOUT:
+            return -ER_DAEMON_BUSY;
+    }
+
+    struct _mcTraceChannelGetNameRemote_args * payload = (struct _mcTraceChannelGetNameRemote_args *)(char *) response.payload;
+
+    memcpy(buffer, &payload->buffer, sizeof(String));
+    return payload->returned;
+}
+
+int mcTraceChannelGetNameRemoteInProc(motor_t motor, int id, OUT String * buffer) {
+    request_message_t message = {
+        .id = 0,
+        .pid = getpid(),
+        .motor_id = motor,
+    };
+    struct _mcTraceChannelGetNameRemote_args args = {
+        .inproc = true,
+        .id = id,
+        .buffer = *buffer
+    };
+    memcpy(message.payload, &args, sizeof(args));
+    mcTraceChannelGetNameRemoteImpl(&message);
+    struct _mcTraceChannelGetNameRemote_args * payload = (struct _mcTraceChannelGetNameRemote_args *)(char *) message.payload;
+    memcpy(buffer, &payload->buffer, sizeof(String));
+    return payload->returned;
+}
+
+int mcTraceChannelGetNameRemote(motor_t motor, int id, OUT String * buffer) {
+    if (call_mode == MC_CALL_CROSS_PROCESS)
+        return mcTraceChannelGetNameRemoteOutOfProc(motor,id,buffer);
+    else
+        return mcTraceChannelGetNameRemoteInProc(motor,id,buffer);
+}
+
+
+int mcTraceChannelLookupRemoteOutOfProc(motor_t motor, String * buffer, OUT int * id) {
+    if (buffer == NULL) return -EINVAL;
+    if (id == NULL) return -EINVAL;
+    struct _mcTraceChannelLookupRemote_args args = {
+        .outofproc = true,
+        .buffer = *buffer,
+        .id = *id
+    };
+    response_message_t response;
+    struct timespec * waittime = &timeout;
+    int size = mcMessageSendWait(motor, TYPE_mcTraceChannelLookupRemote, &args,
+        sizeof args, PRIORITY_CMD, &response, waittime);
+
+    switch (size) {
+        case -ENOENT:
+        case -EAGAIN:
+            return -ER_NO_DAEMON;
+        case -ETIMEDOUT:
+            return -ER_DAEMON_BUSY;
+    }
+
+    struct _mcTraceChannelLookupRemote_args * payload = (struct _mcTraceChannelLookupRemote_args *)(char *) response.payload;
+
+    memcpy(id, &payload->id, sizeof(int));
+    return payload->returned;
+}
+
+int mcTraceChannelLookupRemoteInProc(motor_t motor, String * buffer, OUT int * id) {
+    request_message_t message = {
+        .id = 0,
+        .pid = getpid(),
+        .motor_id = motor,
+    };
+    struct _mcTraceChannelLookupRemote_args args = {
+        .inproc = true,
+        .buffer = *buffer,
+        .id = *id
+    };
+    memcpy(message.payload, &args, sizeof(args));
+    mcTraceChannelLookupRemoteImpl(&message);
+    struct _mcTraceChannelLookupRemote_args * payload = (struct _mcTraceChannelLookupRemote_args *)(char *) message.payload;
+    memcpy(id, &payload->id, sizeof(int));
+    return payload->returned;
+}
+
+int mcTraceChannelLookupRemote(motor_t motor, String * buffer, OUT int * id) {
+    if (call_mode == MC_CALL_CROSS_PROCESS)
+        return mcTraceChannelLookupRemoteOutOfProc(motor,buffer,id);
+    else
+        return mcTraceChannelLookupRemoteInProc(motor,buffer,id);
+}
+
+
+int mcTraceSubscribeAddOutOfProc(motor_t motor, int id, String * name) {
+    if (name == NULL) return -EINVAL;
+    struct _mcTraceSubscribeAdd_args args = {
+        .outofproc = true,
+        .id = id,
+        .name = *name
+    };
+    response_message_t response;
+    struct timespec * waittime = &timeout;
+    int size = mcMessageSendWait(motor, TYPE_mcTraceSubscribeAdd, &args,
+        sizeof args, PRIORITY_CMD, &response, waittime);
+
+    switch (size) {
+        case -ENOENT:
+        case -EAGAIN:
+            return -ER_NO_DAEMON;
+        case -ETIMEDOUT:
+            return -ER_DAEMON_BUSY;
+    }
+
+    struct _mcTraceSubscribeAdd_args * payload = (struct _mcTraceSubscribeAdd_args *)(char *) response.payload;
+
+    
+    return payload->returned;
+}
+
+int mcTraceSubscribeAddInProc(motor_t motor, int id, String * name) {
+    request_message_t message = {
+        .id = 0,
+        .pid = getpid(),
+        .motor_id = motor,
+    };
+    struct _mcTraceSubscribeAdd_args args = {
+        .inproc = true,
+        .id = id,
+        .name = *name
+    };
+    memcpy(message.payload, &args, sizeof(args));
+    mcTraceSubscribeAddImpl(&message);
+    struct _mcTraceSubscribeAdd_args * payload = (struct _mcTraceSubscribeAdd_args *)(char *) message.payload;
+    
+    return payload->returned;
+}
+
+int mcTraceSubscribeAdd(motor_t motor, int id, String * name) {
+    if (call_mode == MC_CALL_CROSS_PROCESS)
+        return mcTraceSubscribeAddOutOfProc(motor,id,name);
+    else
+        return mcTraceSubscribeAddInProc(motor,id,name);
+}
+
+
+int mcTraceSubscribeRemoteOutOfProc(motor_t motor, int level, unsigned 
+    long long mask) {
+    
+    struct _mcTraceSubscribeRemote_args args = {
+        .outofproc = true,
+        .level = level,
+        .mask = mask
+    };
+    response_message_t response;
+    struct timespec * waittime = &timeout;
+    int size = mcMessageSendWait(motor, TYPE_mcTraceSubscribeRemote, &args,
+        sizeof args, PRIORITY_CMD, &response, waittime);
+
+    switch (size) {
+        case -ENOENT:
+        case -EAGAIN:
+            return -ER_NO_DAEMON;
+        case -ETIMEDOUT:
+            return -ER_DAEMON_BUSY;
+    }
+
+    struct _mcTraceSubscribeRemote_args * payload = (struct _mcTraceSubscribeRemote_args *)(char *) response.payload;
+
+    
+    return payload->returned;
+}
+
+int mcTraceSubscribeRemoteInProc(motor_t motor, int level, unsigned 
+    long long mask) {
+    request_message_t message = {
+        .id = 0,
+        .pid = getpid(),
+        .motor_id = motor,
+    };
+    struct _mcTraceSubscribeRemote_args args = {
+        .inproc = true,
+        .level = level,
+        .mask = mask
+    };
+    memcpy(message.payload, &args, sizeof(args));
+    mcTraceSubscribeRemoteImpl(&message);
+    struct _mcTraceSubscribeRemote_args * payload = (struct _mcTraceSubscribeRemote_args *)(char *) message.payload;
+    
+    return payload->returned;
+}
+
+int mcTraceSubscribeRemote(motor_t motor, int level, unsigned 
+    long long mask) {
+    if (call_mode == MC_CALL_CROSS_PROCESS)
+        return mcTraceSubscribeRemoteOutOfProc(motor,level,mask);
+    else
+        return mcTraceSubscribeRemoteInProc(motor,level,mask);
+}
+
+
+int mcTraceSubscribeRemoveOutOfProc(motor_t motor, int id, String * name) {
+    if (name == NULL) return -EINVAL;
+    struct _mcTraceSubscribeRemove_args args = {
+        .outofproc = true,
+        .id = id,
+        .name = *name
+    };
+    response_message_t response;
+    struct timespec * waittime = &timeout;
+    int size = mcMessageSendWait(motor, TYPE_mcTraceSubscribeRemove, &args,
+        sizeof args, PRIORITY_CMD, &response, waittime);
+
+    switch (size) {
+        case -ENOENT:
+        case -EAGAIN:
+            return -ER_NO_DAEMON;
+        case -ETIMEDOUT:
+            return -ER_DAEMON_BUSY;
+    }
+
+    struct _mcTraceSubscribeRemove_args * payload = (struct _mcTraceSubscribeRemove_args *)(char *) response.payload;
+
+    
+    return payload->returned;
+}
+
+int mcTraceSubscribeRemoveInProc(motor_t motor, int id, String * name) {
+    request_message_t message = {
+        .id = 0,
+        .pid = getpid(),
+        .motor_id = motor,
+    };
+    struct _mcTraceSubscribeRemove_args args = {
+        .inproc = true,
+        .id = id,
+        .name = *name
+    };
+    memcpy(message.payload, &args, sizeof(args));
+    mcTraceSubscribeRemoveImpl(&message);
+    struct _mcTraceSubscribeRemove_args * payload = (struct _mcTraceSubscribeRemove_args *)(char *) message.payload;
+    
+    return payload->returned;
+}
+
+int mcTraceSubscribeRemove(motor_t motor, int id, String * name) {
+    if (call_mode == MC_CALL_CROSS_PROCESS)
+        return mcTraceSubscribeRemoveOutOfProc(motor,id,name);
+    else
+        return mcTraceSubscribeRemoveInProc(motor,id,name);
+}
+
+
+int mcTraceUnsubscribeRemoteOutOfProc(motor_t motor, int id) {
+    
+    struct _mcTraceUnsubscribeRemote_args args = {
+        .outofproc = true,
+        .id = id
+    };
+    response_message_t response;
+    struct timespec * waittime = &timeout;
+    int size = mcMessageSendWait(motor, TYPE_mcTraceUnsubscribeRemote, &args,
+        sizeof args, PRIORITY_CMD, &response, waittime);
+
+    switch (size) {
+        case -ENOENT:
+        case -EAGAIN:
+            return -ER_NO_DAEMON;
+        case -ETIMEDOUT:
+            return -ER_DAEMON_BUSY;
+    }
+
+    struct _mcTraceUnsubscribeRemote_args * payload = (struct _mcTraceUnsubscribeRemote_args *)(char *) response.payload;
+
+    
+    return payload->returned;
+}
+
+int mcTraceUnsubscribeRemoteInProc(motor_t motor, int id) {
+    request_message_t message = {
+        .id = 0,
+        .pid = getpid(),
+        .motor_id = motor,
+    };
+    struct _mcTraceUnsubscribeRemote_args args = {
+        .inproc = true,
+        .id = id
+    };
+    memcpy(message.payload, &args, sizeof(args));
+    mcTraceUnsubscribeRemoteImpl(&message);
+    struct _mcTraceUnsubscribeRemote_args * payload = (struct _mcTraceUnsubscribeRemote_args *)(char *) message.payload;
+    
+    return payload->returned;
+}
+
+int mcTraceUnsubscribeRemote(motor_t motor, int id) {
+    if (call_mode == MC_CALL_CROSS_PROCESS)
+        return mcTraceUnsubscribeRemoteOutOfProc(motor,id);
+    else
+        return mcTraceUnsubscribeRemoteInProc(motor,id);
+}
+
+
+int mcUnitScaleGetOutOfProc(motor_t motor, OUT unit_type_t * units, OUT long long * urevs) {
+    if (units == NULL) return -EINVAL;
+    if (urevs == NULL) return -EINVAL;
+    struct _mcUnitScaleGet_args args = {
+        .outofproc = true,
+        .units = *units,
+        .urevs = *urevs
+    };
+    response_message_t response;
+    struct timespec * waittime = &timeout;
+    int size = mcMessageSendWait(motor, TYPE_mcUnitScaleGet, &args,
+        sizeof args, PRIORITY_CMD, &response, waittime);
+
+    switch (size) {
+        case -ENOENT:
+        case -EAGAIN:
+            return -ER_NO_DAEMON;
+        case -ETIMEDOUT:
+            return -ER_DAEMON_BUSY;
+    }
+
+    struct _mcUnitScaleGet_args * payload = (struct _mcUnitScaleGet_args *)(char *) response.payload;
+
+    memcpy(units, &payload->units, sizeof(unit_type_t));
+    memcpy(urevs, &payload->urevs, sizeof(long long));
+    return payload->returned;
+}
+
+int mcUnitScaleGetInProc(motor_t motor, OUT unit_type_t * units, OUT long long * urevs) {
+    request_message_t message = {
+        .id = 0,
+        .pid = getpid(),
+        .motor_id = motor,
+    };
+    struct _mcUnitScaleGet_args args = {
+        .inproc = true,
+        .units = *units,
+        .urevs = *urevs
+    };
+    memcpy(message.payload, &args, sizeof(args));
+    mcUnitScaleGetImpl(&message);
+    struct _mcUnitScaleGet_args * payload = (struct _mcUnitScaleGet_args *)(char *) message.payload;
+    memcpy(units, &payload->units, sizeof(unit_type_t));
+    memcpy(urevs, &payload->urevs, sizeof(long long));
+    return payload->returned;
+}
+
+int mcUnitScaleGet(motor_t motor, OUT unit_type_t * units, OUT long long * urevs) {
+    if (call_mode == MC_CALL_CROSS_PROCESS)
+        return mcUnitScaleGetOutOfProc(motor,units,urevs);
+    else
+        return mcUnitScaleGetInProc(motor,units,urevs);
+}
+
+
+int mcUnitScaleSetOutOfProc(motor_t motor, unit_type_t units, long long urevs) {
+    
+    struct _mcUnitScaleSet_args args = {
+        .outofproc = true,
+        .units = units,
+        .urevs = urevs
+    };
+    response_message_t response;
+    struct timespec * waittime = &timeout;
+    int size = mcMessageSendWait(motor, TYPE_mcUnitScaleSet, &args,
+        sizeof args, PRIORITY_CMD, &response, waittime);
+
+    switch (size) {
+        case -ENOENT:
+        case -EAGAIN:
+            return -ER_NO_DAEMON;
+        case -ETIMEDOUT:
+            return -ER_DAEMON_BUSY;
+    }
+
+    struct _mcUnitScaleSet_args * payload = (struct _mcUnitScaleSet_args *)(char *) response.payload;
+
+    
+    return payload->returned;
+}
+
+int mcUnitScaleSetInProc(motor_t motor, unit_type_t units, long long urevs) {
+    request_message_t message = {
+        .id = 0,
+        .pid = getpid(),
+        .motor_id = motor,
+    };
+    struct _mcUnitScaleSet_args args = {
+        .inproc = true,
+        .units = units,
+        .urevs = urevs
+    };
+    memcpy(message.payload, &args, sizeof(args));
+    mcUnitScaleSetImpl(&message);
+    struct _mcUnitScaleSet_args * payload = (struct _mcUnitScaleSet_args *)(char *) message.payload;
+    
+    return payload->returned;
+}
+
+int mcUnitScaleSet(motor_t motor, unit_type_t units, long long urevs) {
+    if (call_mode == MC_CALL_CROSS_PROCESS)
+        return mcUnitScaleSetOutOfProc(motor,units,urevs);
+    else
+        return mcUnitScaleSetInProc(motor,units,urevs);
+}
+
+
+int mcUnitToMicroRevsOutOfProc(motor_t motor, unit_type_t unit, OUT long long * urevs) {
+    if (urevs == NULL) return -EINVAL;
+    struct _mcUnitToMicroRevs_args args = {
+        .outofproc = true,
+        .unit = unit,
+        .urevs = *urevs
+    };
+    response_message_t response;
+    struct timespec * waittime = &timeout;
+    int size = mcMessageSendWait(motor, TYPE_mcUnitToMicroRevs, &args,
+        sizeof args, PRIORITY_CMD, &response, waittime);
+
+    switch (size) {
+        case -ENOENT:
+        case -EAGAIN:
+            return -ER_NO_DAEMON;
+        case -ETIMEDOUT:
+            return -ER_DAEMON_BUSY;
+    }
+
+    struct _mcUnitToMicroRevs_args * payload = (struct _mcUnitToMicroRevs_args *)(char *) response.payload;
+
+    memcpy(urevs, &payload->urevs, sizeof(long long));
+    return payload->returned;
+}
+
+int mcUnitToMicroRevsInProc(motor_t motor, unit_type_t unit, OUT long long * urevs) {
+    request_message_t message = {
+        .id = 0,
+        .pid = getpid(),
+        .motor_id = motor,
+    };
+    struct _mcUnitToMicroRevs_args args = {
+        .inproc = true,
+        .unit = unit,
+        .urevs = *urevs
+    };
+    memcpy(message.payload, &args, sizeof(args));
+    mcUnitToMicroRevsImpl(&message);
+    struct _mcUnitToMicroRevs_args * payload = (struct _mcUnitToMicroRevs_args *)(char *) message.payload;
+    memcpy(urevs, &payload->urevs, sizeof(long long));
+    return payload->returned;
+}
+
+int mcUnitToMicroRevs(motor_t motor, unit_type_t unit, OUT long long * urevs) {
+    if (call_mode == MC_CALL_CROSS_PROCESS)
+        return mcUnitToMicroRevsOutOfProc(motor,unit,urevs);
+    else
+        return mcUnitToMicroRevsInProc(motor,unit,urevs);
+}
+
@@ -0,0 +1,693 @@
+
+/**
+ ** Automatically generated file -- do not modify directly
+ **
+ ** This file is generated by client.h.py which will compile the list of
+ ** exported proxy functions from the given header files.
+ **
+ **/
+
+#include <stdbool.h>
+#include <stdlib.h>
+
+#include "../drivers/driver.h"
+#include "../motor.h"
+#include "message.h"
+
+extern void mcClientTimeoutSet(const struct timespec *, struct timespec *);
+
+enum mcCallMode {
+    MC_CALL_CROSS_PROCESS,
+    MC_CALL_IN_PROCESS,
+};
+
+extern enum mcCallMode mcClientCallModeGet(void);
+extern void mcClientCallModeSet(enum mcCallMode);
+
+#include "query.h"
+#include "locks.h"
+#include "motor.h"
+#include "motion.h"
+#include "events.h"
+#include "profile.h"
+#include "trace.h"
+#include "firmware.h"
+
+struct _mcConnect_args {
+    bool inproc;        // If the call is made in-process (server-server)
+    bool outofproc;     // If the call is made out-of-process (client-server)
+    int returned;
+    String  connection;
+    MOTOR motor_t  motor;
+    bool recovery;
+};
+extern int mcConnect( String * connection, OUT MOTOR motor_t * motor,
+    bool recovery);
+extern int mcConnectInProc( String * connection, OUT MOTOR motor_t * motor,
+    bool recovery);
+extern int mcConnectOutOfProc( String * connection, OUT MOTOR motor_t * motor,
+    bool recovery);
+
+
+struct _mcDisconnect_args {
+    bool inproc;        // If the call is made in-process (server-server)
+    bool outofproc;     // If the call is made out-of-process (client-server)
+    int returned;
+    
+};
+extern int mcDisconnect(motor_t motor);
+extern int mcDisconnectInProc(motor_t motor);
+extern int mcDisconnectOutOfProc(motor_t motor);
+
+
+struct _mcEStop_args {
+    bool inproc;        // If the call is made in-process (server-server)
+    bool outofproc;     // If the call is made out-of-process (client-server)
+    int returned;
+    
+};
+extern int mcEStop(motor_t motor);
+extern int mcEStopInProc(motor_t motor);
+extern int mcEStopOutOfProc(motor_t motor);
+
+
+struct _mcEventRegister_args {
+    bool inproc;        // If the call is made in-process (server-server)
+    bool outofproc;     // If the call is made out-of-process (client-server)
+    int returned;
+    int event;
+};
+extern int mcEventRegister(motor_t motor, int event);
+extern int mcEventRegisterInProc(motor_t motor, int event);
+extern int mcEventRegisterOutOfProc(motor_t motor, int event);
+
+
+struct _mcEventUnregister_args {
+    bool inproc;        // If the call is made in-process (server-server)
+    bool outofproc;     // If the call is made out-of-process (client-server)
+    int returned;
+    int event;
+};
+extern int mcEventUnregister(motor_t motor, int event);
+extern int mcEventUnregisterInProc(motor_t motor, int event);
+extern int mcEventUnregisterOutOfProc(motor_t motor, int event);
+
+
+struct _mcFirmwareLoad_args {
+    bool inproc;        // If the call is made in-process (server-server)
+    bool outofproc;     // If the call is made out-of-process (client-server)
+    int returned;
+    String  filename;
+};
+extern int mcFirmwareLoad(motor_t motor, String * filename);
+extern int mcFirmwareLoadInProc(motor_t motor, String * filename);
+extern int mcFirmwareLoadOutOfProc(motor_t motor, String * filename);
+
+
+struct _mcHalt_args {
+    bool inproc;        // If the call is made in-process (server-server)
+    bool outofproc;     // If the call is made out-of-process (client-server)
+    int returned;
+    
+};
+extern int mcHalt(motor_t motor);
+extern int mcHaltInProc(motor_t motor);
+extern int mcHaltOutOfProc(motor_t motor);
+
+
+struct _mcHome_args {
+    bool inproc;        // If the call is made in-process (server-server)
+    bool outofproc;     // If the call is made out-of-process (client-server)
+    int returned;
+    enum home_type type;
+    enum home_direction direction;
+};
+extern int mcHome(motor_t motor, enum home_type type, enum home_direction direction);
+extern int mcHomeInProc(motor_t motor, enum home_type type, enum home_direction direction);
+extern int mcHomeOutOfProc(motor_t motor, enum home_type type, enum home_direction direction);
+
+
+struct _mcMicrocodeLoad_args {
+    bool inproc;        // If the call is made in-process (server-server)
+    bool outofproc;     // If the call is made out-of-process (client-server)
+    int returned;
+    String  filename;
+};
+extern int mcMicrocodeLoad(motor_t motor, String * filename);
+extern int mcMicrocodeLoadInProc(motor_t motor, String * filename);
+extern int mcMicrocodeLoadOutOfProc(motor_t motor, String * filename);
+
+
+struct _mcMotorIsLocked_args {
+    bool inproc;        // If the call is made in-process (server-server)
+    bool outofproc;     // If the call is made out-of-process (client-server)
+    bool returned;
+    
+};
+extern bool mcMotorIsLocked(motor_t motor);
+extern bool mcMotorIsLockedInProc(motor_t motor);
+extern bool mcMotorIsLockedOutOfProc(motor_t motor);
+
+
+struct _mcMotorLock_args {
+    bool inproc;        // If the call is made in-process (server-server)
+    bool outofproc;     // If the call is made out-of-process (client-server)
+    int returned;
+    int for_motor_id;
+    lock_mode_t mode;
+};
+extern int mcMotorLock(motor_t motor, int for_motor_id, lock_mode_t mode);
+extern int mcMotorLockInProc(motor_t motor, int for_motor_id, lock_mode_t mode);
+extern int mcMotorLockOutOfProc(motor_t motor, int for_motor_id, lock_mode_t mode);
+
+
+struct _mcMotorUnlock_args {
+    bool inproc;        // If the call is made in-process (server-server)
+    bool outofproc;     // If the call is made out-of-process (client-server)
+    int returned;
+    int for_motor_id;
+};
+extern int mcMotorUnlock(motor_t motor, int for_motor_id);
+extern int mcMotorUnlockInProc(motor_t motor, int for_motor_id);
+extern int mcMotorUnlockOutOfProc(motor_t motor, int for_motor_id);
+
+
+struct _mcMoveAbsolute_args {
+    bool inproc;        // If the call is made in-process (server-server)
+    bool outofproc;     // If the call is made out-of-process (client-server)
+    int returned;
+    int distance;
+};
+extern int mcMoveAbsolute(motor_t motor, int distance);
+extern int mcMoveAbsoluteInProc(motor_t motor, int distance);
+extern int mcMoveAbsoluteOutOfProc(motor_t motor, int distance);
+
+
+struct _mcMoveAbsoluteUnits_args {
+    bool inproc;        // If the call is made in-process (server-server)
+    bool outofproc;     // If the call is made out-of-process (client-server)
+    int returned;
+    int distance;
+    unit_type_t units;
+};
+extern int mcMoveAbsoluteUnits(motor_t motor, int distance, unit_type_t units);
+extern int mcMoveAbsoluteUnitsInProc(motor_t motor, int distance, unit_type_t units);
+extern int mcMoveAbsoluteUnitsOutOfProc(motor_t motor, int distance, unit_type_t units);
+
+
+struct _mcMoveRelative_args {
+    bool inproc;        // If the call is made in-process (server-server)
+    bool outofproc;     // If the call is made out-of-process (client-server)
+    int returned;
+    int distance;
+};
+extern int mcMoveRelative(motor_t motor, int distance);
+extern int mcMoveRelativeInProc(motor_t motor, int distance);
+extern int mcMoveRelativeOutOfProc(motor_t motor, int distance);
+
+
+struct _mcMoveRelativeUnits_args {
+    bool inproc;        // If the call is made in-process (server-server)
+    bool outofproc;     // If the call is made out-of-process (client-server)
+    int returned;
+    int distance;
+    unit_type_t units;
+};
+extern int mcMoveRelativeUnits(motor_t motor, int distance, unit_type_t units);
+extern int mcMoveRelativeUnitsInProc(motor_t motor, int distance, unit_type_t units);
+extern int mcMoveRelativeUnitsOutOfProc(motor_t motor, int distance, unit_type_t units);
+
+
+struct _mcPokeInteger_args {
+    bool inproc;        // If the call is made in-process (server-server)
+    bool outofproc;     // If the call is made out-of-process (client-server)
+    int returned;
+    motor_query_t query;
+    int value;
+};
+extern int mcPokeInteger(motor_t motor, motor_query_t query, int value);
+extern int mcPokeIntegerInProc(motor_t motor, motor_query_t query, int value);
+extern int mcPokeIntegerOutOfProc(motor_t motor, motor_query_t query, int value);
+
+
+struct _mcPokeIntegerUnits_args {
+    bool inproc;        // If the call is made in-process (server-server)
+    bool outofproc;     // If the call is made out-of-process (client-server)
+    int returned;
+    motor_query_t query;
+    int value;
+    unit_type_t units;
+};
+extern int mcPokeIntegerUnits(motor_t motor, motor_query_t query, int value,
+    unit_type_t units);
+extern int mcPokeIntegerUnitsInProc(motor_t motor, motor_query_t query, int value,
+    unit_type_t units);
+extern int mcPokeIntegerUnitsOutOfProc(motor_t motor, motor_query_t query, int value,
+    unit_type_t units);
+
+
+struct _mcPokeIntegerWithIntegerItem_args {
+    bool inproc;        // If the call is made in-process (server-server)
+    bool outofproc;     // If the call is made out-of-process (client-server)
+    int returned;
+    motor_query_t query;
+    int value;
+    int item;
+};
+extern int mcPokeIntegerWithIntegerItem(motor_t motor, motor_query_t query, int value,
+    int item);
+extern int mcPokeIntegerWithIntegerItemInProc(motor_t motor, motor_query_t query, int value,
+    int item);
+extern int mcPokeIntegerWithIntegerItemOutOfProc(motor_t motor, motor_query_t query, int value,
+    int item);
+
+
+struct _mcPokeIntegerWithStringItem_args {
+    bool inproc;        // If the call is made in-process (server-server)
+    bool outofproc;     // If the call is made out-of-process (client-server)
+    int returned;
+    motor_query_t query;
+    int value;
+    String  item;
+};
+extern int mcPokeIntegerWithStringItem(motor_t motor, motor_query_t query, int value,
+    String * item);
+extern int mcPokeIntegerWithStringItemInProc(motor_t motor, motor_query_t query, int value,
+    String * item);
+extern int mcPokeIntegerWithStringItemOutOfProc(motor_t motor, motor_query_t query, int value,
+    String * item);
+
+
+struct _mcPokeString_args {
+    bool inproc;        // If the call is made in-process (server-server)
+    bool outofproc;     // If the call is made out-of-process (client-server)
+    int returned;
+    motor_query_t query;
+    String  value;
+};
+extern int mcPokeString(motor_t motor, motor_query_t query, String * value);
+extern int mcPokeStringInProc(motor_t motor, motor_query_t query, String * value);
+extern int mcPokeStringOutOfProc(motor_t motor, motor_query_t query, String * value);
+
+
+struct _mcPokeStringWithStringItem_args {
+    bool inproc;        // If the call is made in-process (server-server)
+    bool outofproc;     // If the call is made out-of-process (client-server)
+    int returned;
+    motor_query_t query;
+    String  value;
+    String  item;
+};
+extern int mcPokeStringWithStringItem(motor_t motor, motor_query_t query,
+    String * value, String * item);
+extern int mcPokeStringWithStringItemInProc(motor_t motor, motor_query_t query,
+    String * value, String * item);
+extern int mcPokeStringWithStringItemOutOfProc(motor_t motor, motor_query_t query,
+    String * value, String * item);
+
+
+struct _mcProfileGet_args {
+    bool inproc;        // If the call is made in-process (server-server)
+    bool outofproc;     // If the call is made out-of-process (client-server)
+    int returned;
+    Profile  profile;
+};
+extern int mcProfileGet(motor_t motor, OUT Profile * profile);
+extern int mcProfileGetInProc(motor_t motor, OUT Profile * profile);
+extern int mcProfileGetOutOfProc(motor_t motor, OUT Profile * profile);
+
+
+struct _mcProfileGetAccel_args {
+    bool inproc;        // If the call is made in-process (server-server)
+    bool outofproc;     // If the call is made out-of-process (client-server)
+    int returned;
+    Profile  profile;
+    unit_type_t units;
+    int  value;
+};
+extern int mcProfileGetAccel(motor_t motor, Profile * profile, unit_type_t units,
+    OUT int * value);
+extern int mcProfileGetAccelInProc(motor_t motor, Profile * profile, unit_type_t units,
+    OUT int * value);
+extern int mcProfileGetAccelOutOfProc(motor_t motor, Profile * profile, unit_type_t units,
+    OUT int * value);
+
+
+struct _mcProfileGetDeadband_args {
+    bool inproc;        // If the call is made in-process (server-server)
+    bool outofproc;     // If the call is made out-of-process (client-server)
+    int returned;
+    Profile  profile;
+    unit_type_t units;
+    int  value;
+};
+extern int mcProfileGetDeadband(motor_t motor, Profile * profile, unit_type_t units,
+    OUT int * value);
+extern int mcProfileGetDeadbandInProc(motor_t motor, Profile * profile, unit_type_t units,
+    OUT int * value);
+extern int mcProfileGetDeadbandOutOfProc(motor_t motor, Profile * profile, unit_type_t units,
+    OUT int * value);
+
+
+struct _mcProfileGetDecel_args {
+    bool inproc;        // If the call is made in-process (server-server)
+    bool outofproc;     // If the call is made out-of-process (client-server)
+    int returned;
+    Profile  profile;
+    unit_type_t units;
+    int  value;
+};
+extern int mcProfileGetDecel(motor_t motor, Profile * profile, unit_type_t units,
+    OUT int * value);
+extern int mcProfileGetDecelInProc(motor_t motor, Profile * profile, unit_type_t units,
+    OUT int * value);
+extern int mcProfileGetDecelOutOfProc(motor_t motor, Profile * profile, unit_type_t units,
+    OUT int * value);
+
+
+struct _mcProfileGetInitialV_args {
+    bool inproc;        // If the call is made in-process (server-server)
+    bool outofproc;     // If the call is made out-of-process (client-server)
+    int returned;
+    Profile  profile;
+    unit_type_t units;
+    int  value;
+};
+extern int mcProfileGetInitialV(motor_t motor, Profile * profile, unit_type_t units,
+    OUT int * value);
+extern int mcProfileGetInitialVInProc(motor_t motor, Profile * profile, unit_type_t units,
+    OUT int * value);
+extern int mcProfileGetInitialVOutOfProc(motor_t motor, Profile * profile, unit_type_t units,
+    OUT int * value);
+
+
+struct _mcProfileGetMaxSlip_args {
+    bool inproc;        // If the call is made in-process (server-server)
+    bool outofproc;     // If the call is made out-of-process (client-server)
+    int returned;
+    Profile  profile;
+    unit_type_t units;
+    int  value;
+};
+extern int mcProfileGetMaxSlip(motor_t motor, Profile * profile, unit_type_t units,
+    OUT int * value);
+extern int mcProfileGetMaxSlipInProc(motor_t motor, Profile * profile, unit_type_t units,
+    OUT int * value);
+extern int mcProfileGetMaxSlipOutOfProc(motor_t motor, Profile * profile, unit_type_t units,
+    OUT int * value);
+
+
+struct _mcProfileGetMaxV_args {
+    bool inproc;        // If the call is made in-process (server-server)
+    bool outofproc;     // If the call is made out-of-process (client-server)
+    int returned;
+    Profile  profile;
+    unit_type_t units;
+    int  value;
+};
+extern int mcProfileGetMaxV(motor_t motor, Profile * profile, unit_type_t units,
+    OUT int * value);
+extern int mcProfileGetMaxVInProc(motor_t motor, Profile * profile, unit_type_t units,
+    OUT int * value);
+extern int mcProfileGetMaxVOutOfProc(motor_t motor, Profile * profile, unit_type_t units,
+    OUT int * value);
+
+
+struct _mcProfileSet_args {
+    bool inproc;        // If the call is made in-process (server-server)
+    bool outofproc;     // If the call is made out-of-process (client-server)
+    int returned;
+    Profile  profile;
+};
+extern int mcProfileSet(motor_t motor, Profile * profile);
+extern int mcProfileSetInProc(motor_t motor, Profile * profile);
+extern int mcProfileSetOutOfProc(motor_t motor, Profile * profile);
+
+
+struct _mcQueryFloat_args {
+    bool inproc;        // If the call is made in-process (server-server)
+    bool outofproc;     // If the call is made out-of-process (client-server)
+    int returned;
+    motor_query_t query;
+    double  value;
+};
+extern int mcQueryFloat(motor_t motor, motor_query_t query, OUT double * value);
+extern int mcQueryFloatInProc(motor_t motor, motor_query_t query, OUT double * value);
+extern int mcQueryFloatOutOfProc(motor_t motor, motor_query_t query, OUT double * value);
+
+
+struct _mcQueryFloatUnits_args {
+    bool inproc;        // If the call is made in-process (server-server)
+    bool outofproc;     // If the call is made out-of-process (client-server)
+    int returned;
+    motor_query_t query;
+    double  value;
+    unit_type_t units;
+};
+extern int mcQueryFloatUnits(motor_t motor, motor_query_t query, OUT double * value,
+    unit_type_t units);
+extern int mcQueryFloatUnitsInProc(motor_t motor, motor_query_t query, OUT double * value,
+    unit_type_t units);
+extern int mcQueryFloatUnitsOutOfProc(motor_t motor, motor_query_t query, OUT double * value,
+    unit_type_t units);
+
+
+struct _mcQueryInteger_args {
+    bool inproc;        // If the call is made in-process (server-server)
+    bool outofproc;     // If the call is made out-of-process (client-server)
+    int returned;
+    motor_query_t query;
+    int  value;
+};
+extern int mcQueryInteger(motor_t motor, motor_query_t query, OUT int * value);
+extern int mcQueryIntegerInProc(motor_t motor, motor_query_t query, OUT int * value);
+extern int mcQueryIntegerOutOfProc(motor_t motor, motor_query_t query, OUT int * value);
+
+
+struct _mcQueryIntegerUnits_args {
+    bool inproc;        // If the call is made in-process (server-server)
+    bool outofproc;     // If the call is made out-of-process (client-server)
+    int returned;
+    motor_query_t query;
+    int  value;
+    unit_type_t units;
+};
+extern int mcQueryIntegerUnits(motor_t motor, motor_query_t query, OUT int * value,
+    unit_type_t units);
+extern int mcQueryIntegerUnitsInProc(motor_t motor, motor_query_t query, OUT int * value,
+    unit_type_t units);
+extern int mcQueryIntegerUnitsOutOfProc(motor_t motor, motor_query_t query, OUT int * value,
+    unit_type_t units);
+
+
+struct _mcQueryIntegerWithIntegerItem_args {
+    bool inproc;        // If the call is made in-process (server-server)
+    bool outofproc;     // If the call is made out-of-process (client-server)
+    int returned;
+    motor_query_t query;
+    int  value;
+    int item;
+};
+extern int mcQueryIntegerWithIntegerItem(motor_t motor, motor_query_t query,
+    OUT int * value, int item);
+extern int mcQueryIntegerWithIntegerItemInProc(motor_t motor, motor_query_t query,
+    OUT int * value, int item);
+extern int mcQueryIntegerWithIntegerItemOutOfProc(motor_t motor, motor_query_t query,
+    OUT int * value, int item);
+
+
+struct _mcQueryIntegerWithStringItem_args {
+    bool inproc;        // If the call is made in-process (server-server)
+    bool outofproc;     // If the call is made out-of-process (client-server)
+    int returned;
+    motor_query_t query;
+    int  value;
+    String  item;
+};
+extern int mcQueryIntegerWithStringItem(motor_t motor, motor_query_t query,
+    OUT int * value, String * item);
+extern int mcQueryIntegerWithStringItemInProc(motor_t motor, motor_query_t query,
+    OUT int * value, String * item);
+extern int mcQueryIntegerWithStringItemOutOfProc(motor_t motor, motor_query_t query,
+    OUT int * value, String * item);
+
+
+struct _mcQueryString_args {
+    bool inproc;        // If the call is made in-process (server-server)
+    bool outofproc;     // If the call is made out-of-process (client-server)
+    int returned;
+    motor_query_t query;
+    String  value;
+};
+extern int mcQueryString(motor_t motor, motor_query_t query, OUT String * value);
+extern int mcQueryStringInProc(motor_t motor, motor_query_t query, OUT String * value);
+extern int mcQueryStringOutOfProc(motor_t motor, motor_query_t query, OUT String * value);
+
+
+struct _mcSearch_args {
+    bool inproc;        // If the call is made in-process (server-server)
+    bool outofproc;     // If the call is made out-of-process (client-server)
+    int returned;
+    String  driver;
+    String  results;
+};
+extern int mcSearch(motor_t motor, String * driver, OUT String * results);
+extern int mcSearchInProc(motor_t motor, String * driver, OUT String * results);
+extern int mcSearchOutOfProc(motor_t motor, String * driver, OUT String * results);
+
+
+struct _mcSlew_args {
+    bool inproc;        // If the call is made in-process (server-server)
+    bool outofproc;     // If the call is made out-of-process (client-server)
+    int returned;
+    int rate;
+};
+extern int mcSlew(motor_t motor, int rate);
+extern int mcSlewInProc(motor_t motor, int rate);
+extern int mcSlewOutOfProc(motor_t motor, int rate);
+
+
+struct _mcSlewUnits_args {
+    bool inproc;        // If the call is made in-process (server-server)
+    bool outofproc;     // If the call is made out-of-process (client-server)
+    int returned;
+    int rate;
+    unit_type_t units;
+};
+extern int mcSlewUnits(motor_t motor, int rate, unit_type_t units);
+extern int mcSlewUnitsInProc(motor_t motor, int rate, unit_type_t units);
+extern int mcSlewUnitsOutOfProc(motor_t motor, int rate, unit_type_t units);
+
+
+struct _mcStop_args {
+    bool inproc;        // If the call is made in-process (server-server)
+    bool outofproc;     // If the call is made out-of-process (client-server)
+    int returned;
+    
+};
+extern int mcStop(motor_t motor);
+extern int mcStopInProc(motor_t motor);
+extern int mcStopOutOfProc(motor_t motor);
+
+
+struct _mcTraceChannelEnum_args {
+    bool inproc;        // If the call is made in-process (server-server)
+    bool outofproc;     // If the call is made out-of-process (client-server)
+    int returned;
+    String  channels;
+};
+extern int mcTraceChannelEnum(motor_t motor, OUT String * channels);
+extern int mcTraceChannelEnumInProc(motor_t motor, OUT String * channels);
+extern int mcTraceChannelEnumOutOfProc(motor_t motor, OUT String * channels);
+
+
+struct _mcTraceChannelGetNameRemote_args {
+    bool inproc;        // If the call is made in-process (server-server)
+    bool outofproc;     // If the call is made out-of-process (client-server)
+    int returned;
+    int id;
+    String  buffer;
+};
+extern int mcTraceChannelGetNameRemote(motor_t motor, int id, OUT String * buffer);
+extern int mcTraceChannelGetNameRemoteInProc(motor_t motor, int id, OUT String * buffer);
+extern int mcTraceChannelGetNameRemoteOutOfProc(motor_t motor, int id, OUT String * buffer);
+
+
+struct _mcTraceChannelLookupRemote_args {
+    bool inproc;        // If the call is made in-process (server-server)
+    bool outofproc;     // If the call is made out-of-process (client-server)
+    int returned;
+    String  buffer;
+    int  id;
+};
+extern int mcTraceChannelLookupRemote(motor_t motor, String * buffer, OUT int * id);
+extern int mcTraceChannelLookupRemoteInProc(motor_t motor, String * buffer, OUT int * id);
+extern int mcTraceChannelLookupRemoteOutOfProc(motor_t motor, String * buffer, OUT int * id);
+
+
+struct _mcTraceSubscribeAdd_args {
+    bool inproc;        // If the call is made in-process (server-server)
+    bool outofproc;     // If the call is made out-of-process (client-server)
+    int returned;
+    int id;
+    String  name;
+};
+extern int mcTraceSubscribeAdd(motor_t motor, int id, String * name);
+extern int mcTraceSubscribeAddInProc(motor_t motor, int id, String * name);
+extern int mcTraceSubscribeAddOutOfProc(motor_t motor, int id, String * name);
+
+
+struct _mcTraceSubscribeRemote_args {
+    bool inproc;        // If the call is made in-process (server-server)
+    bool outofproc;     // If the call is made out-of-process (client-server)
+    int returned;
+    int level;
+    unsigned 
+    long long mask;
+};
+extern int mcTraceSubscribeRemote(motor_t motor, int level, unsigned 
+    long long mask);
+extern int mcTraceSubscribeRemoteInProc(motor_t motor, int level, unsigned 
+    long long mask);
+extern int mcTraceSubscribeRemoteOutOfProc(motor_t motor, int level, unsigned 
+    long long mask);
+
+
+struct _mcTraceSubscribeRemove_args {
+    bool inproc;        // If the call is made in-process (server-server)
+    bool outofproc;     // If the call is made out-of-process (client-server)
+    int returned;
+    int id;
+    String  name;
+};
+extern int mcTraceSubscribeRemove(motor_t motor, int id, String * name);
+extern int mcTraceSubscribeRemoveInProc(motor_t motor, int id, String * name);
+extern int mcTraceSubscribeRemoveOutOfProc(motor_t motor, int id, String * name);
+
+
+struct _mcTraceUnsubscribeRemote_args {
+    bool inproc;        // If the call is made in-process (server-server)
+    bool outofproc;     // If the call is made out-of-process (client-server)
+    int returned;
+    int id;
+};
+extern int mcTraceUnsubscribeRemote(motor_t motor, int id);
+extern int mcTraceUnsubscribeRemoteInProc(motor_t motor, int id);
+extern int mcTraceUnsubscribeRemoteOutOfProc(motor_t motor, int id);
+
+
+struct _mcUnitScaleGet_args {
+    bool inproc;        // If the call is made in-process (server-server)
+    bool outofproc;     // If the call is made out-of-process (client-server)
+    int returned;
+    unit_type_t  units;
+    long long  urevs;
+};
+extern int mcUnitScaleGet(motor_t motor, OUT unit_type_t * units, OUT long long * urevs);
+extern int mcUnitScaleGetInProc(motor_t motor, OUT unit_type_t * units, OUT long long * urevs);
+extern int mcUnitScaleGetOutOfProc(motor_t motor, OUT unit_type_t * units, OUT long long * urevs);
+
+
+struct _mcUnitScaleSet_args {
+    bool inproc;        // If the call is made in-process (server-server)
+    bool outofproc;     // If the call is made out-of-process (client-server)
+    int returned;
+    unit_type_t units;
+    long long urevs;
+};
+extern int mcUnitScaleSet(motor_t motor, unit_type_t units, long long urevs);
+extern int mcUnitScaleSetInProc(motor_t motor, unit_type_t units, long long urevs);
+extern int mcUnitScaleSetOutOfProc(motor_t motor, unit_type_t units, long long urevs);
+
+
+struct _mcUnitToMicroRevs_args {
+    bool inproc;        // If the call is made in-process (server-server)
+    bool outofproc;     // If the call is made out-of-process (client-server)
+    int returned;
+    unit_type_t unit;
+    long long  urevs;
+};
+extern int mcUnitToMicroRevs(motor_t motor, unit_type_t unit, OUT long long * urevs);
+extern int mcUnitToMicroRevsInProc(motor_t motor, unit_type_t unit, OUT long long * urevs);
+extern int mcUnitToMicroRevsOutOfProc(motor_t motor, unit_type_t unit, OUT long long * urevs);
+
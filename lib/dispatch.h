@@ -0,0 +1,169 @@
+enum proxy_function_ids {
+    TYPE__FIRST = 100,
+    TYPE_mcConnect,
+    TYPE_mcDisconnect,
+    TYPE_mcEStop,
+    TYPE_mcEventRegister,
+    TYPE_mcEventUnregister,
+    TYPE_mcFirmwareLoad,
+    TYPE_mcHalt,
+    TYPE_mcHome,
+    TYPE_mcMicrocodeLoad,
+    TYPE_mcMotorIsLocked,
+    TYPE_mcMotorLock,
+    TYPE_mcMotorUnlock,
+    TYPE_mcMoveAbsolute,
+    TYPE_mcMoveAbsoluteUnits,
+    TYPE_mcMoveRelative,
+    TYPE_mcMoveRelativeUnits,
+    TYPE_mcPokeInteger,
+    TYPE_mcPokeIntegerUnits,
+    TYPE_mcPokeIntegerWithIntegerItem,
+    TYPE_mcPokeIntegerWithStringItem,
+    TYPE_mcPokeString,
+    TYPE_mcPokeStringWithStringItem,
+    TYPE_mcProfileGet,
+    TYPE_mcProfileGetAccel,
+    TYPE_mcProfileGetDeadband,
+    TYPE_mcProfileGetDecel,
+    TYPE_mcProfileGetInitialV,
+    TYPE_mcProfileGetMaxSlip,
+    TYPE_mcProfileGetMaxV,
+    TYPE_mcProfileSet,
+    TYPE_mcQueryFloat,
+    TYPE_mcQueryFloatUnits,
+    TYPE_mcQueryInteger,
+    TYPE_mcQueryIntegerUnits,
+    TYPE_mcQueryIntegerWithIntegerItem,
+    TYPE_mcQueryIntegerWithStringItem,
+    TYPE_mcQueryString,
+    TYPE_mcSearch,
+    TYPE_mcSlew,
+    TYPE_mcSlewUnits,
+    TYPE_mcStop,
+    TYPE_mcTraceChannelEnum,
+    TYPE_mcTraceChannelGetNameRemote,
+    TYPE_mcTraceChannelLookupRemote,
+    TYPE_mcTraceSubscribeAdd,
+    TYPE_mcTraceSubscribeRemote,
+    TYPE_mcTraceSubscribeRemove,
+    TYPE_mcTraceUnsubscribeRemote,
+    TYPE_mcUnitScaleGet,
+    TYPE_mcUnitScaleSet,
+    TYPE_mcUnitToMicroRevs,
+    TYPE__LAST
+};
+
+extern void mcConnectImpl(request_message_t * message);
+extern void mcDisconnectImpl(request_message_t * message);
+extern void mcEStopImpl(request_message_t * message);
+extern void mcEventRegisterImpl(request_message_t * message);
+extern void mcEventUnregisterImpl(request_message_t * message);
+extern void mcFirmwareLoadImpl(request_message_t * message);
+extern void mcHaltImpl(request_message_t * message);
+extern void mcHomeImpl(request_message_t * message);
+extern void mcMicrocodeLoadImpl(request_message_t * message);
+extern void mcMotorIsLockedImpl(request_message_t * message);
+extern void mcMotorLockImpl(request_message_t * message);
+extern void mcMotorUnlockImpl(request_message_t * message);
+extern void mcMoveAbsoluteImpl(request_message_t * message);
+extern void mcMoveAbsoluteUnitsImpl(request_message_t * message);
+extern void mcMoveRelativeImpl(request_message_t * message);
+extern void mcMoveRelativeUnitsImpl(request_message_t * message);
+extern void mcPokeIntegerImpl(request_message_t * message);
+extern void mcPokeIntegerUnitsImpl(request_message_t * message);
+extern void mcPokeIntegerWithIntegerItemImpl(request_message_t * message);
+extern void mcPokeIntegerWithStringItemImpl(request_message_t * message);
+extern void mcPokeStringImpl(request_message_t * message);
+extern void mcPokeStringWithStringItemImpl(request_message_t * message);
+extern void mcProfileGetImpl(request_message_t * message);
+extern void mcProfileGetAccelImpl(request_message_t * message);
+extern void mcProfileGetDeadbandImpl(request_message_t * message);
+extern void mcProfileGetDecelImpl(request_message_t * message);
+extern void mcProfileGetInitialVImpl(request_message_t * message);
+extern void mcProfileGetMaxSlipImpl(request_message_t * message);
+extern void mcProfileGetMaxVImpl(request_message_t * message);
+extern void mcProfileSetImpl(request_message_t * message);
+extern void mcQueryFloatImpl(request_message_t * message);
+extern void mcQueryFloatUnitsImpl(request_message_t * message);
+extern void mcQueryIntegerImpl(request_message_t * message);
+extern void mcQueryIntegerUnitsImpl(request_message_t * message);
+extern void mcQueryIntegerWithIntegerItemImpl(request_message_t * message);
+extern void mcQueryIntegerWithStringItemImpl(request_message_t * message);
+extern void mcQueryStringImpl(request_message_t * message);
+extern void mcSearchImpl(request_message_t * message);
+extern void mcSlewImpl(request_message_t * message);
+extern void mcSlewUnitsImpl(request_message_t * message);
+extern void mcStopImpl(request_message_t * message);
+extern void mcTraceChannelEnumImpl(request_message_t * message);
+extern void mcTraceChannelGetNameRemoteImpl(request_message_t * message);
+extern void mcTraceChannelLookupRemoteImpl(request_message_t * message);
+extern void mcTraceSubscribeAddImpl(request_message_t * message);
+extern void mcTraceSubscribeRemoteImpl(request_message_t * message);
+extern void mcTraceSubscribeRemoveImpl(request_message_t * message);
+extern void mcTraceUnsubscribeRemoteImpl(request_message_t * message);
+extern void mcUnitScaleGetImpl(request_message_t * message);
+extern void mcUnitScaleSetImpl(request_message_t * message);
+extern void mcUnitToMicroRevsImpl(request_message_t * message);
+
+#ifdef DISPATCH_INCLUDE_TABLE
+struct dispatch_table {
+    int type;
+    void (*callable)(request_message_t * message);
+    const char * name;
+} table[] = {
+    { TYPE_mcConnect, mcConnectImpl, "mcConnect" },
+    { TYPE_mcDisconnect, mcDisconnectImpl, "mcDisconnect" },
+    { TYPE_mcEStop, mcEStopImpl, "mcEStop" },
+    { TYPE_mcEventRegister, mcEventRegisterImpl, "mcEventRegister" },
+    { TYPE_mcEventUnregister, mcEventUnregisterImpl, "mcEventUnregister" },
+    { TYPE_mcFirmwareLoad, mcFirmwareLoadImpl, "mcFirmwareLoad" },
+    { TYPE_mcHalt, mcHaltImpl, "mcHalt" },
+    { TYPE_mcHome, mcHomeImpl, "mcHome" },
+    { TYPE_mcMicrocodeLoad, mcMicrocodeLoadImpl, "mcMicrocodeLoad" },
+    { TYPE_mcMotorIsLocked, mcMotorIsLockedImpl, "mcMotorIsLocked" },
+    { TYPE_mcMotorLock, mcMotorLockImpl, "mcMotorLock" },
+    { TYPE_mcMotorUnlock, mcMotorUnlockImpl, "mcMotorUnlock" },
+    { TYPE_mcMoveAbsolute, mcMoveAbsoluteImpl, "mcMoveAbsolute" },
+    { TYPE_mcMoveAbsoluteUnits, mcMoveAbsoluteUnitsImpl, "mcMoveAbsoluteUnits" },
+    { TYPE_mcMoveRelative, mcMoveRelativeImpl, "mcMoveRelative" },
+    { TYPE_mcMoveRelativeUnits, mcMoveRelativeUnitsImpl, "mcMoveRelativeUnits" },
+    { TYPE_mcPokeInteger, mcPokeIntegerImpl, "mcPokeInteger" },
+    { TYPE_mcPokeIntegerUnits, mcPokeIntegerUnitsImpl, "mcPokeIntegerUnits" },
+    { TYPE_mcPokeIntegerWithIntegerItem, mcPokeIntegerWithIntegerItemImpl, "mcPokeIntegerWithIntegerItem" },
+    { TYPE_mcPokeIntegerWithStringItem, mcPokeIntegerWithStringItemImpl, "mcPokeIntegerWithStringItem" },
+    { TYPE_mcPokeString, mcPokeStringImpl, "mcPokeString" },
+    { TYPE_mcPokeStringWithStringItem, mcPokeStringWithStringItemImpl, "mcPokeStringWithStringItem" },
+    { TYPE_mcProfileGet, mcProfileGetImpl, "mcProfileGet" },
+    { TYPE_mcProfileGetAccel, mcProfileGetAccelImpl, "mcProfileGetAccel" },
+    { TYPE_mcProfileGetDeadband, mcProfileGetDeadbandImpl, "mcProfileGetDeadband" },
+    { TYPE_mcProfileGetDecel, mcProfileGetDecelImpl, "mcProfileGetDecel" },
+    { TYPE_mcProfileGetInitialV, mcProfileGetInitialVImpl, "mcProfileGetInitialV" },
+    { TYPE_mcProfileGetMaxSlip, mcProfileGetMaxSlipImpl, "mcProfileGetMaxSlip" },
+    { TYPE_mcProfileGetMaxV, mcProfileGetMaxVImpl, "mcProfileGetMaxV" },
+    { TYPE_mcProfileSet, mcProfileSetImpl, "mcProfileSet" },
+    { TYPE_mcQueryFloat, mcQueryFloatImpl, "mcQueryFloat" },
+    { TYPE_mcQueryFloatUnits, mcQueryFloatUnitsImpl, "mcQueryFloatUnits" },
+    { TYPE_mcQueryInteger, mcQueryIntegerImpl, "mcQueryInteger" },
+    { TYPE_mcQueryIntegerUnits, mcQueryIntegerUnitsImpl, "mcQueryIntegerUnits" },
+    { TYPE_mcQueryIntegerWithIntegerItem, mcQueryIntegerWithIntegerItemImpl, "mcQueryIntegerWithIntegerItem" },
+    { TYPE_mcQueryIntegerWithStringItem, mcQueryIntegerWithStringItemImpl, "mcQueryIntegerWithStringItem" },
+    { TYPE_mcQueryString, mcQueryStringImpl, "mcQueryString" },
+    { TYPE_mcSearch, mcSearchImpl, "mcSearch" },
+    { TYPE_mcSlew, mcSlewImpl, "mcSlew" },
+    { TYPE_mcSlewUnits, mcSlewUnitsImpl, "mcSlewUnits" },
+    { TYPE_mcStop, mcStopImpl, "mcStop" },
+    { TYPE_mcTraceChannelEnum, mcTraceChannelEnumImpl, "mcTraceChannelEnum" },
+    { TYPE_mcTraceChannelGetNameRemote, mcTraceChannelGetNameRemoteImpl, "mcTraceChannelGetNameRemote" },
+    { TYPE_mcTraceChannelLookupRemote, mcTraceChannelLookupRemoteImpl, "mcTraceChannelLookupRemote" },
+    { TYPE_mcTraceSubscribeAdd, mcTraceSubscribeAddImpl, "mcTraceSubscribeAdd" },
+    { TYPE_mcTraceSubscribeRemote, mcTraceSubscribeRemoteImpl, "mcTraceSubscribeRemote" },
+    { TYPE_mcTraceSubscribeRemove, mcTraceSubscribeRemoveImpl, "mcTraceSubscribeRemove" },
+    { TYPE_mcTraceUnsubscribeRemote, mcTraceUnsubscribeRemoteImpl, "mcTraceUnsubscribeRemote" },
+    { TYPE_mcUnitScaleGet, mcUnitScaleGetImpl, "mcUnitScaleGet" },
+    { TYPE_mcUnitScaleSet, mcUnitScaleSetImpl, "mcUnitScaleSet" },
+    { TYPE_mcUnitToMicroRevs, mcUnitToMicroRevsImpl, "mcUnitToMicroRevs" },
+    { 0, NULL, NULL }
+};
+#endif
+
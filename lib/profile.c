@@ -1,4 +1,5 @@
 #include "../motor.h"
+#include "../drivers/driver.h"
 
 #include "profile.h"
 
@@ -81,6 +82,21 @@ PROXYIMPL(mcProfileSet, Profile profile) {
         m->profile.accuracy.units = MICRO_REVS;
     }
 
+    // Install a hardware profile into its slot of the unit, so that moves
+    // can select it by number
+    if (m->profile.attrs.hardware && m->profile.attrs.refresh) {
+        if (m->driver->class->write == NULL)
+            RETURN( ENOTSUP );
+
+        m->profile.attrs.refresh = false;
+        struct motor_query q = {
+            .query = MCPROFILE,
+            .arg.number = m->profile.attrs.number,
+            .value.profile = &m->profile
+        };
+        RETURN( m->driver->class->write(m->driver, &q) );
+    }
+
     RETURN(0);
 }
 
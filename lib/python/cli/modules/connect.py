@@ -24,7 +24,9 @@ class MotorConnect(Mixin):
         mdrive:///dev/ttyM0@115200:x
 
         Will connect to the /dev/ttyM0 port at 115200 baud and attempt to
-        talk to a motor named 'x'
+        talk to a motor named 'x'. With @auto for the speed, all the motors
+        on the port are moved to the fastest speed they all support when
+        the port is first connected
 
         For sticky situations, the motor can be connected to in recovery
         mode where it isn't responding properly to be connected to otherwise
@@ -17,6 +17,9 @@ cdef extern from "motor.h":
         MCHOLDCURRENT
         MCSLIPMAX
 
+        MCPOSITION_ESTIMATED
+        MCPOSITION_ERROR
+
     ctypedef enum motion_increment:
         MILLI_INCH
         INCH
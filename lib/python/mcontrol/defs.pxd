@@ -95,6 +95,7 @@ cdef extern from "motor.h":
     ctypedef enum event_name:
         EV_MOTION
         EV_TRACE
+        EV_FIRMWARE
     ctypedef enum error:
         ER_NO_DAEMON,
         ER_COMM_FAIL,
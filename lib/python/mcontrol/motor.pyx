@@ -157,6 +157,28 @@ cdef class Motor:
 
             raise_status(status, "Unable to set device position")
 
+    property estimated_position:
+        def __get__(self):
+            """
+            Position of the motor estimated by the driver from the motion
+            commanded since the position was last read, and the bound on
+            the error of the estimate, as (position, error). Both come from
+            the same estimate: the driver answers the error of the position
+            read just before. The motor is not read, unless the driver is
+            set to correct the estimate periodically or the motor was
+            stopped (or moved other than by a move command) since last read
+            """
+            cdef double position, error
+            cdef int status
+            with nogil:
+                status = mcQueryFloat(self.id, k.MCPOSITION_ESTIMATED,
+                    &position)
+                if status == 0:
+                    status = mcQueryFloat(self.id, k.MCPOSITION_ERROR, &error)
+            raise_status(status, "Unable to estimate current position")
+
+            return position, error
+
     property velocity:
         def __get__(self):
             cdef double velocity
@@ -289,7 +311,31 @@ cdef extern from "drivers/mdrive/mdrive.h":
 
         MDRIVE_ENCODER,
         MDRIVE_VARIABLE,
-        MDRIVE_EXECUTE
+        MDRIVE_EXECUTE,
+
+        MDRIVE_PIPELINE,
+        MDRIVE_POLL_INTERVAL,
+        MDRIVE_CAPTURE,
+        MDRIVE_TX_DRAIN,
+        MDRIVE_WIRE_PROFILE,
+        MDRIVE_ESTIMATE_CORRECTION,
+
+        MDRIVE_STATS_WAKEUPS,
+        MDRIVE_STATS_IDLE,
+        MDRIVE_STATS_QUEUE_OVERFLOWS,
+        MDRIVE_STATS_ALLOCS,
+        MDRIVE_STATS_RTO,
+        MDRIVE_STATS_RTO_DATA,
+        MDRIVE_STATS_LATENCY_RTT,
+        MDRIVE_STATS_LATENCY_TXLOCK,
+        MDRIVE_STATS_LATENCY_FRAME,
+        MDRIVE_STATS_QUEUE_EMERGENCY,
+        MDRIVE_STATS_QUEUE_MOTION,
+        MDRIVE_STATS_QUEUE_QUERY,
+        MDRIVE_STATS_QUEUE_BULK,
+        MDRIVE_STATS_LATENCY_WRITE,
+        MDRIVE_STATS_WIRE_BYTES,
+        MDRIVE_STATS_WIRE_RATE
 
     ctypedef enum mdrive_io_type:
         IO_INPUT,
@@ -299,6 +345,20 @@ cdef extern from "drivers/mdrive/mdrive.h":
         IO_OUTPUT,
         IO_MOVING
 
+latency_histograms = {
+    'rtt':      MDRIVE_STATS_LATENCY_RTT,
+    'txlock':   MDRIVE_STATS_LATENCY_TXLOCK,
+    'frame':    MDRIVE_STATS_LATENCY_FRAME,
+    'emergency': MDRIVE_STATS_QUEUE_EMERGENCY,
+    'motion':   MDRIVE_STATS_QUEUE_MOTION,
+    'query':    MDRIVE_STATS_QUEUE_QUERY,
+    'bulk':     MDRIVE_STATS_QUEUE_BULK,
+    'write':    MDRIVE_STATS_LATENCY_WRITE,
+}
+
+# Wire profiles (EM, CK settings) by name, as in the connection string
+wire_profiles = ['fast', 'plain', 'keep']
+
 cdef class MdriveMotor(Motor):
 
     property address:
@@ -405,6 +465,183 @@ cdef class MdriveMotor(Motor):
             else:
                 return False
 
+    property pipeline:
+        def __get__(self):
+            cdef int val, status
+            with nogil:
+                status = mcQueryInteger(self.id, MDRIVE_PIPELINE, &val)
+            raise_status(status, "Unable to fetch pipeline depth")
+            return val
+
+        def __set__(self, depth):
+            """
+            Number of requests allowed in flight at once on the port of
+            this motor. Only raise above one for 4-wire buses where the
+            units answer in the order addressed
+            """
+            cdef int status, _depth = depth
+            with nogil:
+                status = mcPokeInteger(self.id, MDRIVE_PIPELINE, _depth)
+            raise_status(status, "Unable to set pipeline depth")
+
+    property poll_interval:
+        def __get__(self):
+            cdef int val, status
+            with nogil:
+                status = mcQueryInteger(self.id, MDRIVE_POLL_INTERVAL, &val)
+            raise_status(status, "Unable to fetch poll interval")
+            return val
+
+        def __set__(self, interval):
+            """
+            Period (in milliseconds) at which the status of the moving axes
+            on the port of this motor is polled in the background. Idle
+            axes are polled less often. While polled, reads of the
+            position, velocity and motion state are answered from the last
+            status polled. Zero stops the polling
+            """
+            cdef int status, _interval = interval
+            with nogil:
+                status = mcPokeInteger(self.id, MDRIVE_POLL_INTERVAL,
+                    _interval)
+            raise_status(status, "Unable to set poll interval")
+
+    property capture:
+        def __get__(self):
+            cdef String buf
+            cdef int status
+            with nogil:
+                status = mcQueryString(self.id, MDRIVE_CAPTURE, &buf)
+            raise_status(status, "Unable to fetch capture file")
+            return buf.buffer.decode('latin-1')
+
+        def __set__(self, filename):
+            """
+            Ring file into which the traffic of the port of this motor is
+            captured, for replay with mdrive-replay. An empty name (or
+            None) stops the capture
+            """
+            cdef String buf = bufferFromString(filename or '')
+            cdef int status
+            with nogil:
+                status = mcPokeString(self.id, MDRIVE_CAPTURE, &buf)
+            raise_status(status, "Unable to capture traffic")
+
+    property tx_drain:
+        def __get__(self):
+            cdef int val, status
+            with nogil:
+                status = mcQueryInteger(self.id, MDRIVE_TX_DRAIN, &val)
+            raise_status(status, "Unable to fetch transmit mode")
+            return val != 0
+
+        def __set__(self, drain):
+            """
+            If set (the default), the driver waits for each request to
+            leave the port of this motor. Otherwise, the request is left to
+            the kernel to transmit, and the response is timed from the
+            estimated end of the transmission
+            """
+            cdef int status, _drain = 1 if drain else 0
+            with nogil:
+                status = mcPokeInteger(self.id, MDRIVE_TX_DRAIN, _drain)
+            raise_status(status, "Unable to set transmit mode")
+
+    property wire_profile:
+        def __get__(self):
+            cdef int val, status
+            with nogil:
+                status = mcQueryInteger(self.id, MDRIVE_WIRE_PROFILE, &val)
+            raise_status(status, "Unable to fetch wire profile")
+            return wire_profiles[val]
+
+        def __set__(self, profile):
+            """
+            Configures the echo and checksum modes of the unit: 'fast'
+            (EM=1, CK=1, the default) for the fewest bytes per request
+            with every request acknowledged, 'plain' (EM=0, CK=0) as for a
+            terminal, or 'keep' to leave the unit as found
+            """
+            cdef int status, _profile = wire_profiles.index(profile)
+            with nogil:
+                status = mcPokeInteger(self.id, MDRIVE_WIRE_PROFILE, _profile)
+            raise_status(status, "Unable to set wire profile")
+
+    property estimate_correction:
+        def __get__(self):
+            cdef int val, status
+            with nogil:
+                status = mcQueryInteger(self.id, MDRIVE_ESTIMATE_CORRECTION,
+                    &val)
+            raise_status(status, "Unable to fetch estimate correction")
+            return val
+
+        def __set__(self, period):
+            """
+            Period (in milliseconds) after which the position estimated
+            for this motor (see estimated_position) is corrected by reading
+            the unit. Zero (the default) leaves the estimate to the reads
+            made otherwise, such as by the status poller (poll_interval)
+            """
+            cdef int status, _period = period
+            with nogil:
+                status = mcPokeInteger(self.id, MDRIVE_ESTIMATE_CORRECTION,
+                    _period)
+            raise_status(status, "Unable to set estimate correction")
+
+    def wire_stats(self, profile=None):
+        """
+        Retrieves the bytes on the wire per transaction, and the
+        transactions per second, measured while in the wire [profile] (see
+        wire_profile) -- the current one if not specified
+        """
+        cdef int nbytes, rate, status, _profile
+        _profile = wire_profiles.index(profile or self.wire_profile)
+        with nogil:
+            status = mcQueryIntegerWithIntegerItem(self.id,
+                MDRIVE_STATS_WIRE_BYTES, &nbytes, _profile)
+            if status == 0:
+                status = mcQueryIntegerWithIntegerItem(self.id,
+                    MDRIVE_STATS_WIRE_RATE, &rate, _profile)
+        raise_status(status, "Unable to fetch wire statistics")
+        return nbytes / 100.0, rate
+
+    def latency(self, which='rtt', percentile=99):
+        """
+        Retrieves a percentile of the latency (in microseconds) of
+        communicating with the unit, as recorded by the driver. [which] is
+        one of 'rtt' (request sent to the first response), 'txlock'
+        (waiting for the port) and 'frame' (receiving the response). The
+        wait for the port is also kept by priority class: 'emergency'
+        (stops), 'motion' (commands), 'query' (reads) and 'bulk'
+        (microcode and firmware upload). 'write' is the time blocked
+        writing a request to the port.
+        Percentiles are honored to a hundredth of a percent (99.99), and
+        100 retrieves the largest latency recorded. If [percentile] is
+        None, the number of samples recorded is returned instead
+        """
+        cdef int val, status, _what = latency_histograms[which]
+        cdef int _item = 0 if percentile is None else round(percentile * 100)
+        if percentile is not None and not 0 < _item <= 10000:
+            raise ValueError("Percentile must be in (0, 100]")
+        with nogil:
+            status = mcQueryIntegerWithIntegerItem(self.id, _what, &val,
+                _item)
+        raise_status(status, "Unable to fetch latency percentile")
+        return val
+
+    def reset_latency(self, which=None):
+        """
+        Clears the latency histogram named by [which] (see latency()), or
+        all of them if not specified
+        """
+        cdef int status, _what
+        for name in ([which] if which else latency_histograms):
+            _what = latency_histograms[name]
+            with nogil:
+                status = mcPokeInteger(self.id, _what, 0)
+            raise_status(status, "Unable to reset latency histogram")
+
     def factory_default(self):
         cdef int status
         with nogil:
@@ -549,6 +786,7 @@ cdef MotionDetails mdFromEventData(event_data_t * data):
 
 cdef class Event(object):
     EV_MOTION = defs.EV_MOTION
+    EV_FIRMWARE = defs.EV_FIRMWARE
 
     cdef readonly Motor motor
     cdef readonly int event
@@ -28,6 +28,8 @@ PROXYIMPL (mcQueryInteger, motor_query_t query, OUT int value) {
     // Convert distance-based queries from microrevs
     switch (args->query) {
         case MCPOSITION:
+        case MCPOSITION_ESTIMATED:
+        case MCPOSITION_ERROR:
         case MCVELOCITY:
             mcMicroRevsToDistance(m, q.value.number, &args->value);
             break;
@@ -56,6 +58,8 @@ PROXYIMPL(mcQueryIntegerUnits, int, motor_query_t query, OUT int value,
     // Convert distance-based queries from microrevs
     switch (args->query) {
         case MCPOSITION:
+        case MCPOSITION_ESTIMATED:
+        case MCPOSITION_ERROR:
         case MCVELOCITY:
             mcMicroRevsToDistanceUnits(m, q.value.number, &args->value,
                 args->units);
@@ -132,6 +136,8 @@ PROXYIMPL (mcQueryFloat, motor_query_t query, OUT double value) {
     // Convert distance-based queries from microrevs
     switch (args->query) {
         case MCPOSITION:
+        case MCPOSITION_ESTIMATED:
+        case MCPOSITION_ERROR:
         case MCVELOCITY:
             mcMicroRevsToDistanceF(m, q.value.number, &args->value);
             break;
@@ -162,6 +168,8 @@ PROXYIMPL(mcQueryFloatUnits, int, motor_query_t query, OUT int value,
     // Convert distance-based queries from microrevs
     switch (args->query) {
         case MCPOSITION:
+        case MCPOSITION_ESTIMATED:
+        case MCPOSITION_ERROR:
         case MCVELOCITY:
             mcMicroRevsToDistanceUnitsF(m, q.value.number, &args->value,
                 args->units);
@@ -21,6 +21,7 @@ enum event_name {
     EV_MOTOR_PROBE,                 // Fired when motor is discovered
 
     EV_TRACE,                       // Trace emitted through mcTrace et. all.
+    EV_FIRMWARE,                    // Firmware upload progress
 
     EV__LAST
 };
@@ -59,6 +60,14 @@ union event_data {                  // Data associated with the event
         bool        shutdown;
     } temp;
 
+    // EV_FIRMWARE event payload
+    struct {
+        unsigned    lines;          // Records burned so far
+        unsigned    total;          // Records in the firmware file
+        unsigned    rate;           // Records per second, so far
+        unsigned    resent;         // Records sent again
+    } firmware;
+
     struct {
         char    level;
         char    channel;
@@ -184,6 +193,9 @@ enum motor_query_type {
 
     MCOPPROFILE,        // Set and retrieve operational profile
 
+    MCPOSITION_ESTIMATED, // Position estimated from the motion (no traffic)
+    MCPOSITION_ERROR,   // Bound on the error of the last estimate read
+
     // NOTE: Drivers may specify additional query types. Refer to individual
     // driver headers for specific query types supported by each respective
     // driver.
@@ -0,0 +1,53 @@
+/*
+ * bench-kinematics.c
+ *
+ * Reports the time taken to plan a move and to evaluate the plan, as done
+ * by the driver when projecting the completion of a move and estimating
+ * the position of the unit along it:
+ *
+ *   ./bench-kinematics [count]
+ */
+#include "../drivers/mdrive/kinematics.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+
+static double
+seconds(struct timespec * a, struct timespec * b) {
+    return (b->tv_sec - a->tv_sec) + (b->tv_nsec - a->tv_nsec) / 1e9;
+}
+
+int main(int argc, char * argv[]) {
+    int count = (argc > 1) ? atoi(argv[1]) : 1000000;
+    struct timespec begin, end;
+    kinematics_t plan;
+    volatile double sink = 0;
+
+    clock_gettime(CLOCK_MONOTONIC, &begin);
+    for (int i=0; i<count; i++) {
+        kinematics_plan(&plan, 1000 + (i & 0xffff) * 97., 1e3, 768e3, 1.5e6,
+            1.5e6);
+        sink += plan.t_rest;
+    }
+    clock_gettime(CLOCK_MONOTONIC, &end);
+    printf("plan     : %.1fns each\n", seconds(&begin, &end) * 1e9 / count);
+
+    kinematics_plan(&plan, 25e6, 1e3, 768e3, 1.5e6, 1.5e6);
+    double dt = plan.t_rest / count;
+
+    clock_gettime(CLOCK_MONOTONIC, &begin);
+    for (int i=0; i<count; i++)
+        sink += kinematics_position(&plan, i * dt);
+    clock_gettime(CLOCK_MONOTONIC, &end);
+    printf("position : %.1fns each\n", seconds(&begin, &end) * 1e9 / count);
+
+    clock_gettime(CLOCK_MONOTONIC, &begin);
+    for (int i=0; i<count; i++)
+        sink += kinematics_stopping_distance(&plan,
+            kinematics_velocity(&plan, i * dt));
+    clock_gettime(CLOCK_MONOTONIC, &end);
+    printf("stopping : %.1fns each\n", seconds(&begin, &end) * 1e9 / count);
+
+    return sink < 0;
+}
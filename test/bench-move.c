@@ -0,0 +1,111 @@
+/*
+ * bench-move.c
+ *
+ * Compares the latency of issuing a microcode-assisted move with the
+ * packed move routine (R1 carrying both the mode and the amount, then EX)
+ * against the three-step sequence (R1, R2, then EX). Stand-in routines are
+ * installed on the unit for the driver to run, and the time taken by the
+ * driver to issue each move is reported, along with the transactions per
+ * move:
+ *
+ *   ./mdrive-emulator -a a -b 9600 -c 1 -e 1 &
+ *   ./bench-move /dev/pts/3@9600:a 200
+ *
+ * The emulator does not run the microcode, so the moves are only issued.
+ */
+#include "../drivers/mdrive/mdrive.h"
+#include "../drivers/mdrive/motion.h"
+#include "../drivers/mdrive/profile.h"
+#include "../drivers/mdrive/serial.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+
+extern int mdrive_init(Driver *, const char *);
+extern void mdrive_uninit(Driver *);
+
+static double
+seconds(struct timespec * a, struct timespec * b) {
+    return (b->tv_sec - a->tv_sec) + (b->tv_nsec - a->tv_nsec) / 1e9;
+}
+
+int main(int argc, char * argv[]) {
+    if (argc < 2) {
+        fprintf(stderr, "Usage: %s <port@speed:address> [count]\n", argv[0]);
+        return 1;
+    }
+
+    int count = (argc > 2) ? atoi(argv[2]) : 200;
+
+    Driver driver = { .id = 1 };
+    if (mdrive_init(&driver, argv[1])) {
+        fprintf(stderr, "Unable to connect to %s\n", argv[1]);
+        return 1;
+    }
+    mdrive_device_t * device = driver.internal;
+
+    // Stand-ins for the routines of move.mxt
+    const char * program[] = { "PG 100", "LB MO", "E", "LB MP", "E", "PG",
+        NULL }, ** line;
+    for (line = program; *line; line++) {
+        if (mdrive_send(device, *line)) {
+            fprintf(stderr, "Unable to install the move routines\n");
+            return 1;
+        }
+    }
+    device->microcode.features.move = true;
+    snprintf(device->microcode.labels.move,
+        sizeof device->microcode.labels.move, "MO");
+    snprintf(device->microcode.labels.packed_move,
+        sizeof device->microcode.labels.packed_move, "MP");
+
+    // Moves with the profile of the unit, so that none is sent
+    if (mdrive_lazyload_profile(device)) {
+        fprintf(stderr, "Unable to read the profile of the unit\n");
+        return 1;
+    }
+    motion_instruction_t command = {
+        .type = MCRELATIVE,
+        .profile = device->profile
+    };
+
+    struct {
+        const char * name;
+        bool packed;
+    } * m, modes[] = {
+        { "three-step", false },
+        { "packed", true },
+        { NULL }
+    };
+    mdrive_histogram_t latency;
+    int failures = 0;
+
+    for (m = modes; m->name; m++) {
+        device->microcode.features.packed_move = m->packed;
+        histogram_reset(&latency);
+        unsigned tx = device->stats.tx;
+
+        struct timespec begin, end, before, after;
+        clock_gettime(CLOCK_MONOTONIC, &begin);
+        for (int i=0; i<count; i++) {
+            clock_gettime(CLOCK_MONOTONIC, &before);
+            if (mdrive_move_assisted(device, &command, (i & 1) ? -400 : 400))
+                failures++;
+            clock_gettime(CLOCK_MONOTONIC, &after);
+            histogram_record(&latency, seconds(&before, &after) * 1e9);
+        }
+        clock_gettime(CLOCK_MONOTONIC, &end);
+
+        double elapsed = seconds(&begin, &end);
+        printf("%-10s: %d moves in %.3fs, %.1f/s, %.1f transactions each\n",
+            m->name, count, elapsed, count / elapsed,
+            (double) (device->stats.tx - tx) / count);
+        printf("            per move (us) p50 %u p99 %u max %u\n",
+            histogram_percentile(&latency, 5000),
+            histogram_percentile(&latency, 9900),
+            histogram_percentile(&latency, 10000));
+    }
+
+    mdrive_uninit(&driver);
+    return failures ? 2 : 0;
+}
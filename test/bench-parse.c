@@ -0,0 +1,178 @@
+/*
+ * bench-parse.c
+ *
+ * Throughput of the response parser of the mdrive driver -- the fast
+ * mdrive_process_response() against the one-char-at-a-time reference
+ * (mdrive_process_response_reference). The traffic is fed to the parsers
+ * in chunks of varying size, the way mdrive_async_read() receives it, and
+ * the responses of the two parsers are checked to be the same.
+ *
+ * Without a file, the traffic is a mix of the responses of units in the
+ * various echo and checksum modes. Otherwise, the file is taken as
+ * captured traffic (raw bytes received from the units):
+ *
+ *   ./bench-parse [file] [megabytes]
+ */
+#include "../drivers/mdrive/mdrive.h"
+#include "../drivers/mdrive/serial.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+
+typedef int (*parser_t)(char *, mdrive_response_t *, int);
+
+// Responses in the various modes. '#' is replaced by the checksum of the
+// chars between the ACK (if any) and itself
+static const char * samples[] = {
+    "\x06" "1234#\r\n",                     // CK=1, EM=1 -- PR P
+    "\x06",                                 // CK=1, command accepted
+    "\x15",                                 // CK=1, command refused
+    "\x06" "-2147483#\r\n",
+    "aPR P#\r\n\x06" "51200#\r\n",          // CK=1, EM=0 -- echo, then data
+    "PR P\r\n1234\r\n>",                    // CK=0, EM=0
+    "\r\n>",
+    "1234\r\n",                             // CK=0, EM=1
+    "\r\n?63\r\n>",                         // Error
+    "!\"a\"?86\r\n",                        // Event
+    "\x06" "Program 1 of 4, position 12800, velocity 768000, slip 0#\r\n",
+    NULL
+};
+
+static int
+build_traffic(char * stream, int size) {
+    const char ** sample, * c;
+    char * out = stream, * start;
+
+    while (true) {
+        sample = &samples[rand() % (sizeof samples / sizeof *samples - 1)];
+        if (out + strlen(*sample) >= stream + size)
+            break;
+        for (c = *sample, start = out; *c; c++) {
+            if (*c == '\x06')
+                start = out + 1;
+            *out = (*c == '#') ? mdrive_calc_checksum(start, out - start) : *c;
+            out++;
+        }
+    }
+    return out - stream;
+}
+
+/**
+ * parse
+ *
+ * Feeds the [traffic] to a parser like mdrive_async_read() does. If
+ * [responses] is given, the parsed responses are stored there.
+ *
+ * Returns:
+ * (long) number of responses parsed
+ */
+static long
+parse(parser_t parser, const char * traffic, long size,
+        mdrive_response_t * responses, long max) {
+    char buffer[512], * load = buffer, * process = buffer;
+    mdrive_response_t response = { };
+    long count = 0, offset = 0;
+    int length;
+    unsigned seed = 1;
+
+    while (offset < size) {
+        length = 1 + rand_r(&seed) % 64;
+        if (length > size - offset)
+            length = size - offset;
+        if (length > sizeof buffer - 1 - (load - buffer)) {
+            // Garbage -- drop it, as the receive thread does
+            response = (mdrive_response_t) { };
+            process = load = buffer;
+            continue;
+        }
+        memcpy(load, traffic + offset, length);
+        offset += length;
+        load += length;
+        *load = 0;
+
+        while (process < load) {
+            process += parser(process, &response, load - process);
+            if ((response.length == 0 && (response.ack || response.nack))
+                    || response.processed) {
+                if (process == load)
+                    process = load = buffer;
+                if (responses && count < max)
+                    responses[count] = response;
+                count++;
+                response = (mdrive_response_t) { };
+            }
+        }
+    }
+    return count;
+}
+
+static double
+elapsed(struct timespec * begin) {
+    struct timespec end;
+
+    clock_gettime(CLOCK_MONOTONIC, &end);
+    return (end.tv_sec - begin->tv_sec) + (end.tv_nsec - begin->tv_nsec) / 1e9;
+}
+
+int main(int argc, char * argv[]) {
+    long size = 1 << 20, count, i, differences = 0;
+    int megabytes = (argc > 2) ? atoi(argv[2]) : 64;
+    char * traffic = malloc(size);
+    struct timespec begin;
+
+    if (argc > 1) {
+        FILE * capture = fopen(argv[1], "rb");
+        if (!capture) {
+            fprintf(stderr, "Unable to open %s\n", argv[1]);
+            return 1;
+        }
+        size = fread(traffic, 1, size, capture);
+        fclose(capture);
+    }
+    else
+        size = build_traffic(traffic, size);
+
+    // The responses of both parsers should be the same (but for the sums
+    // kept by the fast one)
+    count = parse(mdrive_process_response_reference, traffic, size, NULL, 0);
+    mdrive_response_t * expected = calloc(count, sizeof *expected),
+                      * actual = calloc(count, sizeof *actual);
+    parse(mdrive_process_response_reference, traffic, size, expected, count);
+    if (parse(mdrive_process_response, traffic, size, actual, count) != count)
+        differences++;
+    for (i = 0; i < count; i++) {
+        actual[i].sum = actual[i].sum_head = actual[i].sum_ack = 0;
+        if (memcmp(&expected[i], &actual[i], sizeof *actual)) {
+            if (!differences++)
+                fprintf(stderr, "Response %ld differs: %s / %s\n", i,
+                    expected[i].buffer, actual[i].buffer);
+        }
+    }
+    printf("traffic: %ld bytes, %ld responses, %ld differences\n", size,
+        count, differences);
+
+    struct {
+        const char * name;
+        parser_t parser;
+    } * p, parsers[] = {
+        { "reference", mdrive_process_response_reference },
+        { "fast", mdrive_process_response },
+        { NULL, NULL }
+    };
+    for (p = parsers; p->name; p++) {
+        long bytes = 0;
+        clock_gettime(CLOCK_MONOTONIC, &begin);
+        while (bytes < megabytes * (1L << 20)) {
+            parse(p->parser, traffic, size, NULL, 0);
+            bytes += size;
+        }
+        double seconds = elapsed(&begin);
+        printf("%-10s: %.1f MB/s, %.1fM responses/s\n", p->name,
+            bytes / seconds / (1 << 20), count * (bytes / size) / seconds / 1e6);
+    }
+
+    free(expected);
+    free(actual);
+    free(traffic);
+    return differences ? 2 : 0;
+}
@@ -0,0 +1,239 @@
+/*
+ * bench-pipeline.c
+ *
+ * Measures the aggregate transaction rate of several axes sharing one
+ * party-mode port. One thread per axis reads the position of its unit in
+ * a loop. Compare the pipeline depths against the emulator:
+ *
+ *   ./mdrive-emulator -a abcdefgh -b 115200 -c 1 -e 1 -l 2000 &
+ *   ./bench-pipeline /dev/pts/3@115200 abcdefgh 1 500
+ *   ./bench-pipeline /dev/pts/3@115200 abcdefgh 8 500
+ *
+ * With a stop interval (ms), the unit at the last address is not polled.
+ * Instead, it is sent a stop (an emergency) at the interval while the
+ * others are polled, and the time each class of request waited for the
+ * port is reported:
+ *
+ *   ./bench-pipeline /dev/pts/3@115200 abcdefgh 1 500 0 5
+ *
+ * With a poll interval (ms), the position is read through the driver's
+ * read entry instead, answered from the status polled in the background.
+ * The reads then cost far fewer transactions (tx) on the wire:
+ *
+ *   ./bench-pipeline /dev/pts/3@115200 abcdefgh 1 500 0 0 20
+ *
+ * With submit set, each thread submits its reads to the I/O thread of the
+ * port instead, and is done once they are submitted. The time the threads
+ * were kept busy is reported against the time to complete the reads:
+ *
+ *   ./bench-pipeline /dev/pts/3@115200 abcdefgh 1 500 0 0 0 1
+ */
+#include "../drivers/mdrive/mdrive.h"
+#include "../drivers/mdrive/serial.h"
+#include "../drivers/mdrive/io.h"
+#include "../lib/trace.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+
+extern int mdrive_init(Driver *, const char *);
+extern void mdrive_uninit(Driver *);
+extern int mdrive_read_variable(Driver *, struct motor_query *);
+extern int mdrive_write_variable(Driver *, struct motor_query *);
+extern int mdrive_stop(Driver *, enum stop_type);
+
+struct axis {
+    Driver              driver;
+    pthread_t           thread;
+    int                 count;
+    int                 failures;
+    int                 interval;       // Stop interval (ms)
+    double              busy;           // Time (s) the thread was running
+    mdrive_request_t *  requests;
+};
+
+static volatile bool polling = true;
+static bool cached = false, submit = false;
+static int outstanding;
+static sem_t completed;
+
+static void
+trace_output(int id, int level, int channel, const char * buffer) {
+    fprintf(stderr, "%d: %s\n", channel, buffer);
+}
+
+static double
+elapsed(struct timespec * begin) {
+    struct timespec end;
+
+    clock_gettime(CLOCK_MONOTONIC, &end);
+    return (end.tv_sec - begin->tv_sec) + (end.tv_nsec - begin->tv_nsec) / 1e9;
+}
+
+static void
+read_completed(mdrive_request_t * request, void * arg) {
+    struct axis * axis = arg;
+
+    if (request->status != RESPONSE_OK)
+        __atomic_add_fetch(&axis->failures, 1, __ATOMIC_RELAXED);
+    if (__atomic_sub_fetch(&outstanding, 1, __ATOMIC_ACQ_REL) == 0)
+        sem_post(&completed);
+}
+
+static void *
+axis_run(void * arg) {
+    struct axis * axis = arg;
+    struct timespec begin;
+    int value;
+
+    struct motor_query query = { .query = MCPOSITION };
+
+    clock_gettime(CLOCK_MONOTONIC, &begin);
+    for (int i=0; i<axis->count; i++) {
+        if (submit) {
+            axis->requests[i] = (mdrive_request_t) {
+                .command = "PR P",
+                .options = { .expect_data = true },
+                .callback = read_completed,
+                .arg = axis
+            };
+            if (mdrive_submit(axis->driver.internal, &axis->requests[i]))
+                axis->failures++;
+        }
+        else if (cached ? mdrive_read_variable(&axis->driver, &query)
+                : mdrive_get_integer(axis->driver.internal, "P", &value))
+            axis->failures++;
+    }
+    axis->busy = elapsed(&begin);
+
+    return NULL;
+}
+
+static void *
+axis_stop(void * arg) {
+    struct axis * axis = arg;
+    struct timespec interval = { .tv_nsec = axis->interval * 1000000L };
+
+    while (polling) {
+        if (mdrive_stop(&axis->driver, MCSTOP))
+            axis->failures++;
+        axis->count++;
+        nanosleep(&interval, NULL);
+    }
+
+    return NULL;
+}
+
+static void
+print_queue(const char * name, mdrive_histogram_t * histogram) {
+    if (histogram->count)
+        printf(" %s %u p50 %u p99 %u max %u", name, histogram->count,
+            histogram_percentile(histogram, 5000),
+            histogram_percentile(histogram, 9900),
+            histogram_percentile(histogram, 10000));
+}
+
+int main(int argc, char * argv[]) {
+    if (argc < 3) {
+        fprintf(stderr,
+            "Usage: %s <port@speed> <addresses> [depth] [count] [trace] "
+            "[stop-ms] [poll-ms] [submit]\n", argv[0]);
+        return 1;
+    }
+
+    const char * addresses = argv[2];
+    int naxes = strlen(addresses), depth = (argc > 3) ? atoi(argv[3]) : 1,
+        count = (argc > 4) ? atoi(argv[4]) : 500, failures = 0;
+    struct axis * axes = calloc(naxes, sizeof *axes);
+    if (argc > 5 && atoi(argv[5]))
+        mcTraceSubscribe(atoi(argv[5]), ALL_CHANNELS, trace_output);
+    int interval = (argc > 6) ? atoi(argv[6]) : 0, pollers = naxes,
+        poll = (argc > 7) ? atoi(argv[7]) : 0;
+    submit = argc > 8 && atoi(argv[8]);
+    if (interval && naxes > 1)
+        axes[--pollers].interval = interval;
+    char connection[64];
+
+    for (int i=0; i<naxes; i++) {
+        snprintf(connection, sizeof connection, "%s:%c", argv[1],
+            addresses[i]);
+        axes[i].driver.id = i + 1;
+        axes[i].count = axes[i].interval ? 0 : count;
+        axes[i].requests = calloc(count, sizeof *axes[i].requests);
+        if (mdrive_init(&axes[i].driver, connection)) {
+            fprintf(stderr, "Unable to connect to %s\n", connection);
+            return 1;
+        }
+    }
+
+    struct motor_query query = {
+        .query = MDRIVE_PIPELINE,
+        .value.number = depth
+    };
+    if (mdrive_write_variable(&axes[0].driver, &query)) {
+        fprintf(stderr, "Unable to set pipeline depth to %d\n", depth);
+        return 1;
+    }
+    if (poll) {
+        query = (struct motor_query) {
+            .query = MDRIVE_POLL_INTERVAL,
+            .value.number = poll
+        };
+        if (mdrive_write_variable(&axes[0].driver, &query)) {
+            fprintf(stderr, "Unable to poll every %dms\n", poll);
+            return 1;
+        }
+        cached = true;
+    }
+
+    outstanding = submit ? pollers * count : 0;
+    sem_init(&completed, 0, 0);
+
+    struct timespec begin;
+    clock_gettime(CLOCK_MONOTONIC, &begin);
+    for (int i=0; i<naxes; i++)
+        pthread_create(&axes[i].thread, NULL,
+            axes[i].interval ? axis_stop : axis_run, &axes[i]);
+    double busy = 0;
+    for (int i=0; i<pollers; i++) {
+        pthread_join(axes[i].thread, NULL);
+        busy += axes[i].busy;
+    }
+    if (outstanding)
+        sem_wait(&completed);
+    for (int i=0; i<pollers; i++)
+        failures += axes[i].failures;
+    double seconds = elapsed(&begin);
+    polling = false;
+    if (pollers < naxes) {
+        pthread_join(axes[pollers].thread, NULL);
+        failures += axes[pollers].failures;
+    }
+
+    printf("axes: %d depth: %d transactions: %d (%d failed) in %.3fs, "
+        "%.1f/s\n", pollers, depth, pollers * count, failures, seconds,
+        pollers * count / seconds);
+    printf("  threads busy %.3fs (%.1f%% of the time)\n", busy,
+        busy / pollers / seconds * 100);
+    for (int i=0; i<naxes; i++) {
+        mdrive_device_t * device = axes[i].driver.internal;
+        printf("  %c: tx %u rx %u timeouts %u resends %u\n",
+            device->address, device->stats.tx, device->stats.rx,
+            device->stats.timeouts, device->stats.resends);
+        if (!interval)
+            continue;
+        printf("     queue (us):");
+        print_queue("emergency",
+            &device->stats.queue_histogram[MDRIVE_PRIORITY_EMERGENCY]);
+        print_queue("query",
+            &device->stats.queue_histogram[MDRIVE_PRIORITY_QUERY]);
+        printf("\n");
+    }
+
+    for (int i=0; i<naxes; i++) {
+        mdrive_uninit(&axes[i].driver);
+        free(axes[i].requests);
+    }
+    free(axes);
+    return failures ? 2 : 0;
+}
@@ -0,0 +1,159 @@
+/*
+ * bench-queue.c
+ *
+ * Microbenchmark of the response queue and pool of the mdrive driver. A
+ * producer thread hands responses to a consumer thread through a queue_t
+ * the way the receive thread hands them to mdrive_communicate(). The
+ * responses are either taken from the per-port pool or allocated from the
+ * heap with calloc() as the driver used to. Heap allocations are counted
+ * by wrapping calloc() and malloc().
+ *
+ * If a port is given, transactions are also run against a unit (or the
+ * emulator) and the heap allocations per transaction are reported:
+ *
+ *   ./bench-queue 1000000
+ *   ./mdrive-emulator -a a -b 115200 &
+ *   ./bench-queue 1000000 /dev/pts/3@115200:a 1000
+ */
+#include "../drivers/mdrive/mdrive.h"
+#include "../drivers/mdrive/serial.h"
+
+#include <sched.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+extern int mdrive_init(Driver *, const char *);
+extern void mdrive_uninit(Driver *);
+
+extern void * __libc_malloc(size_t);
+extern void * __libc_calloc(size_t, size_t);
+
+// Only allocations made by the threads under test are counted -- or by
+// all the threads (including the receive thread of the driver)
+static unsigned long allocations;
+static __thread bool counting;
+static volatile bool counting_all;
+
+void *
+malloc(size_t size) {
+    if (counting || counting_all)
+        __atomic_add_fetch(&allocations, 1, __ATOMIC_RELAXED);
+    return __libc_malloc(size);
+}
+
+void *
+calloc(size_t count, size_t size) {
+    if (counting || counting_all)
+        __atomic_add_fetch(&allocations, 1, __ATOMIC_RELAXED);
+    return __libc_calloc(count, size);
+}
+
+struct run {
+    queue_t             queue;
+    mdrive_response_t * slots[8];
+    mdrive_response_pool_t pool;
+    bool                use_pool;
+    long                count;
+};
+
+static void *
+producer(void * arg) {
+    struct run * run = arg;
+    mdrive_response_t * response;
+
+    counting = true;
+    for (long i=0; i<run->count; i++) {
+        response = run->use_pool ? mdrive_response_alloc(&run->pool)
+            : calloc(1, sizeof *response);
+        response->txid = i;
+        while (!queue_push(&run->queue, response))
+            sched_yield();
+    }
+    counting = false;
+    return NULL;
+}
+
+static void
+bench_queue(long count, bool use_pool) {
+    struct run run = { .use_pool = use_pool, .count = count };
+    struct timespec begin, end;
+    mdrive_response_t * response;
+    pthread_t thread;
+    long received = 0, misordered = 0;
+    unsigned long before;
+
+    queue_init(&run.queue, run.slots, sizeof run.slots / sizeof *run.slots);
+    mdrive_response_pool_init(&run.pool);
+
+    before = allocations;
+    clock_gettime(CLOCK_MONOTONIC, &begin);
+    pthread_create(&thread, NULL, producer, &run);
+    counting = true;
+    while (received < count) {
+        if (!(response = queue_pop(&run.queue))) {
+            sched_yield();
+            continue;
+        }
+        if (response->txid != (unsigned) received)
+            misordered++;
+        received++;
+        if (use_pool)
+            mdrive_response_free(&run.pool, response);
+        else
+            free(response);
+    }
+    counting = false;
+    pthread_join(thread, NULL);
+    clock_gettime(CLOCK_MONOTONIC, &end);
+
+    double elapsed = (end.tv_sec - begin.tv_sec)
+        + (end.tv_nsec - begin.tv_nsec) / 1e9;
+    unsigned long heap = allocations - before;
+
+    printf("%-6s: %ld responses in %.3fs, %.1fM/s, heap allocations %lu "
+        "(%.3f/response), out of order %ld\n",
+        use_pool ? "pool" : "calloc", count, elapsed, count / elapsed / 1e6,
+        heap, 1. * heap / count, misordered);
+}
+
+static int
+bench_transactions(const char * connection, int count) {
+    Driver driver = { .id = 1 };
+    int value, failures = 0;
+    unsigned long before;
+
+    if (mdrive_init(&driver, connection)) {
+        fprintf(stderr, "Unable to connect to %s\n", connection);
+        return 1;
+    }
+    mdrive_device_t * device = driver.internal;
+
+    // The receive thread allocates the responses
+    before = allocations;
+    counting_all = true;
+    device->comm->pool.allocs = 0;
+    for (int i=0; i<count; i++)
+        if (mdrive_get_integer(device, "P", &value))
+            failures++;
+    counting_all = false;
+
+    printf("transactions: %d (%d failed), heap allocations %lu "
+        "(%.3f/transaction), pool misses %u\n",
+        count, failures, allocations - before,
+        1. * (allocations - before) / count, device->comm->pool.allocs);
+
+    mdrive_uninit(&driver);
+    return failures ? 2 : 0;
+}
+
+int main(int argc, char * argv[]) {
+    long count = (argc > 1) ? atol(argv[1]) : 1000000;
+
+    bench_queue(count, false);
+    bench_queue(count, true);
+
+    if (argc > 2)
+        return bench_transactions(argv[2], (argc > 3) ? atoi(argv[3]) : 1000);
+
+    return 0;
+}
@@ -0,0 +1,134 @@
+/*
+ * bench-serial.c
+ *
+ * Measures the round-trip latency and transaction rate of
+ * mdrive_communicate() against a unit -- or against the pseudo-terminal
+ * emulator (mdrive-emulator), which makes it usable without hardware:
+ *
+ *   ./mdrive-emulator -a a -b 115200 -c 1 -e 1 &
+ *   ./bench-serial /dev/pts/3@115200:a 1000
+ *
+ * The driver objects are linked in directly, so the benchmark runs the
+ * serial stack in-process without the daemon.
+ *
+ * The bytes on the wire per transaction, and the transaction rate, are
+ * reported by the wire profile (EM, CK) used. Compare the profiles with:
+ *
+ *   ./bench-serial '/dev/pts/3@115200:a?profile=plain' 1000
+ */
+#include "../drivers/mdrive/mdrive.h"
+#include "../drivers/mdrive/serial.h"
+#include "../lib/trace.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+
+extern int mdrive_init(Driver *, const char *);
+extern void mdrive_uninit(Driver *);
+
+static int
+compare_ll(const void * a, const void * b) {
+    long long x = *(const long long *) a, y = *(const long long *) b;
+    return (x > y) - (x < y);
+}
+
+static void
+trace_output(int id, int level, int channel, const char * buffer) {
+    fprintf(stderr, "%d: %s\n", channel, buffer);
+}
+
+int main(int argc, char * argv[]) {
+    if (argc < 2) {
+        fprintf(stderr, "Usage: %s <port@speed:address> [count] [trace]\n",
+            argv[0]);
+        return 1;
+    }
+
+    int count = (argc > 2) ? atoi(argv[2]) : 1000;
+    if (argc > 3)
+        mcTraceSubscribe(atoi(argv[3]), ALL_CHANNELS, trace_output);
+
+    Driver driver = { .id = 1 };
+    if (mdrive_init(&driver, argv[1])) {
+        fprintf(stderr, "Unable to connect to %s\n", argv[1]);
+        return 1;
+    }
+    mdrive_device_t * device = driver.internal;
+
+    long long * samples = calloc(count, sizeof *samples), total = 0;
+    struct timespec start, end, begin;
+    int value, failures = 0;
+
+    clock_gettime(CLOCK_MONOTONIC, &begin);
+    for (int i=0; i<count; i++) {
+        clock_gettime(CLOCK_MONOTONIC, &start);
+        if (mdrive_get_integer(device, "P", &value))
+            failures++;
+        clock_gettime(CLOCK_MONOTONIC, &end);
+        samples[i] = (end.tv_sec - start.tv_sec) * (long long)1e9
+            + (end.tv_nsec - start.tv_nsec);
+        total += samples[i];
+    }
+    double elapsed = (end.tv_sec - begin.tv_sec)
+        + (end.tv_nsec - begin.tv_nsec) / 1e9;
+
+    qsort(samples, count, sizeof *samples, compare_ll);
+
+    printf("transactions: %d (%d failed) in %.3fs, %.1f/s\n",
+        count, failures, elapsed, count / elapsed);
+    printf("latency (us): min %lld avg %lld p50 %lld p99 %lld max %lld\n",
+        samples[0] / 1000, total / count / 1000,
+        samples[count / 2] / 1000, samples[count * 99 / 100] / 1000,
+        samples[count - 1] / 1000);
+    printf("stats: tx %u rx %u acks %u nacks %u timeouts %u resends %u "
+        "overflows %u\n",
+        device->stats.tx, device->stats.rx, device->stats.acks,
+        device->stats.nacks, device->stats.timeouts, device->stats.resends,
+        device->stats.overflows);
+    printf("port: wakeups %u bytes %u (%.1f/wakeup) frames %u idle-closed %u "
+        "dropped %u\n",
+        device->comm->rxstats.wakeups, device->comm->rxstats.bytes,
+        1. * device->comm->rxstats.bytes
+            / (device->comm->rxstats.wakeups ? device->comm->rxstats.wakeups : 1),
+        device->comm->rxstats.frames, device->comm->rxstats.idle_closes,
+        device->comm->rxstats.dropped);
+    printf("rto (us): commands %d (srtt %d) data %d (srtt %d)\n",
+        device->stats.rtt_short.rto / 1000, device->stats.rtt_short.srtt / 1000,
+        device->stats.rtt_data.rto / 1000, device->stats.rtt_data.srtt / 1000);
+
+    static const char * profiles[] = {
+        [MDRIVE_WIRE_FAST] = "fast",
+        [MDRIVE_WIRE_PLAIN] = "plain",
+        [MDRIVE_WIRE_KEEP] = "keep",
+    };
+    for (int i = 0; i < MDRIVE_WIRE_PROFILES; i++) {
+        struct mdrive_wire_stats * wire = &device->stats.wire[i];
+        if (wire->transactions)
+            printf("wire (%s): transactions %u, %.1f bytes each, %.1f/s\n",
+                profiles[i], wire->transactions,
+                (double) wire->bytes / wire->transactions,
+                wire->transactions / (wire->time / 1e9));
+    }
+
+    struct {
+        const char * name;
+        mdrive_histogram_t * histogram;
+    } * h, histograms[] = {
+        { "rtt", &device->stats.rtt_histogram },
+        { "txlock", &device->stats.txlock_histogram },
+        { "frame", &device->stats.frame_histogram },
+        { "write", &device->stats.write_histogram },
+        { NULL, NULL }
+    };
+    for (h = histograms; h->name; h++)
+        printf("%s (us): samples %u p50 %u p99 %u p99.9 %u max %u\n",
+            h->name, h->histogram->count,
+            histogram_percentile(h->histogram, 5000),
+            histogram_percentile(h->histogram, 9900),
+            histogram_percentile(h->histogram, 9990),
+            histogram_percentile(h->histogram, 10000));
+
+    free(samples);
+    mdrive_uninit(&driver);
+    return failures ? 2 : 0;
+}
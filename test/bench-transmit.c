@@ -0,0 +1,97 @@
+/*
+ * bench-transmit.c
+ *
+ * Compares the transmit modes of the driver: waiting for each request to
+ * leave the port (tcdrain, the default) against leaving the transmission
+ * to the kernel and timing the response from its estimated end. For each
+ * mode, a worker thread reads a variable of the unit in a loop, and the
+ * share of its time spent blocked writing requests is reported, along
+ * with the distribution of the time blocked per request:
+ *
+ *   ./mdrive-emulator -a a -b 9600 -c 1 -e 1 &
+ *   ./bench-transmit /dev/pts/3@9600:a 500
+ *
+ * Note that a pseudo-terminal drains as soon as the emulator reads the
+ * request, whereas a UART drains at the baud rate -- the time blocked in
+ * the drain mode is much longer with real hardware.
+ */
+#include "../drivers/mdrive/mdrive.h"
+#include "../drivers/mdrive/serial.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+
+extern int mdrive_init(Driver *, const char *);
+extern void mdrive_uninit(Driver *);
+extern int mdrive_write_variable(Driver *, struct motor_query *);
+
+static double
+seconds(struct timespec * a, struct timespec * b) {
+    return (b->tv_sec - a->tv_sec) + (b->tv_nsec - a->tv_nsec) / 1e9;
+}
+
+int main(int argc, char * argv[]) {
+    if (argc < 2) {
+        fprintf(stderr, "Usage: %s <port@speed:address> [count] [variable]\n",
+            argv[0]);
+        return 1;
+    }
+
+    int count = (argc > 2) ? atoi(argv[2]) : 500;
+    const char * variable = (argc > 3) ? argv[3] : "P";
+
+    Driver driver = { .id = 1 };
+    if (mdrive_init(&driver, argv[1])) {
+        fprintf(stderr, "Unable to connect to %s\n", argv[1]);
+        return 1;
+    }
+    mdrive_device_t * device = driver.internal;
+
+    struct {
+        const char * name;
+        bool drain;
+    } * m, modes[] = {
+        { "drain", true },
+        { "estimated", false },
+        { NULL }
+    };
+    int value, failures = 0;
+
+    for (m = modes; m->name; m++) {
+        struct motor_query query = {
+            .query = MDRIVE_TX_DRAIN,
+            .value.number = m->drain
+        };
+        if (mdrive_write_variable(&driver, &query)) {
+            fprintf(stderr, "Unable to select the %s mode\n", m->name);
+            return 1;
+        }
+        histogram_reset(&device->stats.write_histogram);
+        device->stats.writetime = 0;
+        unsigned timeouts = device->stats.timeouts;
+
+        struct timespec begin, end, cpu_begin, cpu_end;
+        clock_gettime(CLOCK_MONOTONIC, &begin);
+        clock_gettime(CLOCK_THREAD_CPUTIME_ID, &cpu_begin);
+        for (int i=0; i<count; i++)
+            if (mdrive_get_integer(device, variable, &value))
+                failures++;
+        clock_gettime(CLOCK_THREAD_CPUTIME_ID, &cpu_end);
+        clock_gettime(CLOCK_MONOTONIC, &end);
+
+        double elapsed = seconds(&begin, &end);
+        printf("%-9s: %d transactions in %.3fs, %.1f/s, timeouts %u\n",
+            m->name, count, elapsed, count / elapsed,
+            device->stats.timeouts - timeouts);
+        printf("           blocked writing %.1f%% of the time, cpu %.1f%%; "
+            "per request (us) p50 %u p99 %u max %u\n",
+            device->stats.writetime / 1e9 / elapsed * 100,
+            seconds(&cpu_begin, &cpu_end) / elapsed * 100,
+            histogram_percentile(&device->stats.write_histogram, 5000),
+            histogram_percentile(&device->stats.write_histogram, 9900),
+            histogram_percentile(&device->stats.write_histogram, 10000));
+    }
+
+    mdrive_uninit(&driver);
+    return failures ? 2 : 0;
+}
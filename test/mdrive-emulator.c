@@ -0,0 +1,1175 @@
+/*
+ * mdrive-emulator.c
+ *
+ * Emulates one or more MDrive units on a pseudo-terminal so that the
+ * serial stack in drivers/mdrive can be exercised and benchmarked without
+ * hardware. The emulator prints the name of the slave side of the
+ * pseudo-terminal, which can be used in a connection string such as
+ *
+ *   mdrive:///dev/pts/3@115200:a
+ *
+ * Enough MCode is understood to satisfy the driver: PR of variables and
+ * quoted strings, assignments, VA declarations, program mode (PG, LB, CP,
+ * EX of installed labels), simple motion (MA, MR, SL), IP, S, FD and UG.
+ * Checksum mode (CK), the echo modes (EM 0/1/2) and party-mode addressing
+ * are honored when framing responses. Reboots (^C) print the copyright
+ * banner, or the '$' prompt if the unit is in firmware upgrade mode.
+ *
+ * Faults can be injected at random: NACKs (-N) and error 63 overruns (-O).
+ * Outgoing bytes are paced at the requested baud rate (-b). With -b auto,
+ * the speed configured on the slave side by the driver is used, and units
+ * configured (BD) at a different speed will not understand the traffic.
+ * Units can be limited to a maximum speed (-m), above which BD is refused.
+ *
+ * Each unit processes its commands (-l) independently of the others, like
+ * the real units on a shared bus. Replies are scheduled for transmission
+ * when their unit is finished, and go out on the wire one after another.
+ */
+#include <ctype.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <signal.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/prctl.h>
+#include <termios.h>
+#include <time.h>
+#include <unistd.h>
+
+#define MAX_UNITS       16
+#define MAX_VARIABLES   96
+#define MAX_LABELS      48
+#define MAX_REPLIES     64
+
+#define ACK     '\x06'
+#define NACK    '\x15'
+
+enum { CK_OFF=0, CK_ON };
+enum { EM_ON=0, EM_PROMPT, EM_QUIET, EM_DELAY };
+
+// MDrive error codes used by the emulator
+enum {
+    E_NOVAR = 20,
+    E_INVAL = 21,
+    E_WHAT = 24,
+    E_CLOBBER = 28,
+    E_NOLABEL = 30,
+    E_OVERRUN = 63,
+};
+
+struct emu_variable {
+    char                name[3];
+    bool                user;           // Declared with VA
+    bool                string;         // Value is text (DN, SN, ...)
+    int                 value;
+    char                text[24];
+};
+
+// Settings which survive (S)ave and are restored at reboot or IP
+struct emu_nvram {
+    struct emu_variable vars[MAX_VARIABLES];
+    int                 nvars;
+    char                labels[MAX_LABELS][3];
+    int                 nlabels;
+};
+
+struct emu_unit {
+    struct emu_nvram    ram;            // Working copy
+    struct emu_nvram    saved;          // Saved copy (NVRAM)
+
+    bool                error;          // Error flag is set
+    bool                programming;    // In program mode (PG 100)
+    bool                upgrade;        // In firmware upgrade mode
+    bool                upgrade_armed;  // UG received, enter at reboot
+    int                 records;        // Firmware records received
+    int                 max_baud;       // Fastest BD accepted (0 any)
+    int                 listening;      // BD in effect (since reboot)
+
+    // Motion state (steps)
+    bool                moving;
+    int                 pstart;
+    int                 ptarget;
+    int                 velocity;       // steps/sec, signed
+    bool                slewing;
+    struct timespec     start;
+
+    struct timespec     busy;           // Processing until
+};
+
+// Reply waiting for its unit to finish processing or for the wire
+struct emu_output {
+    char                data[256];
+    int                 length, pos;
+    struct timespec     due;
+};
+
+struct emu_reply {
+    char                data[128];
+    int                 length;
+    bool                has_data;       // Reply to PR
+    bool                error;
+};
+
+static struct {
+    int                 master, slave;
+    char                name[64];
+    const char *        link;
+
+    struct emu_unit     units[MAX_UNITS];
+    int                 count;
+
+    int                 baud;           // 0 for no pacing, -1 for auto
+    long                latency_us;     // Processing time per command
+    double              nack_rate;
+    double              overrun_rate;
+    unsigned            seed;
+    int                 verbose;
+
+    // Transmit queue
+    struct emu_output   replies[MAX_REPLIES];
+    int                 head, pending;
+    struct timespec     now;            // Receipt of the current command
+    struct timespec     due;            // Completion of the current command
+    struct timespec     wire;           // Wire is busy until
+
+    // Statistics
+    unsigned long       lines, rxbytes, txbytes, nacks, overruns, dropped;
+} emu = {
+    .master = -1,
+    .slave = -1,
+    .baud = 0,
+    .seed = 1,
+};
+
+static volatile sig_atomic_t done = 0;
+
+static const struct {
+    const char *        name;
+    int                 value;
+    const char *        text;
+} defaults[] = {
+    { "A",  1000000, NULL },    { "D",  1000000, NULL },
+    { "VM", 768000, NULL },     { "VI", 1000, NULL },
+    { "SF", 15, NULL },         { "DB", 0, NULL },
+    { "RC", 25, NULL },         { "HC", 5, NULL },
+    { "MS", 256, NULL },        { "EE", 0, NULL },
+    { "DE", 1, NULL },          { "CK", CK_OFF, NULL },
+    { "EM", EM_ON, NULL },      { "BD", 96, NULL },
+    { "PY", 0, NULL },          { "ES", 0, NULL },
+    { "ER", 0, NULL },          { "ST", 0, NULL },
+    { "P",  0, NULL },          { "V",  0, NULL },
+    { "MV", 0, NULL },          { "VC", 0, NULL },
+    { "IT", 31, NULL },         { "EV", 0, NULL },
+    { "I1", 0, NULL },          { "I2", 0, NULL },
+    { "I3", 0, NULL },          { "I4", 0, NULL },
+    { "O1", 0, NULL },          { "O2", 0, NULL },
+    { "O3", 0, NULL },
+    { "R1", 0, NULL },          { "R2", 0, NULL },
+    { "R3", 0, NULL },          { "R4", 0, NULL },
+    { "S1", 0, "0,0,0" },       { "S2", 0, "0,0,0" },
+    { "S3", 0, "0,0,0" },       { "S4", 0, "0,0,0" },
+    { "S5", 0, "0,0" },
+    { "DN", 0, "!" },           { "SN", 0, NULL },
+    { "PN", 0, "MDI1FRD23A7-EQ" },
+    { "VR", 0, "3.013" },
+    { NULL, 0, NULL }
+};
+
+static int
+baud_to_setting(int baud) {
+    switch (baud) {
+        case 4800:      return 48;
+        case 9600:      return 96;
+        case 19200:     return 19;
+        case 38400:     return 38;
+        case 115200:    return 11;
+    }
+    return 0;
+}
+
+static int
+setting_to_baud(int setting) {
+    switch (setting) {
+        case 48:        return 4800;
+        case 96:        return 9600;
+        case 19:        return 19200;
+        case 38:        return 38400;
+        case 11:        return 115200;
+    }
+    return 0;
+}
+
+static int
+termios_to_baud(speed_t speed) {
+    switch (speed) {
+        case B4800:     return 4800;
+        case B9600:     return 9600;
+        case B19200:    return 19200;
+        case B38400:    return 38400;
+        case B115200:   return 115200;
+    }
+    return 0;
+}
+
+static char
+emu_checksum(const char * buffer, int length) {
+    unsigned char checksum = 0;
+    while (length--)
+        checksum += *buffer++;
+    return (~checksum + 1) | 128;
+}
+
+static bool
+chance(double rate) {
+    return rate > 0 && rand_r(&emu.seed) < rate * RAND_MAX;
+}
+
+static struct emu_variable *
+emu_var(struct emu_unit * unit, const char * name) {
+    for (int i=0; i<unit->ram.nvars; i++)
+        if (strcmp(unit->ram.vars[i].name, name) == 0)
+            return &unit->ram.vars[i];
+    return NULL;
+}
+
+static int
+emu_var_int(struct emu_unit * unit, const char * name) {
+    struct emu_variable * var = emu_var(unit, name);
+    return var ? var->value : 0;
+}
+
+static void
+emu_var_set(struct emu_unit * unit, const char * name, int value) {
+    struct emu_variable * var = emu_var(unit, name);
+    if (var)
+        var->value = value;
+}
+
+static char
+emu_address(struct emu_unit * unit) {
+    return emu_var(unit, "DN")->text[0];
+}
+
+static bool
+emu_party(struct emu_unit * unit) {
+    return emu_var_int(unit, "PY") != 0;
+}
+
+static void
+emu_unit_defaults(struct emu_unit * unit, char address, int index) {
+    struct emu_nvram * ram = &unit->ram;
+
+    memset(ram, 0, sizeof *ram);
+    for (int i=0; defaults[i].name; i++) {
+        struct emu_variable * var = &ram->vars[ram->nvars++];
+        snprintf(var->name, sizeof var->name, "%s", defaults[i].name);
+        var->value = defaults[i].value;
+        if (defaults[i].text) {
+            var->string = true;
+            snprintf(var->text, sizeof var->text, "%s", defaults[i].text);
+        }
+    }
+    struct emu_variable * sn = emu_var(unit, "SN");
+    sn->string = true;
+    snprintf(sn->text, sizeof sn->text, "%09d", 270000001 + index);
+
+    if (address && address != '!') {
+        snprintf(emu_var(unit, "DN")->text, 2, "%c", address);
+        emu_var_set(unit, "PY", 1);
+    }
+    if (emu.baud > 0)
+        emu_var_set(unit, "BD", baud_to_setting(emu.baud));
+
+    unit->saved = unit->ram;
+    unit->listening = emu_var_int(unit, "BD");
+}
+
+/**
+ * emu_position
+ *
+ * Updates the motion state of the unit to the current time. Motion is
+ * modeled at constant velocity (VM) which is good enough to exercise
+ * position polling and completion detection in the driver.
+ */
+static void
+emu_position(struct emu_unit * unit) {
+    if (!unit->moving)
+        return;
+
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    double elapsed = (now.tv_sec - unit->start.tv_sec)
+        + (now.tv_nsec - unit->start.tv_nsec) / 1e9;
+    long long travel = elapsed * unit->velocity;
+    int position;
+
+    if (unit->slewing)
+        position = unit->pstart + travel;
+    else if (llabs(travel) >= llabs((long long)unit->ptarget - unit->pstart)) {
+        position = unit->ptarget;
+        unit->moving = false;
+    }
+    else
+        position = unit->pstart + travel;
+
+    emu_var_set(unit, "P", position);
+    emu_var_set(unit, "V", unit->moving ? unit->velocity : 0);
+    emu_var_set(unit, "MV", unit->moving ? 1 : 0);
+}
+
+static void
+emu_move(struct emu_unit * unit, int target, bool slew, int rate) {
+    emu_position(unit);
+    unit->pstart = emu_var_int(unit, "P");
+    clock_gettime(CLOCK_MONOTONIC, &unit->start);
+
+    if (slew) {
+        unit->slewing = rate != 0;
+        unit->moving = rate != 0;
+        unit->velocity = rate;
+    }
+    else {
+        int vm = abs(emu_var_int(unit, "VM"));
+        unit->slewing = false;
+        unit->ptarget = target;
+        unit->velocity = (target < unit->pstart) ? -vm : vm;
+        unit->moving = target != unit->pstart && vm;
+    }
+    emu_position(unit);
+}
+
+static void
+emu_stop(struct emu_unit * unit) {
+    emu_position(unit);
+    unit->moving = unit->slewing = false;
+    emu_var_set(unit, "V", 0);
+    emu_var_set(unit, "MV", 0);
+}
+
+static bool
+emu_label_exists(struct emu_unit * unit, const char * name) {
+    for (int i=0; i<unit->ram.nlabels; i++)
+        if (strcmp(unit->ram.labels[i], name) == 0)
+            return true;
+    return false;
+}
+
+static int
+emu_print(struct emu_unit * unit, char * args, struct emu_reply * reply) {
+    char * item = args, name[4];
+    emu_position(unit);
+
+    while (*item) {
+        while (isspace(*item)) item++;
+
+        if (*item == '"') {
+            char * end = strchr(++item, '"');
+            if (!end)
+                return E_WHAT;
+            reply->length += snprintf(reply->data + reply->length,
+                sizeof reply->data - reply->length, "%.*s",
+                (int)(end - item), item);
+            item = end + 1;
+        }
+        else {
+            int len = 0;
+            while (isalnum(item[len])) len++;
+            if (len == 0 || len > 2)
+                return E_WHAT;
+            snprintf(name, sizeof name, "%.*s", len, item);
+            item += len;
+
+            struct emu_variable * var = emu_var(unit, name);
+            if (!var)
+                return E_NOVAR;
+            if (var->string)
+                reply->length += snprintf(reply->data + reply->length,
+                    sizeof reply->data - reply->length, "%s", var->text);
+            else
+                reply->length += snprintf(reply->data + reply->length,
+                    sizeof reply->data - reply->length, "%d", var->value);
+
+            // Reading the error code clears the error
+            if (strcmp(name, "ER") == 0) {
+                unit->error = false;
+                var->value = 0;
+            }
+        }
+        while (isspace(*item)) item++;
+        if (*item == ',')
+            item++;
+        else if (*item)
+            return E_WHAT;
+    }
+    reply->has_data = true;
+    return 0;
+}
+
+static int
+emu_assign(struct emu_unit * unit, char * name, char * value) {
+    struct emu_variable * var = emu_var(unit, name);
+    if (!var)
+        return E_NOVAR;
+
+    while (isspace(*value)) value++;
+
+    if (var->string) {
+        if (*value == '"')
+            snprintf(var->text, sizeof var->text, "%.*s",
+                (int)strcspn(value + 1, "\""), value + 1);
+        else if (strcmp(name, "DN") == 0 && isdigit(*value))
+            // DN = 97 assigns the ASCII char
+            snprintf(var->text, 2, "%c", atoi(value));
+        else
+            snprintf(var->text, sizeof var->text, "%s", value);
+        return 0;
+    }
+
+    char * end;
+    long number = strtol(value, &end, 10);
+    while (isspace(*end)) end++;
+    if (end == value || *end)
+        return E_INVAL;
+    if (strcmp(name, "BD") == 0 && (!setting_to_baud(number)
+            || (unit->max_baud && setting_to_baud(number) > unit->max_baud)))
+        return E_INVAL;
+
+    var->value = number;
+
+    if (strcmp(name, "P") == 0) {
+        unit->pstart = unit->ptarget = number;
+        emu_stop(unit);
+    }
+    else if (strcmp(name, "ER") == 0)
+        unit->error = number != 0;
+    else if (strcmp(name, "ST") == 0 && number == 0)
+        var->value = 0;
+    return 0;
+}
+
+static int
+emu_declare(struct emu_unit * unit, char * args) {
+    char name[4];
+    int len = 0;
+
+    while (isspace(*args)) args++;
+    while (isalnum(args[len])) len++;
+    if (len == 0 || len > 2)
+        return E_WHAT;
+    snprintf(name, sizeof name, "%.*s", len, args);
+
+    if (emu_var(unit, name))
+        return E_CLOBBER;
+    if (unit->ram.nvars == MAX_VARIABLES)
+        return E_WHAT;
+
+    struct emu_variable * var = &unit->ram.vars[unit->ram.nvars++];
+    *var = (struct emu_variable) { .user = true };
+    snprintf(var->name, sizeof var->name, "%.2s", name);
+
+    char * equals = strchr(args, '=');
+    if (equals)
+        var->value = strtol(equals + 1, NULL, 10);
+    return 0;
+}
+
+static void
+emu_clear_program(struct emu_unit * unit, const char * label) {
+    if (!label || !*label) {
+        unit->ram.nlabels = 0;
+        return;
+    }
+    for (int i=0; i<unit->ram.nlabels; i++) {
+        if (strcmp(unit->ram.labels[i], label) == 0) {
+            memmove(unit->ram.labels[i], unit->ram.labels[i+1],
+                (unit->ram.nlabels - i - 1) * sizeof unit->ram.labels[0]);
+            unit->ram.nlabels--;
+            return;
+        }
+    }
+}
+
+/**
+ * emu_execute
+ *
+ * Executes one MCode statement on the unit. The checksum and address, if
+ * any, have already been stripped from the command.
+ *
+ * Returns:
+ * (int) 0 upon success or the MDrive error code to be set on the unit
+ */
+static int
+emu_execute(struct emu_unit * unit, char * command, struct emu_reply * reply) {
+    char keyword[4] = "", * args;
+    int len = 0;
+
+    while (isspace(*command)) command++;
+    while (isalnum(command[len])) len++;
+    if (len > 2)
+        return E_WHAT;
+    snprintf(keyword, sizeof keyword, "%.*s", len, command);
+    for (char * k = keyword; *k; k++)
+        *k = toupper(*k);
+    args = command + len;
+    while (isspace(*args)) args++;
+
+    // In program mode, everything up to the closing PG is kept
+    if (unit->programming) {
+        if (strcmp(keyword, "PG") == 0)
+            unit->programming = false;
+        else if (strcmp(keyword, "LB") == 0) {
+            if (unit->ram.nlabels == MAX_LABELS)
+                return E_WHAT;
+            if (emu_label_exists(unit, args))
+                return E_CLOBBER;
+            snprintf(unit->ram.labels[unit->ram.nlabels++],
+                sizeof unit->ram.labels[0], "%.2s", args);
+        }
+        return 0;
+    }
+
+    if (*args == '=')
+        return emu_assign(unit, keyword, args + 1);
+
+    if (strcmp(keyword, "PR") == 0)
+        return emu_print(unit, args, reply);
+    else if (strcmp(keyword, "MA") == 0 || strcmp(keyword, "MR") == 0) {
+        char * end;
+        long steps = strtol(args, &end, 10);
+        if (end == args)
+            return E_WHAT;
+        emu_position(unit);
+        if (keyword[1] == 'R')
+            steps += emu_var_int(unit, "P");
+        emu_move(unit, steps, false, 0);
+    }
+    else if (strcmp(keyword, "SL") == 0)
+        emu_move(unit, 0, true, strtol(args, NULL, 10));
+    else if (strcmp(keyword, "EX") == 0) {
+        if (!emu_label_exists(unit, args))
+            return E_NOLABEL;
+    }
+    else if (strcmp(keyword, "VA") == 0)
+        return emu_declare(unit, args);
+    else if (strcmp(keyword, "CP") == 0)
+        emu_clear_program(unit, args);
+    else if (strcmp(keyword, "PG") == 0)
+        unit->programming = atoi(args) > 0;
+    else if (strcmp(keyword, "IP") == 0)
+        unit->ram = unit->saved;
+    else if (strcmp(keyword, "S") == 0)
+        unit->saved = unit->ram;
+    else if (strcmp(keyword, "FD") == 0) {
+        emu_unit_defaults(unit, '!', unit - emu.units);
+        emu_var_set(unit, "BD", 96);
+        unit->saved = unit->ram;
+    }
+    else if (strcmp(keyword, "UG") == 0)
+        unit->upgrade_armed = strtol(args, NULL, 10) == 2956102;
+    else if (strcmp(keyword, "ER") == 0 && !*args) {
+        unit->error = false;
+        emu_var_set(unit, "ER", 0);
+    }
+    else if (strcmp(keyword, "ST") == 0 && !*args)
+        emu_var_set(unit, "ST", 0);
+    else if (*keyword == 0 && *args == 0)
+        // Empty line
+        ;
+    else
+        return E_WHAT;
+
+    return 0;
+}
+
+static void
+ts_add_ns(struct timespec * ts, long long ns) {
+    ts->tv_sec += ns / 1000000000;
+    ts->tv_nsec += ns % 1000000000;
+    if (ts->tv_nsec >= 1000000000) {
+        ts->tv_nsec -= 1000000000;
+        ts->tv_sec++;
+    }
+}
+
+static long long
+ts_diff_ns(const struct timespec * a, const struct timespec * b) {
+    return (a->tv_sec - b->tv_sec) * 1000000000LL + (a->tv_nsec - b->tv_nsec);
+}
+
+/**
+ * emu_process
+ *
+ * Accounts for the processing time of the command received for the unit.
+ * A unit works through its commands one at a time, but the units process
+ * concurrently. The reply of the command is due when the unit is done.
+ */
+static void
+emu_process(struct emu_unit * unit) {
+    emu.due = (ts_diff_ns(&unit->busy, &emu.now) > 0) ? unit->busy : emu.now;
+    ts_add_ns(&emu.due, emu.latency_us * 1000LL);
+    unit->busy = emu.due;
+}
+
+static int
+emu_port_baud(void) {
+    struct termios tty;
+    if (tcgetattr(emu.master, &tty))
+        return 0;
+    return termios_to_baud(cfgetospeed(&tty));
+}
+
+/**
+ * emu_listening
+ *
+ * With -b auto, units configured (BD) at another speed than the one of
+ * the port only receive garbage. A new BD takes effect at reboot.
+ */
+static bool
+emu_listening(struct emu_unit * unit) {
+    if (emu.baud >= 0)
+        return true;
+    return baud_to_setting(emu_port_baud()) == unit->listening;
+}
+
+/**
+ * emu_write
+ *
+ * Schedules bytes to be sent back to the driver when the command being
+ * handled is finished processing (see emu_process).
+ */
+static void
+emu_write(const char * buffer, int length) {
+    if (emu.pending == MAX_REPLIES || length > sizeof emu.replies[0].data) {
+        emu.dropped++;
+        return;
+    }
+
+    struct emu_output * out =
+        &emu.replies[(emu.head + emu.pending++) % MAX_REPLIES];
+    memcpy(out->data, buffer, length);
+    out->length = length;
+    out->pos = 0;
+    out->due = emu.due;
+}
+
+/**
+ * emu_transmit
+ *
+ * Sends the replies which are due back to the driver, paced at the
+ * configured baud rate so that the driver observes realistic inter-byte
+ * timing. Replies are sent in the order they were scheduled.
+ *
+ * Returns:
+ * (long long) nanoseconds until the next byte is to be sent, or -1 if
+ * there is nothing left to send
+ */
+static long long
+emu_transmit(void) {
+    struct timespec now;
+    long long wait;
+
+    while (emu.pending) {
+        struct emu_output * out = &emu.replies[emu.head];
+        int baud = (emu.baud < 0) ? emu_port_baud() : emu.baud;
+
+        clock_gettime(CLOCK_MONOTONIC, &now);
+        wait = ts_diff_ns(&out->due, &now);
+        if (baud > 0)
+            wait = (wait > ts_diff_ns(&emu.wire, &now)) ? wait
+                : ts_diff_ns(&emu.wire, &now);
+        if (wait > 0)
+            return wait;
+
+        if (out->pos == 0 && emu.verbose > 1) {
+            fprintf(stderr, "TX:");
+            for (int i=0; i<out->length; i++)
+                fprintf(stderr, isprint(out->data[i]) ? " %c" : " %02x",
+                    (unsigned char) out->data[i]);
+            fprintf(stderr, "\n");
+        }
+
+        // 8N1 is ten bits on the wire per byte
+        int count = (baud > 0) ? 1 : out->length - out->pos;
+        int wr = write(emu.master, out->data + out->pos, count);
+        if (wr < 0 && errno != EINTR && errno != EAGAIN) {
+            // Driver is gone
+            emu.pending = 0;
+            break;
+        }
+        else if (wr > 0) {
+            out->pos += wr;
+            emu.txbytes += wr;
+            if (baud > 0) {
+                if (ts_diff_ns(&emu.wire, &now) < 0)
+                    emu.wire = now;
+                ts_add_ns(&emu.wire, 10LL * 1000000000 / baud);
+            }
+        }
+        if (out->pos == out->length) {
+            emu.head = (emu.head + 1) % MAX_REPLIES;
+            emu.pending--;
+        }
+    }
+    return -1;
+}
+
+/**
+ * emu_frame
+ *
+ * Frames the reply of a unit according to its communication settings.
+ * The echo of the received command uses the echo mode in effect when the
+ * command was received, while the rest of the response uses the settings
+ * in effect after the command was processed (like the real units).
+ */
+static void
+emu_frame(struct emu_unit * unit, int echo, const char * raw, int rawlen,
+        struct emu_reply * reply) {
+    char buffer[256];
+    int length = 0;
+    int checksum = emu_var_int(unit, "CK"), mode = emu_var_int(unit, "EM");
+
+    if (echo == EM_ON) {
+        memcpy(buffer, raw, rawlen);
+        length = rawlen;
+        buffer[length++] = '\r';
+        buffer[length++] = '\n';
+    }
+
+    if (checksum) {
+        buffer[length++] = reply->error ? NACK : ACK;
+        if (reply->has_data) {
+            memcpy(buffer + length, reply->data, reply->length);
+            length += reply->length;
+            buffer[length++] = emu_checksum(reply->data, reply->length);
+            buffer[length++] = '\r';
+            buffer[length++] = '\n';
+        }
+    }
+    else if (mode == EM_QUIET) {
+        if (reply->has_data) {
+            memcpy(buffer + length, reply->data, reply->length);
+            length += reply->length;
+            buffer[length++] = '\r';
+            buffer[length++] = '\n';
+        }
+    }
+    else {
+        memcpy(buffer + length, reply->data, reply->length);
+        length += reply->length;
+        buffer[length++] = '\r';
+        buffer[length++] = '\n';
+        buffer[length++] = reply->error ? '?' : '>';
+    }
+
+    if (length)
+        emu_write(buffer, length);
+}
+
+/**
+ * emu_unit_line
+ *
+ * Handles one line addressed to the unit. [command] is the line without
+ * the party address and terminator; [raw] is the line as received.
+ */
+static void
+emu_unit_line(struct emu_unit * unit, char * command, int length,
+        const char * raw, int rawlen, bool silent) {
+    struct emu_reply reply = { .length = 0 };
+    int echo = emu_var_int(unit, "EM"), status;
+    char text[128];
+
+    if (!emu_listening(unit)) {
+        // Unit is listening at a different speed, so this is garbage
+        emu.dropped++;
+        return;
+    }
+
+    if (length > 0 && (command[length-1] & 0x80)) {
+        // Checksum char. Units not in checksum mode just ignore it
+        if (emu_var_int(unit, "CK")
+                && emu_checksum(raw, rawlen-1) != raw[rawlen-1]) {
+            reply.error = true;
+            goto respond;
+        }
+        length--;
+    }
+    else if (emu_var_int(unit, "CK")) {
+        // Checksum missing
+        reply.error = true;
+        goto respond;
+    }
+
+    if (chance(emu.nack_rate)) {
+        // Line noise -- command not understood. Not in checksum mode, the
+        // unit just won't respond
+        emu.nacks++;
+        if (!emu_var_int(unit, "CK"))
+            return;
+        reply.error = true;
+        goto respond;
+    }
+
+    if (!unit->programming && chance(emu.overrun_rate)) {
+        emu.overruns++;
+        unit->error = true;
+        emu_var_set(unit, "ER", E_OVERRUN);
+        goto respond;
+    }
+
+    snprintf(text, sizeof text, "%.*s", length, command);
+    status = emu_execute(unit, text, &reply);
+    if (status) {
+        unit->error = true;
+        emu_var_set(unit, "ER", status);
+        reply.has_data = false;
+    }
+
+respond:
+    reply.error |= unit->error;
+    emu_process(unit);
+    if (!silent)
+        emu_frame(unit, echo, raw, rawlen, &reply);
+}
+
+/**
+ * emu_upgrade_line
+ *
+ * Units in firmware upgrade mode answer the magic codes and acknowledge
+ * each Intel-HEX record. Records with a bad checksum are refused.
+ */
+static void
+emu_upgrade_line(struct emu_unit * unit, const char * line, int length) {
+    char buffer[64];
+    int wr = 0;
+
+    if (length >= 3 && line[1] == ':') {
+        buffer[wr++] = ACK;
+        switch (line[2]) {
+            case 's':
+                wr += snprintf(buffer + wr, sizeof buffer - wr, "%s\r\n",
+                    emu_var(unit, "SN")->text);
+                break;
+            case 'v':
+                wr += snprintf(buffer + wr, sizeof buffer - wr, "03000D\r\n");
+                break;
+            case 'p':
+                wr += snprintf(buffer + wr, sizeof buffer - wr, "%s\r\n",
+                    emu_var(unit, "PN")->text);
+                break;
+        }
+    }
+    else if (strncmp(line, ":IMSInc", 7) == 0)
+        buffer[wr++] = ACK;
+    else {
+        // Intel-HEX record -- the sum of all bytes is zero
+        unsigned char sum = 0;
+        unsigned int byte;
+        for (int i=1; i + 1 < length; i += 2) {
+            if (sscanf(line + i, "%2x", &byte) != 1)
+                break;
+            sum += byte;
+        }
+        buffer[wr++] = (sum == 0) ? ACK : NACK;
+        unit->records++;
+    }
+    emu_process(unit);
+    emu_write(buffer, wr);
+}
+
+static void
+emu_reboot(struct emu_unit * unit) {
+    static const char banner[] =
+        "Copyright 2001-2010 by Intelligent Motion Systems, Inc.\r\n>";
+
+    emu_stop(unit);
+    unit->error = false;
+    unit->programming = false;
+
+    if (unit->upgrade && unit->records) {
+        // Firmware was flashed: unit is factory defaulted
+        unit->upgrade = false;
+        emu_unit_defaults(unit, '!', unit - emu.units);
+        emu_var_set(unit, "BD", 96);
+        unit->saved = unit->ram;
+    }
+    else if (unit->upgrade_armed) {
+        unit->upgrade = true;
+        unit->upgrade_armed = false;
+        unit->records = 0;
+    }
+    unit->ram = unit->saved;
+    unit->listening = emu_var_int(unit, "BD");
+    emu_var_set(unit, "P", 0);
+
+    emu_process(unit);
+
+    if (unit->upgrade)
+        emu_write("$", 1);
+    else if (!emu_party(unit))
+        emu_write(banner, sizeof banner - 1);
+}
+
+static struct emu_unit *
+emu_find_unit(char address) {
+    for (int i=0; i<emu.count; i++)
+        if (!emu.units[i].upgrade && emu_party(&emu.units[i])
+                && emu_address(&emu.units[i]) == address)
+            return &emu.units[i];
+    return NULL;
+}
+
+/**
+ * emu_control
+ *
+ * Handles the immediate control chars: escape (abort motion and
+ * programs) and ^C (reboot). The line received so far holds the party
+ * address, if any.
+ */
+static void
+emu_control(char ch, const char * line, int length) {
+    for (int i=0; i<emu.count; i++) {
+        struct emu_unit * unit = &emu.units[i];
+        bool global = length == 1 && line[0] == '*';
+
+        if (length == 1 && !global) {
+            if (!emu_party(unit) || emu_address(unit) != line[0])
+                continue;
+        }
+        else if (length == 0 && emu_party(unit) && !unit->upgrade
+                && !unit->upgrade_armed)
+            continue;
+        if (!emu_listening(unit))
+            continue;
+
+        if (ch == '\x03')
+            emu_reboot(unit);
+        else {
+            struct emu_reply reply = { .length = 0 };
+            emu_stop(unit);
+            if (!global)
+                emu_frame(unit, EM_PROMPT, NULL, 0, &reply);
+        }
+    }
+}
+
+static void
+emu_dispatch(char * line, int length) {
+    char raw[160];
+    struct emu_unit * unit;
+
+    emu.lines++;
+    if (emu.verbose)
+        fprintf(stderr, "RX: %.*s\n", length, line);
+
+    int rawlen = snprintf(raw, sizeof raw, "%.*s", length, line);
+
+    // Units in upgrade mode have the address ':'
+    for (int i=0; i<emu.count; i++) {
+        if (emu.units[i].upgrade && line[0] == ':') {
+            emu_upgrade_line(&emu.units[i], line, length);
+            return;
+        }
+    }
+
+    if (line[0] == '*') {
+        for (int i=0; i<emu.count; i++)
+            if (emu_party(&emu.units[i]))
+                emu_unit_line(&emu.units[i], line + 1, length - 1, raw,
+                    rawlen, true);
+        return;
+    }
+
+    if ((unit = emu_find_unit(line[0]))) {
+        emu_unit_line(unit, line + 1, length - 1, raw, rawlen, false);
+        return;
+    }
+
+    // Units not in party mode consider all the traffic
+    for (int i=0; i<emu.count; i++)
+        if (!emu_party(&emu.units[i]) && !emu.units[i].upgrade)
+            emu_unit_line(&emu.units[i], line, length, raw, rawlen, false);
+}
+
+static void
+emu_receive(const char * buffer, int length) {
+    static char line[160];
+    static int pos = 0;
+    static bool skip_checksum = false;
+
+    emu.rxbytes += length;
+
+    // Replies to commands without processing time are due right away
+    clock_gettime(CLOCK_MONOTONIC, &emu.now);
+    emu.due = emu.now;
+
+    while (length--) {
+        char ch = *buffer++;
+
+        if (ch == '\x1b' || ch == '\x03') {
+            emu_control(ch, line, pos);
+            pos = 0;
+            skip_checksum = true;
+            continue;
+        }
+        else if (skip_checksum && (ch & 0x80)) {
+            // Checksum of a raw control command
+            skip_checksum = false;
+            continue;
+        }
+        skip_checksum = false;
+
+        if (ch == '\r' || ch == '\n') {
+            if (pos)
+                emu_dispatch(line, pos);
+            pos = 0;
+        }
+        else if (pos < sizeof line - 1)
+            line[pos++] = ch;
+    }
+}
+
+static int
+emu_open(void) {
+    emu.master = posix_openpt(O_RDWR | O_NOCTTY);
+    if (emu.master < 0 || grantpt(emu.master) || unlockpt(emu.master))
+        return -1;
+
+    snprintf(emu.name, sizeof emu.name, "%s", ptsname(emu.master));
+
+    // Keep the slave open so that the master does not see EIO (hangup)
+    // between connections from the driver
+    emu.slave = open(emu.name, O_RDWR | O_NOCTTY);
+    if (emu.slave < 0)
+        return -1;
+
+    struct termios tty;
+    tcgetattr(emu.slave, &tty);
+    cfmakeraw(&tty);
+    cfsetispeed(&tty, B9600);
+    cfsetospeed(&tty, B9600);
+    tcsetattr(emu.slave, TCSANOW, &tty);
+
+    if (emu.link) {
+        unlink(emu.link);
+        if (symlink(emu.name, emu.link)) {
+            perror("symlink");
+            return -1;
+        }
+    }
+    return 0;
+}
+
+static void
+emu_report(void) {
+    fprintf(stderr, "lines=%lu rxbytes=%lu txbytes=%lu nacks=%lu "
+        "overruns=%lu dropped=%lu\n", emu.lines, emu.rxbytes, emu.txbytes,
+        emu.nacks, emu.overruns, emu.dropped);
+}
+
+static void
+on_signal(int signal) {
+    done = 1;
+}
+
+static void
+usage(const char * name) {
+    fprintf(stderr,
+        "Usage: %s [options]\n"
+        "  -a <addrs>   Party-mode addresses of emulated units (eg. abc).\n"
+        "               Default is one unit not in party mode\n"
+        "  -b <baud>    Pace output at <baud>, or 'auto' for the speed set\n"
+        "               on the port by the driver. Default is no pacing\n"
+        "  -c <0|1>     Initial checksum mode (CK)\n"
+        "  -e <0-2>     Initial echo mode (EM)\n"
+        "  -l <usec>    Processing latency of each command\n"
+        "  -m <a:baud>  Fastest speed (BD) accepted by the units at the\n"
+        "               addresses before the colon (eg. bc:38400)\n"
+        "  -N <rate>    Probability of an injected NACK\n"
+        "  -O <rate>    Probability of an injected error 63 (overrun)\n"
+        "  -s <seed>    Seed for fault injection\n"
+        "  -L <path>    Create a symlink to the slave device\n"
+        "  -v           Verbose (twice to trace output bytes)\n", name);
+}
+
+int main(int argc, char * argv[]) {
+    const char * addresses = "!", * limits[MAX_UNITS];
+    int opt, ck = -1, em = -1, nlimits = 0;
+
+    while ((opt = getopt(argc, argv, "a:b:c:e:l:m:N:O:s:L:vh")) != -1) {
+        switch (opt) {
+            case 'a': addresses = optarg; break;
+            case 'b':
+                emu.baud = (strcmp(optarg, "auto") == 0) ? -1 : atoi(optarg);
+                break;
+            case 'c': ck = atoi(optarg); break;
+            case 'e': em = atoi(optarg); break;
+            case 'l': emu.latency_us = atol(optarg); break;
+            case 'm':
+                if (nlimits < MAX_UNITS)
+                    limits[nlimits++] = optarg;
+                break;
+            case 'N': emu.nack_rate = atof(optarg); break;
+            case 'O': emu.overrun_rate = atof(optarg); break;
+            case 's': emu.seed = strtoul(optarg, NULL, 10); break;
+            case 'L': emu.link = optarg; break;
+            case 'v': emu.verbose++; break;
+            default:
+                usage(argv[0]);
+                return 1;
+        }
+    }
+
+    for (const char * a = addresses; *a && emu.count < MAX_UNITS; a++) {
+        struct emu_unit * unit = &emu.units[emu.count];
+        emu_unit_defaults(unit, *a, emu.count);
+        if (ck >= 0) emu_var_set(unit, "CK", ck);
+        if (em >= 0) emu_var_set(unit, "EM", em);
+        unit->saved = unit->ram;
+        for (int i=0; i<nlimits; i++) {
+            const char * colon = strchr(limits[i], ':');
+            if (colon && memchr(limits[i], *a, colon - limits[i]))
+                unit->max_baud = atoi(colon + 1);
+        }
+        emu.count++;
+    }
+
+    if (emu_open()) {
+        perror("Unable to open pseudo-terminal");
+        return 1;
+    }
+
+    signal(SIGINT, on_signal);
+    signal(SIGTERM, on_signal);
+
+    // Output is paced with poll() timeouts, which are otherwise allowed to
+    // run late by 50us (several char times at 115200)
+    prctl(PR_SET_TIMERSLACK, 1);
+
+    printf("%s\n", emu.name);
+    fflush(stdout);
+
+    char buffer[256];
+    struct pollfd pfd = { .fd = emu.master, .events = POLLIN };
+    while (!done) {
+        long long wait = emu_transmit();
+        struct timespec timeout = { .tv_nsec = 250000000 };
+        if (wait >= 0)
+            timeout = (struct timespec) { .tv_sec = wait / 1000000000,
+                .tv_nsec = wait % 1000000000 };
+        if (ppoll(&pfd, 1, &timeout, NULL) < 1)
+            continue;
+        int length = read(emu.master, buffer, sizeof buffer);
+        if (length < 0 && errno != EINTR && errno != EAGAIN)
+            break;
+        else if (length > 0)
+            emu_receive(buffer, length);
+    }
+
+    emu_report();
+    if (emu.link)
+        unlink(emu.link);
+    return 0;
+}
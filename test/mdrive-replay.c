@@ -0,0 +1,303 @@
+/*
+ * mdrive-replay.c
+ *
+ * Replays the traffic captured from a port (see drivers/mdrive/capture.h)
+ * through the response parser and classifier of the driver. The bytes
+ * read from the port are fed to mdrive_process_response() in the chunks
+ * they were received in, and each response is classified as the unit
+ * would have it classified, without talking to any unit.
+ *
+ * The capture is replayed at its original pace, or [speed] times faster.
+ * A speed of zero replays as fast as possible and reports the throughput
+ * of the parser -- to benchmark it against production traffic:
+ *
+ *   ./mdrive-replay [-v] [-s speed] capture
+ *
+ * With -v, each transfer and response is printed as replayed.
+ */
+#include "../drivers/mdrive/mdrive.h"
+#include "../drivers/mdrive/capture.h"
+#include "../drivers/mdrive/config.h"
+#include "../drivers/mdrive/serial.h"
+
+#include <fcntl.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+extern int mdrive_classify_response(mdrive_device_t *, mdrive_response_t *);
+
+static const char * classes[] = {
+    [RESPONSE_OK] = "ok",
+    [RESPONSE_RETRY] = "retry",
+    [RESPONSE_ERROR] = "error",
+    [RESPONSE_NACK] = "nack",
+    [RESPONSE_BAD_CHECKSUM] = "bad-checksum",
+    [RESPONSE_UNKNOWN] = "unknown",
+    [RESPONSE_TIMEOUT] = "timeout",
+    [RESPONSE_IOERROR] = "ioerror",
+};
+
+// A transfer reassembled from its records
+struct transfer {
+    uint64_t            time;
+    unsigned            txid;
+    char                address;
+    int                 length;
+    char                data[512];
+};
+
+static bool verbose = false;
+static unsigned long responses = 0, by_class[RESPONSE_IOERROR + 1];
+
+static void
+print_bytes(const char * data, int length) {
+    for (; length--; data++) {
+        if (*data >= 0x20 && *data < 0x7f && *data != '\\')
+            putchar(*data);
+        else if (*data == '\r')
+            printf("\\r");
+        else if (*data == '\n')
+            printf("\\n");
+        else
+            printf("\\x%02x", (unsigned char) *data);
+    }
+}
+
+static void
+print_transfer(const char * kind, struct transfer * transfer, uint64_t start) {
+    printf("%12.6f %-5s %c #%-6u ", (transfer->time - start) / 1e9, kind,
+        transfer->address ? transfer->address : '-', transfer->txid);
+    print_bytes(transfer->data, transfer->length);
+    printf("\n");
+}
+
+/**
+ * append
+ *
+ * Adds a record to the transfer it is part of.
+ *
+ * Returns:
+ * (bool) TRUE if the transfer is complete
+ */
+static bool
+append(struct transfer * transfer, struct mdrive_capture_record * record) {
+    int length = record->length;
+
+    if (transfer->length == 0) {
+        transfer->time = record->time;
+        transfer->txid = record->txid;
+        transfer->address = record->address;
+    }
+    if (length > sizeof transfer->data - transfer->length)
+        length = sizeof transfer->data - transfer->length;
+    memcpy(transfer->data + transfer->length, record->data, length);
+    transfer->length += length;
+
+    return !(record->flags & MDRIVE_CAPTURE_MORE);
+}
+
+/**
+ * deliver
+ *
+ * Classifies a completed response, as the transaction receiving it would.
+ */
+static void
+deliver(mdrive_device_t * device, mdrive_response_t * response) {
+    int class;
+
+    response->buffer[response->length] = 0;
+    responses++;
+    class = response->event ? RESPONSE_OK
+        : mdrive_classify_response(device, response);
+    by_class[class]++;
+    if (verbose) {
+        printf("%12s %-5s %s%s '", "", "->",
+            response->event ? "event " : "", classes[class]);
+        print_bytes(response->buffer, response->length);
+        printf("'\n");
+    }
+    *response = (mdrive_response_t) { };
+}
+
+static double
+elapsed(struct timespec * begin) {
+    struct timespec end;
+
+    clock_gettime(CLOCK_MONOTONIC, &end);
+    return (end.tv_sec - begin->tv_sec) + (end.tv_nsec - begin->tv_nsec) / 1e9;
+}
+
+int main(int argc, char * argv[]) {
+    double speed = 1;
+    int option;
+
+    while ((option = getopt(argc, argv, "vs:")) != -1) {
+        switch (option) {
+            case 'v':
+                verbose = true;
+                break;
+            case 's':
+                speed = atof(optarg);
+                break;
+            default:
+                optind = argc;
+        }
+    }
+    if (optind != argc - 1 || speed < 0) {
+        fprintf(stderr, "Usage: %s [-v] [-s speed] capture\n", argv[0]);
+        return 1;
+    }
+
+    int fd = open(argv[optind], O_RDONLY);
+    struct stat info;
+    if (fd < 0 || fstat(fd, &info)) {
+        fprintf(stderr, "Unable to open %s\n", argv[optind]);
+        return 1;
+    }
+    struct mdrive_capture_header * header = mmap(NULL, info.st_size,
+        PROT_READ, MAP_SHARED, fd, 0);
+    if (header == MAP_FAILED || info.st_size < sizeof *header
+            || memcmp(header->magic, MDRIVE_CAPTURE_MAGIC, sizeof header->magic)
+            || header->record_size != sizeof (struct mdrive_capture_record)
+            || info.st_size < sizeof *header
+                + (off_t) header->slots * header->record_size) {
+        fprintf(stderr, "%s is not a capture\n", argv[optind]);
+        return 1;
+    }
+    struct mdrive_capture_record * records =
+        (struct mdrive_capture_record *) (header + 1), * record;
+
+    // The ring holds the last [slots] records written
+    uint64_t next = header->next, number = 0, start = 0;
+    if (next > header->slots)
+        number = next - header->slots;
+
+    // Responses are classified against a unit in the checksum mode of the
+    // last request sent
+    mdrive_device_t device = { .offline = true, .ignore_errors = true };
+    mdrive_response_t response = { };
+    struct transfer tx = { }, rx = { }, match = { };
+    char buffer[512], * load = buffer, * process = buffer;
+    mdrive_comm_device_t port = { };
+    unsigned long records_replayed = 0, lost = 0, bytes_tx = 0,
+        bytes_rx = 0, matched = 0, dropped = 0;
+    uint64_t last_rx = 0;
+    struct timespec begin, parse_begin;
+    double parse_time = 0;
+    int class;
+
+    printf("capture of %s: %llu records, %u in the ring\n", header->port,
+        (unsigned long long) next, header->slots);
+
+    clock_gettime(CLOCK_MONOTONIC, &begin);
+    for (; number < next; number++) {
+        record = &records[number % header->slots];
+        if (record->number != number + 1) {
+            // Overwritten while replaying, or never completed
+            lost++;
+            continue;
+        }
+        records_replayed++;
+        if (start == 0)
+            start = record->time;
+
+        // Keep to the pace of the capture
+        if (speed > 0) {
+            double due = (record->time - start) / 1e9 / speed
+                - elapsed(&begin);
+            if (due > 0)
+                nanosleep(&(struct timespec) { .tv_sec = (time_t) due,
+                    .tv_nsec = (due - (time_t) due) * 1e9 }, NULL);
+        }
+
+        switch (record->kind) {
+            case MDRIVE_CAPTURE_TX:
+                if (!append(&tx, record))
+                    break;
+                bytes_tx += tx.length;
+                device.checksum = CK_OFF;
+                for (int i = 0; i < tx.length; i++)
+                    if (tx.data[i] & 0x80)
+                        device.checksum = CK_ON;
+                if (verbose)
+                    print_transfer("tx", &tx, start);
+                tx.length = 0;
+                break;
+
+            case MDRIVE_CAPTURE_RX:
+                if (!append(&rx, record))
+                    break;
+                bytes_rx += rx.length;
+
+                // The line went idle in the middle of a response
+                port.speed = record->speed;
+                if (response.received && record->time - last_rx
+                        > mdrive_frame_idle_time(&port)) {
+                    if (response.length || response.error)
+                        deliver(&device, &response);
+                    response = (mdrive_response_t) { };
+                    process = load = buffer;
+                }
+                last_rx = record->time;
+                if (verbose)
+                    print_transfer("rx", &rx, start);
+
+                // As mdrive_async_read() does
+                if (rx.length > sizeof buffer - 1 - (load - buffer)) {
+                    response = (mdrive_response_t) { };
+                    process = load = buffer;
+                }
+                memcpy(load, rx.data, rx.length);
+                load += rx.length;
+                *load = 0;
+                rx.length = 0;
+
+                clock_gettime(CLOCK_MONOTONIC, &parse_begin);
+                while (process < load) {
+                    process += mdrive_process_response(process, &response,
+                        load - process);
+                    if ((response.length == 0
+                                && (response.ack || response.nack))
+                            || response.processed) {
+                        if (process == load)
+                            process = load = buffer;
+                        deliver(&device, &response);
+                    }
+                }
+                parse_time += elapsed(&parse_begin);
+                break;
+
+            case MDRIVE_CAPTURE_MATCH:
+                if (!append(&match, record))
+                    break;
+                if (match.txid)
+                    matched++;
+                else
+                    dropped++;
+                if (verbose)
+                    print_transfer(match.txid ? "match" : "drop", &match,
+                        start);
+                match.length = 0;
+                break;
+        }
+    }
+
+    printf("replayed %lu records (%lu lost) in %.3fs: tx %lu bytes, "
+        "rx %lu bytes\n", records_replayed, lost, elapsed(&begin), bytes_tx,
+        bytes_rx);
+    printf("responses %lu (matched %lu, dropped %lu):", responses, matched,
+        dropped);
+    for (class = 0; class <= RESPONSE_IOERROR; class++)
+        if (by_class[class])
+            printf(" %s %lu", classes[class], by_class[class]);
+    printf("\n");
+    if (parse_time > 0)
+        printf("parser: %.1f MB/s, %.2fM responses/s\n",
+            bytes_rx / parse_time / (1 << 20), responses / parse_time / 1e6);
+
+    munmap(header, info.st_size);
+    close(fd);
+    return 0;
+}
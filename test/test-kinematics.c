@@ -0,0 +1,128 @@
+/*
+ * test-kinematics.c
+ *
+ * Checks the trapezoidal motion planned by the driver (kinematics.c) over
+ * a sweep of profiles and distances -- moves which reach the maximum
+ * velocity and moves which do not:
+ *
+ *   ./test-kinematics
+ *
+ * Returns non-zero if any check fails.
+ */
+#include "../drivers/mdrive/kinematics.h"
+
+#include <errno.h>
+#include <math.h>
+#include <stdbool.h>
+#include <stdio.h>
+
+static int failures, checks;
+
+#define CHECK(cond, ...) do {                       \
+    checks++;                                       \
+    if (!(cond)) {                                  \
+        failures++;                                 \
+        fprintf(stderr, __VA_ARGS__);               \
+        fputc('\n', stderr);                        \
+    }                                               \
+} while (0)
+
+static bool
+near(double a, double b, double scale) {
+    return fabs(a - b) <= 1e-6 * fmax(1, fabs(scale));
+}
+
+static void
+check_plan(double distance, double vstart, double vmax, double accel,
+        double decel) {
+    kinematics_t plan;
+    const int samples = 1000;
+
+    if (kinematics_plan(&plan, distance, vstart, vmax, accel, decel)) {
+        CHECK(0, "plan(%g, %g, %g, %g, %g) failed", distance, vstart, vmax,
+            accel, decel);
+        return;
+    }
+
+    CHECK(plan.vpeak <= vmax * (1 + 1e-12), "vpeak %g above vmax %g",
+        plan.vpeak, vmax);
+    CHECK(0 <= plan.t_peak && plan.t_peak <= plan.t_decel
+        && plan.t_decel <= plan.t_rest, "times out of order for %g",
+        distance);
+    CHECK(near(kinematics_position(&plan, plan.t_rest), fabs(distance),
+        distance), "position at rest is not the distance %g", distance);
+    CHECK(near(kinematics_position(&plan, plan.t_rest * (1 - 1e-12)),
+        fabs(distance), distance), "position jumps at rest for %g",
+        distance);
+    CHECK(kinematics_time_to_rest(&plan, 0) == plan.t_rest
+        && kinematics_time_to_rest(&plan, plan.t_rest * 2) == 0,
+        "time to rest is wrong for %g", distance);
+
+    double dt = plan.t_rest / samples, last = 0;
+    for (int i=1; i<=samples; i++) {
+        double t = i * dt, x = kinematics_position(&plan, t),
+            v = kinematics_velocity(&plan, t - dt / 2);
+
+        CHECK(x >= last, "position goes back at %g for %g", t, distance);
+        CHECK(v >= 0 && v <= plan.vpeak * (1 + 1e-12),
+            "velocity %g out of range at %g for %g", v, t, distance);
+        // Over each sample the velocity is linear (or the sample spans a
+        // corner of the trapezoid), so the mid-point velocity gives the
+        // travel exactly, save for the corners
+        if (!(t > plan.t_peak && t - dt < plan.t_peak)
+                && !(t > plan.t_decel && t - dt < plan.t_decel))
+            CHECK(near(x - last, v * dt, distance),
+                "velocity %g does not match travel %g at %g for %g", v,
+                (x - last) / dt, t, distance);
+        last = x;
+    }
+
+    // Stopping from any velocity reached takes the unit as far as the
+    // remaining deceleration of the plan
+    double v = kinematics_velocity(&plan, plan.t_decel);
+    CHECK(near(kinematics_stopping_distance(&plan, v),
+        fabs(distance) - kinematics_position(&plan, plan.t_decel), distance),
+        "stopping distance is off for %g", distance);
+    CHECK(near(kinematics_stopping_time(&plan, v),
+        plan.t_rest - plan.t_decel, plan.t_rest),
+        "stopping time is off for %g", distance);
+    CHECK(kinematics_stopping_time(&plan, plan.vstart) == 0
+        && kinematics_stopping_distance(&plan, -plan.vstart / 2) == 0,
+        "stopping from the initial velocity is not immediate");
+}
+
+int main(int argc, char * argv[]) {
+    const double distances[] = { 1, 100, 1e3, 12345, 1e5, 1e6, 25e6, 1e9 },
+        vstarts[] = { 0, 1e3, 1e5, 2e6 },
+        vmaxs[] = { 1e4, 768e3, 2e6, 5e6 },
+        rates[] = { 1e3, 1e5, 1.5e6, 1e7 };
+
+    for (unsigned i=0; i<sizeof distances / sizeof *distances; i++)
+    for (unsigned j=0; j<sizeof vstarts / sizeof *vstarts; j++)
+    for (unsigned k=0; k<sizeof vmaxs / sizeof *vmaxs; k++)
+    for (unsigned a=0; a<sizeof rates / sizeof *rates; a++)
+    for (unsigned d=0; d<sizeof rates / sizeof *rates; d++) {
+        check_plan(distances[i], vstarts[j], vmaxs[k], rates[a], rates[d]);
+        check_plan(-distances[i], vstarts[j], vmaxs[k], rates[a], rates[d]);
+    }
+
+    // Planned by hand: 1 rev at VM 1 rev/s, A = D = 2 rev/s^2, VI = 0 takes
+    // 0.5s up, 0.5s at VM and 0.5s down
+    kinematics_t plan;
+    kinematics_plan(&plan, 1e6, 0, 1e6, 2e6, 2e6);
+    CHECK(near(plan.t_peak, .5, 1) && near(plan.t_decel, 1, 1)
+        && near(plan.t_rest, 1.5, 1), "1 rev move takes %g, %g, %g",
+        plan.t_peak, plan.t_decel, plan.t_rest);
+    // And an eighth of a rev never reaches VM: up to 0.5 rev/s in 0.25s
+    kinematics_plan(&plan, 125e3, 0, 1e6, 2e6, 2e6);
+    CHECK(near(plan.vpeak, 5e5, 1e6) && near(plan.t_rest, .5, 1),
+        "1/8 rev move peaks at %g, rests at %g", plan.vpeak, plan.t_rest);
+
+    CHECK(kinematics_plan(&plan, 1, 0, 0, 1, 1) == EINVAL
+        && kinematics_plan(&plan, 1, 0, 1, -1, 1) == EINVAL
+        && kinematics_plan(&plan, 1, 0, 1, 1, 0) == EINVAL,
+        "invalid profile accepted");
+
+    printf("%d checks, %d failed\n", checks, failures);
+    return failures ? 1 : 0;
+}